@@ -3,6 +3,22 @@
 //
 
 #include "Game.h"
+#include "../common/Config.h"
+#include <chrono>
+#include <iomanip>
+#include <vector>
+
+// waits for the async init jobs however Init is left (an exception included), they decrement the counters it owns
+struct PendingInitJobs
+{
+    std::vector<JobCounter*> counters;
+
+    ~PendingInitJobs()
+    {
+        for (JobCounter* counter : counters)
+            JobSystem::Wait(*counter);
+    }
+};
 
 /*
  * Methods
@@ -11,11 +27,61 @@ void Game::Init(EngineConfig* pConfig)
 {
     // init engine systems
     Logger::Init();
-    SceneSystem::Init();
-    Window::Init(pConfig);
-    AudioEngine::Init();
-    Input::Init();
-    EngineRenderer::Init();
+    JobSystem::Init();
+
+    // CPU benchmarks run before anything touches the window or the GPU
+    if (Benchmarks::RunConfigured() && Config::ShouldExitAfterBenchmarks())
+    {
+        bBenchmarkOnly = true;
+        return;
+    }
+
+    // independent subsystems initialize on the job system while the main thread does the GLFW work
+    JobCounter audioCounter;
+    JobCounter shaderCounter;
+    JobCounter deviceCounter;
+    PendingInitJobs pendingJobs{{ &audioCounter, &shaderCounter, &deviceCounter }};
+
+    if (!Config::IsHeadless()) // no audio output on headless (benchmarking) machines
+        initTimings.MeasureAsync("Audio", AudioEngine::Init, audioCounter);
+    initTimings.MeasureAsync("Shader Reads", []() {
+        JobCounter readCounter;
+        Shader::Preload(GpuCulling::GetShaderFiles(), &readCounter);
+        Shader::Preload(SceneRenderer::GetShaderFiles(), &readCounter);
+        JobSystem::Wait(readCounter);
+    }, shaderCounter);
+
+    // the SIMD math kernels are checked against the scalar path once, up front
+    initTimings.Measure("Math Self Check", []() { BatchMath::GetVerifiedLevel(); });
+    initTimings.Measure("Scene", SceneSystem::Init);
+    initTimings.Measure("Window", [pConfig]() { Window::Init(pConfig); });
+
+    // the instance needs GLFW's extensions, the surface and device need the window
+    initTimings.MeasureAsync("Vulkan Instance", VulkanDevice::CreateInstance, deviceCounter);
+    initTimings.Measure("Input", Input::Init);
+    initTimings.Measure("Frame Scheduler", FrameScheduler::Init);
+    initTimings.Measure("Frame Pacer", FramePacer::Init);
+
+    // the renderer creates the culling pipelines from the preloaded shaders, they must all be read by then
+    JobSystem::Wait(deviceCounter);
+    JobSystem::Wait(shaderCounter);
+    initTimings.RethrowFailure();
+    initTimings.Measure("Renderer", EngineRenderer::Init);
+    renderQueueDrawSet = CommandBufferCache::CreateDrawSet("Render Queue", [](VkCommandBuffer commandBuffer) {
+        RenderQueue::Record(commandBuffer, RENDER_QUEUE_PASS_MAIN);
+    });
+    if (Config::IsGpuCullingTestSceneEnabled())
+        initTimings.Measure("GPU Culling Test Scene", []() {
+            GpuCulling::CreateTestScene(Config::GetGpuCullingTestObjectCount());
+        });
+    if (Config::IsSceneTestSceneEnabled())
+        initTimings.Measure("Scene Test Scene", []() {
+            SceneRenderer::CreateTestScene(Config::GetSceneTestObjectCount());
+        });
+
+    JobSystem::Wait(audioCounter);
+    initTimings.RethrowFailure();
+    initTimings.Report();
 //    Renderer::Init(GraphicsBackend::VULKAN);
 //    EditorInterface::Init();
 //    CGeforceNow::Init();
@@ -23,10 +89,68 @@ void Game::Init(EngineConfig* pConfig)
 
 void Game::Run()
 {
+    if (bBenchmarkOnly)
+        return;
+
+    if (Window::IsHeadless())
+    {
+        RunHeadless();
+        return;
+    }
+
     Window::UpdateFPSInTitle(0.0f);
 
+    // the render thread records frame N - 1 while we simulate frame N
+    bool bRenderThread = Config::IsRenderThreadEnabled();
+    if (bRenderThread)
+        RenderThread::Start([this](const RenderPacket& packet) { Draw(packet); });
+
+    RenderPacket localPacket; // without a render thread, packets are drawn right away
+
+    FixedTimestep timestep(Config::GetSimulationTickRate(), Config::GetMaxCatchUpTicks());
+    auto previousFrameStart = RenderPacket::Clock::now();
+    RenderPacket::Clock::time_point frameStart;
+    double elapsed = 0.0;
+
+    // the frame's work, independent tasks (audio and the rest) run at the same time
+    FrameScheduler::RegisterTask("Window Events", 0, FRAME_RESOURCE_INPUT, []() {
+        Window::Update();
+        glfwPollEvents();
+    }, true);
+    FrameScheduler::RegisterTask("Audio", 0, FRAME_RESOURCE_AUDIO, AudioEngine::Update);
+    FrameScheduler::RegisterTask("Simulation", FRAME_RESOURCE_INPUT, FRAME_RESOURCE_SCENE, [&]() {
+        Simulate(timestep, elapsed);
+    });
+    // recorded right here without a render thread, which has to be on the main thread like the swap chain's GLFW calls
+    FrameScheduler::RegisterTask("Render Extraction", FRAME_RESOURCE_SCENE, FRAME_RESOURCE_RENDER, [&]() {
+        auto renderStart = RenderPacket::Clock::now();
+        if (bRenderThread)
+        {
+            BuildRenderPacket(RenderThread::BeginPacket(), frameStart, timestep);
+            RenderThread::PublishPacket();
+        }
+        else
+        {
+            localPacket.Reset();
+            BuildRenderPacket(localPacket, frameStart, timestep);
+            Draw(localPacket);
+        }
+        renderStats.AddSample(std::chrono::duration<double, std::milli>(RenderPacket::Clock::now() - renderStart).count());
+    }, !bRenderThread);
+
     while(!Window::ShouldCloseWindow())
     {
+        // NOTE: In low latency mode this waits until just before the predicted GPU slot, so input is sampled late.
+        //       With a render thread, the render thread paces the presents and the game thread follows it.
+        if (bRenderThread)
+            FramePacer::BeginGameFrame();
+        else
+            FramePacer::BeginFrame();
+
+        frameStart = RenderPacket::Clock::now();
+        elapsed = std::chrono::duration<double>(frameStart - previousFrameStart).count();
+        previousFrameStart = frameStart;
+
         double currentTime = Window::GetTime();
         double delta = currentTime - previousTime;
         frameCount++;
@@ -41,37 +165,214 @@ void Game::Run()
             previousTime = currentTime;
         }
 
-        Window::Update();
-        glfwPollEvents();
+        FrameScheduler::Run();
 
-//        Draw();
+        // frame rate limiter (with a render thread, it limits the render thread and this only measures the frame)
+        if (bRenderThread)
+            FramePacer::EndGameFrame();
+        else
+            FramePacer::EndFrame();
 
-        AudioEngine::Update();
+        // increment the frame number
+        frames++;
+        FrameMark;
+    }
+
+    RenderThread::Stop();
+    ReportTimings(timestep, bRenderThread ? "Render extraction" : "Render");
+    FrameScheduler::ReportStatistics();
+}
+
+void Game::RunHeadless()
+{
+    uint32_t frameCount = Config::GetHeadlessFrameCount();
+    uint32_t readbackInterval = Config::GetHeadlessReadbackInterval();
+
+    Logger::Info("Running " + std::to_string(frameCount) + " headless frames");
+
+    FrameStatistics frameStats;
+    auto previousFrameTime = std::chrono::steady_clock::now();
+
+    // rendered right away on this thread, so every headless frame shows exactly the simulated frame
+    RenderPacket packet;
+
+    // one tick per frame, whatever the frame time, so headless runs see the same simulation every time
+    FixedTimestep timestep(Config::GetSimulationTickRate(), Config::GetMaxCatchUpTicks());
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        // captured asynchronously, the image is written to disk a few frames later by a worker thread
+        if (readbackInterval > 0 && (i + 1) % readbackInterval == 0)
+        {
+            std::stringstream ss;
+            ss << "headless_frame_" << std::setw(5) << std::setfill('0') << i << ".png";
+            FrameCapture::RequestCapture(ss.str());
+        }
+
+        auto frameStart = std::chrono::steady_clock::now();
+        Simulate(timestep, timestep.GetTickDuration());
+
+        auto renderStart = std::chrono::steady_clock::now();
+        packet.Reset();
+        BuildRenderPacket(packet, frameStart, timestep);
+        Draw(packet);
+        renderStats.AddSample(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count());
+
+        auto currentFrameTime = std::chrono::steady_clock::now();
+        frameStats.AddSample(std::chrono::duration<double, std::milli>(currentFrameTime - previousFrameTime).count());
+
+        previousFrameTime = currentFrameTime;
 
         // increment the frame number
         frames++;
         FrameMark;
     }
+
+    EngineRenderer::WaitIdle();
+    frameStats.Report("Headless");
+    ReportTimings(timestep, "Render");
+
+    const auto& queueStats = RenderQueue::GetFrameStatistics();
+    if (queueStats.draws > 0)
+        Logger::Info("Render queue: " + std::to_string(queueStats.draws) + " draws, " +
+                     std::to_string(queueStats.pipelineBinds) + " pipeline binds, " +
+                     std::to_string(queueStats.descriptorSetBinds) + " descriptor set binds, " +
+                     std::to_string(queueStats.vertexBufferBinds + queueStats.indexBufferBinds) + " buffer binds, " +
+                     std::to_string(queueStats.skippedBinds) + " redundant binds skipped in the last frame");
+
+    const auto& sceneStats = SceneRenderer::GetLastStatistics();
+    if (sceneStats.meshes > 0)
+        Logger::Info("Scene: " + std::to_string(sceneStats.draws) + "/" + std::to_string(sceneStats.meshes) +
+                     " meshes drawn in the last frame, " + std::to_string(sceneStats.inFrustum) + " in the frustum, " +
+                     std::to_string(sceneStats.occluded) + " hidden by " + std::to_string(sceneStats.occluders) +
+                     " occluders");
+
+    if (GpuCulling::GetObjectCount() > 0)
+        Logger::Info("GPU culling: " + std::to_string(GpuCulling::GetLastVisibleCount()) + "/" +
+                     std::to_string(GpuCulling::GetObjectCount()) + " objects visible in the last frame");
+}
+
+void Game::Simulate(FixedTimestep &timestep, double fElapsedSeconds)
+{
+    uint32_t ticks = timestep.Advance(fElapsedSeconds);
+    for (uint32_t i = 0; i < ticks; i++)
+    {
+        auto tickStart = std::chrono::steady_clock::now();
+        Tick(timestep.GetTickDuration());
+        tickStats.AddSample(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tickStart).count());
+    }
+}
+
+void Game::Tick(double fDeltaTime)
+{
+    ZoneScoped;
+
+    // the renderer blends between the last two states
+    previousState = currentState;
+    currentState.time += fDeltaTime;
+
+    SceneSystem::Update(fDeltaTime);
+}
+
+void Game::BuildRenderPacket(RenderPacket &packet, RenderPacket::Clock::time_point simulationStart,
+                             const FixedTimestep &timestep)
+{
+    float alpha = timestep.GetAlpha();
+
+    packet.frame = frames;
+    packet.tick = timestep.GetTickCount();
+    packet.interpolationAlpha = alpha;
+    packet.time = previousState.time + (currentState.time - previousState.time) * alpha;
+    packet.simulationStart = simulationStart;
+
+    // NOTE: This may run on a worker while the render thread draws, so it must not touch the swap chain or the GPU
+    //       culling objects (only the test scenes' cameras, which read the published aspect ratio)
+    if (GpuCulling::HasTestScene())
+        packet.viewProjection = GpuCulling::GetTestSceneViewProjection(packet.time);
+    else if (SceneRenderer::HasTestScene())
+        packet.viewProjection = SceneRenderer::GetTestSceneViewProjection(packet.time);
+
+    // the render thread submits these to the render queue
+    SceneRenderer::Extract(packet);
+}
+
+void Game::ReportTimings(const FixedTimestep &timestep, const std::string &sRenderName)
+{
+    // reported apart, since the simulation runs at the tick rate and the rendering at the frame rate
+    tickStats.Report("Simulation tick");
+    renderStats.Report(sRenderName);
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3) << "Simulation: " << timestep.GetTickCount() << " ticks of "
+       << timestep.GetTickDuration() * 1000.0 << " ms over " << frames << " frames, " << timestep.GetClampedFrames()
+       << " frames hit the catch-up limit (" << timestep.GetDroppedTime() * 1000.0 << " ms dropped)";
+    Logger::Info(ss.str());
 }
 
-void Game::Draw()
+void Game::Draw(const RenderPacket &packet)
 {
     // REVIEW: Does the editor draws BEFORE or AFTER the gamne?
 //    EditorInterface::Draw();
 //    Renderer::Draw();
+    if (auto commandBuffer = EngineRenderer::BeginFrame())
+    {
+        const glm::mat4& viewProjection = packet.viewProjection;
+
+        for (const auto& draw : packet.draws)
+            RenderQueue::Submit(draw, draw.pushConstantSize > 0 ? &packet.pushConstants[draw.pushConstantOffset] : nullptr,
+                                draw.pushConstantSize);
+
+        if (GpuCulling::GetObjectCount() > 0)
+        {
+            GPU_PROFILE_SCOPE(commandBuffer, "Culling");
+            GpuCulling::Cull(commandBuffer, viewProjection);
+        }
+
+        {
+            GPU_PROFILE_SCOPE(commandBuffer, "Main Pass");
+
+            // the culled objects are replayed as they were recorded, the queue's draws change every frame
+            CommandBufferCache::InvalidateDrawSet(renderQueueDrawSet);
+            mainPassDrawSets.clear();
+            if (GpuCulling::GetDrawSet() != CommandBufferCache::INVALID_DRAW_SET)
+                mainPassDrawSets.push_back(GpuCulling::GetDrawSet());
+            mainPassDrawSets.push_back(renderQueueDrawSet);
+
+            EngineRenderer::BeginSwapChainRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            CommandBufferCache::Execute(commandBuffer, mainPassDrawSets);
+            EngineRenderer::EndSwapChainRenderPass(commandBuffer);
+        }
+        EngineRenderer::EndFrame();
+
+        if (!bFirstFrameDrawn)
+        {
+            bFirstFrameDrawn = true;
+            Logger::Info("Time to first frame: " + std::to_string(initTimings.GetElapsedMilliseconds()) + " ms");
+        }
+    }
 }
 
 void Game::Cleanup()
 {
+    if (bBenchmarkOnly)
+    {
+        JobSystem::Shutdown();
+        return;
+    }
+
     // destroy engine systems
 //    CGeforceNow::Shutdown();
     SceneSystem::Shutdown();
     EngineRenderer::Shutdown();
+    FramePacer::Shutdown();
+    FrameScheduler::Shutdown();
 //    EditorInterface::Shutdown();
 //    Renderer::Shutdown();
     Input::Shutdown();
-    AudioEngine::Shutdown();
+    if (!Window::IsHeadless())
+        AudioEngine::Shutdown();
     Window::Shutdown();
+    JobSystem::Shutdown();
 }
 
 
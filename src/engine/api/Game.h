@@ -7,26 +7,72 @@
 
 #include <Tracy.hpp>
 #include <string>
+#include <vector>
 #include "../common/structs.h"
+#include "../common/BatchMath.h"
+#include "../common/FixedTimestep.h"
+#include "../common/FrameScheduler.h"
+#include "../common/JobSystem.h"
 #include "../audio/AudioEngine.h"
 #include "../input/Input.h"
 #include "../rendering/Window.h"
 #include "../rendering/Renderer.h"
+#include "../rendering/CommandBufferCache.h"
 #include "../rendering/EngineRenderer.h"
+#include "../rendering/FrameCapture.h"
+#include "../rendering/FramePacer.h"
+#include "../rendering/GpuCulling.h"
+#include "../rendering/RenderQueue.h"
+#include "../rendering/RenderThread.h"
+#include "../rendering/SceneRenderer.h"
+#include "../rendering/Shader.h"
+#include "../rendering/VulkanDevice.h"
 #include "../gui/EditorInterface.h"
 #include "../profiling/Logger.h"
+#include "../profiling/Benchmarks.h"
+#include "../profiling/FrameStatistics.h"
+#include "../profiling/GpuProfiler.h"
+#include "../profiling/InitTimings.h"
 #include "../scenes/SceneSystem.h"
 #include "../sdks/GeforceNow.h"
 
+// what the simulation produces every tick, the renderer interpolates between the last two
+// NOTE: Entities keep their own previous state (PreviousTransform), blended when the scene is extracted
+struct SimulationState
+{
+    double time = 0.0; // drives the test scene cameras
+};
+
 class Game
 {
 public:
     void Init(EngineConfig* pConfig); // initializes everything in the engine
     void Run();  // main loop
-    void Draw(); // draw loop
+    void Draw(const RenderPacket& packet); // draw loop, on the render thread when there's one
     void Cleanup(); // shuts down the engine
 
 private:
+    void RunHeadless(); // renders a fixed number of offscreen frames and reports frame times
+    void Simulate(FixedTimestep& timestep, double fElapsedSeconds); // runs the fixed ticks the elapsed time adds up to
+    void Tick(double fDeltaTime); // one fixed simulation step
+    void BuildRenderPacket(RenderPacket& packet, RenderPacket::Clock::time_point simulationStart,
+                           const FixedTimestep& timestep); // what the renderer needs from the frame
+    void ReportTimings(const FixedTimestep& timestep, const std::string& sRenderName);
+
+    bool bBenchmarkOnly = false; // only the configured benchmarks ran, the engine was never initialized
+
+    InitTimings initTimings;        // per subsystem, and time-to-first-frame
+    bool bFirstFrameDrawn = false;
+
+    // the main pass is made of draw sets (see CommandBufferCache), the render queue is recorded into one every frame
+    uint32_t renderQueueDrawSet = CommandBufferCache::INVALID_DRAW_SET;
+    std::vector<uint32_t> mainPassDrawSets;
+
+    SimulationState previousState;
+    SimulationState currentState;
+    FrameStatistics tickStats;      // CPU time per simulation tick
+    FrameStatistics renderStats;    // CPU time rendering (or building the packet, with a render thread) per frame
+
     int frames = 0;
     int frameCount = 0;
     double previousTime = glfwGetTime();
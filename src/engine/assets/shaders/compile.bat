@@ -1,3 +1,7 @@
 glslc shader.vert -o vert.spv
 glslc shader.frag -o frag.spv
+glslc indirect.vert -o indirect.vert.spv
+glslc indirect.frag -o indirect.frag.spv
+glslc mesh.vert -o mesh.vert.spv
+glslc cull.comp -o cull.comp.spv
 pause
\ No newline at end of file
@@ -0,0 +1,32 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+struct ObjectData {
+    mat4 transform;
+    vec4 boundingSphere;
+    uint firstIndex;
+    uint indexCount;
+    int vertexOffset;
+    uint padding;
+};
+
+layout (std430, binding = 0) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+// one buffer per frame in flight, so the recorded draws never have to change
+layout (binding = 1) uniform Camera {
+    mat4 viewProjection;
+} camera;
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in vec2 inTexCoord;
+
+layout (location = 0) out vec3 fragColor;
+
+void main() {
+    // the culling pass stores the object index as the draw's first instance
+    gl_Position = camera.viewProjection * objects[gl_InstanceIndex].transform * vec4(inPosition, 1.0);
+    fragColor = inColor;
+}
@@ -0,0 +1,19 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// one draw per scene mesh, the render queue pushes these with every draw
+layout (push_constant) uniform Mesh {
+    mat4 modelViewProjection;
+    vec4 color;
+} mesh;
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in vec2 inTexCoord;
+
+layout (location = 0) out vec3 fragColor;
+
+void main() {
+    gl_Position = mesh.modelViewProjection * vec4(inPosition, 1.0);
+    fragColor = inColor * mesh.color.rgb;
+}
@@ -5,6 +5,8 @@
 #include "AudioEngine.h"
 #include "../profiling/Profiler.h"
 #include "../profiling/Logger.h"
+#include "../common/Config.h"
+#include <sstream>
 
 CAudioEngineImpl* mImplementation = nullptr;
 
@@ -56,6 +58,23 @@ void AudioEngine::Init()
     Logger::Info("Initializing audio engine");
     PROFILE_FUNCTION();
     mImplementation = new CAudioEngineImpl;
+
+    // banks listed in the config ([Audio] Banks, comma separated), a missing one shouldn't keep the engine from starting
+    std::stringstream ss(Config::GetAudioBanks());
+    std::string sBankName;
+    while (std::getline(ss, sBankName, ','))
+    {
+        if (sBankName.empty())
+            continue;
+
+        try
+        {
+            LoadBank(sBankName, FMOD_STUDIO_LOAD_BANK_NORMAL);
+        } catch (const std::runtime_error&)
+        {
+            Logger::Warn("Could not load audio bank " + sBankName);
+        }
+    }
 }
 
 void AudioEngine::Update()
@@ -68,6 +87,7 @@ void AudioEngine::Shutdown()
 {
     Logger::Info("Shutting down audio engine");
     PROFILE_FUNCTION();
+    mImplementation->mSoundPool.ReportStatistics();
     delete mImplementation;
 }
 
@@ -82,12 +102,12 @@ int AudioEngine::ErrorCheck(FMOD_RESULT result)
     return 0;
 }
 
-void AudioEngine::LoadSound(const std::string &sSoundName, bool b3d, bool bLooping, bool bStream)
+SoundHandle AudioEngine::LoadSound(const std::string &sSoundName, bool b3d, bool bLooping, bool bStream)
 {
     // check if the sound is loaded
     auto tFoundIt = mImplementation->mSounds.find(sSoundName);
     if (tFoundIt != mImplementation->mSounds.end())
-        return;
+        return tFoundIt->second;
 
     FMOD_MODE eMode = FMOD_DEFAULT;
     eMode |= b3d ? FMOD_3D : FMOD_2D;
@@ -97,10 +117,12 @@ void AudioEngine::LoadSound(const std::string &sSoundName, bool b3d, bool bLoopi
     // load the sound
     FMOD::Sound* sound = nullptr;
     AudioEngine::ErrorCheck(mImplementation->mSystem->createSound(sSoundName.c_str(), eMode, nullptr, &sound));
-    if (sound)
-    {
-        mImplementation->mSounds[sSoundName] = sound;
-    }
+    if (!sound)
+        return {};
+
+    SoundHandle handle = mImplementation->mSoundPool.Create(SoundResource{sSoundName, sound});
+    mImplementation->mSounds[sSoundName] = handle;
+    return handle;
 }
 
 void AudioEngine::UnLoadSound(const std::string &sSoundName)
@@ -110,35 +132,47 @@ void AudioEngine::UnLoadSound(const std::string &sSoundName)
     if (foundIt == mImplementation->mSounds.end())
         return;
 
+    UnLoadSound(foundIt->second);
+}
+
+void AudioEngine::UnLoadSound(SoundHandle pSound)
+{
+    SoundResource* resource = mImplementation->mSoundPool.Get(pSound);
+    if (!resource)
+        return;
+
     // unload the sound
-    AudioEngine::ErrorCheck(foundIt->second->release());
-    mImplementation->mSounds.erase(foundIt);
+    AudioEngine::ErrorCheck(resource->sound->release());
+    mImplementation->mSounds.erase(resource->name);
+    mImplementation->mSoundPool.Destroy(pSound);
 }
 
 int AudioEngine::PlaySoundFile(const std::string &sSoundName, const Vector3 &vPosition, float fVolumedB)
 {
-    // check if the sound is loaded
+    // the sound is loaded (as 3d) if it's not yet
+    return PlaySoundFile(LoadSound(sSoundName, true), vPosition, fVolumedB);
+}
+
+int AudioEngine::PlaySoundFile(SoundHandle pSound, const Vector3 &vPosition, float fVolumedB)
+{
     int channelId = mImplementation->mNextChannelId++;
-    auto foundIt = mImplementation->mSounds.find(sSoundName);
 
-    // the sound is not loaded, so we load it
-    if (foundIt == mImplementation->mSounds.end())
-    {
-        LoadSound(sSoundName, true);
-        foundIt = mImplementation->mSounds.find(sSoundName);
-        if (foundIt == mImplementation->mSounds.end())
-        {
-            return channelId;
-        }
-    }
+    // the sound could not be loaded
+    if (pSound.IsNull())
+        return channelId;
+
+    // check if the sound is loaded
+    SoundResource* resource = mImplementation->mSoundPool.Get(pSound);
+    if (!resource)
+        return channelId;
 
     // play the sound in a new created channel
     FMOD::Channel* channel = nullptr;
-    AudioEngine::ErrorCheck(mImplementation->mSystem->playSound(foundIt->second, nullptr, true, &channel));
+    AudioEngine::ErrorCheck(mImplementation->mSystem->playSound(resource->sound, nullptr, true, &channel));
     if (channel)
     {
         FMOD_MODE currMode;
-        foundIt->second->getMode(&currMode);
+        resource->sound->getMode(&currMode);
 
         // if the sound is in 3d space, we set its 3d attributes in fmod
         if (currMode & FMOD_3D)
@@ -12,6 +12,7 @@
 #include <vector>
 #include <math.h>
 #include <iostream>
+#include "../common/HandlePool.h"
 
 struct Vector3
 {
@@ -20,6 +21,14 @@ struct Vector3
     float z;
 };
 
+struct SoundResource
+{
+    std::string name;
+    FMOD::Sound* sound = nullptr;
+};
+
+typedef THandle<SoundResource> SoundHandle;
+
 // using the pimpl idiom
 struct CAudioEngineImpl
 {
@@ -35,12 +44,13 @@ struct CAudioEngineImpl
 
     typedef std::map<std::string, FMOD::Studio::Bank*> BankMap;
     typedef std::map<std::string, FMOD::Studio::EventInstance*> EventMap;
-    typedef std::map<std::string, FMOD::Sound*> SoundMap;
+    typedef std::map<std::string, SoundHandle> SoundMap;
     typedef std::map<int, FMOD::Channel*> ChannelMap;
 
     BankMap mBanks;
     EventMap mEvents;
-    SoundMap mSounds;
+    SoundMap mSounds; // by name, only used when loading, playing goes through the handle
+    THandlePool<SoundResource> mSoundPool{"Sound"};
     ChannelMap mChannels;
 };
 
@@ -52,15 +62,20 @@ public:
     static void Shutdown();
     static int ErrorCheck(FMOD_RESULT result);
 
-    void LoadSound(const std::string& sSoundName, bool b3d = false, bool bLooping = false, bool bStream = false);
+    // returns the handle of the sound when it's already loaded, a null handle when it can't be loaded
+    SoundHandle LoadSound(const std::string& sSoundName, bool b3d = false, bool bLooping = false, bool bStream = false);
     void UnLoadSound(const std::string& sSoundName);
+    void UnLoadSound(SoundHandle pSound);
+    // loads the sound the first time it's played
     int PlaySoundFile(const std::string& sSoundName, const Vector3& vPosition = Vector3{0,0,0}, float fVolumedB = 0.0f);
+    // does nothing (and returns the channel id anyway) for a stale handle
+    int PlaySoundFile(SoundHandle pSound, const Vector3& vPosition = Vector3{0,0,0}, float fVolumedB = 0.0f);
     bool IsPlaying(int nChannelId);
 
     void SetChannel3dPosition(int nChannelId, const Vector3& vPosition);
     void SetChannelVolume(int nChannelId, float fVolumedB);
 
-    void LoadBank(const std::string& sBankName, FMOD_STUDIO_LOAD_BANK_FLAGS pflags);
+    static void LoadBank(const std::string& sBankName, FMOD_STUDIO_LOAD_BANK_FLAGS pflags);
 
     void LoadEvent(const std::string& sEventName);
     void PlayEvent(const std::string& sEventName);
@@ -0,0 +1,818 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "BatchMath.h"
+#include "../profiling/Logger.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <Tracy.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+// NOTE: Every kernel adds its products in the order glm does, without FMA:
+//       matrix * matrix column ((a0 * b0 + a1 * b1) + a2 * b2) + a3 * b3
+//       matrix * point (m0 * x + m1 * y) + (m2 * z + m3)
+//       so all of them agree bit for bit
+
+void TransformArrays::Resize(uint32_t count)
+{
+    for (auto* array : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scaleX,
+                         &scaleY, &scaleZ })
+        array->resize(count);
+}
+
+void PointArrays::Resize(uint32_t count)
+{
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+}
+
+//
+// Scalar kernels
+//
+
+void ComposeTransformScalar(const TransformArrays& transforms, uint32_t i, glm::mat4& result)
+{
+    float x = transforms.rotationX[i];
+    float y = transforms.rotationY[i];
+    float z = transforms.rotationZ[i];
+    float w = transforms.rotationW[i];
+
+    float xx = x * x;
+    float yy = y * y;
+    float zz = z * z;
+    float xz = x * z;
+    float xy = x * y;
+    float yz = y * z;
+    float wx = w * x;
+    float wy = w * y;
+    float wz = w * z;
+
+    float sx = transforms.scaleX[i];
+    float sy = transforms.scaleY[i];
+    float sz = transforms.scaleZ[i];
+
+    result[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * sx, (2.0f * (xy + wz)) * sx, (2.0f * (xz - wy)) * sx, 0.0f);
+    result[1] = glm::vec4((2.0f * (xy - wz)) * sy, (1.0f - 2.0f * (xx + zz)) * sy, (2.0f * (yz + wx)) * sy, 0.0f);
+    result[2] = glm::vec4((2.0f * (xz + wy)) * sz, (2.0f * (yz - wx)) * sz, (1.0f - 2.0f * (xx + yy)) * sz, 0.0f);
+    result[3] = glm::vec4(transforms.positionX[i], transforms.positionY[i], transforms.positionZ[i], 1.0f);
+}
+
+void ComposeTransformsScalar(const TransformArrays& transforms, uint32_t begin, uint32_t end, glm::mat4* result)
+{
+    for (uint32_t i = begin; i < end; i++)
+        ComposeTransformScalar(transforms, i, result[i]);
+}
+
+// aStride is 0 when every b is multiplied by the same a
+void MultiplyMatricesScalar(const glm::mat4* a, uint32_t aStride, const glm::mat4* b, glm::mat4* result, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const glm::mat4& left = a[i * aStride];
+        const glm::mat4& right = b[i];
+
+        glm::mat4 product;
+        for (int column = 0; column < 4; column++)
+            for (int row = 0; row < 4; row++)
+                product[column][row] = ((left[0][row] * right[column][0] + left[1][row] * right[column][1]) +
+                                        left[2][row] * right[column][2]) + left[3][row] * right[column][3];
+        result[i] = product;
+    }
+}
+
+void TransformPointsScalar(const glm::mat4& m, const PointArrays& points, PointArrays& result, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        float x = points.x[i];
+        float y = points.y[i];
+        float z = points.z[i];
+        result.x[i] = (m[0][0] * x + m[1][0] * y) + (m[2][0] * z + m[3][0]);
+        result.y[i] = (m[0][1] * x + m[1][1] * y) + (m[2][1] * z + m[3][1]);
+        result.z[i] = (m[0][2] * x + m[1][2] * y) + (m[2][2] * z + m[3][2]);
+    }
+}
+
+// the center is transformed as a point, the extents by the absolute rotation and scale (Arvo's method)
+void TransformBoxesScalar(const glm::mat4& m, const BoundingBoxes& boxes, BoundingBoxes& result, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        float x = boxes.centerX[i];
+        float y = boxes.centerY[i];
+        float z = boxes.centerZ[i];
+        float ex = boxes.extentX[i];
+        float ey = boxes.extentY[i];
+        float ez = boxes.extentZ[i];
+
+        result.centerX[i] = (m[0][0] * x + m[1][0] * y) + (m[2][0] * z + m[3][0]);
+        result.centerY[i] = (m[0][1] * x + m[1][1] * y) + (m[2][1] * z + m[3][1]);
+        result.centerZ[i] = (m[0][2] * x + m[1][2] * y) + (m[2][2] * z + m[3][2]);
+        result.extentX[i] = (std::abs(m[0][0]) * ex + std::abs(m[1][0]) * ey) + std::abs(m[2][0]) * ez;
+        result.extentY[i] = (std::abs(m[0][1]) * ex + std::abs(m[1][1]) * ey) + std::abs(m[2][1]) * ez;
+        result.extentZ[i] = (std::abs(m[0][2]) * ex + std::abs(m[1][2]) * ey) + std::abs(m[2][2]) * ez;
+    }
+}
+
+#if SIMD_X86
+
+//
+// SSE4.1 kernels
+//
+
+// r0..r3 hold the rows of one column for 4 objects, written as that column of each object's matrix
+SIMD_TARGET_SSE41 inline void StoreColumnSse41(glm::mat4* result, int column, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+{
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(&result[0][column][0], r0);
+    _mm_storeu_ps(&result[1][column][0], r1);
+    _mm_storeu_ps(&result[2][column][0], r2);
+    _mm_storeu_ps(&result[3][column][0], r3);
+}
+
+SIMD_TARGET_SSE41 void ComposeTransformsSse41(const TransformArrays& transforms, uint32_t begin, uint32_t end, glm::mat4* result)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&transforms.rotationX[i]);
+        __m128 y = _mm_loadu_ps(&transforms.rotationY[i]);
+        __m128 z = _mm_loadu_ps(&transforms.rotationZ[i]);
+        __m128 w = _mm_loadu_ps(&transforms.rotationW[i]);
+
+        __m128 xx = _mm_mul_ps(x, x);
+        __m128 yy = _mm_mul_ps(y, y);
+        __m128 zz = _mm_mul_ps(z, z);
+        __m128 xz = _mm_mul_ps(x, z);
+        __m128 xy = _mm_mul_ps(x, y);
+        __m128 yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x);
+        __m128 wy = _mm_mul_ps(w, y);
+        __m128 wz = _mm_mul_ps(w, z);
+
+        __m128 sx = _mm_loadu_ps(&transforms.scaleX[i]);
+        __m128 sy = _mm_loadu_ps(&transforms.scaleY[i]);
+        __m128 sz = _mm_loadu_ps(&transforms.scaleZ[i]);
+
+        StoreColumnSse41(result + i, 0,
+                         _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+                         zero);
+        StoreColumnSse41(result + i, 1,
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                         _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+                         zero);
+        StoreColumnSse41(result + i, 2,
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                         _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+                         zero);
+        StoreColumnSse41(result + i, 3,
+                         _mm_loadu_ps(&transforms.positionX[i]),
+                         _mm_loadu_ps(&transforms.positionY[i]),
+                         _mm_loadu_ps(&transforms.positionZ[i]),
+                         one);
+    }
+
+    ComposeTransformsScalar(transforms, i, end, result);
+}
+
+SIMD_TARGET_SSE41 void MultiplyMatricesSse41(const glm::mat4* a, uint32_t aStride, const glm::mat4* b, glm::mat4* result, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float* left = &a[i * aStride][0][0];
+        const float* right = &b[i][0][0];
+
+        __m128 a0 = _mm_loadu_ps(left);
+        __m128 a1 = _mm_loadu_ps(left + 4);
+        __m128 a2 = _mm_loadu_ps(left + 8);
+        __m128 a3 = _mm_loadu_ps(left + 12);
+
+        // every column is done before storing, so the result can be one of the inputs
+        __m128 columns[4];
+        for (int column = 0; column < 4; column++)
+        {
+            __m128 b = _mm_loadu_ps(right + column * 4);
+            __m128 sum = _mm_mul_ps(a0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+            columns[column] = sum;
+        }
+
+        float* product = &result[i][0][0];
+        for (int column = 0; column < 4; column++)
+            _mm_storeu_ps(product + column * 4, columns[column]);
+    }
+}
+
+SIMD_TARGET_SSE41 void TransformPointsSse41(const glm::mat4& m, const PointArrays& points, PointArrays& result, uint32_t begin, uint32_t end)
+{
+    __m128 m00 = _mm_set1_ps(m[0][0]), m01 = _mm_set1_ps(m[0][1]), m02 = _mm_set1_ps(m[0][2]);
+    __m128 m10 = _mm_set1_ps(m[1][0]), m11 = _mm_set1_ps(m[1][1]), m12 = _mm_set1_ps(m[1][2]);
+    __m128 m20 = _mm_set1_ps(m[2][0]), m21 = _mm_set1_ps(m[2][1]), m22 = _mm_set1_ps(m[2][2]);
+    __m128 m30 = _mm_set1_ps(m[3][0]), m31 = _mm_set1_ps(m[3][1]), m32 = _mm_set1_ps(m[3][2]);
+
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&points.x[i]);
+        __m128 y = _mm_loadu_ps(&points.y[i]);
+        __m128 z = _mm_loadu_ps(&points.z[i]);
+
+        _mm_storeu_ps(&result.x[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m10, y)), _mm_add_ps(_mm_mul_ps(m20, z), m30)));
+        _mm_storeu_ps(&result.y[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, x), _mm_mul_ps(m11, y)), _mm_add_ps(_mm_mul_ps(m21, z), m31)));
+        _mm_storeu_ps(&result.z[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, x), _mm_mul_ps(m12, y)), _mm_add_ps(_mm_mul_ps(m22, z), m32)));
+    }
+
+    TransformPointsScalar(m, points, result, i, end);
+}
+
+SIMD_TARGET_SSE41 void TransformBoxesSse41(const glm::mat4& m, const BoundingBoxes& boxes, BoundingBoxes& result, uint32_t begin, uint32_t end)
+{
+    __m128 m00 = _mm_set1_ps(m[0][0]), m01 = _mm_set1_ps(m[0][1]), m02 = _mm_set1_ps(m[0][2]);
+    __m128 m10 = _mm_set1_ps(m[1][0]), m11 = _mm_set1_ps(m[1][1]), m12 = _mm_set1_ps(m[1][2]);
+    __m128 m20 = _mm_set1_ps(m[2][0]), m21 = _mm_set1_ps(m[2][1]), m22 = _mm_set1_ps(m[2][2]);
+    __m128 m30 = _mm_set1_ps(m[3][0]), m31 = _mm_set1_ps(m[3][1]), m32 = _mm_set1_ps(m[3][2]);
+
+    __m128 a00 = _mm_set1_ps(std::abs(m[0][0])), a01 = _mm_set1_ps(std::abs(m[0][1])), a02 = _mm_set1_ps(std::abs(m[0][2]));
+    __m128 a10 = _mm_set1_ps(std::abs(m[1][0])), a11 = _mm_set1_ps(std::abs(m[1][1])), a12 = _mm_set1_ps(std::abs(m[1][2]));
+    __m128 a20 = _mm_set1_ps(std::abs(m[2][0])), a21 = _mm_set1_ps(std::abs(m[2][1])), a22 = _mm_set1_ps(std::abs(m[2][2]));
+
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&boxes.centerX[i]);
+        __m128 y = _mm_loadu_ps(&boxes.centerY[i]);
+        __m128 z = _mm_loadu_ps(&boxes.centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+        __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+        __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+        _mm_storeu_ps(&result.centerX[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m10, y)), _mm_add_ps(_mm_mul_ps(m20, z), m30)));
+        _mm_storeu_ps(&result.centerY[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, x), _mm_mul_ps(m11, y)), _mm_add_ps(_mm_mul_ps(m21, z), m31)));
+        _mm_storeu_ps(&result.centerZ[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, x), _mm_mul_ps(m12, y)), _mm_add_ps(_mm_mul_ps(m22, z), m32)));
+        _mm_storeu_ps(&result.extentX[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(a00, ex), _mm_mul_ps(a10, ey)), _mm_mul_ps(a20, ez)));
+        _mm_storeu_ps(&result.extentY[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(a01, ex), _mm_mul_ps(a11, ey)), _mm_mul_ps(a21, ez)));
+        _mm_storeu_ps(&result.extentZ[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(a02, ex), _mm_mul_ps(a12, ey)), _mm_mul_ps(a22, ez)));
+    }
+
+    TransformBoxesScalar(m, boxes, result, i, end);
+}
+
+//
+// AVX2 kernels
+//
+
+// like StoreColumnSse41 for 8 objects, the transpose works on each 128 bit half, objects 0-3 in the low halves
+SIMD_TARGET_AVX2 inline void StoreColumnAvx2(glm::mat4* result, int column, __m256 r0, __m256 r1, __m256 r2, __m256 r3)
+{
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+
+    __m256 c0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 c1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 c2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 c3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+    _mm_storeu_ps(&result[0][column][0], _mm256_castps256_ps128(c0));
+    _mm_storeu_ps(&result[1][column][0], _mm256_castps256_ps128(c1));
+    _mm_storeu_ps(&result[2][column][0], _mm256_castps256_ps128(c2));
+    _mm_storeu_ps(&result[3][column][0], _mm256_castps256_ps128(c3));
+    _mm_storeu_ps(&result[4][column][0], _mm256_extractf128_ps(c0, 1));
+    _mm_storeu_ps(&result[5][column][0], _mm256_extractf128_ps(c1, 1));
+    _mm_storeu_ps(&result[6][column][0], _mm256_extractf128_ps(c2, 1));
+    _mm_storeu_ps(&result[7][column][0], _mm256_extractf128_ps(c3, 1));
+}
+
+SIMD_TARGET_AVX2 void ComposeTransformsAvx2(const TransformArrays& transforms, uint32_t begin, uint32_t end, glm::mat4* result)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    uint32_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&transforms.rotationX[i]);
+        __m256 y = _mm256_loadu_ps(&transforms.rotationY[i]);
+        __m256 z = _mm256_loadu_ps(&transforms.rotationZ[i]);
+        __m256 w = _mm256_loadu_ps(&transforms.rotationW[i]);
+
+        __m256 xx = _mm256_mul_ps(x, x);
+        __m256 yy = _mm256_mul_ps(y, y);
+        __m256 zz = _mm256_mul_ps(z, z);
+        __m256 xz = _mm256_mul_ps(x, z);
+        __m256 xy = _mm256_mul_ps(x, y);
+        __m256 yz = _mm256_mul_ps(y, z);
+        __m256 wx = _mm256_mul_ps(w, x);
+        __m256 wy = _mm256_mul_ps(w, y);
+        __m256 wz = _mm256_mul_ps(w, z);
+
+        __m256 sx = _mm256_loadu_ps(&transforms.scaleX[i]);
+        __m256 sy = _mm256_loadu_ps(&transforms.scaleY[i]);
+        __m256 sz = _mm256_loadu_ps(&transforms.scaleZ[i]);
+
+        StoreColumnAvx2(result + i, 0,
+                        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx),
+                        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+                        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+                        zero);
+        StoreColumnAvx2(result + i, 1,
+                        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+                        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy),
+                        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+                        zero);
+        StoreColumnAvx2(result + i, 2,
+                        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+                        _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+                        _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz),
+                        zero);
+        StoreColumnAvx2(result + i, 3,
+                        _mm256_loadu_ps(&transforms.positionX[i]),
+                        _mm256_loadu_ps(&transforms.positionY[i]),
+                        _mm256_loadu_ps(&transforms.positionZ[i]),
+                        one);
+    }
+
+    ComposeTransformsScalar(transforms, i, end, result);
+}
+
+// two columns at a time: the left matrix's columns are repeated in both halves, and each half multiplies them with
+// one column of the right matrix
+SIMD_TARGET_AVX2 void MultiplyMatricesAvx2(const glm::mat4* a, uint32_t aStride, const glm::mat4* b, glm::mat4* result, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float* left = &a[i * aStride][0][0];
+        const float* right = &b[i][0][0];
+
+        __m128 l0 = _mm_loadu_ps(left);
+        __m128 l1 = _mm_loadu_ps(left + 4);
+        __m128 l2 = _mm_loadu_ps(left + 8);
+        __m128 l3 = _mm_loadu_ps(left + 12);
+        __m256 a0 = _mm256_insertf128_ps(_mm256_castps128_ps256(l0), l0, 1);
+        __m256 a1 = _mm256_insertf128_ps(_mm256_castps128_ps256(l1), l1, 1);
+        __m256 a2 = _mm256_insertf128_ps(_mm256_castps128_ps256(l2), l2, 1);
+        __m256 a3 = _mm256_insertf128_ps(_mm256_castps128_ps256(l3), l3, 1);
+
+        __m256 b01 = _mm256_loadu_ps(right);
+        __m256 b23 = _mm256_loadu_ps(right + 8);
+
+        __m256 sum01 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(0, 0, 0, 0)));
+        sum01 = _mm256_add_ps(sum01, _mm256_mul_ps(a1, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(1, 1, 1, 1))));
+        sum01 = _mm256_add_ps(sum01, _mm256_mul_ps(a2, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(2, 2, 2, 2))));
+        sum01 = _mm256_add_ps(sum01, _mm256_mul_ps(a3, _mm256_shuffle_ps(b01, b01, _MM_SHUFFLE(3, 3, 3, 3))));
+
+        __m256 sum23 = _mm256_mul_ps(a0, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(0, 0, 0, 0)));
+        sum23 = _mm256_add_ps(sum23, _mm256_mul_ps(a1, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(1, 1, 1, 1))));
+        sum23 = _mm256_add_ps(sum23, _mm256_mul_ps(a2, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(2, 2, 2, 2))));
+        sum23 = _mm256_add_ps(sum23, _mm256_mul_ps(a3, _mm256_shuffle_ps(b23, b23, _MM_SHUFFLE(3, 3, 3, 3))));
+
+        float* product = &result[i][0][0];
+        _mm256_storeu_ps(product, sum01);
+        _mm256_storeu_ps(product + 8, sum23);
+    }
+}
+
+SIMD_TARGET_AVX2 void TransformPointsAvx2(const glm::mat4& m, const PointArrays& points, PointArrays& result, uint32_t begin, uint32_t end)
+{
+    __m256 m00 = _mm256_set1_ps(m[0][0]), m01 = _mm256_set1_ps(m[0][1]), m02 = _mm256_set1_ps(m[0][2]);
+    __m256 m10 = _mm256_set1_ps(m[1][0]), m11 = _mm256_set1_ps(m[1][1]), m12 = _mm256_set1_ps(m[1][2]);
+    __m256 m20 = _mm256_set1_ps(m[2][0]), m21 = _mm256_set1_ps(m[2][1]), m22 = _mm256_set1_ps(m[2][2]);
+    __m256 m30 = _mm256_set1_ps(m[3][0]), m31 = _mm256_set1_ps(m[3][1]), m32 = _mm256_set1_ps(m[3][2]);
+
+    uint32_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&points.x[i]);
+        __m256 y = _mm256_loadu_ps(&points.y[i]);
+        __m256 z = _mm256_loadu_ps(&points.z[i]);
+
+        _mm256_storeu_ps(&result.x[i], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, x), _mm256_mul_ps(m10, y)), _mm256_add_ps(_mm256_mul_ps(m20, z), m30)));
+        _mm256_storeu_ps(&result.y[i], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m01, x), _mm256_mul_ps(m11, y)), _mm256_add_ps(_mm256_mul_ps(m21, z), m31)));
+        _mm256_storeu_ps(&result.z[i], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m02, x), _mm256_mul_ps(m12, y)), _mm256_add_ps(_mm256_mul_ps(m22, z), m32)));
+    }
+
+    TransformPointsScalar(m, points, result, i, end);
+}
+
+SIMD_TARGET_AVX2 void TransformBoxesAvx2(const glm::mat4& m, const BoundingBoxes& boxes, BoundingBoxes& result, uint32_t begin, uint32_t end)
+{
+    __m256 m00 = _mm256_set1_ps(m[0][0]), m01 = _mm256_set1_ps(m[0][1]), m02 = _mm256_set1_ps(m[0][2]);
+    __m256 m10 = _mm256_set1_ps(m[1][0]), m11 = _mm256_set1_ps(m[1][1]), m12 = _mm256_set1_ps(m[1][2]);
+    __m256 m20 = _mm256_set1_ps(m[2][0]), m21 = _mm256_set1_ps(m[2][1]), m22 = _mm256_set1_ps(m[2][2]);
+    __m256 m30 = _mm256_set1_ps(m[3][0]), m31 = _mm256_set1_ps(m[3][1]), m32 = _mm256_set1_ps(m[3][2]);
+
+    __m256 a00 = _mm256_set1_ps(std::abs(m[0][0])), a01 = _mm256_set1_ps(std::abs(m[0][1])), a02 = _mm256_set1_ps(std::abs(m[0][2]));
+    __m256 a10 = _mm256_set1_ps(std::abs(m[1][0])), a11 = _mm256_set1_ps(std::abs(m[1][1])), a12 = _mm256_set1_ps(std::abs(m[1][2]));
+    __m256 a20 = _mm256_set1_ps(std::abs(m[2][0])), a21 = _mm256_set1_ps(std::abs(m[2][1])), a22 = _mm256_set1_ps(std::abs(m[2][2]));
+
+    uint32_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&boxes.centerX[i]);
+        __m256 y = _mm256_loadu_ps(&boxes.centerY[i]);
+        __m256 z = _mm256_loadu_ps(&boxes.centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&boxes.extentX[i]);
+        __m256 ey = _mm256_loadu_ps(&boxes.extentY[i]);
+        __m256 ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+
+        _mm256_storeu_ps(&result.centerX[i], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, x), _mm256_mul_ps(m10, y)), _mm256_add_ps(_mm256_mul_ps(m20, z), m30)));
+        _mm256_storeu_ps(&result.centerY[i], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m01, x), _mm256_mul_ps(m11, y)), _mm256_add_ps(_mm256_mul_ps(m21, z), m31)));
+        _mm256_storeu_ps(&result.centerZ[i], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m02, x), _mm256_mul_ps(m12, y)), _mm256_add_ps(_mm256_mul_ps(m22, z), m32)));
+        _mm256_storeu_ps(&result.extentX[i], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a00, ex), _mm256_mul_ps(a10, ey)), _mm256_mul_ps(a20, ez)));
+        _mm256_storeu_ps(&result.extentY[i], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a01, ex), _mm256_mul_ps(a11, ey)), _mm256_mul_ps(a21, ez)));
+        _mm256_storeu_ps(&result.extentZ[i], _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a02, ex), _mm256_mul_ps(a12, ey)), _mm256_mul_ps(a22, ez)));
+    }
+
+    TransformBoxesScalar(m, boxes, result, i, end);
+}
+
+#endif
+
+//
+// Initialization/Destruction
+//
+
+BatchMath::BatchMath(ESimdLevel eSimdLevel)
+{
+    // never use an instruction set the CPU doesn't have
+    mSimdLevel = Simd::IsSupported(eSimdLevel) ? eSimdLevel : Simd::GetBestLevel();
+}
+
+//
+// External
+//
+
+void BatchMath::ComposeTransforms(const TransformArrays &transforms, uint32_t begin, uint32_t end, glm::mat4 *result) const
+{
+    switch (mSimdLevel)
+    {
+#if SIMD_X86
+        case SIMD_AVX2:
+            return ComposeTransformsAvx2(transforms, begin, end, result);
+        case SIMD_SSE41:
+            return ComposeTransformsSse41(transforms, begin, end, result);
+#endif
+        default:
+            return ComposeTransformsScalar(transforms, begin, end, result);
+    }
+}
+
+void BatchMath::MultiplyMatrices(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *result, uint32_t count) const
+{
+    switch (mSimdLevel)
+    {
+#if SIMD_X86
+        case SIMD_AVX2:
+            return MultiplyMatricesAvx2(a, 1, b, result, count);
+        case SIMD_SSE41:
+            return MultiplyMatricesSse41(a, 1, b, result, count);
+#endif
+        default:
+            return MultiplyMatricesScalar(a, 1, b, result, count);
+    }
+}
+
+void BatchMath::MultiplyMatrices(const glm::mat4 &a, const glm::mat4 *b, glm::mat4 *result, uint32_t count) const
+{
+    switch (mSimdLevel)
+    {
+#if SIMD_X86
+        case SIMD_AVX2:
+            return MultiplyMatricesAvx2(&a, 0, b, result, count);
+        case SIMD_SSE41:
+            return MultiplyMatricesSse41(&a, 0, b, result, count);
+#endif
+        default:
+            return MultiplyMatricesScalar(&a, 0, b, result, count);
+    }
+}
+
+void BatchMath::TransformPoints(const glm::mat4 &matrix, const PointArrays &points, PointArrays &result) const
+{
+    switch (mSimdLevel)
+    {
+#if SIMD_X86
+        case SIMD_AVX2:
+            return TransformPointsAvx2(matrix, points, result, 0, points.Size());
+        case SIMD_SSE41:
+            return TransformPointsSse41(matrix, points, result, 0, points.Size());
+#endif
+        default:
+            return TransformPointsScalar(matrix, points, result, 0, points.Size());
+    }
+}
+
+void BatchMath::TransformBoxes(const glm::mat4 &matrix, const BoundingBoxes &boxes, BoundingBoxes &result) const
+{
+    switch (mSimdLevel)
+    {
+#if SIMD_X86
+        case SIMD_AVX2:
+            return TransformBoxesAvx2(matrix, boxes, result, 0, boxes.Size());
+        case SIMD_SSE41:
+            return TransformBoxesSse41(matrix, boxes, result, 0, boxes.Size());
+#endif
+        default:
+            return TransformBoxesScalar(matrix, boxes, result, 0, boxes.Size());
+    }
+}
+
+//
+// Self check
+//
+
+// random inputs for every kernel, the same for a given count
+struct BatchMathData
+{
+    explicit BatchMathData(uint32_t count)
+    {
+        std::mt19937 random(count);
+        std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+
+        transforms.Resize(count);
+        points.Resize(count);
+        boxes.Resize(count);
+        a.resize(count);
+        b.resize(count);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            transforms.positionX[i] = position(random);
+            transforms.positionY[i] = position(random);
+            transforms.positionZ[i] = position(random);
+
+            glm::quat rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+            transforms.rotationX[i] = rotation.x;
+            transforms.rotationY[i] = rotation.y;
+            transforms.rotationZ[i] = rotation.z;
+            transforms.rotationW[i] = rotation.w;
+
+            transforms.scaleX[i] = scale(random);
+            transforms.scaleY[i] = scale(random);
+            transforms.scaleZ[i] = scale(random);
+
+            points.x[i] = position(random);
+            points.y[i] = position(random);
+            points.z[i] = position(random);
+
+            boxes.centerX[i] = position(random);
+            boxes.centerY[i] = position(random);
+            boxes.centerZ[i] = position(random);
+            boxes.extentX[i] = scale(random);
+            boxes.extentY[i] = scale(random);
+            boxes.extentZ[i] = scale(random);
+
+            for (int column = 0; column < 4; column++)
+                for (int row = 0; row < 4; row++)
+                {
+                    a[i][column][row] = unit(random);
+                    b[i][column][row] = unit(random);
+                }
+        }
+
+        glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+        matrix = projection * glm::lookAt(glm::vec3(10.0f, 20.0f, 30.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    TransformArrays transforms;
+    PointArrays points;
+    BoundingBoxes boxes;
+    std::vector<glm::mat4> a;
+    std::vector<glm::mat4> b;
+    glm::mat4 matrix{1.0f};
+};
+
+// what every kernel produced
+struct BatchMathResults
+{
+    void Run(const BatchMath& math, const BatchMathData& data)
+    {
+        uint32_t count = data.transforms.Size();
+        composed.resize(count);
+        products.resize(count);
+        sharedProducts.resize(count);
+        points.Resize(count);
+        boxes.Resize(count);
+
+        math.ComposeTransforms(data.transforms, 0, count, composed.data());
+        math.MultiplyMatrices(data.a.data(), data.b.data(), products.data(), count);
+        math.MultiplyMatrices(data.matrix, data.b.data(), sharedProducts.data(), count);
+        math.TransformPoints(data.matrix, data.points, points);
+        math.TransformBoxes(data.matrix, data.boxes, boxes);
+    }
+
+    // bit for bit, so -0 and 0 (or two different NaNs) don't count as the same
+    bool operator==(const BatchMathResults& other) const
+    {
+        auto same = [](const auto& left, const auto& right) {
+            return left.size() == right.size() &&
+                   std::memcmp(left.data(), right.data(), left.size() * sizeof(left[0])) == 0;
+        };
+
+        return same(composed, other.composed) && same(products, other.products) &&
+               same(sharedProducts, other.sharedProducts) && same(points.x, other.points.x) &&
+               same(points.y, other.points.y) && same(points.z, other.points.z) &&
+               same(boxes.centerX, other.boxes.centerX) && same(boxes.centerY, other.boxes.centerY) &&
+               same(boxes.centerZ, other.boxes.centerZ) && same(boxes.extentX, other.boxes.extentX) &&
+               same(boxes.extentY, other.boxes.extentY) && same(boxes.extentZ, other.boxes.extentZ);
+    }
+
+    std::vector<glm::mat4> composed;
+    std::vector<glm::mat4> products;
+    std::vector<glm::mat4> sharedProducts;
+    PointArrays points;
+    BoundingBoxes boxes;
+};
+
+// not a multiple of 8, so the scalar tails are checked too
+const uint32_t SELF_CHECK_COUNT = 1027;
+
+bool CheckSimdLevel(ESimdLevel eLevel)
+{
+    BatchMathData data(SELF_CHECK_COUNT);
+
+    BatchMathResults reference, results;
+    reference.Run(BatchMath(SIMD_SCALAR), data);
+    results.Run(BatchMath(eLevel), data);
+
+    if (results == reference)
+        return true;
+
+    Logger::Error("Batch math kernels don't match the scalar path with", Simd::ToString(eLevel));
+    return false;
+}
+
+bool BatchMath::RunSelfCheck()
+{
+    bool bPassed = true;
+    for (ESimdLevel level : { SIMD_SSE41, SIMD_AVX2 })
+        if (Simd::IsSupported(level))
+            bPassed = CheckSimdLevel(level) && bPassed;
+
+    return bPassed;
+}
+
+ESimdLevel FindVerifiedSimdLevel()
+{
+    for (ESimdLevel level : { SIMD_AVX2, SIMD_SSE41 })
+    {
+        if (Simd::IsSupported(level) && CheckSimdLevel(level))
+        {
+            Logger::Info("Batch math kernels verified with " + Simd::ToString(level));
+            return level;
+        }
+    }
+
+    return SIMD_SCALAR;
+}
+
+ESimdLevel BatchMath::GetVerifiedLevel()
+{
+    static ESimdLevel level = FindVerifiedSimdLevel();
+    return level;
+}
+
+//
+// Benchmark
+//
+
+void BatchMath::RunBenchmark()
+{
+    const uint32_t count = 1000000;
+    const uint32_t iterations = 20;
+
+    Logger::Info("Batch math benchmark: " + std::to_string(count) + " objects, best SIMD level is " +
+                 Simd::ToString(Simd::GetBestLevel()) + (RunSelfCheck() ? ", self check passed" : ", SELF CHECK FAILED"));
+
+    BatchMathData data(count);
+
+    auto measure = [iterations](const std::function<void()>& kernel) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            kernel();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+    };
+
+    // glm, one object at a time
+    BatchMathResults glmResults;
+    glmResults.composed.resize(count);
+    glmResults.products.resize(count);
+    glmResults.sharedProducts.resize(count);
+    glmResults.points.Resize(count);
+    glmResults.boxes.Resize(count);
+
+    double glmTimes[5];
+    glmTimes[0] = measure([&]() {
+        const auto& t = data.transforms;
+        for (uint32_t i = 0; i < count; i++)
+            glmResults.composed[i] = glm::translate(glm::mat4(1.0f), glm::vec3(t.positionX[i], t.positionY[i], t.positionZ[i])) *
+                                     glm::mat4_cast(glm::quat(t.rotationW[i], t.rotationX[i], t.rotationY[i], t.rotationZ[i])) *
+                                     glm::scale(glm::mat4(1.0f), glm::vec3(t.scaleX[i], t.scaleY[i], t.scaleZ[i]));
+    });
+    glmTimes[1] = measure([&]() {
+        for (uint32_t i = 0; i < count; i++)
+            glmResults.products[i] = data.a[i] * data.b[i];
+    });
+    glmTimes[2] = measure([&]() {
+        for (uint32_t i = 0; i < count; i++)
+            glmResults.sharedProducts[i] = data.matrix * data.b[i];
+    });
+    glmTimes[3] = measure([&]() {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            glm::vec4 point = data.matrix * glm::vec4(data.points.x[i], data.points.y[i], data.points.z[i], 1.0f);
+            glmResults.points.x[i] = point.x;
+            glmResults.points.y[i] = point.y;
+            glmResults.points.z[i] = point.z;
+        }
+    });
+    glmTimes[4] = measure([&]() {
+        glm::mat3 absMatrix(glm::abs(glm::vec3(data.matrix[0])), glm::abs(glm::vec3(data.matrix[1])),
+                            glm::abs(glm::vec3(data.matrix[2])));
+        const auto& boxes = data.boxes;
+        auto& result = glmResults.boxes;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            glm::vec4 center = data.matrix * glm::vec4(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i], 1.0f);
+            glm::vec3 extent = absMatrix * glm::vec3(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+            result.centerX[i] = center.x;
+            result.centerY[i] = center.y;
+            result.centerZ[i] = center.z;
+            result.extentX[i] = extent.x;
+            result.extentY[i] = extent.y;
+            result.extentZ[i] = extent.z;
+        }
+    });
+
+    const char* kernelNames[5] = { "TRS to mat4", "mat4 * mat4", "shared mat4 * mat4", "points", "AABBs" };
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3) << "  glm loops: ";
+    for (int kernel = 0; kernel < 5; kernel++)
+        ss << (kernel > 0 ? ", " : "") << kernelNames[kernel] << " " << glmTimes[kernel] << " ms";
+    Logger::Info(ss.str());
+
+    BatchMathResults reference;
+    for (ESimdLevel level : { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2 })
+    {
+        if (!Simd::IsSupported(level))
+        {
+            Logger::Info("  " + Simd::ToString(level) + ": not supported by this CPU");
+            continue;
+        }
+
+        BatchMath math(level);
+        BatchMathResults results;
+        results.Run(math, data); // sizes the outputs
+
+        double times[5];
+        times[0] = measure([&]() { math.ComposeTransforms(data.transforms, 0, count, results.composed.data()); });
+        times[1] = measure([&]() { math.MultiplyMatrices(data.a.data(), data.b.data(), results.products.data(), count); });
+        times[2] = measure([&]() { math.MultiplyMatrices(data.matrix, data.b.data(), results.sharedProducts.data(), count); });
+        times[3] = measure([&]() { math.TransformPoints(data.matrix, data.points, results.points); });
+        times[4] = measure([&]() { math.TransformBoxes(data.matrix, data.boxes, results.boxes); });
+
+        std::string sAgreement;
+        if (level == SIMD_SCALAR)
+        {
+            reference = results;
+            sAgreement = results == glmResults ? ", bit-identical to glm" : ", differs from glm";
+        } else
+        {
+            sAgreement = results == reference ? ", bit-identical to scalar" : ", DOES NOT MATCH SCALAR";
+        }
+
+        // millions of objects per second, and how much faster than glm
+        ss.str("");
+        ss << std::fixed << std::setprecision(3) << "  " << Simd::ToString(level) << ": ";
+        for (int kernel = 0; kernel < 5; kernel++)
+            ss << (kernel > 0 ? ", " : "") << kernelNames[kernel] << " " << times[kernel] << " ms ("
+               << std::setprecision(1) << count / (times[kernel] * 1000.0) << " M/s, "
+               << std::setprecision(2) << glmTimes[kernel] / times[kernel] << "x glm)" << std::setprecision(3);
+        ss << sAgreement;
+        Logger::Info(ss.str());
+    }
+}
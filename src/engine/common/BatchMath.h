@@ -0,0 +1,81 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_BATCHMATH_H
+#define VULKAN_ENGINE_BATCHMATH_H
+
+#include <glm/mat4x4.hpp>
+#include <cstdint>
+#include <vector>
+#include "Simd.h"
+#include "../culling/FrustumCuller.h" // BoundingBoxes
+
+// object transforms in structure of arrays form, rotations are quaternions
+struct TransformArrays
+{
+    void Resize(uint32_t count);
+    uint32_t Size() const { return static_cast<uint32_t>(positionX.size()); }
+
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    std::vector<float> rotationX;
+    std::vector<float> rotationY;
+    std::vector<float> rotationZ;
+    std::vector<float> rotationW;
+    std::vector<float> scaleX;
+    std::vector<float> scaleY;
+    std::vector<float> scaleZ;
+};
+
+// points in structure of arrays form
+struct PointArrays
+{
+    void Resize(uint32_t count);
+    uint32_t Size() const { return static_cast<uint32_t>(x.size()); }
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+};
+
+// Math on arrays of objects, 8 at a time with AVX2 (4 with SSE4.1). Every SIMD level adds its products in the same
+// order as the scalar path (and as glm), so they all give bit-identical results. A self check verifies that at runtime
+// before the default SIMD level is picked.
+// NOTE: That needs the compiler to not fuse multiplies and adds, don't build with -mfma or -march=native
+class BatchMath
+{
+public:
+    explicit BatchMath(ESimdLevel eSimdLevel = GetVerifiedLevel());
+
+    // translation * rotation * scale for every transform in [begin, end), written to result[begin..end)
+    void ComposeTransforms(const TransformArrays& transforms, uint32_t begin, uint32_t end, glm::mat4* result) const;
+
+    // result[i] = a[i] * b[i]
+    void MultiplyMatrices(const glm::mat4* a, const glm::mat4* b, glm::mat4* result, uint32_t count) const;
+    // result[i] = a * b[i] (e.g. view projection * model)
+    void MultiplyMatrices(const glm::mat4& a, const glm::mat4* b, glm::mat4* result, uint32_t count) const;
+
+    // affine transform of points (w = 1), result must have the same size
+    void TransformPoints(const glm::mat4& matrix, const PointArrays& points, PointArrays& result) const;
+    // boxes that enclose the transformed boxes, result must have the same size
+    void TransformBoxes(const glm::mat4& matrix, const BoundingBoxes& boxes, BoundingBoxes& result) const;
+
+    ESimdLevel GetSimdLevel() const { return mSimdLevel; }
+
+    // runs every kernel with every supported SIMD level on random data and compares them with the scalar path, bit for
+    // bit, logs and returns false on a mismatch
+    static bool RunSelfCheck();
+    // the best SIMD level that passed the self check, which runs the first time this is called
+    static ESimdLevel GetVerifiedLevel();
+
+    // throughput of every kernel and SIMD level against the equivalent glm loops
+    static void RunBenchmark();
+
+private:
+    ESimdLevel mSimdLevel;
+};
+
+
+#endif //VULKAN_ENGINE_BATCHMATH_H
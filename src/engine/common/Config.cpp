@@ -54,6 +54,141 @@ std::string Config::GetEngineVersion()
     return GetSingleton().GetEngineVersionImpl();
 }
 
+bool Config::IsHeadless()
+{
+    return GetSingleton().IsHeadlessImpl();
+}
+
+uint32_t Config::GetHeadlessFrameCount()
+{
+    return GetSingleton().GetHeadlessFrameCountImpl();
+}
+
+uint32_t Config::GetHeadlessReadbackInterval()
+{
+    return GetSingleton().GetHeadlessReadbackIntervalImpl();
+}
+
+std::string Config::GetPresentMode()
+{
+    return GetSingleton().GetPresentModeImpl();
+}
+
+uint32_t Config::GetFrameRateLimit()
+{
+    return GetSingleton().GetFrameRateLimitImpl();
+}
+
+bool Config::IsLowLatencyEnabled()
+{
+    return GetSingleton().IsLowLatencyEnabledImpl();
+}
+
+bool Config::IsGpuProfilingEnabled()
+{
+    return GetSingleton().IsGpuProfilingEnabledImpl();
+}
+
+bool Config::IsGpuPipelineStatisticsEnabled()
+{
+    return GetSingleton().IsGpuPipelineStatisticsEnabledImpl();
+}
+
+bool Config::IsTimelineSemaphoreEnabled()
+{
+    return GetSingleton().IsTimelineSemaphoreEnabledImpl();
+}
+
+uint32_t Config::GetGeometryVertexCapacity()
+{
+    return GetSingleton().GetGeometryVertexCapacityImpl();
+}
+
+uint32_t Config::GetGeometryIndexCapacity()
+{
+    return GetSingleton().GetGeometryIndexCapacityImpl();
+}
+
+bool Config::IsGpuCullingTestSceneEnabled()
+{
+    return GetSingleton().IsGpuCullingTestSceneEnabledImpl();
+}
+
+uint32_t Config::GetGpuCullingTestObjectCount()
+{
+    return GetSingleton().GetGpuCullingTestObjectCountImpl();
+}
+
+bool Config::IsGpuCullingValidationEnabled()
+{
+    return GetSingleton().IsGpuCullingValidationEnabledImpl();
+}
+
+std::string Config::GetBenchmarks()
+{
+    return GetSingleton().GetBenchmarksImpl();
+}
+
+bool Config::ShouldExitAfterBenchmarks()
+{
+    return GetSingleton().ShouldExitAfterBenchmarksImpl();
+}
+
+uint32_t Config::GetCaptureRingSize()
+{
+    return GetSingleton().GetCaptureRingSizeImpl();
+}
+
+bool Config::IsContinuousCaptureEnabled()
+{
+    return GetSingleton().IsContinuousCaptureEnabledImpl();
+}
+
+std::string Config::GetCaptureFormat()
+{
+    return GetSingleton().GetCaptureFormatImpl();
+}
+
+uint32_t Config::GetJobWorkerCount()
+{
+    return GetSingleton().GetJobWorkerCountImpl();
+}
+
+bool Config::IsRenderThreadEnabled()
+{
+    return GetSingleton().IsRenderThreadEnabledImpl();
+}
+
+uint32_t Config::GetSimulationTickRate()
+{
+    return GetSingleton().GetSimulationTickRateImpl();
+}
+
+uint32_t Config::GetMaxCatchUpTicks()
+{
+    return GetSingleton().GetMaxCatchUpTicksImpl();
+}
+
+std::string Config::GetCriticalPathReportFile()
+{
+    return GetSingleton().GetCriticalPathReportFileImpl();
+}
+
+std::string Config::GetAudioBanks()
+{
+    return GetSingleton().GetAudioBanksImpl();
+}
+
+bool Config::IsSceneTestSceneEnabled()
+{
+    return GetSingleton().IsSceneTestSceneEnabledImpl();
+}
+
+uint32_t Config::GetSceneTestObjectCount()
+{
+    return GetSingleton().GetSceneTestObjectCountImpl();
+}
+
 // Implementations
 uint32_t Config::GetWindowWidthImpl()
 {
@@ -90,7 +225,140 @@ std::string Config::GetEngineVersionImpl()
     return reader.Get("Engine", "Version", "v0.0.0");
 }
 
+bool Config::IsHeadlessImpl()
+{
+    return reader.GetBoolean("Headless", "Enabled", false);
+}
+
+uint32_t Config::GetHeadlessFrameCountImpl()
+{
+    return static_cast<uint32_t>(reader.GetInteger("Headless", "Frames", 1000));
+}
+
+uint32_t Config::GetHeadlessReadbackIntervalImpl()
+{
+    // 0 means we never read back the rendered images
+    return static_cast<uint32_t>(reader.GetInteger("Headless", "ReadbackInterval", 0));
+}
+
+std::string Config::GetPresentModeImpl()
+{
+    // fifo (v-sync), mailbox (triple buffering) or immediate (no v-sync, may tear)
+    return reader.Get("Renderer", "PresentMode", "mailbox");
+}
+
+uint32_t Config::GetFrameRateLimitImpl()
+{
+    // 0 means uncapped
+    return static_cast<uint32_t>(reader.GetInteger("Renderer", "FrameRateLimit", 0));
+}
+
+bool Config::IsLowLatencyEnabledImpl()
+{
+    return reader.GetBoolean("Renderer", "LowLatency", false);
+}
+
+bool Config::IsGpuProfilingEnabledImpl()
+{
+    return reader.GetBoolean("Profiling", "GpuTimestamps", true);
+}
+
+bool Config::IsGpuPipelineStatisticsEnabledImpl()
+{
+    return reader.GetBoolean("Profiling", "GpuPipelineStatistics", false);
+}
+
+bool Config::IsTimelineSemaphoreEnabledImpl()
+{
+    return reader.GetBoolean("Renderer", "TimelineSemaphores", true);
+}
+
+uint32_t Config::GetGeometryVertexCapacityImpl()
+{
+    return static_cast<uint32_t>(reader.GetInteger("Renderer", "GeometryVertexCapacity", 1048576));
+}
+
+uint32_t Config::GetGeometryIndexCapacityImpl()
+{
+    return static_cast<uint32_t>(reader.GetInteger("Renderer", "GeometryIndexCapacity", 4194304));
+}
+
+bool Config::IsGpuCullingTestSceneEnabledImpl()
+{
+    return reader.GetBoolean("Culling", "TestScene", false);
+}
+
+uint32_t Config::GetGpuCullingTestObjectCountImpl()
+{
+    return static_cast<uint32_t>(reader.GetInteger("Culling", "TestObjectCount", 100000));
+}
+
+bool Config::IsGpuCullingValidationEnabledImpl()
+{
+    return reader.GetBoolean("Culling", "Validation", true);
+}
+
+std::string Config::GetBenchmarksImpl()
+{
+    return reader.Get("Benchmark", "Run", "");
+}
+
+bool Config::ShouldExitAfterBenchmarksImpl()
+{
+    return reader.GetBoolean("Benchmark", "ExitAfterRun", true);
+}
+
+uint32_t Config::GetCaptureRingSizeImpl()
+{
+    return static_cast<uint32_t>(reader.GetInteger("Capture", "RingSize", 4));
+}
 
+bool Config::IsContinuousCaptureEnabledImpl()
+{
+    return reader.GetBoolean("Capture", "Continuous", false);
+}
 
+std::string Config::GetCaptureFormatImpl()
+{
+    return reader.Get("Capture", "Format", "png");
+}
 
+uint32_t Config::GetJobWorkerCountImpl()
+{
+    return static_cast<uint32_t>(reader.GetInteger("Jobs", "WorkerCount", 0));
+}
 
+bool Config::IsRenderThreadEnabledImpl()
+{
+    return reader.GetBoolean("Renderer", "RenderThread", true);
+}
+
+uint32_t Config::GetSimulationTickRateImpl()
+{
+    return static_cast<uint32_t>(reader.GetInteger("Simulation", "TickRate", 60));
+}
+
+uint32_t Config::GetMaxCatchUpTicksImpl()
+{
+    return static_cast<uint32_t>(reader.GetInteger("Simulation", "MaxCatchUpTicks", 5));
+}
+
+std::string Config::GetCriticalPathReportFileImpl()
+{
+    return reader.Get("Profiling", "CriticalPathReport", "");
+}
+
+std::string Config::GetAudioBanksImpl()
+{
+    return reader.Get("Audio", "Banks", "assets/audio/Master.bank,assets/audio/Master.strings.bank");
+}
+
+bool Config::IsSceneTestSceneEnabledImpl()
+{
+    return reader.GetBoolean("Scene", "TestScene", false);
+}
+
+uint32_t Config::GetSceneTestObjectCountImpl()
+{
+    return static_cast<uint32_t>(reader.GetInteger("Scene", "TestObjectCount", 10000));
+}
@@ -26,6 +26,33 @@ public:
     static bool GetSaveToLogFile();
     static std::string GetEngineName();
     static std::string GetEngineVersion();
+    static bool IsHeadless();
+    static uint32_t GetHeadlessFrameCount();
+    static uint32_t GetHeadlessReadbackInterval();
+    static std::string GetPresentMode();
+    static uint32_t GetFrameRateLimit();
+    static bool IsLowLatencyEnabled();
+    static bool IsGpuProfilingEnabled();
+    static bool IsGpuPipelineStatisticsEnabled();
+    static bool IsTimelineSemaphoreEnabled();
+    static uint32_t GetGeometryVertexCapacity();
+    static uint32_t GetGeometryIndexCapacity();
+    static bool IsGpuCullingTestSceneEnabled();
+    static uint32_t GetGpuCullingTestObjectCount();
+    static bool IsGpuCullingValidationEnabled();
+    static std::string GetBenchmarks();
+    static bool ShouldExitAfterBenchmarks();
+    static uint32_t GetCaptureRingSize();
+    static bool IsContinuousCaptureEnabled();
+    static std::string GetCaptureFormat();
+    static uint32_t GetJobWorkerCount();
+    static bool IsRenderThreadEnabled();
+    static uint32_t GetSimulationTickRate();
+    static uint32_t GetMaxCatchUpTicks();
+    static std::string GetCriticalPathReportFile();
+    static std::string GetAudioBanks();
+    static bool IsSceneTestSceneEnabled();
+    static uint32_t GetSceneTestObjectCount();
 
 private:
     INIReader reader;
@@ -39,6 +66,33 @@ private:
     bool GetSaveToLogFileImpl();
     std::string GetEngineNameImpl();
     std::string GetEngineVersionImpl();
+    bool IsHeadlessImpl();
+    uint32_t GetHeadlessFrameCountImpl();
+    uint32_t GetHeadlessReadbackIntervalImpl();
+    std::string GetPresentModeImpl();
+    uint32_t GetFrameRateLimitImpl();
+    bool IsLowLatencyEnabledImpl();
+    bool IsGpuProfilingEnabledImpl();
+    bool IsGpuPipelineStatisticsEnabledImpl();
+    bool IsTimelineSemaphoreEnabledImpl();
+    uint32_t GetGeometryVertexCapacityImpl();
+    uint32_t GetGeometryIndexCapacityImpl();
+    bool IsGpuCullingTestSceneEnabledImpl();
+    uint32_t GetGpuCullingTestObjectCountImpl();
+    bool IsGpuCullingValidationEnabledImpl();
+    std::string GetBenchmarksImpl();
+    bool ShouldExitAfterBenchmarksImpl();
+    uint32_t GetCaptureRingSizeImpl();
+    bool IsContinuousCaptureEnabledImpl();
+    std::string GetCaptureFormatImpl();
+    uint32_t GetJobWorkerCountImpl();
+    bool IsRenderThreadEnabledImpl();
+    uint32_t GetSimulationTickRateImpl();
+    uint32_t GetMaxCatchUpTicksImpl();
+    std::string GetCriticalPathReportFileImpl();
+    std::string GetAudioBanksImpl();
+    bool IsSceneTestSceneEnabledImpl();
+    uint32_t GetSceneTestObjectCountImpl();
 };
 
 
@@ -0,0 +1,57 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "FixedTimestep.h"
+#include <algorithm>
+#include <cmath>
+
+FixedTimestep::FixedTimestep(uint32_t tickRate, uint32_t maxCatchUpTicks)
+    : mTickDuration(1.0 / std::max(tickRate, 1u)), mMaxCatchUpTicks(std::max(maxCatchUpTicks, 1u))
+{
+}
+
+uint32_t FixedTimestep::Advance(double fElapsedSeconds)
+{
+    mAccumulator += std::max(fElapsedSeconds, 0.0);
+
+    auto ticks = static_cast<uint32_t>(std::min(std::floor(mAccumulator / mTickDuration), static_cast<double>(mMaxCatchUpTicks)));
+    mAccumulator -= ticks * mTickDuration;
+
+    // too far behind, drop whole ticks but keep the fraction so the alpha stays smooth
+    if (mAccumulator >= mTickDuration)
+    {
+        double remainder = std::fmod(mAccumulator, mTickDuration);
+        mDroppedTime += mAccumulator - remainder;
+        mAccumulator = remainder;
+        mClampedFrames++;
+    }
+
+    mTickCount += ticks;
+    return ticks;
+}
+
+double FixedTimestep::GetTickDuration() const
+{
+    return mTickDuration;
+}
+
+uint64_t FixedTimestep::GetTickCount() const
+{
+    return mTickCount;
+}
+
+double FixedTimestep::GetDroppedTime() const
+{
+    return mDroppedTime;
+}
+
+uint32_t FixedTimestep::GetClampedFrames() const
+{
+    return mClampedFrames;
+}
+
+float FixedTimestep::GetAlpha() const
+{
+    return static_cast<float>(std::min(mAccumulator / mTickDuration, 1.0));
+}
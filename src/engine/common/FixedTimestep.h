@@ -0,0 +1,41 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_FIXEDTIMESTEP_H
+#define VULKAN_ENGINE_FIXEDTIMESTEP_H
+
+#include <cstdint>
+
+// Accumulates real time and hands it out in fixed ticks, so the simulation steps the same way whatever the frame
+// rate is. What's left in the accumulator becomes the interpolation alpha between the last two simulated states.
+// When a frame takes too long, at most maxCatchUpTicks are run and the rest of the time is dropped, so a slow
+// simulation can't spiral into ever longer frames.
+class FixedTimestep
+{
+public:
+    FixedTimestep(uint32_t tickRate, uint32_t maxCatchUpTicks);
+
+    // adds the real time since the last frame, returns how many ticks to simulate
+    uint32_t Advance(double fElapsedSeconds);
+
+    double GetTickDuration() const;  // in seconds
+    uint64_t GetTickCount() const;   // ticks handed out so far
+    double GetDroppedTime() const;   // in seconds, lost to the catch-up limit
+    uint32_t GetClampedFrames() const;
+
+    // how far we are between the previous and current state, in [0, 1)
+    float GetAlpha() const;
+
+private:
+    double mTickDuration;
+    uint32_t mMaxCatchUpTicks;
+
+    double mAccumulator = 0.0;
+    uint64_t mTickCount = 0;
+    double mDroppedTime = 0.0;
+    uint32_t mClampedFrames = 0;
+};
+
+
+#endif //VULKAN_ENGINE_FIXEDTIMESTEP_H
@@ -0,0 +1,286 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "FrameScheduler.h"
+#include "Config.h"
+#include "../profiling/Logger.h"
+#include <Tracy.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+FrameSchedulerImpl* mFrameSchedulerImpl = nullptr;
+
+//
+// Initialization/Destruction
+//
+
+void FrameScheduler::Init()
+{
+    Logger::Info("Initializing frame scheduler");
+    mFrameSchedulerImpl = new FrameSchedulerImpl();
+}
+
+void FrameScheduler::Shutdown()
+{
+    Logger::Info("Shutting down frame scheduler");
+    delete mFrameSchedulerImpl;
+    mFrameSchedulerImpl = nullptr;
+}
+
+FrameSchedulerImpl::FrameSchedulerImpl()
+{
+    std::string sReportFile = Config::GetCriticalPathReportFile();
+    if (!sReportFile.empty())
+    {
+        reportFile.open(sReportFile);
+        if (reportFile.is_open())
+            reportFile << "frame,wall_ms,busy_ms,critical_path_ms,critical_path\n";
+        else
+            Logger::Error("Failed to open the critical path report", sReportFile);
+    }
+}
+
+FrameSchedulerImpl::~FrameSchedulerImpl() = default;
+
+//
+// External
+//
+
+uint32_t FrameScheduler::RegisterTask(const std::string &sName, uint32_t reads, uint32_t writes,
+                                      const std::function<void()> &function, bool bMainThread)
+{
+    auto& tasks = mFrameSchedulerImpl->tasks;
+    tasks.push_back(FrameTask{ sName, reads, writes, function, bMainThread });
+
+    mFrameSchedulerImpl->criticalPathCount.push_back(0);
+    mFrameSchedulerImpl->totalMilliseconds.push_back(0.0);
+
+    return static_cast<uint32_t>(tasks.size() - 1);
+}
+
+void FrameScheduler::SetTaskEnabled(uint32_t taskId, bool bEnabled)
+{
+    mFrameSchedulerImpl->tasks[taskId].bEnabled = bEnabled;
+}
+
+void FrameScheduler::Run()
+{
+    ZoneScoped;
+
+    auto& impl = *mFrameSchedulerImpl;
+    impl.BuildGraph();
+
+    impl.frameStart = FrameSchedulerImpl::Clock::now();
+    std::fill(impl.taskStart.begin(), impl.taskStart.end(), impl.frameStart);
+    std::fill(impl.taskEnd.begin(), impl.taskEnd.end(), impl.frameStart);
+
+    // roots first, the rest is launched by the last task it depends on
+    for (uint32_t taskId = 0; taskId < impl.tasks.size(); taskId++)
+        if (impl.tasks[taskId].bEnabled && impl.dependencies[taskId].empty())
+            impl.Launch(taskId);
+
+    // runs main thread tasks (and other jobs) while waiting
+    JobSystem::Wait(impl.frameCounter);
+
+    impl.BuildReport();
+    impl.WriteReport();
+    impl.frame++;
+}
+
+const FrameTaskReport &FrameScheduler::GetLastReport()
+{
+    return mFrameSchedulerImpl->lastReport;
+}
+
+std::string FrameScheduler::GetTaskName(uint32_t taskId)
+{
+    return mFrameSchedulerImpl->tasks[taskId].name;
+}
+
+void FrameScheduler::ReportStatistics()
+{
+    auto& impl = *mFrameSchedulerImpl;
+    if (impl.frame == 0)
+        return;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3) << "Frame tasks over " << impl.frame << " frames:";
+    for (uint32_t taskId = 0; taskId < impl.tasks.size(); taskId++)
+    {
+        ss << "\n  " << impl.tasks[taskId].name << ": avg " << impl.totalMilliseconds[taskId] / impl.frame
+           << " ms, on the critical path in " << std::setprecision(1)
+           << 100.0 * impl.criticalPathCount[taskId] / impl.frame << "% of frames" << std::setprecision(3);
+    }
+    Logger::Info(ss.str());
+}
+
+//
+// Implementation
+//
+
+void FrameSchedulerImpl::BuildGraph()
+{
+    uint32_t taskCount = static_cast<uint32_t>(tasks.size());
+
+    dependencies.assign(taskCount, {});
+    dependents.assign(taskCount, {});
+    taskStart.resize(taskCount);
+    taskEnd.resize(taskCount);
+
+    if (pendingCapacity < taskCount)
+    {
+        pendingDependencies = std::make_unique<std::atomic<uint32_t>[]>(taskCount);
+        pendingCapacity = taskCount;
+    }
+
+    // per resource bit: the last task that wrote it, and who read it since
+    const uint32_t resourceBits = 32;
+    std::vector<int32_t> lastWriter(resourceBits, -1);
+    std::vector<std::vector<uint32_t>> readersSinceWrite(resourceBits);
+
+    for (uint32_t taskId = 0; taskId < taskCount; taskId++)
+    {
+        const auto& task = tasks[taskId];
+        if (!task.bEnabled)
+            continue;
+
+        auto& taskDependencies = dependencies[taskId];
+        for (uint32_t bit = 0; bit < resourceBits; bit++)
+        {
+            uint32_t resource = 1u << bit;
+            bool bReads = (task.reads & resource) != 0;
+            bool bWrites = (task.writes & resource) != 0;
+            if (!bReads && !bWrites)
+                continue;
+
+            // read after write, write after write
+            if (lastWriter[bit] >= 0)
+                taskDependencies.push_back(static_cast<uint32_t>(lastWriter[bit]));
+
+            if (bWrites)
+            {
+                // write after read
+                for (uint32_t reader : readersSinceWrite[bit])
+                    taskDependencies.push_back(reader);
+
+                lastWriter[bit] = static_cast<int32_t>(taskId);
+                readersSinceWrite[bit].clear();
+            }
+            else
+            {
+                readersSinceWrite[bit].push_back(taskId);
+            }
+        }
+
+        std::sort(taskDependencies.begin(), taskDependencies.end());
+        taskDependencies.erase(std::unique(taskDependencies.begin(), taskDependencies.end()), taskDependencies.end());
+        taskDependencies.erase(std::remove(taskDependencies.begin(), taskDependencies.end(), taskId), taskDependencies.end());
+
+        for (uint32_t dependency : taskDependencies)
+            dependents[dependency].push_back(taskId);
+
+        pendingDependencies[taskId].store(static_cast<uint32_t>(taskDependencies.size()));
+    }
+}
+
+void FrameSchedulerImpl::Launch(uint32_t taskId)
+{
+    auto job = [this, taskId]() { Execute(taskId); };
+    if (tasks[taskId].bMainThread)
+        JobSystem::RunOnMainThread(job, &frameCounter);
+    else
+        JobSystem::Run(job, &frameCounter);
+}
+
+void FrameSchedulerImpl::Execute(uint32_t taskId)
+{
+    const auto& task = tasks[taskId];
+    ZoneTransientN(zone, task.name.c_str(), true);
+
+    taskStart[taskId] = Clock::now();
+    task.function();
+    taskEnd[taskId] = Clock::now();
+
+    // the last dependency to finish launches the task
+    for (uint32_t dependent : dependents[taskId])
+        if (pendingDependencies[dependent].fetch_sub(1) == 1)
+            Launch(dependent);
+}
+
+void FrameSchedulerImpl::BuildReport()
+{
+    uint32_t taskCount = static_cast<uint32_t>(tasks.size());
+    auto toMilliseconds = [this](Clock::time_point time) {
+        return std::chrono::duration<double, std::milli>(time - frameStart).count();
+    };
+
+    FrameTaskReport& report = lastReport;
+    report.frame = frame;
+    report.busyMilliseconds = 0.0;
+    report.wallMilliseconds = 0.0;
+    report.taskStart.assign(taskCount, 0.0);
+    report.taskDuration.assign(taskCount, 0.0);
+    report.criticalPath.clear();
+
+    // dependencies always come first in registration order, so a single pass finds the longest chain
+    std::vector<double> pathLength(taskCount, 0.0);
+    std::vector<int32_t> pathPrevious(taskCount, -1);
+    int32_t pathEnd = -1;
+
+    for (uint32_t taskId = 0; taskId < taskCount; taskId++)
+    {
+        if (!tasks[taskId].bEnabled)
+            continue;
+
+        double duration = toMilliseconds(taskEnd[taskId]) - toMilliseconds(taskStart[taskId]);
+        report.taskStart[taskId] = toMilliseconds(taskStart[taskId]);
+        report.taskDuration[taskId] = duration;
+        report.busyMilliseconds += duration;
+        report.wallMilliseconds = std::max(report.wallMilliseconds, toMilliseconds(taskEnd[taskId]));
+        totalMilliseconds[taskId] += duration;
+
+        for (uint32_t dependency : dependencies[taskId])
+        {
+            if (pathLength[dependency] > pathLength[taskId])
+            {
+                pathLength[taskId] = pathLength[dependency];
+                pathPrevious[taskId] = static_cast<int32_t>(dependency);
+            }
+        }
+        pathLength[taskId] += duration;
+
+        if (pathEnd < 0 || pathLength[taskId] > pathLength[pathEnd])
+            pathEnd = static_cast<int32_t>(taskId);
+    }
+
+    for (int32_t taskId = pathEnd; taskId >= 0; taskId = pathPrevious[taskId])
+    {
+        report.criticalPath.push_back(static_cast<uint32_t>(taskId));
+        criticalPathCount[taskId]++;
+    }
+    std::reverse(report.criticalPath.begin(), report.criticalPath.end());
+    report.criticalPathMilliseconds = pathEnd >= 0 ? pathLength[pathEnd] : 0.0;
+
+    TracyPlot("Frame Tasks Critical Path (ms)", report.criticalPathMilliseconds);
+    TracyPlot("Frame Tasks Busy (ms)", report.busyMilliseconds);
+}
+
+void FrameSchedulerImpl::WriteReport()
+{
+    if (!reportFile.is_open())
+        return;
+
+    reportFile << std::fixed << std::setprecision(4) << lastReport.frame << "," << lastReport.wallMilliseconds << ","
+               << lastReport.busyMilliseconds << "," << lastReport.criticalPathMilliseconds << ",";
+
+    for (size_t i = 0; i < lastReport.criticalPath.size(); i++)
+    {
+        uint32_t taskId = lastReport.criticalPath[i];
+        reportFile << (i > 0 ? " > " : "") << tasks[taskId].name << " (" << lastReport.taskDuration[taskId] << ")";
+    }
+    reportFile << "\n";
+}
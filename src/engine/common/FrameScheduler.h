@@ -0,0 +1,111 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_FRAMESCHEDULER_H
+#define VULKAN_ENGINE_FRAMESCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+
+// what frame tasks read and write, tasks touching the same resource run in the order they were registered
+enum EFrameResource
+{
+    FRAME_RESOURCE_INPUT        = 1 << 0,   // window events, input state
+    FRAME_RESOURCE_SCENE        = 1 << 1,   // simulation state
+    FRAME_RESOURCE_AUDIO        = 1 << 2,
+    FRAME_RESOURCE_RENDER       = 1 << 3    // render extraction (render packets, recording)
+};
+
+struct FrameTask
+{
+    std::string name;
+    uint32_t reads;     // EFrameResource bits
+    uint32_t writes;    // EFrameResource bits
+    std::function<void()> function;
+    bool bMainThread;   // for GLFW and anything else bound to the main thread
+    bool bEnabled = true;
+};
+
+// timings of a frame, relative to the start of FrameScheduler::Run
+struct FrameTaskReport
+{
+    uint64_t frame = 0;
+    double wallMilliseconds = 0.0;
+    double busyMilliseconds = 0.0;          // sum of every task's duration
+    double criticalPathMilliseconds = 0.0;
+    std::vector<uint32_t> criticalPath;     // task ids, first to last
+    std::vector<double> taskStart;          // per task id, in ms
+    std::vector<double> taskDuration;       // per task id, in ms (0 for disabled ones)
+};
+
+struct FrameSchedulerImpl
+{
+    typedef std::chrono::steady_clock Clock;
+
+    FrameSchedulerImpl();
+    ~FrameSchedulerImpl();
+
+    void BuildGraph();
+    void Launch(uint32_t taskId);
+    void Execute(uint32_t taskId);
+    void BuildReport();
+    void WriteReport();
+
+    std::vector<FrameTask> tasks;
+
+    // rebuilt every frame from the enabled tasks
+    std::vector<std::vector<uint32_t>> dependencies;
+    std::vector<std::vector<uint32_t>> dependents;
+    std::unique_ptr<std::atomic<uint32_t>[]> pendingDependencies;
+    uint32_t pendingCapacity = 0;
+
+    JobCounter frameCounter;
+    Clock::time_point frameStart;
+    std::vector<Clock::time_point> taskStart;
+    std::vector<Clock::time_point> taskEnd;
+
+    uint64_t frame = 0;
+    FrameTaskReport lastReport;
+
+    // how often each task bounded the frame, and its total time, for the summary
+    std::vector<uint32_t> criticalPathCount;
+    std::vector<double> totalMilliseconds;
+
+    std::ofstream reportFile; // per frame critical path, if configured
+};
+
+// Per-frame tasks of the engine's subsystems. Every task declares what it reads and writes, and each frame the
+// scheduler turns them into a DAG (a task waits for the earlier tasks that write what it touches, or read what it
+// writes) and runs it on the job system, so independent subsystems update at the same time.
+// After the frame the longest chain of dependent tasks, the one that bounds the frame time, is reported.
+class FrameScheduler
+{
+public:
+    static void Init();
+    static void Shutdown();
+
+    // tasks are ordered by registration when they conflict, returns the task id
+    static uint32_t RegisterTask(const std::string& sName, uint32_t reads, uint32_t writes,
+                                 const std::function<void()>& function, bool bMainThread = false);
+    static void SetTaskEnabled(uint32_t taskId, bool bEnabled);
+
+    // builds and runs the frame's graph, call from the main thread, returns once every task is done
+    static void Run();
+
+    static const FrameTaskReport& GetLastReport();
+    static std::string GetTaskName(uint32_t taskId);
+
+    // which tasks bounded the frames so far, and how long they took on average
+    static void ReportStatistics();
+};
+
+
+#endif //VULKAN_ENGINE_FRAMESCHEDULER_H
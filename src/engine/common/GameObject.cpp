@@ -3,3 +3,41 @@
 //
 
 #include "GameObject.h"
+#include <glm/common.hpp>
+#include <glm/trigonometric.hpp>
+#include <cmath>
+
+Transform InterpolateTransform(const Transform &previous, const Transform &current, float fAlpha)
+{
+    // rotation is in whole degrees, wrapped to [0, 360)
+    int32_t from = static_cast<int32_t>(previous.rotation % 360);
+    int32_t delta = static_cast<int32_t>(current.rotation % 360) - from;
+    if (delta > 180)
+        delta -= 360;
+    else if (delta < -180)
+        delta += 360;
+
+    int32_t rotation = from + static_cast<int32_t>(glm::round(static_cast<float>(delta) * fAlpha));
+
+    Transform transform{};
+    transform.position = glm::mix(previous.position, current.position, fAlpha);
+    transform.rotation = static_cast<uint32_t>((rotation + 360) % 360);
+    transform.scale = glm::mix(previous.scale, current.scale, fAlpha);
+    return transform;
+}
+
+glm::mat4 ComposeTransformMatrix(const glm::vec2 &position, uint32_t rotation, const glm::vec2 &scale)
+{
+    float radians = glm::radians(static_cast<float>(rotation % 360));
+    float c = std::cos(radians);
+    float s = std::sin(radians);
+
+    glm::mat4 matrix(1.0f);
+    matrix[0][0] = c * scale.x;
+    matrix[0][1] = s * scale.x;
+    matrix[1][0] = -s * scale.y;
+    matrix[1][1] = c * scale.y;
+    matrix[3][0] = position.x;
+    matrix[3][1] = position.y;
+    return matrix;
+}
@@ -5,7 +5,9 @@
 #ifndef VULKAN_ENGINE_GAMEOBJECT_H
 #define VULKAN_ENGINE_GAMEOBJECT_H
 
+#include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
+#include <cstdint>
 
 struct Transform {
     glm::vec2 position;
@@ -13,6 +15,12 @@ struct Transform {
     glm::vec2 scale;
 };
 
+// blends two simulated states for rendering, rotation takes the shortest way around
+Transform InterpolateTransform(const Transform& previous, const Transform& current, float fAlpha);
+
+// 2D translation * rotation (degrees, around Z) * scale
+glm::mat4 ComposeTransformMatrix(const glm::vec2& position, uint32_t rotation, const glm::vec2& scale);
+
 class GameObject
 {
 public:
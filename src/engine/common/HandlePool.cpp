@@ -0,0 +1,20 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "HandlePool.h"
+#include "../profiling/Logger.h"
+
+void ReportHandlePoolStatistics(const std::string& sTypeName, const HandlePoolStatistics& statistics)
+{
+    std::string message = sTypeName + " handles: " + std::to_string(statistics.alive) + " alive (peak " +
+                          std::to_string(statistics.peak) + ", " + std::to_string(statistics.capacity) + " slots), " +
+                          std::to_string(statistics.created) + " created, " + std::to_string(statistics.destroyed) +
+                          " destroyed, " + std::to_string(statistics.staleLookups) + " stale lookups";
+
+    // stale lookups mean something kept a handle past the object's lifetime
+    if (statistics.staleLookups > 0)
+        Logger::Warn(message);
+    else
+        Logger::Info(message);
+}
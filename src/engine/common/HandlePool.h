@@ -0,0 +1,172 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_HANDLEPOOL_H
+#define VULKAN_ENGINE_HANDLEPOOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+const uint32_t INVALID_HANDLE_INDEX = ~0u;
+
+// Reference to an object in a THandlePool. The type only keeps handles of different resources from being mixed up,
+// the generation tells a live object from one that was destroyed (and whose slot may have been reused since).
+template<typename T>
+struct THandle
+{
+    uint32_t index = INVALID_HANDLE_INDEX;
+    uint32_t generation = 0;
+
+    bool IsNull() const { return index == INVALID_HANDLE_INDEX; }
+
+    bool operator==(const THandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const THandle& other) const { return !(*this == other); }
+};
+
+struct HandlePoolStatistics
+{
+    uint32_t alive = 0;
+    uint32_t capacity = 0;          // slots, alive or free
+    uint32_t peak = 0;              // most alive at once
+    uint64_t created = 0;
+    uint64_t destroyed = 0;
+    uint64_t staleLookups = 0;      // lookups with a destroyed (or never created) handle, null handles aren't counted
+};
+
+// logs the statistics of a pool, one line per pool
+void ReportHandlePoolStatistics(const std::string& sTypeName, const HandlePoolStatistics& statistics);
+
+// Objects addressed by THandle: they live in one contiguous array, so a lookup is a bounds check, a generation compare
+// and an index. Destroyed slots go to a free list and are reused, and their generation is bumped so the handles that
+// still point at them are detected as stale.
+// The generation of a slot is odd while it is alive and even while it is free, so a handle can't match a free slot.
+// NOTE: Not thread safe, the owner locks if it's shared between threads
+template<typename T>
+class THandlePool
+{
+public:
+    typedef THandle<T> Handle;
+
+    explicit THandlePool(const std::string& sTypeName) : mTypeName(sTypeName) {}
+
+    Handle Create(T item)
+    {
+        uint32_t index;
+        if (!mFreeSlots.empty())
+        {
+            index = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            mItems[index] = std::move(item);
+        } else
+        {
+            index = static_cast<uint32_t>(mItems.size());
+            mItems.push_back(std::move(item));
+            mGenerations.push_back(0);
+        }
+
+        mGenerations[index]++;
+
+        mStatistics.alive++;
+        mStatistics.created++;
+        if (mStatistics.alive > mStatistics.peak)
+            mStatistics.peak = mStatistics.alive;
+
+        return Handle{index, mGenerations[index]};
+    }
+
+    // returns false (and does nothing) for a stale or null handle
+    bool Destroy(Handle handle)
+    {
+        if (!IsValid(handle))
+        {
+            CountStaleLookup(handle);
+            return false;
+        }
+
+        mItems[handle.index] = T(); // releases whatever the object holds on to
+        mGenerations[handle.index]++;
+        mFreeSlots.push_back(handle.index);
+
+        mStatistics.alive--;
+        mStatistics.destroyed++;
+        return true;
+    }
+
+    bool IsValid(Handle handle) const
+    {
+        return handle.index < mGenerations.size() && mGenerations[handle.index] == handle.generation;
+    }
+
+    // nullptr for a stale or null handle
+    T* Get(Handle handle)
+    {
+        if (!IsValid(handle))
+        {
+            CountStaleLookup(handle);
+            return nullptr;
+        }
+        return &mItems[handle.index];
+    }
+
+    const T* Get(Handle handle) const
+    {
+        return const_cast<THandlePool*>(this)->Get(handle);
+    }
+
+    // the function gets (Handle, T&) for every alive object, in slot order
+    template<typename Function>
+    void ForEach(Function function)
+    {
+        for (uint32_t i = 0; i < mItems.size(); i++)
+        {
+            if (mGenerations[i] & 1u)
+                function(Handle{i, mGenerations[i]}, mItems[i]);
+        }
+    }
+
+    // destroys every object, handles to them become stale
+    void Clear()
+    {
+        ForEach([this](Handle handle, T&) { Destroy(handle); });
+    }
+
+    uint32_t GetCount() const { return mStatistics.alive; }
+
+    HandlePoolStatistics GetStatistics() const
+    {
+        HandlePoolStatistics statistics = mStatistics;
+        statistics.capacity = static_cast<uint32_t>(mItems.size());
+        statistics.staleLookups = mStaleLookups.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+    void ReportStatistics() const
+    {
+        ReportHandlePoolStatistics(mTypeName, GetStatistics());
+    }
+
+private:
+    // a null handle never pointed at anything, only handles that outlived their object are stale
+    void CountStaleLookup(Handle handle) const
+    {
+        if (!handle.IsNull())
+            mStaleLookups.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::string mTypeName;
+
+    // by slot
+    std::vector<T> mItems;
+    std::vector<uint32_t> mGenerations;
+    std::vector<uint32_t> mFreeSlots;
+
+    HandlePoolStatistics mStatistics;
+    mutable std::atomic<uint64_t> mStaleLookups{0}; // lookups are const and may come from several readers
+};
+
+
+#endif //VULKAN_ENGINE_HANDLEPOOL_H
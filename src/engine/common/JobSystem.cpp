@@ -0,0 +1,524 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "JobSystem.h"
+#include "Config.h"
+#include "../profiling/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#ifdef TRACY_ENABLE
+#include <common/TracySystem.hpp>
+#endif
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+JobSystemImpl* mJobSystemImpl = nullptr;
+
+// index of the worker running on this thread, 0 is the main thread
+thread_local uint32_t currentThreadIdx = ~0u;
+// picks the first worker to steal from
+thread_local uint32_t stealSeed = 2463534242u;
+
+//
+// Initialization/Destruction
+//
+
+void JobSystem::Init()
+{
+    uint32_t workerCount = Config::GetJobWorkerCount();
+    if (workerCount == 0)
+        workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+
+    Init(workerCount);
+}
+
+void JobSystem::Init(uint32_t workerCount)
+{
+    if (mJobSystemImpl != nullptr)
+        Shutdown();
+
+    Logger::Info("Initializing job system with " + std::to_string(workerCount) + " worker threads");
+    currentThreadIdx = 0;
+    mJobSystemImpl = new JobSystemImpl(workerCount);
+}
+
+void JobSystem::Shutdown()
+{
+    if (mJobSystemImpl == nullptr)
+        return;
+
+    delete mJobSystemImpl;
+    mJobSystemImpl = nullptr;
+    currentThreadIdx = ~0u;
+}
+
+JobSystemImpl::JobSystemImpl(uint32_t workerCount)
+{
+    workers.resize(workerCount + 1);
+    for (auto& worker : workers)
+        worker = std::make_unique<JobWorker>();
+
+    // threads start once every deque exists, since they steal from each other right away
+    for (uint32_t i = 1; i < workers.size(); i++)
+        workers[i]->thread = std::thread(&JobSystemImpl::WorkerLoop, this, i);
+}
+
+JobSystemImpl::~JobSystemImpl()
+{
+    // whatever is still queued runs before the workers stop
+    while (RunOneJob(0))
+        ;
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        bRunning.store(false);
+    }
+    sleepCondition.notify_all();
+
+    for (auto& worker : workers)
+        if (worker->thread.joinable())
+            worker->thread.join();
+}
+
+//
+// External
+//
+
+bool JobSystem::IsInitialized()
+{
+    return mJobSystemImpl != nullptr;
+}
+
+uint32_t JobSystem::GetThreadCount()
+{
+    if (mJobSystemImpl == nullptr)
+        return 1;
+
+    return static_cast<uint32_t>(mJobSystemImpl->workers.size());
+}
+
+uint32_t JobSystem::GetCurrentThreadIdx()
+{
+    return currentThreadIdx;
+}
+
+void JobSystem::Run(const JobFunction &function, JobCounter *counter)
+{
+    // without the job system everything runs right away
+    if (mJobSystemImpl == nullptr)
+    {
+        function();
+        return;
+    }
+
+    if (counter != nullptr)
+        counter->value.fetch_add(1);
+
+    mJobSystemImpl->Schedule(new Job{ function, counter });
+}
+
+void JobSystem::Run(const std::vector<JobFunction> &functions, JobCounter *counter)
+{
+    for (auto& function : functions)
+        Run(function, counter);
+}
+
+void JobSystem::RunAfter(JobCounter &dependency, const JobFunction &function, JobCounter *counter)
+{
+    if (mJobSystemImpl == nullptr)
+    {
+        function();
+        return;
+    }
+
+    if (counter != nullptr)
+        counter->value.fetch_add(1);
+
+    Job* job = new Job{ function, counter };
+    {
+        // the last job of the dependency takes the continuations under the same lock, so checking the value here
+        // can't miss it reaching zero
+        std::lock_guard<std::mutex> lock(dependency.continuationMutex);
+        if (dependency.value.load() > 0)
+        {
+            dependency.continuations.push_back(job);
+            return;
+        }
+    }
+
+    mJobSystemImpl->Schedule(job);
+}
+
+void JobSystem::RunOnMainThread(const JobFunction &function, JobCounter *counter)
+{
+    if (mJobSystemImpl == nullptr || currentThreadIdx == 0)
+    {
+        function();
+        return;
+    }
+
+    if (counter != nullptr)
+        counter->value.fetch_add(1);
+
+    std::lock_guard<std::mutex> lock(mJobSystemImpl->mainThreadMutex);
+    mJobSystemImpl->mainThreadJobs.push_back(new Job{ function, counter });
+}
+
+void JobSystem::ProcessMainThreadJobs()
+{
+    if (mJobSystemImpl == nullptr || currentThreadIdx != 0)
+        return;
+
+    std::deque<Job*> jobs;
+    {
+        std::lock_guard<std::mutex> lock(mJobSystemImpl->mainThreadMutex);
+        jobs.swap(mJobSystemImpl->mainThreadJobs);
+    }
+
+    for (Job* job : jobs)
+        mJobSystemImpl->Execute(job);
+}
+
+void JobSystem::Wait(JobCounter &counter)
+{
+    while (!counter.IsDone())
+    {
+        if (mJobSystemImpl == nullptr || !mJobSystemImpl->RunOneJob(currentThreadIdx))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t minChunkSize, const std::function<void(uint32_t, uint32_t)> &function)
+{
+    if (count == 0)
+        return;
+
+    // a few chunks per thread, so threads that finish early can steal the rest
+    uint32_t maxChunks = (count + minChunkSize - 1) / std::max(minChunkSize, 1u);
+    uint32_t chunkCount = std::min(GetThreadCount() * 4, maxChunks);
+    if (chunkCount <= 1 || GetThreadCount() == 1)
+    {
+        function(0, count);
+        return;
+    }
+
+    uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    JobCounter counter;
+    for (uint32_t begin = chunkSize; begin < count; begin += chunkSize)
+    {
+        uint32_t end = std::min(begin + chunkSize, count);
+        Run([&function, begin, end]() { function(begin, end); }, &counter);
+    }
+
+    function(0, std::min(chunkSize, count));
+    Wait(counter);
+}
+
+void JobSystem::RunBenchmark()
+{
+    const uint32_t itemCount = 10000000;
+    const uint32_t jobCount = 100000;
+
+    bool bOwnsJobSystem = mJobSystemImpl == nullptr;
+    uint32_t previousWorkerCount = GetThreadCount() - 1;
+
+    Logger::Info("Job system benchmark: parallel for over " + std::to_string(itemCount) + " items, " +
+                 std::to_string(jobCount) + " tiny jobs with fan-in and a chain of continuations, " +
+                 std::to_string(std::thread::hardware_concurrency()) + " hardware threads");
+
+    std::vector<float> items(itemCount);
+    double parallelForBaseline = 0.0;
+    double expectedSum = 0.0;
+
+    for (uint32_t threadCount : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+    {
+        Init(threadCount - 1);
+
+        // compute bound parallel for
+        auto start = std::chrono::steady_clock::now();
+        ParallelFor(itemCount, 4096, [&items](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+                items[i] = std::sqrt(static_cast<float>(i)) * std::sin(static_cast<float>(i) * 0.001f);
+        });
+        double parallelForMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // fan-out of tiny jobs, then fan-in on a single counter
+        std::atomic<uint64_t> sum{0};
+        JobCounter fanIn;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < jobCount; i++)
+            Run([&sum, i]() { sum.fetch_add(i, std::memory_order_relaxed); }, &fanIn);
+        Wait(fanIn);
+        double fanInMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // stages of 64 jobs, each one started by the end of the previous stage
+        const uint32_t stageCount = 64;
+        std::atomic<uint32_t> stagesRun{0};
+        std::vector<std::unique_ptr<JobCounter>> stages;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t stage = 0; stage < stageCount; stage++)
+        {
+            stages.push_back(std::make_unique<JobCounter>());
+            for (uint32_t i = 0; i < 64; i++)
+            {
+                auto job = [&stagesRun]() { stagesRun.fetch_add(1, std::memory_order_relaxed); };
+                if (stage == 0)
+                    Run(job, stages[stage].get());
+                else
+                    RunAfter(*stages[stage - 1], job, stages[stage].get());
+            }
+        }
+        Wait(*stages.back());
+        double chainMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        double checkSum = 0.0;
+        for (uint32_t i = 0; i < itemCount; i += 997)
+            checkSum += items[i];
+
+        if (threadCount == 1)
+        {
+            parallelForBaseline = parallelForMilliseconds;
+            expectedSum = checkSum;
+        }
+
+        bool bCorrect = checkSum == expectedSum &&
+                        sum.load() == static_cast<uint64_t>(jobCount) * (jobCount - 1) / 2 &&
+                        stagesRun.load() == stageCount * 64;
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3) << "  " << threadCount << " threads: parallel for " << parallelForMilliseconds
+           << " ms (" << std::setprecision(2) << parallelForBaseline / parallelForMilliseconds << "x), "
+           << std::setprecision(3) << jobCount << " jobs " << fanInMilliseconds << " ms ("
+           << fanInMilliseconds * 1000000.0 / jobCount << " ns/job), chain " << chainMilliseconds << " ms"
+           << (bCorrect ? "" : " MISMATCH");
+        Logger::Info(ss.str());
+    }
+
+    if (bOwnsJobSystem)
+        Shutdown();
+    else
+        Init(previousWorkerCount);
+}
+
+//
+// Implementation
+//
+
+bool JobDeque::Push(Job *job)
+{
+    int64_t bottom = mBottom.load(std::memory_order_relaxed);
+    int64_t top = mTop.load(std::memory_order_acquire);
+    if (bottom - top >= CAPACITY)
+        return false;
+
+    mJobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mBottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job *JobDeque::Pop()
+{
+    int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+    mBottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = mTop.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // empty
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = mJobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // last job, a thief might be taking it at the same time
+        if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+Job *JobDeque::Steal()
+{
+    int64_t top = mTop.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = mBottom.load(std::memory_order_acquire);
+    if (top >= bottom)
+        return nullptr;
+
+    Job* job = mJobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr; // lost the race to another thief or the owner
+
+    return job;
+}
+
+bool JobDeque::IsEmpty() const
+{
+    return mBottom.load(std::memory_order_relaxed) <= mTop.load(std::memory_order_relaxed);
+}
+
+void JobSystemImpl::WorkerLoop(uint32_t workerIdx)
+{
+    currentThreadIdx = workerIdx;
+
+#ifdef TRACY_ENABLE
+    std::string sName = "Job Worker " + std::to_string(workerIdx);
+    tracy::SetThreadName(sName.c_str());
+#endif
+
+    const uint32_t spinCount = 64;
+    uint32_t idle = 0;
+    while (bRunning.load(std::memory_order_relaxed))
+    {
+        if (RunOneJob(workerIdx))
+        {
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < spinCount)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // nothing to do for a while, sleep until a job is pushed
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingWorkers.fetch_add(1);
+        if (bRunning.load() && !HasWork())
+            sleepCondition.wait_for(lock, std::chrono::milliseconds(10));
+        sleepingWorkers.fetch_sub(1);
+        idle = 0;
+    }
+
+    currentThreadIdx = ~0u;
+}
+
+void JobSystemImpl::Schedule(Job *job)
+{
+    uint32_t workerIdx = currentThreadIdx;
+    if (workerIdx < workers.size())
+    {
+        // a full deque means there's plenty of work already, run it here instead of growing
+        if (!workers[workerIdx]->deque.Push(job))
+        {
+            Execute(job);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedJobs.push_back(job);
+    }
+
+    // pairs with the sleeping worker incrementing the count before checking for work
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepingWorkers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCondition.notify_one();
+    }
+}
+
+bool JobSystemImpl::RunOneJob(uint32_t workerIdx)
+{
+    Job* job = nullptr;
+
+    if (workerIdx < workers.size())
+        job = workers[workerIdx]->deque.Pop();
+
+    // the main thread takes care of its own jobs while it waits
+    if (job == nullptr && workerIdx == 0)
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        if (!mainThreadJobs.empty())
+        {
+            job = mainThreadJobs.front();
+            mainThreadJobs.pop_front();
+        }
+    }
+
+    if (job == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (!sharedJobs.empty())
+        {
+            job = sharedJobs.front();
+            sharedJobs.pop_front();
+        }
+    }
+
+    // steal, starting from a random worker so thieves don't all go after the same one
+    if (job == nullptr && workers.size() > 1)
+    {
+        stealSeed ^= stealSeed << 13;
+        stealSeed ^= stealSeed >> 17;
+        stealSeed ^= stealSeed << 5;
+
+        uint32_t count = static_cast<uint32_t>(workers.size());
+        for (uint32_t i = 0; i < count && job == nullptr; i++)
+        {
+            uint32_t victim = (stealSeed + i) % count;
+            if (victim != workerIdx)
+                job = workers[victim]->deque.Steal();
+        }
+    }
+
+    if (job == nullptr)
+        return false;
+
+    Execute(job);
+    return true;
+}
+
+void JobSystemImpl::Execute(Job *job)
+{
+    job->function();
+    FinishJob(job->counter);
+    delete job;
+}
+
+void JobSystemImpl::FinishJob(JobCounter *counter)
+{
+    if (counter == nullptr)
+        return;
+
+    counter->finishing.fetch_add(1);
+    if (counter->value.fetch_sub(1) == 1)
+    {
+        std::vector<Job*> continuations;
+        {
+            std::lock_guard<std::mutex> lock(counter->continuationMutex);
+            continuations.swap(counter->continuations);
+        }
+
+        for (Job* continuation : continuations)
+            Schedule(continuation);
+    }
+    // last access, whoever waits on the counter may destroy it from here on
+    counter->finishing.fetch_sub(1);
+}
+
+bool JobSystemImpl::HasWork()
+{
+    for (auto& worker : workers)
+        if (!worker->deque.IsEmpty())
+            return true;
+
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    return !sharedJobs.empty();
+}
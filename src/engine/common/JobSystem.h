@@ -0,0 +1,135 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_JOBSYSTEM_H
+#define VULKAN_ENGINE_JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> JobFunction;
+
+struct JobCounter;
+
+struct Job
+{
+    JobFunction function;
+    JobCounter* counter = nullptr; // decremented once the job has run
+};
+
+// Fan-in: every job started with a counter increments it, and decrements it once it's done. Wait on a counter to
+// know its jobs are finished, or start jobs after it to chain them.
+struct JobCounter
+{
+    // the finishing count keeps a counter that just reached zero alive until its last job is done touching it
+    bool IsDone() const { return value.load() == 0 && finishing.load() == 0; }
+
+    std::atomic<int32_t> value{0};
+    std::atomic<int32_t> finishing{0};
+
+    // jobs waiting for this counter to reach zero (see JobSystem::RunAfter)
+    std::mutex continuationMutex;
+    std::vector<Job*> continuations;
+};
+
+// Chase-Lev work stealing deque: the owner pushes and pops at the bottom, other workers steal from the top.
+// Capacity is fixed, a full deque makes the caller run the job right away.
+class JobDeque
+{
+public:
+    static constexpr int64_t CAPACITY = 4096; // power of two
+
+    bool Push(Job* job);
+    Job* Pop();
+    Job* Steal();
+    bool IsEmpty() const;
+
+private:
+    alignas(64) std::atomic<int64_t> mTop{0};
+    alignas(64) std::atomic<int64_t> mBottom{0};
+    alignas(64) std::atomic<Job*> mJobs[CAPACITY];
+};
+
+struct JobWorker
+{
+    JobDeque deque;
+    std::thread thread; // none for the main thread (worker 0)
+};
+
+struct JobSystemImpl
+{
+    explicit JobSystemImpl(uint32_t workerCount);
+    ~JobSystemImpl();
+
+    void WorkerLoop(uint32_t workerIdx);
+    void Schedule(Job* job);
+    bool RunOneJob(uint32_t workerIdx);
+    void Execute(Job* job);
+    void FinishJob(JobCounter* counter);
+    bool HasWork();
+
+    std::vector<std::unique_ptr<JobWorker>> workers; // 0 is the main thread
+    std::atomic<bool> bRunning{true};
+
+    // woken up when jobs are pushed, so idle workers don't spin
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<uint32_t> sleepingWorkers{0};
+
+    // jobs started from threads the job system doesn't own (they have no deque)
+    std::mutex sharedMutex;
+    std::deque<Job*> sharedJobs;
+
+    // jobs that must run on the main thread (GLFW, ...)
+    std::mutex mainThreadMutex;
+    std::deque<Job*> mainThreadJobs;
+};
+
+// Work stealing job system: every worker thread (and the main thread) owns a Chase-Lev deque, jobs are pushed to the
+// deque of the thread that starts them and idle workers steal from the others.
+// Waiting on a counter never blocks, the waiting thread runs other jobs in the meantime.
+class JobSystem
+{
+public:
+    // worker count from the config ([Jobs] WorkerCount), one per core besides the main thread when it's 0
+    static void Init();
+    // the calling thread becomes the main thread, 0 workers runs every job on it
+    static void Init(uint32_t workerCount);
+    static void Shutdown();
+    static bool IsInitialized();
+
+    // worker threads plus the main thread
+    static uint32_t GetThreadCount();
+    // index of the calling thread (0 for the main thread), ~0u for threads the job system doesn't know
+    static uint32_t GetCurrentThreadIdx();
+
+    static void Run(const JobFunction& function, JobCounter* counter = nullptr);
+    static void Run(const std::vector<JobFunction>& functions, JobCounter* counter);
+
+    // starts the job once the dependency reaches zero (right away if it already has)
+    static void RunAfter(JobCounter& dependency, const JobFunction& function, JobCounter* counter = nullptr);
+
+    // for code that has to run on the main thread (GLFW), executed by ProcessMainThreadJobs or while the main thread waits
+    static void RunOnMainThread(const JobFunction& function, JobCounter* counter = nullptr);
+    static void ProcessMainThreadJobs();
+
+    // runs other jobs until the counter reaches zero
+    static void Wait(JobCounter& counter);
+
+    // splits [0, count) in chunks (a few per thread, at least minChunkSize items) and waits for all of them
+    static void ParallelFor(uint32_t count, uint32_t minChunkSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+    // fan-out/fan-in, parallel_for and tiny job overhead with 1 to 64 threads
+    static void RunBenchmark();
+};
+
+
+#endif //VULKAN_ENGINE_JOBSYSTEM_H
@@ -0,0 +1,16 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "Parallel.h"
+#include "JobSystem.h"
+
+void ParallelFor(uint32_t count, uint32_t minChunkSize, const std::function<void(uint32_t, uint32_t)> &fn)
+{
+    JobSystem::ParallelFor(count, minChunkSize, fn);
+}
+
+uint32_t GetParallelThreadCount()
+{
+    return JobSystem::GetThreadCount();
+}
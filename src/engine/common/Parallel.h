@@ -0,0 +1,19 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_PARALLEL_H
+#define VULKAN_ENGINE_PARALLEL_H
+
+#include <cstdint>
+#include <functional>
+
+// runs fn over [0, count) split in chunks of at least minChunkSize items on the job system (see JobSystem::ParallelFor),
+// the calling thread takes the first chunk and runs everything when the job system isn't initialized
+void ParallelFor(uint32_t count, uint32_t minChunkSize, const std::function<void(uint32_t begin, uint32_t end)>& fn);
+
+// how many threads ParallelFor spreads the work over (calling thread included)
+uint32_t GetParallelThreadCount();
+
+
+#endif //VULKAN_ENGINE_PARALLEL_H
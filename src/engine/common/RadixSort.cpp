@@ -0,0 +1,86 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "RadixSort.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <array>
+
+// below this, a chunk costs more to hand out than to sort
+const uint32_t MIN_RADIX_CHUNK_SIZE = 8192;
+
+const uint32_t RADIX_BITS = 8;
+const uint32_t RADIX_BUCKETS = 1u << RADIX_BITS;
+
+void RadixSort(std::vector<SortItem> &items, std::vector<SortItem> &scratch)
+{
+    auto count = static_cast<uint32_t>(items.size());
+    if (count < 2)
+        return;
+
+    scratch.resize(count);
+
+    uint32_t chunkSize = std::max(MIN_RADIX_CHUNK_SIZE, (count + GetParallelThreadCount() - 1) / GetParallelThreadCount());
+    uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    // bits that are set in some keys but not in others, only their bytes need a pass
+    uint64_t anyBits = 0, allBits = ~0ull;
+    for (const auto& item : items)
+    {
+        anyBits |= item.key;
+        allBits &= item.key;
+    }
+    uint64_t changingBits = anyBits ^ allBits;
+
+    std::vector<std::array<uint32_t, RADIX_BUCKETS>> histograms(chunkCount);
+    SortItem* source = items.data();
+    SortItem* destination = scratch.data();
+
+    for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS)
+    {
+        if (((changingBits >> shift) & (RADIX_BUCKETS - 1)) == 0)
+            continue;
+
+        ParallelFor(chunkCount, 1, [&](uint32_t firstChunk, uint32_t lastChunk) {
+            for (uint32_t chunk = firstChunk; chunk < lastChunk; chunk++)
+            {
+                auto& histogram = histograms[chunk];
+                histogram.fill(0);
+
+                uint32_t end = std::min(count, (chunk + 1) * chunkSize);
+                for (uint32_t i = chunk * chunkSize; i < end; i++)
+                    histogram[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+            }
+        });
+
+        // where every chunk starts writing each digit: digits in order, then chunks in order (keeps the sort stable)
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < RADIX_BUCKETS; digit++)
+        {
+            for (auto& histogram : histograms)
+            {
+                uint32_t digitCount = histogram[digit];
+                histogram[digit] = offset;
+                offset += digitCount;
+            }
+        }
+
+        ParallelFor(chunkCount, 1, [&](uint32_t firstChunk, uint32_t lastChunk) {
+            for (uint32_t chunk = firstChunk; chunk < lastChunk; chunk++)
+            {
+                auto& offsets = histograms[chunk];
+
+                uint32_t end = std::min(count, (chunk + 1) * chunkSize);
+                for (uint32_t i = chunk * chunkSize; i < end; i++)
+                    destination[offsets[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+            }
+        });
+
+        std::swap(source, destination);
+    }
+
+    // an odd number of passes leaves the result in the scratch buffer
+    if (source != items.data())
+        items.swap(scratch);
+}
@@ -0,0 +1,23 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_RADIXSORT_H
+#define VULKAN_ENGINE_RADIXSORT_H
+
+#include <cstdint>
+#include <vector>
+
+struct SortItem
+{
+    uint64_t key;
+    uint32_t value;
+};
+
+// Stable LSD radix sort (8 bits per pass) on the keys. Histograms and scatters are spread over worker threads and
+// passes over bytes that are the same in every key are skipped, so narrow keys only pay for the bits they use.
+// scratch is only there so its memory can be reused between calls
+void RadixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch);
+
+
+#endif //VULKAN_ENGINE_RADIXSORT_H
@@ -0,0 +1,67 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "Simd.h"
+
+#if SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+ESimdLevel DetectSimdLevel()
+{
+#if SIMD_X86 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool bSse41 = (info[2] & (1 << 19)) != 0;
+    bool bOsSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+    bool bAvx2 = false;
+    if (maxLeaf >= 7 && bOsSavesAvx)
+    {
+        __cpuidex(info, 7, 0);
+        bAvx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    return bAvx2 ? SIMD_AVX2 : (bSse41 ? SIMD_SSE41 : SIMD_SCALAR);
+#elif SIMD_X86
+    // also checks that the OS saves the AVX registers
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return SIMD_SSE41;
+    return SIMD_SCALAR;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+ESimdLevel Simd::GetBestLevel()
+{
+    static ESimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+bool Simd::IsSupported(ESimdLevel eLevel)
+{
+    return eLevel <= GetBestLevel();
+}
+
+std::string Simd::ToString(ESimdLevel eLevel)
+{
+    switch (eLevel)
+    {
+        case SIMD_SCALAR:
+            return "Scalar";
+        case SIMD_SSE41:
+            return "SSE4.1";
+        case SIMD_AVX2:
+            return "AVX2";
+    }
+
+    return "Unknown";
+}
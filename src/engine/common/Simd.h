@@ -0,0 +1,45 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_SIMD_H
+#define VULKAN_ENGINE_SIMD_H
+
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+// SSE4.1/AVX2 kernels are compiled per function, so the engine still runs on CPUs without them
+// NOTE: MSVC doesn't need this, it accepts any intrinsic anywhere
+#if SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_SSE41
+#define SIMD_TARGET_AVX2
+#endif
+
+enum ESimdLevel
+{
+    SIMD_SCALAR,
+    SIMD_SSE41,
+    SIMD_AVX2
+};
+
+class Simd
+{
+public:
+    // the best instruction set supported by both the CPU and the OS
+    static ESimdLevel GetBestLevel();
+    static bool IsSupported(ESimdLevel eLevel);
+
+    static std::string ToString(ESimdLevel eLevel);
+};
+
+
+#endif //VULKAN_ENGINE_SIMD_H
@@ -0,0 +1,48 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "Frustum.h"
+#include <glm/geometric.hpp>
+#include <algorithm>
+
+Frustum Frustum::FromViewProjection(const glm::mat4 &viewProjection)
+{
+    // Gribb/Hartmann: the planes are combinations of the matrix rows (glm is column major, so m[column][row])
+    auto row = [&viewProjection](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+
+    Frustum frustum{};
+    frustum.planes[FRUSTUM_LEFT] = row(3) + row(0);
+    frustum.planes[FRUSTUM_RIGHT] = row(3) - row(0);
+    frustum.planes[FRUSTUM_BOTTOM] = row(3) + row(1);
+    frustum.planes[FRUSTUM_TOP] = row(3) - row(1);
+    frustum.planes[FRUSTUM_NEAR] = row(2); // 0..1 depth, for -1..1 this would be row(3) + row(2)
+    frustum.planes[FRUSTUM_FAR] = row(3) - row(2);
+
+    for (auto& plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    return frustum;
+}
+
+bool Frustum::IsSphereVisible(const glm::vec3 &center, float radius) const
+{
+    for (const auto& plane : planes)
+    {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+void TransformBoundingSphere(const glm::mat4 &transform, const glm::vec4 &localSphere, glm::vec3 &center, float &radius)
+{
+    center = glm::vec3(transform * glm::vec4(glm::vec3(localSphere), 1.0f));
+
+    float scale = std::max(glm::length(glm::vec3(transform[0])),
+                           std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    radius = localSphere.w * scale;
+}
@@ -0,0 +1,39 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_FRUSTUM_H
+#define VULKAN_ENGINE_FRUSTUM_H
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <array>
+
+enum EFrustumPlane
+{
+    FRUSTUM_LEFT,
+    FRUSTUM_RIGHT,
+    FRUSTUM_BOTTOM,
+    FRUSTUM_TOP,
+    FRUSTUM_NEAR,
+    FRUSTUM_FAR,
+    FRUSTUM_PLANE_COUNT
+};
+
+// six normalized planes (xyz = inward normal, w = distance), a point p is inside when dot(n, p) + d >= 0
+struct Frustum
+{
+    std::array<glm::vec4, FRUSTUM_PLANE_COUNT> planes;
+
+    // NOTE: Expects a vulkan style projection (depth in the 0..1 range)
+    static Frustum FromViewProjection(const glm::mat4& viewProjection);
+
+    bool IsSphereVisible(const glm::vec3& center, float radius) const;
+};
+
+// the bounding sphere of an object once it's been moved by its transform (radius scaled by the largest axis)
+void TransformBoundingSphere(const glm::mat4& transform, const glm::vec4& localSphere, glm::vec3& center, float& radius);
+
+
+#endif //VULKAN_ENGINE_FRUSTUM_H
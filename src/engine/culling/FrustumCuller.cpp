@@ -0,0 +1,514 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "FrustumCuller.h"
+#include "../common/Parallel.h"
+#include "../profiling/Logger.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <Tracy.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+// chunks smaller than this cost more to hand out than to cull
+const uint32_t MIN_CULLING_CHUNK_SIZE = 16384;
+
+// lane indices of the set bits of every mask, plus how many there are, so visible indices are written without branches
+template<uint32_t LANES>
+struct CompactionTable
+{
+    CompactionTable()
+    {
+        for (uint32_t mask = 0; mask < (1u << LANES); mask++)
+        {
+            count[mask] = 0;
+            for (uint32_t lane = 0; lane < LANES; lane++)
+            {
+                lanes[mask][lane] = 0;
+                if (mask & (1u << lane))
+                    lanes[mask][count[mask]++] = lane;
+            }
+        }
+    }
+
+    alignas(32) uint32_t lanes[1u << LANES][LANES];
+    uint32_t count[1u << LANES];
+};
+
+const CompactionTable<4> COMPACTION_TABLE_4;
+const CompactionTable<8> COMPACTION_TABLE_8;
+
+// NOTE: Every kernel computes a plane distance as ((nx * x + ny * y) + nz * z) + d, in that order and without FMA,
+//       so all of them agree bit for bit
+
+bool IsSphereInside(const Frustum& frustum, float x, float y, float z, float radius)
+{
+    for (const auto& plane : frustum.planes)
+    {
+        float distance = plane.x * x + plane.y * y + plane.z * z + plane.w;
+        if (!(distance >= -radius))
+            return false;
+    }
+
+    return true;
+}
+
+bool IsBoxInside(const Frustum& frustum, const Frustum& absFrustum, float x, float y, float z, float ex, float ey, float ez)
+{
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+    {
+        const auto& plane = frustum.planes[i];
+        const auto& absPlane = absFrustum.planes[i];
+
+        // the box's extent along the plane normal
+        float radius = absPlane.x * ex + absPlane.y * ey + absPlane.z * ez;
+        float distance = plane.x * x + plane.y * y + plane.z * z + plane.w;
+        if (!(distance >= -radius))
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t CullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end, uint32_t* visibleIndices)
+{
+    uint32_t visibleCount = 0;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        visibleIndices[visibleCount] = i;
+        visibleCount += IsSphereInside(frustum, spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], spheres.radius[i]) ? 1 : 0;
+    }
+
+    return visibleCount;
+}
+
+uint32_t CullBoxesScalar(const Frustum& frustum, const Frustum& absFrustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end,
+                         uint32_t* visibleIndices)
+{
+    uint32_t visibleCount = 0;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        visibleIndices[visibleCount] = i;
+        visibleCount += IsBoxInside(frustum, absFrustum, boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i],
+                                    boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]) ? 1 : 0;
+    }
+
+    return visibleCount;
+}
+
+#if SIMD_X86
+SIMD_TARGET_SSE41 uint32_t CullSpheresSse41(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end,
+                                            uint32_t* visibleIndices)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    uint32_t visibleCount = 0;
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(spheres.centerX.data() + i);
+        __m128 y = _mm_loadu_ps(spheres.centerY.data() + i);
+        __m128 z = _mm_loadu_ps(spheres.centerZ.data() + i);
+        __m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(spheres.radius.data() + i), signMask);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& plane : frustum.planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), z));
+            distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        auto mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+        __m128i indices = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(i)),
+                                        _mm_load_si128(reinterpret_cast<const __m128i*>(COMPACTION_TABLE_4.lanes[mask])));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(visibleIndices + visibleCount), indices);
+        visibleCount += COMPACTION_TABLE_4.count[mask];
+    }
+
+    return visibleCount + CullSpheresScalar(frustum, spheres, i, end, visibleIndices + visibleCount);
+}
+
+SIMD_TARGET_SSE41 uint32_t CullBoxesSse41(const Frustum& frustum, const Frustum& absFrustum, const BoundingBoxes& boxes, uint32_t begin,
+                                          uint32_t end, uint32_t* visibleIndices)
+{
+    uint32_t visibleCount = 0;
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(boxes.centerX.data() + i);
+        __m128 y = _mm_loadu_ps(boxes.centerY.data() + i);
+        __m128 z = _mm_loadu_ps(boxes.centerZ.data() + i);
+        __m128 ex = _mm_loadu_ps(boxes.extentX.data() + i);
+        __m128 ey = _mm_loadu_ps(boxes.extentY.data() + i);
+        __m128 ez = _mm_loadu_ps(boxes.extentZ.data() + i);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+        {
+            const auto& plane = frustum.planes[p];
+            const auto& absPlane = absFrustum.planes[p];
+
+            __m128 radius = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(absPlane.x), ex), _mm_mul_ps(_mm_set1_ps(absPlane.y), ey));
+            radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(absPlane.z), ez));
+
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), z));
+            distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(radius, _mm_set1_ps(-0.0f))));
+        }
+
+        auto mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+        __m128i indices = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(i)),
+                                        _mm_load_si128(reinterpret_cast<const __m128i*>(COMPACTION_TABLE_4.lanes[mask])));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(visibleIndices + visibleCount), indices);
+        visibleCount += COMPACTION_TABLE_4.count[mask];
+    }
+
+    return visibleCount + CullBoxesScalar(frustum, absFrustum, boxes, i, end, visibleIndices + visibleCount);
+}
+
+SIMD_TARGET_AVX2 uint32_t CullSpheresAvx2(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end,
+                                          uint32_t* visibleIndices)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    // the planes don't change, so they stay in registers for the whole loop
+    __m256 planeX[FRUSTUM_PLANE_COUNT], planeY[FRUSTUM_PLANE_COUNT], planeZ[FRUSTUM_PLANE_COUNT], planeW[FRUSTUM_PLANE_COUNT];
+    for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+    {
+        planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+        planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+        planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+        planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+    }
+
+    uint32_t visibleCount = 0;
+    uint32_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(spheres.centerX.data() + i);
+        __m256 y = _mm256_loadu_ps(spheres.centerY.data() + i);
+        __m256 z = _mm256_loadu_ps(spheres.centerZ.data() + i);
+        __m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(spheres.radius.data() + i), signMask);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(planeZ[p], z));
+            distance = _mm256_add_ps(distance, planeW[p]);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+
+        auto mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+        __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)),
+                                           _mm256_load_si256(reinterpret_cast<const __m256i*>(COMPACTION_TABLE_8.lanes[mask])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(visibleIndices + visibleCount), indices);
+        visibleCount += COMPACTION_TABLE_8.count[mask];
+    }
+
+    return visibleCount + CullSpheresScalar(frustum, spheres, i, end, visibleIndices + visibleCount);
+}
+
+SIMD_TARGET_AVX2 uint32_t CullBoxesAvx2(const Frustum& frustum, const Frustum& absFrustum, const BoundingBoxes& boxes, uint32_t begin,
+                                        uint32_t end, uint32_t* visibleIndices)
+{
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    uint32_t visibleCount = 0;
+    uint32_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(boxes.centerX.data() + i);
+        __m256 y = _mm256_loadu_ps(boxes.centerY.data() + i);
+        __m256 z = _mm256_loadu_ps(boxes.centerZ.data() + i);
+        __m256 ex = _mm256_loadu_ps(boxes.extentX.data() + i);
+        __m256 ey = _mm256_loadu_ps(boxes.extentY.data() + i);
+        __m256 ez = _mm256_loadu_ps(boxes.extentZ.data() + i);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+        {
+            const auto& plane = frustum.planes[p];
+            const auto& absPlane = absFrustum.planes[p];
+
+            __m256 radius = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(absPlane.x), ex), _mm256_mul_ps(_mm256_set1_ps(absPlane.y), ey));
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(absPlane.z), ez));
+
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), x), _mm256_mul_ps(_mm256_set1_ps(plane.y), y));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), z));
+            distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.w));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_xor_ps(radius, signMask), _CMP_GE_OQ));
+        }
+
+        auto mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+        __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)),
+                                           _mm256_load_si256(reinterpret_cast<const __m256i*>(COMPACTION_TABLE_8.lanes[mask])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(visibleIndices + visibleCount), indices);
+        visibleCount += COMPACTION_TABLE_8.count[mask];
+    }
+
+    return visibleCount + CullBoxesScalar(frustum, absFrustum, boxes, i, end, visibleIndices + visibleCount);
+}
+#endif
+
+Frustum GetAbsoluteFrustum(const Frustum& frustum)
+{
+    Frustum absFrustum{};
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+        absFrustum.planes[i] = glm::abs(frustum.planes[i]);
+
+    return absFrustum;
+}
+
+//
+// Bounding volumes
+//
+
+void BoundingSpheres::Add(const glm::vec3 &center, float sphereRadius)
+{
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    radius.push_back(sphereRadius);
+}
+
+void BoundingSpheres::Resize(uint32_t count)
+{
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    radius.resize(count);
+}
+
+void BoundingSpheres::Clear()
+{
+    Resize(0);
+}
+
+void BoundingBoxes::Add(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax)
+{
+    glm::vec3 center = (aabbMin + aabbMax) * 0.5f;
+    glm::vec3 extent = (aabbMax - aabbMin) * 0.5f;
+
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extent.x);
+    extentY.push_back(extent.y);
+    extentZ.push_back(extent.z);
+}
+
+void BoundingBoxes::Resize(uint32_t count)
+{
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    extentX.resize(count);
+    extentY.resize(count);
+    extentZ.resize(count);
+}
+
+void BoundingBoxes::Clear()
+{
+    Resize(0);
+}
+
+//
+// Initialization/Destruction
+//
+
+FrustumCuller::FrustumCuller(ESimdLevel eSimdLevel)
+{
+    // never use an instruction set the CPU doesn't have
+    mSimdLevel = Simd::IsSupported(eSimdLevel) ? eSimdLevel : Simd::GetBestLevel();
+}
+
+//
+// External
+//
+
+uint32_t FrustumCuller::CullSpheres(const Frustum &frustum, const BoundingSpheres &spheres, uint32_t begin, uint32_t end,
+                                    uint32_t *visibleIndices) const
+{
+    switch (mSimdLevel)
+    {
+#if SIMD_X86
+        case SIMD_AVX2:
+            return CullSpheresAvx2(frustum, spheres, begin, end, visibleIndices);
+        case SIMD_SSE41:
+            return CullSpheresSse41(frustum, spheres, begin, end, visibleIndices);
+#endif
+        default:
+            return CullSpheresScalar(frustum, spheres, begin, end, visibleIndices);
+    }
+}
+
+uint32_t FrustumCuller::CullBoxes(const Frustum &frustum, const BoundingBoxes &boxes, uint32_t begin, uint32_t end,
+                                  uint32_t *visibleIndices) const
+{
+    Frustum absFrustum = GetAbsoluteFrustum(frustum);
+
+    switch (mSimdLevel)
+    {
+#if SIMD_X86
+        case SIMD_AVX2:
+            return CullBoxesAvx2(frustum, absFrustum, boxes, begin, end, visibleIndices);
+        case SIMD_SSE41:
+            return CullBoxesSse41(frustum, absFrustum, boxes, begin, end, visibleIndices);
+#endif
+        default:
+            return CullBoxesScalar(frustum, absFrustum, boxes, begin, end, visibleIndices);
+    }
+}
+
+void FrustumCuller::CullSpheres(const Frustum &frustum, const BoundingSpheres &spheres, std::vector<uint32_t> &visible) const
+{
+    ZoneScoped;
+
+    CullParallel(spheres.Size(), visible, [&](uint32_t begin, uint32_t end, uint32_t* visibleIndices) {
+        return CullSpheres(frustum, spheres, begin, end, visibleIndices);
+    });
+}
+
+void FrustumCuller::CullBoxes(const Frustum &frustum, const BoundingBoxes &boxes, std::vector<uint32_t> &visible) const
+{
+    ZoneScoped;
+
+    CullParallel(boxes.Size(), visible, [&](uint32_t begin, uint32_t end, uint32_t* visibleIndices) {
+        return CullBoxes(frustum, boxes, begin, end, visibleIndices);
+    });
+}
+
+void FrustumCuller::RunBenchmark()
+{
+    Logger::Info("Frustum culling benchmark: best SIMD level is " + Simd::ToString(Simd::GetBestLevel()) + ", " +
+                 std::to_string(GetParallelThreadCount()) + " threads");
+
+    glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    projection[1][1] *= -1;
+    Frustum frustum = Frustum::FromViewProjection(
+            projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    for (uint32_t objectCount : { 10000u, 100000u, 1000000u, 10000000u })
+    {
+        std::mt19937 random(objectCount);
+        std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+        std::uniform_real_distribution<float> size(0.5f, 10.0f);
+
+        BoundingSpheres spheres;
+        BoundingBoxes boxes;
+        spheres.Resize(objectCount);
+        boxes.Resize(objectCount);
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            glm::vec3 center;
+            center.x = position(random);
+            center.y = position(random);
+            center.z = position(random);
+            float radius = size(random);
+
+            spheres.centerX[i] = boxes.centerX[i] = center.x;
+            spheres.centerY[i] = boxes.centerY[i] = center.y;
+            spheres.centerZ[i] = boxes.centerZ[i] = center.z;
+            spheres.radius[i] = boxes.extentX[i] = boxes.extentY[i] = boxes.extentZ[i] = radius;
+        }
+
+        // enough iterations for stable timings at every size
+        uint32_t iterations = std::max(1u, 20000000u / objectCount);
+
+        std::vector<uint32_t> referenceSpheres, referenceBoxes;
+        for (ESimdLevel level : { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2 })
+        {
+            if (!Simd::IsSupported(level))
+                continue;
+
+            FrustumCuller culler(level);
+            std::vector<uint32_t> visibleSpheres(objectCount), visibleBoxes(objectCount);
+
+            auto measure = [iterations](const std::function<void()>& cull) {
+                auto start = std::chrono::steady_clock::now();
+                for (uint32_t i = 0; i < iterations; i++)
+                    cull();
+                return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+            };
+
+            uint32_t sphereCount = 0, boxCount = 0;
+            double sphereSingle = measure([&]() { sphereCount = culler.CullSpheres(frustum, spheres, 0, objectCount, visibleSpheres.data()); });
+            double boxSingle = measure([&]() { boxCount = culler.CullBoxes(frustum, boxes, 0, objectCount, visibleBoxes.data()); });
+            double sphereParallel = measure([&]() { culler.CullSpheres(frustum, spheres, visibleSpheres); });
+            double boxParallel = measure([&]() { culler.CullBoxes(frustum, boxes, visibleBoxes); });
+
+            // every level must agree with the scalar reference
+            std::string sAgreement;
+            if (level == SIMD_SCALAR)
+            {
+                referenceSpheres = visibleSpheres;
+                referenceBoxes = visibleBoxes;
+            } else
+            {
+                bool bSame = referenceSpheres == visibleSpheres && referenceBoxes == visibleBoxes;
+                sAgreement = bSame ? ", matches scalar" : ", DOES NOT MATCH SCALAR";
+            }
+
+            if (sphereCount != visibleSpheres.size() || boxCount != visibleBoxes.size())
+                sAgreement += ", SINGLE/MULTI THREADED MISMATCH";
+
+            // millions of objects per second
+            auto throughput = [objectCount](double milliseconds) { return objectCount / (milliseconds * 1000.0); };
+
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(3) << "  " << objectCount << " objects, " << Simd::ToString(level)
+               << ": spheres " << sphereSingle << " ms (" << throughput(sphereSingle) << " M/s), threaded " << sphereParallel
+               << " ms (" << throughput(sphereParallel) << " M/s), " << visibleSpheres.size() << " visible"
+               << " | boxes " << boxSingle << " ms (" << throughput(boxSingle) << " M/s), threaded " << boxParallel
+               << " ms (" << throughput(boxParallel) << " M/s), " << visibleBoxes.size() << " visible" << sAgreement;
+            Logger::Info(ss.str());
+        }
+    }
+}
+
+//
+// Implementation
+//
+
+template<typename TCullChunk>
+void FrustumCuller::CullParallel(uint32_t count, std::vector<uint32_t> &visible, const TCullChunk &cullChunk) const
+{
+    visible.resize(count);
+    if (count == 0)
+        return;
+
+    // a few chunks per thread, rounded to whole SIMD registers
+    uint32_t chunkSize = std::max(MIN_CULLING_CHUNK_SIZE, count / (GetParallelThreadCount() * 4));
+    chunkSize = (chunkSize + 7) & ~7u;
+    uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    // every chunk writes its visible indices where the chunk starts, so chunks never overlap
+    std::vector<uint32_t> chunkVisibleCounts(chunkCount);
+    ParallelFor(chunkCount, 1, [&](uint32_t firstChunk, uint32_t lastChunk) {
+        for (uint32_t chunk = firstChunk; chunk < lastChunk; chunk++)
+        {
+            uint32_t begin = chunk * chunkSize;
+            uint32_t end = std::min(begin + chunkSize, count);
+            chunkVisibleCounts[chunk] = cullChunk(begin, end, visible.data() + begin);
+        }
+    });
+
+    // then they are moved together, in order
+    uint32_t visibleCount = chunkVisibleCounts[0];
+    for (uint32_t chunk = 1; chunk < chunkCount; chunk++)
+    {
+        const uint32_t* chunkIndices = visible.data() + chunk * chunkSize;
+        std::copy(chunkIndices, chunkIndices + chunkVisibleCounts[chunk], visible.begin() + visibleCount);
+        visibleCount += chunkVisibleCounts[chunk];
+    }
+
+    visible.resize(visibleCount);
+}
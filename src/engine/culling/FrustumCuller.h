@@ -0,0 +1,77 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_FRUSTUMCULLER_H
+#define VULKAN_ENGINE_FRUSTUMCULLER_H
+
+#include <glm/vec3.hpp>
+#include <cstdint>
+#include <vector>
+#include "Frustum.h"
+#include "../common/Simd.h"
+
+// bounding spheres in structure of arrays form, so 8 of them load into one AVX2 register per component
+struct BoundingSpheres
+{
+    void Add(const glm::vec3& center, float radius);
+    void Resize(uint32_t count);
+    void Clear();
+    uint32_t Size() const { return static_cast<uint32_t>(radius.size()); }
+
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+};
+
+// axis aligned boxes as center and half extents (what the plane test needs), in structure of arrays form
+struct BoundingBoxes
+{
+    void Add(const glm::vec3& aabbMin, const glm::vec3& aabbMax);
+    void Resize(uint32_t count);
+    void Clear();
+    uint32_t Size() const { return static_cast<uint32_t>(centerX.size()); }
+
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+};
+
+// Tests bounding volumes against the 6 planes of a frustum, 8 at a time with AVX2 (4 with SSE4.1), and writes the
+// indices of the visible ones as a compact, sorted list the renderer can walk.
+// Every SIMD level gives exactly the same result as the scalar path.
+class FrustumCuller
+{
+public:
+    explicit FrustumCuller(ESimdLevel eSimdLevel = Simd::GetBestLevel());
+
+    // tests the objects in [begin, end) and writes the visible indices to visibleIndices, returns how many were written
+    // NOTE: visibleIndices must have room for end - begin indices
+    uint32_t CullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t begin, uint32_t end,
+                         uint32_t* visibleIndices) const;
+    uint32_t CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, uint32_t begin, uint32_t end,
+                       uint32_t* visibleIndices) const;
+
+    // tests every object, chunks are spread over worker threads and merged back in order
+    void CullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint32_t>& visible) const;
+    void CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint32_t>& visible) const;
+
+    ESimdLevel GetSimdLevel() const { return mSimdLevel; }
+
+    // culls 10k to 10M random objects with every SIMD level (single and multi threaded) and logs the throughput
+    static void RunBenchmark();
+
+private:
+    // splits [0, count) in chunks for the worker threads and compacts their results
+    template<typename TCullChunk>
+    void CullParallel(uint32_t count, std::vector<uint32_t>& visible, const TCullChunk& cullChunk) const;
+
+    ESimdLevel mSimdLevel;
+};
+
+
+#endif //VULKAN_ENGINE_FRUSTUMCULLER_H
@@ -0,0 +1,580 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "OcclusionCuller.h"
+#include "../common/Parallel.h"
+#include "../profiling/FrameStatistics.h"
+#include "../profiling/Logger.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <Tracy.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+// values of a triangle's edge functions and depth at the first pixel of a row, and their step per pixel
+struct RasterRow
+{
+    float e[3];
+    float a[3];
+    float z;
+    float dzdx;
+};
+
+// NOTE: Every kernel computes a pixel as value + step * (float) offset, in that order and without FMA,
+//       so all of them write bit-identical depth buffers
+
+// rasterizes the pixels [xBegin, xEnd) of a row, the row values are for pixel xStart (a multiple of 8, <= xBegin)
+void RasterizeSpanScalar(float* depthRow, int xStart, int xBegin, int xEnd, const RasterRow& row)
+{
+    for (int x = xBegin; x < xEnd; x++)
+    {
+        auto offset = static_cast<float>(x - xStart);
+        float e0 = row.e[0] + row.a[0] * offset;
+        float e1 = row.e[1] + row.a[1] * offset;
+        float e2 = row.e[2] + row.a[2] * offset;
+        if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+        {
+            float z = row.z + row.dzdx * offset;
+            depthRow[x] = depthRow[x] < z ? depthRow[x] : z;
+        }
+    }
+}
+
+// true when a pixel of [xBegin, xEnd] (inclusive) in the 8 pixels starting at xStart is farther than depth
+bool IsSpanVisibleScalar(const float* depthRow, int xStart, int xBegin, int xEnd, float depth)
+{
+    for (int x = std::max(xStart, xBegin); x <= std::min(xStart + 7, xEnd); x++)
+    {
+        if (depthRow[x] > depth)
+            return true;
+    }
+
+    return false;
+}
+
+#if SIMD_X86
+SIMD_TARGET_SSE41 void RasterizeSpanSse41(float* depthRow, int xStart, int xBegin, int xEnd, const RasterRow& row)
+{
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i begin = _mm_set1_epi32(xBegin - 1);
+    const __m128i end = _mm_set1_epi32(xEnd);
+    const __m128i start = _mm_set1_epi32(xStart);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (int x = xStart; x < xEnd; x += 4)
+    {
+        __m128i pixel = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+        __m128 offset = _mm_cvtepi32_ps(_mm_sub_epi32(pixel, start));
+        __m128 inSpan = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(pixel, begin), _mm_cmplt_epi32(pixel, end)));
+
+        __m128 e0 = _mm_add_ps(_mm_set1_ps(row.e[0]), _mm_mul_ps(_mm_set1_ps(row.a[0]), offset));
+        __m128 e1 = _mm_add_ps(_mm_set1_ps(row.e[1]), _mm_mul_ps(_mm_set1_ps(row.a[1]), offset));
+        __m128 e2 = _mm_add_ps(_mm_set1_ps(row.e[2]), _mm_mul_ps(_mm_set1_ps(row.a[2]), offset));
+        __m128 inside = _mm_and_ps(inSpan, _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero))));
+        if (_mm_movemask_ps(inside) == 0)
+            continue;
+
+        __m128 z = _mm_add_ps(_mm_set1_ps(row.z), _mm_mul_ps(_mm_set1_ps(row.dzdx), offset));
+        __m128 depth = _mm_loadu_ps(depthRow + x);
+        _mm_storeu_ps(depthRow + x, _mm_blendv_ps(depth, _mm_min_ps(depth, z), inside));
+    }
+}
+
+SIMD_TARGET_SSE41 bool IsSpanVisibleSse41(const float* depthRow, int xStart, int xBegin, int xEnd, float depth)
+{
+    const __m128i begin = _mm_set1_epi32(xBegin - 1);
+    const __m128i end = _mm_set1_epi32(xEnd + 1);
+    const __m128 reference = _mm_set1_ps(depth);
+
+    for (int x = xStart; x < xStart + 8; x += 4)
+    {
+        __m128i pixel = _mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3));
+        __m128 inSpan = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(pixel, begin), _mm_cmplt_epi32(pixel, end)));
+        __m128 farther = _mm_cmpgt_ps(_mm_loadu_ps(depthRow + x), reference);
+        if (_mm_movemask_ps(_mm_and_ps(inSpan, farther)) != 0)
+            return true;
+    }
+
+    return false;
+}
+
+SIMD_TARGET_AVX2 void RasterizeSpanAvx2(float* depthRow, int xStart, int xBegin, int xEnd, const RasterRow& row)
+{
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i begin = _mm256_set1_epi32(xBegin - 1);
+    const __m256i end = _mm256_set1_epi32(xEnd);
+    const __m256i start = _mm256_set1_epi32(xStart);
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (int x = xStart; x < xEnd; x += 8)
+    {
+        __m256i pixel = _mm256_add_epi32(_mm256_set1_epi32(x), lanes);
+        __m256 offset = _mm256_cvtepi32_ps(_mm256_sub_epi32(pixel, start));
+        __m256 inSpan = _mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(pixel, begin), _mm256_cmpgt_epi32(end, pixel)));
+
+        __m256 e0 = _mm256_add_ps(_mm256_set1_ps(row.e[0]), _mm256_mul_ps(_mm256_set1_ps(row.a[0]), offset));
+        __m256 e1 = _mm256_add_ps(_mm256_set1_ps(row.e[1]), _mm256_mul_ps(_mm256_set1_ps(row.a[1]), offset));
+        __m256 e2 = _mm256_add_ps(_mm256_set1_ps(row.e[2]), _mm256_mul_ps(_mm256_set1_ps(row.a[2]), offset));
+        __m256 inside = _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ),
+                                      _mm256_and_ps(_mm256_cmp_ps(e1, zero, _CMP_GE_OQ), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ)));
+        inside = _mm256_and_ps(inSpan, inside);
+        if (_mm256_movemask_ps(inside) == 0)
+            continue;
+
+        __m256 z = _mm256_add_ps(_mm256_set1_ps(row.z), _mm256_mul_ps(_mm256_set1_ps(row.dzdx), offset));
+        __m256 depth = _mm256_loadu_ps(depthRow + x);
+        _mm256_storeu_ps(depthRow + x, _mm256_blendv_ps(depth, _mm256_min_ps(depth, z), inside));
+    }
+}
+
+SIMD_TARGET_AVX2 bool IsSpanVisibleAvx2(const float* depthRow, int xStart, int xBegin, int xEnd, float depth)
+{
+    __m256i pixel = _mm256_add_epi32(_mm256_set1_epi32(xStart), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i inSpan = _mm256_and_si256(_mm256_cmpgt_epi32(pixel, _mm256_set1_epi32(xBegin - 1)),
+                                      _mm256_cmpgt_epi32(_mm256_set1_epi32(xEnd + 1), pixel));
+    __m256 farther = _mm256_cmp_ps(_mm256_loadu_ps(depthRow + xStart), _mm256_set1_ps(depth), _CMP_GT_OQ);
+
+    return _mm256_movemask_ps(_mm256_and_ps(_mm256_castsi256_ps(inSpan), farther)) != 0;
+}
+#endif
+
+// clips a polygon against the near plane (z >= 0 in vulkan clip space)
+void ClipAgainstNearPlane(const std::vector<glm::vec4>& input, std::vector<glm::vec4>& output)
+{
+    output.clear();
+
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        const glm::vec4& current = input[i];
+        const glm::vec4& next = input[(i + 1) % input.size()];
+
+        bool bCurrentInside = current.z >= 0.0f;
+        bool bNextInside = next.z >= 0.0f;
+
+        if (bCurrentInside)
+            output.push_back(current);
+
+        if (bCurrentInside != bNextInside)
+        {
+            float t = current.z / (current.z - next.z);
+            output.push_back(current + (next - current) * t);
+        }
+    }
+}
+
+//
+// Initialization/Destruction
+//
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height, ESimdLevel eSimdLevel)
+{
+    mTilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    mTilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    mWidth = mTilesX * TILE_WIDTH;
+    mHeight = mTilesY * TILE_HEIGHT;
+
+    // never use an instruction set the CPU doesn't have
+    mSimdLevel = Simd::IsSupported(eSimdLevel) ? eSimdLevel : Simd::GetBestLevel();
+
+    mDepth.resize(mWidth * mHeight, 1.0f);
+    mTileMaxDepth.resize(mTilesX * mTilesY, 1.0f);
+}
+
+//
+// External
+//
+
+void OcclusionCuller::BeginFrame(const glm::mat4 &viewProjection)
+{
+    mViewProjection = viewProjection;
+    mTriangles.clear();
+    mStatistics = OcclusionStatistics{};
+}
+
+void OcclusionCuller::AddOccluder(const std::vector<glm::vec3> &vertices, const std::vector<uint32_t> &indices,
+                                  const glm::mat4 &transform)
+{
+    glm::mat4 modelViewProjection = mViewProjection * transform;
+
+    std::vector<glm::vec4> clipVertices(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+        clipVertices[i] = modelViewProjection * glm::vec4(vertices[i], 1.0f);
+
+    std::vector<glm::vec4> polygon(3), clipped;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (int v = 0; v < 3; v++)
+            polygon[v] = clipVertices[indices[i + v]];
+
+        // entirely outside of one of the planes
+        const glm::vec4 &p0 = polygon[0], &p1 = polygon[1], &p2 = polygon[2];
+        if ((p0.x > p0.w && p1.x > p1.w && p2.x > p2.w) || (p0.x < -p0.w && p1.x < -p1.w && p2.x < -p2.w) ||
+            (p0.y > p0.w && p1.y > p1.w && p2.y > p2.w) || (p0.y < -p0.w && p1.y < -p1.w && p2.y < -p2.w) ||
+            (p0.z > p0.w && p1.z > p1.w && p2.z > p2.w) || (p0.z < 0.0f && p1.z < 0.0f && p2.z < 0.0f))
+            continue;
+
+        ClipAgainstNearPlane(polygon, clipped);
+
+        // the clipped polygon is convex, a fan rebuilds its triangles
+        for (size_t v = 1; v + 1 < clipped.size(); v++)
+        {
+            const glm::vec4* corners[3] = { &clipped[0], &clipped[v], &clipped[v + 1] };
+
+            OcclusionTriangle triangle{};
+            bool bValid = true;
+            for (int c = 0; c < 3; c++)
+            {
+                if (corners[c]->w <= 1e-6f)
+                {
+                    bValid = false;
+                    break;
+                }
+
+                float invW = 1.0f / corners[c]->w;
+                triangle.x[c] = (corners[c]->x * invW * 0.5f + 0.5f) * static_cast<float>(mWidth);
+                triangle.y[c] = (corners[c]->y * invW * 0.5f + 0.5f) * static_cast<float>(mHeight);
+                triangle.z[c] = corners[c]->z * invW;
+            }
+
+            if (bValid)
+                mTriangles.push_back(triangle);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+    ZoneScoped;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+
+    // every band of tile rows is owned by one thread, so no pixel is ever written by two of them
+    ParallelFor(mTilesY, 4, [this](uint32_t firstTileRow, uint32_t lastTileRow) {
+        RasterizeRows(firstTileRow * TILE_HEIGHT, lastTileRow * TILE_HEIGHT);
+        UpdateTileDepths(firstTileRow, lastTileRow);
+    });
+
+    mStatistics.occluderTriangles = static_cast<uint32_t>(mTriangles.size());
+    mStatistics.rasterMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3 &aabbMin, const glm::vec3 &aabbMax) const
+{
+    glm::vec2 ndcMin(std::numeric_limits<float>::max());
+    glm::vec2 ndcMax(-std::numeric_limits<float>::max());
+    float nearestDepth = std::numeric_limits<float>::max();
+
+    // the corners are the projected min corner plus combinations of the projected edges
+    glm::vec4 origin = mViewProjection * glm::vec4(aabbMin, 1.0f);
+    glm::vec4 edgeX = mViewProjection[0] * (aabbMax.x - aabbMin.x);
+    glm::vec4 edgeY = mViewProjection[1] * (aabbMax.y - aabbMin.y);
+    glm::vec4 edgeZ = mViewProjection[2] * (aabbMax.z - aabbMin.z);
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 clip = origin;
+        if (i & 1) clip += edgeX;
+        if (i & 2) clip += edgeY;
+        if (i & 4) clip += edgeZ;
+
+        // crossing the near plane, we can't tell
+        if (clip.w <= 1e-6f || clip.z < 0.0f)
+            return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, glm::vec2(ndc));
+        ndcMax = glm::max(ndcMax, glm::vec2(ndc));
+        nearestDepth = std::min(nearestDepth, ndc.z);
+    }
+
+    // outside of the frustum (the frustum culler should have caught it already)
+    if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f || nearestDepth > 1.0f)
+        return false;
+
+    // every pixel the box's screen rectangle touches
+    int minX = std::max(0, static_cast<int>(std::floor((ndcMin.x * 0.5f + 0.5f) * static_cast<float>(mWidth))));
+    int minY = std::max(0, static_cast<int>(std::floor((ndcMin.y * 0.5f + 0.5f) * static_cast<float>(mHeight))));
+    int maxX = std::min(static_cast<int>(mWidth) - 1, static_cast<int>(std::floor((ndcMax.x * 0.5f + 0.5f) * static_cast<float>(mWidth))));
+    int maxY = std::min(static_cast<int>(mHeight) - 1, static_cast<int>(std::floor((ndcMax.y * 0.5f + 0.5f) * static_cast<float>(mHeight))));
+
+    for (int tileY = minY / static_cast<int>(TILE_HEIGHT); tileY <= maxY / static_cast<int>(TILE_HEIGHT); tileY++)
+    {
+        for (int tileX = minX / static_cast<int>(TILE_WIDTH); tileX <= maxX / static_cast<int>(TILE_WIDTH); tileX++)
+        {
+            // the whole tile is closer than the box, no need to look at its pixels
+            if (mTileMaxDepth[tileY * mTilesX + tileX] <= nearestDepth)
+                continue;
+
+            if (IsTileVisible(tileX, tileY, minX, minY, maxX, maxY, nearestDepth))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t OcclusionCuller::TestObjects(const glm::vec3 *aabbMins, const glm::vec3 *aabbMaxs, uint32_t count, uint8_t *visible)
+{
+    ZoneScoped;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::atomic<uint32_t> visibleCount{0};
+    ParallelFor(count, 1024, [&](uint32_t begin, uint32_t end) {
+        uint32_t chunkVisible = 0;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            visible[i] = IsVisible(aabbMins[i], aabbMaxs[i]) ? 1 : 0;
+            chunkVisible += visible[i];
+        }
+        visibleCount += chunkVisible;
+    });
+
+    mStatistics.testedObjects += count;
+    mStatistics.culledObjects += count - visibleCount;
+    mStatistics.testMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return visibleCount;
+}
+
+void OcclusionCuller::RunBenchmark()
+{
+    const uint32_t occludeeCount = 100000;
+    const uint32_t iterations = 20;
+
+    Logger::Info("Occlusion culling benchmark: " + std::to_string(occludeeCount) + " objects behind a wall, best SIMD level is " +
+                 Simd::ToString(Simd::GetBestLevel()) + ", " + std::to_string(GetParallelThreadCount()) + " threads");
+
+    glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 2.0f, 0.1f, 500.0f);
+    projection[1][1] *= -1;
+    glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // a unit box, used both as occluder mesh and to place the objects
+    std::vector<glm::vec3> boxVertices;
+    for (int i = 0; i < 8; i++)
+        boxVertices.emplace_back((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+    std::vector<uint32_t> boxIndices = {
+            0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+            2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5
+    };
+
+    // a wall of blocks with a few gaps in it
+    std::vector<glm::mat4> occluders;
+    for (int y = -2; y < 2; y++)
+    {
+        for (int x = -3; x < 3; x++)
+        {
+            if ((x * 7 + y * 3) % 5 == 0)
+                continue;
+
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x * 10.0f + 5.0f, y * 5.0f + 2.5f, -20.0f));
+            occluders.push_back(glm::scale(transform, glm::vec3(10.0f, 5.0f, 1.0f)));
+        }
+    }
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> positionX(-80.0f, 80.0f);
+    std::uniform_real_distribution<float> positionY(-40.0f, 40.0f);
+    std::uniform_real_distribution<float> positionZ(-200.0f, -25.0f);
+    std::uniform_real_distribution<float> size(0.25f, 2.0f);
+
+    std::vector<glm::vec3> aabbMins(occludeeCount), aabbMaxs(occludeeCount);
+    for (uint32_t i = 0; i < occludeeCount; i++)
+    {
+        glm::vec3 center;
+        center.x = positionX(random);
+        center.y = positionY(random);
+        center.z = positionZ(random);
+        float halfSize = size(random) * 0.5f;
+
+        aabbMins[i] = center - glm::vec3(halfSize);
+        aabbMaxs[i] = center + glm::vec3(halfSize);
+    }
+
+    std::vector<float> referenceDepth;
+    std::vector<uint8_t> referenceVisible;
+
+    for (ESimdLevel level : { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2 })
+    {
+        if (!Simd::IsSupported(level))
+        {
+            Logger::Info("  " + Simd::ToString(level) + ": not supported by this CPU");
+            continue;
+        }
+
+        OcclusionCuller culler(256, 128, level);
+        std::vector<uint8_t> visible(occludeeCount);
+        FrameStatistics rasterStats, testStats;
+
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            culler.BeginFrame(viewProjection);
+            for (const auto& transform : occluders)
+                culler.AddOccluder(boxVertices, boxIndices, transform);
+            culler.RasterizeOccluders();
+            culler.TestObjects(aabbMins.data(), aabbMaxs.data(), occludeeCount, visible.data());
+
+            rasterStats.AddSample(culler.GetStatistics().rasterMilliseconds);
+            testStats.AddSample(culler.GetStatistics().testMilliseconds);
+        }
+
+        // every level must agree with the scalar reference, bit for bit
+        std::string sAgreement;
+        if (level == SIMD_SCALAR)
+        {
+            referenceDepth = culler.GetDepthBuffer();
+            referenceVisible = visible;
+        } else
+        {
+            bool bSameDepth = memcmp(referenceDepth.data(), culler.GetDepthBuffer().data(), referenceDepth.size() * sizeof(float)) == 0;
+            bool bSameVisibility = referenceVisible == visible;
+            sAgreement = (bSameDepth && bSameVisibility) ? ", matches scalar" : ", DOES NOT MATCH SCALAR";
+        }
+
+        const auto& stats = culler.GetStatistics();
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3) << "  " << Simd::ToString(level) << ": "
+           << stats.occluderTriangles << " occluder triangles rasterized in " << rasterStats.GetAverage() << " ms, "
+           << stats.testedObjects << " objects tested in " << testStats.GetAverage() << " ms, "
+           << stats.culledObjects << " culled" << sAgreement;
+        Logger::Info(ss.str());
+    }
+}
+
+//
+// Implementation
+//
+
+void OcclusionCuller::RasterizeRows(uint32_t firstRow, uint32_t lastRow)
+{
+    for (const auto& triangle : mTriangles)
+        RasterizeTriangle(triangle, static_cast<int>(firstRow), static_cast<int>(lastRow));
+}
+
+void OcclusionCuller::RasterizeTriangle(const OcclusionTriangle &triangle, int firstRow, int lastRow)
+{
+    float x0 = triangle.x[0], y0 = triangle.y[0], z0 = triangle.z[0];
+    float x1 = triangle.x[1], y1 = triangle.y[1], z1 = triangle.z[1];
+    float x2 = triangle.x[2], y2 = triangle.y[2], z2 = triangle.z[2];
+
+    // occluders are drawn double sided, so both windings are turned into a positive area
+    float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (std::abs(area) < 1e-8f)
+        return;
+    if (area < 0.0f)
+    {
+        std::swap(x1, x2);
+        std::swap(y1, y2);
+        std::swap(z1, z2);
+        area = -area;
+    }
+
+    // pixels whose center is inside the triangle's bounds
+    int minX = std::max(0, static_cast<int>(std::ceil(std::min({ x0, x1, x2 }) - 0.5f)));
+    int maxX = std::min(static_cast<int>(mWidth) - 1, static_cast<int>(std::floor(std::max({ x0, x1, x2 }) - 0.5f)));
+    int minY = std::max(firstRow, static_cast<int>(std::ceil(std::min({ y0, y1, y2 }) - 0.5f)));
+    int maxY = std::min(lastRow - 1, static_cast<int>(std::floor(std::max({ y0, y1, y2 }) - 0.5f)));
+    if (minX > maxX || minY > maxY)
+        return;
+
+    // edge functions e(x, y) = a * x + b * y + c, positive inside
+    float a[3] = { y0 - y1, y1 - y2, y2 - y0 };
+    float b[3] = { x1 - x0, x2 - x1, x0 - x2 };
+    float c[3] = { x0 * y1 - y0 * x1, x1 * y2 - y1 * x2, x2 * y0 - y2 * x0 };
+
+    // depth plane
+    float dzdx = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) / area;
+    float dzdy = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) / area;
+
+    int xStart = minX & ~7;
+    float startX = static_cast<float>(xStart) + 0.5f;
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        float centerY = static_cast<float>(y) + 0.5f;
+
+        RasterRow row{};
+        for (int i = 0; i < 3; i++)
+        {
+            row.e[i] = a[i] * startX + b[i] * centerY + c[i];
+            row.a[i] = a[i];
+        }
+        row.z = z0 + dzdx * (startX - x0) + dzdy * (centerY - y0);
+        row.dzdx = dzdx;
+
+        float* depthRow = mDepth.data() + static_cast<size_t>(y) * mWidth;
+        switch (mSimdLevel)
+        {
+#if SIMD_X86
+            case SIMD_AVX2:
+                RasterizeSpanAvx2(depthRow, xStart, minX, maxX + 1, row);
+                break;
+            case SIMD_SSE41:
+                RasterizeSpanSse41(depthRow, xStart, minX, maxX + 1, row);
+                break;
+#endif
+            default:
+                RasterizeSpanScalar(depthRow, xStart, minX, maxX + 1, row);
+                break;
+        }
+    }
+}
+
+void OcclusionCuller::UpdateTileDepths(uint32_t firstTileRow, uint32_t lastTileRow)
+{
+    for (uint32_t tileY = firstTileRow; tileY < lastTileRow; tileY++)
+    {
+        for (uint32_t tileX = 0; tileX < mTilesX; tileX++)
+        {
+            float maxDepth = 0.0f;
+            for (uint32_t y = 0; y < TILE_HEIGHT; y++)
+            {
+                const float* depthRow = mDepth.data() + (tileY * TILE_HEIGHT + y) * mWidth + tileX * TILE_WIDTH;
+                for (uint32_t x = 0; x < TILE_WIDTH; x++)
+                    maxDepth = std::max(maxDepth, depthRow[x]);
+            }
+            mTileMaxDepth[tileY * mTilesX + tileX] = maxDepth;
+        }
+    }
+}
+
+bool OcclusionCuller::IsTileVisible(uint32_t tileX, uint32_t tileY, int minX, int minY, int maxX, int maxY, float depth) const
+{
+    int xStart = static_cast<int>(tileX * TILE_WIDTH);
+    int firstRow = std::max(minY, static_cast<int>(tileY * TILE_HEIGHT));
+    int lastRow = std::min(maxY, static_cast<int>(tileY * TILE_HEIGHT + TILE_HEIGHT - 1));
+
+    for (int y = firstRow; y <= lastRow; y++)
+    {
+        const float* depthRow = mDepth.data() + static_cast<size_t>(y) * mWidth;
+
+        bool bVisible;
+        switch (mSimdLevel)
+        {
+#if SIMD_X86
+            case SIMD_AVX2:
+                bVisible = IsSpanVisibleAvx2(depthRow, xStart, minX, maxX, depth);
+                break;
+            case SIMD_SSE41:
+                bVisible = IsSpanVisibleSse41(depthRow, xStart, minX, maxX, depth);
+                break;
+#endif
+            default:
+                bVisible = IsSpanVisibleScalar(depthRow, xStart, minX, maxX, depth);
+                break;
+        }
+
+        if (bVisible)
+            return true;
+    }
+
+    return false;
+}
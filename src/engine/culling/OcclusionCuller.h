@@ -0,0 +1,90 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_OCCLUSIONCULLER_H
+#define VULKAN_ENGINE_OCCLUSIONCULLER_H
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <cstdint>
+#include <vector>
+#include "../common/Simd.h"
+
+// an occluder triangle once projected to the depth buffer (pixels, depth in the 0..1 range)
+struct OcclusionTriangle
+{
+    float x[3];
+    float y[3];
+    float z[3];
+};
+
+struct OcclusionStatistics
+{
+    uint32_t occluderTriangles = 0;
+    uint32_t testedObjects = 0;
+    uint32_t culledObjects = 0;
+    double rasterMilliseconds = 0.0;
+    double testMilliseconds = 0.0;
+};
+
+// Software occlusion culling: selected occluders are rasterized (on the CPU, at a low resolution) into a depth
+// buffer, then the bounding boxes of objects are tested against it, so hidden objects never reach Vulkan.
+// The depth buffer is split in 8x4 pixel tiles that also keep their farthest depth, most boxes are resolved with
+// the tile depths alone, without looking at the pixels.
+class OcclusionCuller
+{
+public:
+    static constexpr uint32_t TILE_WIDTH = 8; // one AVX2 register of depths
+    static constexpr uint32_t TILE_HEIGHT = 4;
+
+    // the width is rounded up to a whole number of tiles
+    explicit OcclusionCuller(uint32_t width = 256, uint32_t height = 128, ESimdLevel eSimdLevel = Simd::GetBestLevel());
+
+    // clears the depth buffer and the occluders of the previous frame
+    // NOTE: Expects a vulkan style projection (depth in the 0..1 range)
+    void BeginFrame(const glm::mat4& viewProjection);
+
+    // projects (and clips) the triangles of an occluder, call before RasterizeOccluders
+    void AddOccluder(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const glm::mat4& transform);
+
+    // rasterizes every occluder, horizontal bands of tiles are spread over worker threads
+    void RasterizeOccluders();
+
+    bool IsVisible(const glm::vec3& aabbMin, const glm::vec3& aabbMax) const;
+
+    // tests many boxes over worker threads, fills visible (one byte per object) and returns the visible count
+    uint32_t TestObjects(const glm::vec3* aabbMins, const glm::vec3* aabbMaxs, uint32_t count, uint8_t* visible);
+
+    uint32_t GetWidth() const { return mWidth; }
+    uint32_t GetHeight() const { return mHeight; }
+    ESimdLevel GetSimdLevel() const { return mSimdLevel; }
+    const std::vector<float>& GetDepthBuffer() const { return mDepth; }
+    const OcclusionStatistics& GetStatistics() const { return mStatistics; }
+
+    // rasterizes a synthetic scene with every SIMD level, checks they agree and logs the timings
+    static void RunBenchmark();
+
+private:
+    void RasterizeRows(uint32_t firstRow, uint32_t lastRow);
+    void RasterizeTriangle(const OcclusionTriangle& triangle, int firstRow, int lastRow);
+    void UpdateTileDepths(uint32_t firstTileRow, uint32_t lastTileRow);
+    bool IsTileVisible(uint32_t tileX, uint32_t tileY, int minX, int minY, int maxX, int maxY, float depth) const;
+
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mTilesX;
+    uint32_t mTilesY;
+    ESimdLevel mSimdLevel;
+
+    glm::mat4 mViewProjection{1.0f};
+
+    std::vector<float> mDepth;           // row major, cleared to the far plane (1.0)
+    std::vector<float> mTileMaxDepth;    // farthest depth of each tile
+    std::vector<OcclusionTriangle> mTriangles;
+
+    OcclusionStatistics mStatistics;
+};
+
+
+#endif //VULKAN_ENGINE_OCCLUSIONCULLER_H
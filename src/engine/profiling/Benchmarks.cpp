@@ -0,0 +1,69 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "Benchmarks.h"
+#include "Logger.h"
+#include "../common/BatchMath.h"
+#include "../common/Config.h"
+#include "../common/JobSystem.h"
+#include "../culling/FrustumCuller.h"
+#include "../culling/OcclusionCuller.h"
+#include "../rendering/RenderQueue.h"
+#include "../scenes/SceneSystem.h"
+#include "../scenes/TransformHierarchy.h"
+#include <functional>
+#include <map>
+
+// every benchmark, by the name used in the config
+const std::map<std::string, std::function<void()>> BENCHMARKS = {
+        { "occlusion", OcclusionCuller::RunBenchmark },
+        { "frustum", FrustumCuller::RunBenchmark },
+        { "renderqueue", RenderQueue::RunBenchmark },
+        { "submission", RenderQueue::RunSubmissionBenchmark },
+        { "jobs", JobSystem::RunBenchmark },
+        { "ecs", SceneSystem::RunBenchmark },
+        { "ecs_scaling", SceneSystem::RunScalingBenchmark },
+        { "hierarchy", TransformHierarchy::RunBenchmark },
+        { "batchmath", BatchMath::RunBenchmark },
+};
+
+//
+// External
+//
+
+bool Benchmarks::RunConfigured()
+{
+    std::string sList = Config::GetBenchmarks();
+    bool bRanAny = false;
+
+    std::stringstream ss(sList);
+    std::string sName;
+    while (std::getline(ss, sName, ','))
+    {
+        // trim spaces around the name
+        sName.erase(0, sName.find_first_not_of(' '));
+        sName.erase(sName.find_last_not_of(' ') + 1);
+        if (sName.empty())
+            continue;
+
+        if (Run(sName))
+            bRanAny = true;
+    }
+
+    return bRanAny;
+}
+
+bool Benchmarks::Run(const std::string &sName)
+{
+    auto benchmark = BENCHMARKS.find(sName);
+    if (benchmark == BENCHMARKS.end())
+    {
+        Logger::Error("Unknown benchmark", sName);
+        return false;
+    }
+
+    Logger::Info("Running benchmark '" + sName + "'");
+    benchmark->second();
+    return true;
+}
@@ -0,0 +1,23 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_BENCHMARKS_H
+#define VULKAN_ENGINE_BENCHMARKS_H
+
+#include <string>
+
+// CPU side benchmarks of engine systems, they don't need a window or a GPU
+// Enabled with a comma separated list in the [Benchmark] Run config key (e.g. "occlusion")
+class Benchmarks
+{
+public:
+    // runs the benchmarks listed in the config, returns true if any of them ran
+    static bool RunConfigured();
+
+    // runs a single benchmark by name, returns false when there's no benchmark with that name
+    static bool Run(const std::string& sName);
+};
+
+
+#endif //VULKAN_ENGINE_BENCHMARKS_H
@@ -0,0 +1,99 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "FrameStatistics.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+void FrameStatistics::AddSample(double fMilliseconds)
+{
+    mSamples.push_back(fMilliseconds);
+}
+
+void FrameStatistics::Reset()
+{
+    mSamples.clear();
+}
+
+size_t FrameStatistics::GetSampleCount() const
+{
+    return mSamples.size();
+}
+
+double FrameStatistics::GetMin() const
+{
+    if (mSamples.empty())
+        return 0.0;
+
+    return *std::min_element(mSamples.begin(), mSamples.end());
+}
+
+double FrameStatistics::GetMax() const
+{
+    if (mSamples.empty())
+        return 0.0;
+
+    return *std::max_element(mSamples.begin(), mSamples.end());
+}
+
+double FrameStatistics::GetAverage() const
+{
+    if (mSamples.empty())
+        return 0.0;
+
+    return std::accumulate(mSamples.begin(), mSamples.end(), 0.0) / static_cast<double>(mSamples.size());
+}
+
+double FrameStatistics::GetVariance() const
+{
+    if (mSamples.size() < 2)
+        return 0.0;
+
+    double average = GetAverage();
+    double sum = 0.0;
+    for (double sample : mSamples)
+    {
+        sum += (sample - average) * (sample - average);
+    }
+
+    return sum / static_cast<double>(mSamples.size() - 1);
+}
+
+double FrameStatistics::GetStandardDeviation() const
+{
+    return std::sqrt(GetVariance());
+}
+
+double FrameStatistics::GetPercentile(double fPercentile) const
+{
+    if (mSamples.empty())
+        return 0.0;
+
+    // nearest-rank percentile
+    std::vector<double> sorted(mSamples);
+    std::sort(sorted.begin(), sorted.end());
+
+    auto rank = static_cast<size_t>(std::ceil(fPercentile / 100.0 * static_cast<double>(sorted.size())));
+    rank = std::clamp<size_t>(rank, 1, sorted.size());
+
+    return sorted[rank - 1];
+}
+
+void FrameStatistics::Report(const std::string &sName) const
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << sName << " frame times (ms) -> frames: " << GetSampleCount()
+       << " | avg: " << GetAverage()
+       << " | min: " << GetMin()
+       << " | max: " << GetMax()
+       << " | stddev: " << GetStandardDeviation()
+       << " | p50: " << GetPercentile(50.0)
+       << " | p95: " << GetPercentile(95.0)
+       << " | p99: " << GetPercentile(99.0);
+
+    Logger::Info(ss.str());
+}
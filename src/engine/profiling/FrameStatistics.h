@@ -0,0 +1,34 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_FRAMESTATISTICS_H
+#define VULKAN_ENGINE_FRAMESTATISTICS_H
+
+#include <string>
+#include <vector>
+
+// collects frame times (in milliseconds) and reports min/avg/max, variance and percentiles
+class FrameStatistics
+{
+public:
+    void AddSample(double fMilliseconds);
+    void Reset();
+
+    size_t GetSampleCount() const;
+    double GetMin() const;
+    double GetMax() const;
+    double GetAverage() const;
+    double GetVariance() const;
+    double GetStandardDeviation() const;
+    double GetPercentile(double fPercentile) const;
+
+    // logs a one line summary of the collected samples
+    void Report(const std::string& sName) const;
+
+private:
+    std::vector<double> mSamples;
+};
+
+
+#endif //VULKAN_ENGINE_FRAMESTATISTICS_H
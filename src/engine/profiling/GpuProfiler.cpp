@@ -0,0 +1,357 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "GpuProfiler.h"
+#include "Logger.h"
+#include "../common/Config.h"
+#include "../rendering/VulkanDevice.h"
+#include "../rendering/VulkanSwapchain.h"
+#include <cassert>
+#include <sstream>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+GpuProfilerImpl* mGpuProfilerImpl = nullptr;
+
+//
+// Initialization/Destruction
+//
+
+void GpuProfiler::Init()
+{
+    Logger::Info("Initializing GPU profiler");
+
+    mGpuProfilerImpl = new GpuProfilerImpl;
+}
+
+void GpuProfiler::Shutdown()
+{
+    Logger::Info("Shutting down GPU profiler");
+
+    ReportStatistics();
+
+    delete mGpuProfilerImpl;
+    mGpuProfilerImpl = nullptr;
+}
+
+//
+// External
+//
+
+void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    if (!mGpuProfilerImpl->bEnabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(mGpuProfilerImpl->mutex);
+
+    assert(mGpuProfilerImpl->openScopes.empty() && "A GPU scope was left open on the previous frame");
+
+    mGpuProfilerImpl->currentFrame = frameIndex;
+    GpuProfilerFrame& frame = mGpuProfilerImpl->frames[frameIndex];
+
+    // the GPU is done with this slot (acquiring waited for it), so whatever it recorded last time is available now
+    mGpuProfilerImpl->ResolveFrame(frame);
+
+    vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, GpuProfilerImpl::MAX_SCOPES_PER_FRAME * 2);
+    if (frame.statisticsPool != VK_NULL_HANDLE)
+        vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, GpuProfilerImpl::MAX_SCOPES_PER_FRAME);
+
+    // tracy also needs to read back its queries outside of a render pass
+    if (mGpuProfilerImpl->tracyContext)
+    {
+        TracyVkCollect(mGpuProfilerImpl->tracyContext, commandBuffer);
+    }
+}
+
+uint32_t GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const std::string &sName)
+{
+    if (mGpuProfilerImpl == nullptr || !mGpuProfilerImpl->bEnabled)
+        return INVALID_SCOPE;
+
+    std::lock_guard<std::mutex> lock(mGpuProfilerImpl->mutex);
+
+    GpuProfilerFrame& frame = mGpuProfilerImpl->frames[mGpuProfilerImpl->currentFrame];
+    if (frame.scopes.size() >= GpuProfilerImpl::MAX_SCOPES_PER_FRAME)
+    {
+        Logger::Warn("Too many GPU scopes in a single frame, ignoring " + sName);
+        return INVALID_SCOPE;
+    }
+
+    uint32_t& depth = mGpuProfilerImpl->openScopes[commandBuffer];
+
+    GpuProfilerScope scope;
+    scope.name = sName;
+    scope.depth = depth;
+    scope.timestampQuery = static_cast<uint32_t>(frame.scopes.size()) * 2;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, scope.timestampQuery);
+
+    // statistics queries can't be nested, so only the outermost scope of a command buffer gets them
+    if (frame.statisticsPool != VK_NULL_HANDLE && depth == 0)
+    {
+        scope.statisticsQuery = static_cast<int32_t>(frame.statisticsCount++);
+        vkCmdBeginQuery(commandBuffer, frame.statisticsPool, static_cast<uint32_t>(scope.statisticsQuery), 0);
+    }
+
+    depth++;
+    frame.scopes.push_back(scope);
+
+    return static_cast<uint32_t>(frame.scopes.size() - 1);
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+    if (scope == INVALID_SCOPE || mGpuProfilerImpl == nullptr || !mGpuProfilerImpl->bEnabled)
+        return;
+
+    std::lock_guard<std::mutex> lock(mGpuProfilerImpl->mutex);
+
+    GpuProfilerFrame& frame = mGpuProfilerImpl->frames[mGpuProfilerImpl->currentFrame];
+    assert(scope < frame.scopes.size() && !frame.scopes[scope].bClosed && "Invalid GPU scope");
+
+    GpuProfilerScope& profilerScope = frame.scopes[scope];
+
+    if (profilerScope.statisticsQuery >= 0)
+        vkCmdEndQuery(commandBuffer, frame.statisticsPool, static_cast<uint32_t>(profilerScope.statisticsQuery));
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool, profilerScope.timestampQuery + 1);
+    profilerScope.bClosed = true;
+
+    auto openScope = mGpuProfilerImpl->openScopes.find(commandBuffer);
+    if (--openScope->second == 0)
+        mGpuProfilerImpl->openScopes.erase(openScope);
+}
+
+bool GpuProfiler::IsEnabled()
+{
+    return mGpuProfilerImpl != nullptr && mGpuProfilerImpl->bEnabled;
+}
+
+TracyVkCtx GpuProfiler::GetTracyContext()
+{
+    return mGpuProfilerImpl ? mGpuProfilerImpl->tracyContext : nullptr;
+}
+
+const std::vector<GpuScopeTiming> &GpuProfiler::GetLastFrameTimings()
+{
+    return mGpuProfilerImpl->lastFrameTimings;
+}
+
+double GpuProfiler::GetScopeTime(const std::string &sName)
+{
+    for (const auto& timing : mGpuProfilerImpl->lastFrameTimings)
+    {
+        if (timing.name == sName)
+            return timing.milliseconds;
+    }
+
+    return 0.0;
+}
+
+const FrameStatistics *GpuProfiler::GetScopeStatistics(const std::string &sName)
+{
+    auto stats = mGpuProfilerImpl->scopeStats.find(sName);
+    return stats != mGpuProfilerImpl->scopeStats.end() ? &stats->second : nullptr;
+}
+
+void GpuProfiler::ReportStatistics()
+{
+    if (!mGpuProfilerImpl->bEnabled)
+        return;
+
+    for (const auto& [sName, stats] : mGpuProfilerImpl->scopeStats)
+    {
+        if (stats.GetSampleCount() > 0)
+            stats.Report("GPU " + sName);
+    }
+
+    for (const auto& timing : mGpuProfilerImpl->lastFrameTimings)
+    {
+        if (!timing.hasPipelineStatistics)
+            continue;
+
+        std::stringstream ss;
+        ss << "GPU " << timing.name << " (last frame) | vertex invocations: " << timing.vertexInvocations
+           << " | fragment invocations: " << timing.fragmentInvocations;
+        Logger::Info(ss.str());
+    }
+}
+
+GpuProfileScope::GpuProfileScope(VkCommandBuffer commandBuffer, const char *sName)
+    : mCommandBuffer(commandBuffer), mScope(GpuProfiler::BeginScope(commandBuffer, sName))
+{
+}
+
+GpuProfileScope::~GpuProfileScope()
+{
+    GpuProfiler::EndScope(mCommandBuffer, mScope);
+}
+
+//
+// Implementation
+//
+
+GpuProfilerImpl::GpuProfilerImpl()
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(VulkanDevice::GetPhysicalDevice(), &properties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(VulkanDevice::GetPhysicalDevice(), &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(VulkanDevice::GetPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[VulkanDevice::GetGraphicsQueueFamilyIdx()].timestampValidBits;
+
+    if (!Config::IsGpuProfilingEnabled())
+    {
+        Logger::Info("GPU profiling disabled by config");
+        return;
+    }
+
+    if (validBits == 0)
+    {
+        Logger::Warn("Graphics queue doesn't support timestamps, GPU profiling disabled");
+        return;
+    }
+
+    bEnabled = true;
+    bPipelineStatistics = VulkanDevice::IsPipelineStatisticsEnabled();
+    timestampPeriod = static_cast<double>(properties.limits.timestampPeriod);
+    timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    CreateQueryPools();
+    CreateTracyContext();
+}
+
+GpuProfilerImpl::~GpuProfilerImpl()
+{
+    if (tracyContext)
+    {
+        TracyVkDestroy(tracyContext);
+    }
+
+    DestroyQueryPools();
+}
+
+void GpuProfilerImpl::CreateQueryPools()
+{
+    frames.resize(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT);
+
+    for (auto& frame : frames)
+    {
+        VkQueryPoolCreateInfo timestampInfo{};
+        timestampInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        timestampInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        timestampInfo.queryCount = MAX_SCOPES_PER_FRAME * 2; // begin + end
+
+        VK_CHECK(vkCreateQueryPool(VulkanDevice::GetDevice(), &timestampInfo, nullptr, &frame.timestampPool));
+
+        if (bPipelineStatistics)
+        {
+            VkQueryPoolCreateInfo statisticsInfo{};
+            statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            statisticsInfo.queryCount = MAX_SCOPES_PER_FRAME;
+            statisticsInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                                                VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+            VK_CHECK(vkCreateQueryPool(VulkanDevice::GetDevice(), &statisticsInfo, nullptr, &frame.statisticsPool));
+        }
+    }
+
+    Logger::Debug("Created GPU profiler query pools");
+}
+
+void GpuProfilerImpl::DestroyQueryPools()
+{
+    for (auto& frame : frames)
+    {
+        if (frame.timestampPool != VK_NULL_HANDLE)
+            vkDestroyQueryPool(VulkanDevice::GetDevice(), frame.timestampPool, nullptr);
+
+        if (frame.statisticsPool != VK_NULL_HANDLE)
+            vkDestroyQueryPool(VulkanDevice::GetDevice(), frame.statisticsPool, nullptr);
+    }
+
+    frames.clear();
+}
+
+void GpuProfilerImpl::CreateTracyContext()
+{
+    // tracy calibrates its GPU clock by submitting a few command buffers of its own
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = VulkanDevice::GetCommandPool();
+    allocInfo.commandBufferCount = 1;
+
+    // NOTE: Tracy records into the command buffer, so the pool stays locked until it's freed
+    std::lock_guard<std::mutex> lock(VulkanDevice::GetCommandPoolMutex());
+
+    VkCommandBuffer commandBuffer;
+    VK_CHECK(vkAllocateCommandBuffers(VulkanDevice::GetDevice(), &allocInfo, &commandBuffer));
+
+    tracyContext = TracyVkContext(VulkanDevice::GetPhysicalDevice(), VulkanDevice::GetDevice(),
+                                  VulkanDevice::GetGraphicsQueue(), commandBuffer);
+
+    vkFreeCommandBuffers(VulkanDevice::GetDevice(), VulkanDevice::GetCommandPool(), 1, &commandBuffer);
+}
+
+void GpuProfilerImpl::ResolveFrame(GpuProfilerFrame &frame)
+{
+    if (frame.scopes.empty())
+        return;
+
+    uint32_t scopeCount = static_cast<uint32_t>(frame.scopes.size());
+
+    std::vector<uint64_t> timestamps(scopeCount * 2);
+    VkResult result = vkGetQueryPoolResults(VulkanDevice::GetDevice(), frame.timestampPool, 0, scopeCount * 2,
+                                            timestamps.size() * sizeof(uint64_t), timestamps.data(),
+                                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    // two statistics per query, in the order of the bits (vertex before fragment)
+    std::vector<uint64_t> statistics(frame.statisticsCount * 2);
+    if (result == VK_SUCCESS && frame.statisticsCount > 0)
+    {
+        result = vkGetQueryPoolResults(VulkanDevice::GetDevice(), frame.statisticsPool, 0, frame.statisticsCount,
+                                       statistics.size() * sizeof(uint64_t), statistics.data(),
+                                       2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        lastFrameTimings.clear();
+
+        for (const auto& scope : frame.scopes)
+        {
+            if (!scope.bClosed)
+                continue;
+
+            uint64_t begin = timestamps[scope.timestampQuery] & timestampMask;
+            uint64_t end = timestamps[scope.timestampQuery + 1] & timestampMask;
+
+            GpuScopeTiming timing;
+            timing.name = scope.name;
+            timing.depth = scope.depth;
+            timing.milliseconds = static_cast<double>((end - begin) & timestampMask) * timestampPeriod / 1000000.0;
+
+            if (scope.statisticsQuery >= 0)
+            {
+                timing.hasPipelineStatistics = true;
+                timing.vertexInvocations = statistics[scope.statisticsQuery * 2];
+                timing.fragmentInvocations = statistics[scope.statisticsQuery * 2 + 1];
+            }
+
+            scopeStats[timing.name].AddSample(timing.milliseconds);
+            lastFrameTimings.push_back(timing);
+        }
+    } else {
+        Logger::Warn("GPU profiler results were not ready, dropping a frame of timings");
+    }
+
+    frame.scopes.clear();
+    frame.statisticsCount = 0;
+}
@@ -0,0 +1,127 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_GPUPROFILER_H
+#define VULKAN_ENGINE_GPUPROFILER_H
+
+#include <vulkan/vulkan.h>
+#include <TracyVulkan.hpp>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FrameStatistics.h"
+#include "Profiler.h"
+
+// timings of a named GPU scope, resolved once the frame that recorded it has finished on the GPU
+struct GpuScopeTiming
+{
+    std::string name;
+    uint32_t depth = 0;
+    double milliseconds = 0.0;
+
+    // only filled for top level scopes when pipeline statistics are enabled
+    bool hasPipelineStatistics = false;
+    uint64_t vertexInvocations = 0;
+    uint64_t fragmentInvocations = 0;
+};
+
+struct GpuProfilerScope
+{
+    std::string name;
+    uint32_t depth = 0;
+    uint32_t timestampQuery = 0;        // begin query, the end query is the next one
+    int32_t statisticsQuery = -1;       // -1 when no statistics were recorded for this scope
+    bool bClosed = false;
+};
+
+// each frame in flight owns its query pools, so we never reset queries the GPU may still be writing to
+struct GpuProfilerFrame
+{
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;
+    std::vector<GpuProfilerScope> scopes;
+    uint32_t statisticsCount = 0;
+};
+
+struct GpuProfilerImpl
+{
+    GpuProfilerImpl();
+    ~GpuProfilerImpl();
+
+    static constexpr uint32_t MAX_SCOPES_PER_FRAME = 256;
+
+    void CreateQueryPools();
+    void DestroyQueryPools();
+    void CreateTracyContext();
+    void ResolveFrame(GpuProfilerFrame& frame);
+
+    bool bEnabled = false;
+    bool bPipelineStatistics = false;
+
+    double timestampPeriod = 1.0; // nanoseconds per tick
+    uint64_t timestampMask = ~0ull;
+
+    std::vector<GpuProfilerFrame> frames;
+    uint32_t currentFrame = 0;
+
+    // scopes may be recorded from any thread and any command buffer of the current frame
+    std::mutex mutex;
+    std::unordered_map<VkCommandBuffer, uint32_t> openScopes; // nesting depth per command buffer
+
+    std::vector<GpuScopeTiming> lastFrameTimings;
+    std::map<std::string, FrameStatistics> scopeStats;
+
+    TracyVkCtx tracyContext = nullptr;
+};
+
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t INVALID_SCOPE = ~0u;
+
+    // needs the device to be initialized
+    static void Init();
+    static void Shutdown();
+
+    // call right after the frame's command buffer has begun (outside of any render pass)
+    // NOTE: The GPU must be done with this frame slot already, since its results are read back here
+    static void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    static uint32_t BeginScope(VkCommandBuffer commandBuffer, const std::string& sName);
+    static void EndScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    static bool IsEnabled();
+    static TracyVkCtx GetTracyContext();
+
+    // timings of the most recent frame that completed on the GPU
+    static const std::vector<GpuScopeTiming>& GetLastFrameTimings();
+    static double GetScopeTime(const std::string& sName);
+    static const FrameStatistics* GetScopeStatistics(const std::string& sName);
+    static void ReportStatistics();
+};
+
+// RAII helper, prefer the GPU_PROFILE_SCOPE macro which also emits a Tracy GPU zone
+class GpuProfileScope
+{
+public:
+    GpuProfileScope(VkCommandBuffer commandBuffer, const char* sName);
+    ~GpuProfileScope();
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    VkCommandBuffer mCommandBuffer;
+    uint32_t mScope;
+};
+
+#define GPU_PROFILE_SCOPE(commandBuffer, name)                                              \
+    GpuProfileScope CONCAT(gpuProfileScope, __LINE__)(commandBuffer, name);                \
+    TracyVkZoneTransient(GpuProfiler::GetTracyContext(), CONCAT(tracyGpuZone, __LINE__),   \
+                         commandBuffer, name, GpuProfiler::GetTracyContext() != nullptr)
+
+
+#endif //VULKAN_ENGINE_GPUPROFILER_H
@@ -0,0 +1,79 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "InitTimings.h"
+#include "Logger.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+InitTimings::InitTimings() : mStart(std::chrono::steady_clock::now())
+{
+}
+
+void InitTimings::Measure(const std::string &sName, const std::function<void()> &function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.push_back({ sName, std::chrono::duration<double, std::milli>(start - mStart).count(),
+                         std::chrono::duration<double, std::milli>(end - start).count(), JobSystem::GetCurrentThreadIdx() });
+}
+
+void InitTimings::MeasureAsync(const std::string &sName, const std::function<void()> &function, JobCounter &counter)
+{
+    JobSystem::Run([this, sName, function]() {
+        try
+        {
+            Measure(sName, function);
+        } catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mFailure)
+                mFailure = std::current_exception();
+        }
+    }, &counter);
+}
+
+void InitTimings::RethrowFailure()
+{
+    std::exception_ptr failure;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::swap(failure, mFailure);
+    }
+
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+void InitTimings::Report() const
+{
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        entries = mEntries;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.startMilliseconds < b.startMilliseconds;
+    });
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2) << "Initialization took " << GetElapsedMilliseconds() << " ms:";
+    for (const auto& entry : entries)
+    {
+        ss << "\n  " << std::left << std::setw(20) << entry.name << std::right << " at " << std::setw(8)
+           << entry.startMilliseconds << " ms, took " << std::setw(8) << entry.durationMilliseconds << " ms on "
+           << (entry.threadIdx == 0 ? std::string("the main thread") : "worker " + std::to_string(entry.threadIdx));
+    }
+    Logger::Info(ss.str());
+}
+
+double InitTimings::GetElapsedMilliseconds() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+}
@@ -0,0 +1,54 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_INITTIMINGS_H
+#define VULKAN_ENGINE_INITTIMINGS_H
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../common/JobSystem.h"
+
+// Times the initialization of each subsystem, whether it runs on the main thread or on the job system, so
+// time-to-first-frame can be tracked. Starts counting when created.
+class InitTimings
+{
+public:
+    InitTimings();
+
+    // runs the function here
+    void Measure(const std::string& sName, const std::function<void()>& function);
+    // runs the function on the job system, exceptions are kept for RethrowFailure
+    void MeasureAsync(const std::string& sName, const std::function<void()>& function, JobCounter& counter);
+
+    // throws the first exception an async init hit (wait on its counter first)
+    void RethrowFailure();
+
+    // logs every subsystem (when it started, how long it took and on which thread) and the total so far
+    void Report() const;
+
+    double GetElapsedMilliseconds() const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        double startMilliseconds;
+        double durationMilliseconds;
+        uint32_t threadIdx;
+    };
+
+    std::chrono::steady_clock::time_point mStart;
+
+    mutable std::mutex mMutex;
+    std::vector<Entry> mEntries;
+    std::exception_ptr mFailure;
+};
+
+
+#endif //VULKAN_ENGINE_INITTIMINGS_H
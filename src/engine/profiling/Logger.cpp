@@ -4,6 +4,10 @@
 
 #include "Logger.h"
 #include "../common/Config.h"
+#include <mutex>
+
+// subsystems log from worker threads too, this keeps lines (and the log file) from interleaving
+std::mutex mLoggerMutex;
 
 /*
  * INITIALIZATION
@@ -33,6 +37,7 @@ void Logger::Init()
  */
 void Logger::Info(std::string msg)
 {
+    std::lock_guard<std::mutex> lock(mLoggerMutex);
 #ifdef SHOW_CONSOLE
 #if __linux__ || __APPLE__
     std::cout << COLOR_BLUE << INFO_STR << msg << RESET << std::endl;
@@ -50,6 +55,7 @@ void Logger::Info(std::string msg)
  */
 void Logger::Warn(std::string msg)
 {
+    std::lock_guard<std::mutex> lock(mLoggerMutex);
 #ifdef SHOW_CONSOLE
 #if __linux__ || __APPLE__
     std::cout << COLOR_YELLOW << WARN_STR << msg << RESET << std::endl;
@@ -67,6 +73,7 @@ void Logger::Warn(std::string msg)
  */
 void Logger::Error(std::string errMsg, std::string errParam)
 {
+    std::lock_guard<std::mutex> lock(mLoggerMutex);
 #ifdef SHOW_CONSOLE
 #if __linux__ || __APPLE__
     std::cout << COLOR_RED << ERROR_STR << errMsg << " -> " << errParam << RESET << std::endl;
@@ -84,6 +91,7 @@ void Logger::Error(std::string errMsg, std::string errParam)
  */
 void Logger::Debug(std::string msg)
 {
+    std::lock_guard<std::mutex> lock(mLoggerMutex);
 #ifdef SHOW_CONSOLE
 #if __linux__ || __APPLE__
     std::cout << COLOR_PURPLE << DEBUG_STR << msg << RESET << std::endl;
@@ -0,0 +1,259 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "CommandBufferCache.h"
+#include "DeletionQueue.h"
+#include "EngineRenderer.h"
+#include "VulkanDevice.h"
+#include "VulkanSwapchain.h"
+#include <Tracy.hpp>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+CommandBufferCacheImpl* mCommandBufferCacheImpl = nullptr;
+
+//
+// Initialization/Destruction
+//
+
+void CommandBufferCache::Init()
+{
+    mCommandBufferCacheImpl = new CommandBufferCacheImpl;
+}
+
+void CommandBufferCache::Shutdown()
+{
+    delete mCommandBufferCacheImpl;
+    mCommandBufferCacheImpl = nullptr;
+}
+
+//
+// External
+//
+
+void CommandBufferCache::BeginFrame()
+{
+    TracyPlot("Draw sets recorded", static_cast<int64_t>(mCommandBufferCacheImpl->frameRecords));
+    TracyPlot("Draw sets reused", static_cast<int64_t>(mCommandBufferCacheImpl->frameReuses));
+
+    mCommandBufferCacheImpl->frameRecords = 0;
+    mCommandBufferCacheImpl->frameReuses = 0;
+}
+
+uint32_t CommandBufferCache::CreateDrawSet(const std::string &sName, const DrawSetRecordFunction &record,
+                                           const std::vector<uint64_t> &dependencies)
+{
+    uint32_t id = mCommandBufferCacheImpl->nextDrawSetId++;
+
+    StaticDrawSet drawSet;
+    drawSet.name = sName;
+    drawSet.record = record;
+    drawSet.dependencies = dependencies;
+    drawSet.frames.resize(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT);
+
+    // secondary command buffers are allocated up front, they get reset (not freed) when re-recorded
+    std::vector<VkCommandBuffer> commandBuffers(drawSet.frames.size());
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = VulkanDevice::GetCommandPool();
+    allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+
+    {
+        std::lock_guard<std::mutex> lock(VulkanDevice::GetCommandPoolMutex());
+        VK_CHECK(vkAllocateCommandBuffers(VulkanDevice::GetDevice(), &allocInfo, commandBuffers.data()));
+    }
+
+    for (size_t i = 0; i < commandBuffers.size(); i++)
+        drawSet.frames[i].commandBuffer = commandBuffers[i];
+
+    mCommandBufferCacheImpl->drawSets[id] = std::move(drawSet);
+
+    Logger::Debug("Created static draw set '" + sName + "'");
+
+    return id;
+}
+
+void CommandBufferCache::DestroyDrawSet(uint32_t drawSet)
+{
+    auto it = mCommandBufferCacheImpl->drawSets.find(drawSet);
+    if (it == mCommandBufferCacheImpl->drawSets.end())
+        return;
+
+    // the frame being recorded (or one still in flight) may execute them, they're freed once it completed
+    for (auto& recorded : it->second.frames)
+        DeletionQueue::PushCommandBuffer(recorded.commandBuffer);
+
+    mCommandBufferCacheImpl->drawSets.erase(it);
+}
+
+void CommandBufferCache::SetDependencies(uint32_t drawSet, const std::vector<uint64_t> &dependencies)
+{
+    auto it = mCommandBufferCacheImpl->drawSets.find(drawSet);
+    if (it == mCommandBufferCacheImpl->drawSets.end())
+        return;
+
+    it->second.dependencies = dependencies;
+    InvalidateDrawSet(drawSet);
+}
+
+void CommandBufferCache::Invalidate(uint64_t dependency)
+{
+    mCommandBufferCacheImpl->dependencyVersions[dependency]++;
+}
+
+void CommandBufferCache::InvalidateDrawSet(uint32_t drawSet)
+{
+    auto it = mCommandBufferCacheImpl->drawSets.find(drawSet);
+    if (it == mCommandBufferCacheImpl->drawSets.end())
+        return;
+
+    for (auto& recorded : it->second.frames)
+        recorded.bValid = false;
+}
+
+void CommandBufferCache::Execute(VkCommandBuffer commandBuffer, const std::vector<uint32_t> &drawSets)
+{
+    ZoneScoped;
+
+    uint32_t frameIndex = EngineRenderer::GetFrameIndex();
+
+    std::vector<VkCommandBuffer> secondaryBuffers;
+    secondaryBuffers.reserve(drawSets.size());
+
+    for (auto id : drawSets)
+    {
+        auto it = mCommandBufferCacheImpl->drawSets.find(id);
+        if (it == mCommandBufferCacheImpl->drawSets.end())
+        {
+            Logger::Warn("Trying to execute an unknown draw set");
+            continue;
+        }
+
+        StaticDrawSet& drawSet = it->second;
+        RecordedDrawSet& recorded = drawSet.frames[frameIndex];
+
+        // this frame slot was waited on in BeginFrame, so its command buffer is no longer in use
+        if (mCommandBufferCacheImpl->IsUpToDate(drawSet, recorded))
+        {
+            mCommandBufferCacheImpl->frameReuses++;
+        } else
+        {
+            mCommandBufferCacheImpl->Record(drawSet, recorded);
+            mCommandBufferCacheImpl->frameRecords++;
+        }
+
+        secondaryBuffers.push_back(recorded.commandBuffer);
+    }
+
+    if (!secondaryBuffers.empty())
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+}
+
+uint32_t CommandBufferCache::GetFrameRecordCount()
+{
+    return mCommandBufferCacheImpl->frameRecords;
+}
+
+uint32_t CommandBufferCache::GetFrameReuseCount()
+{
+    return mCommandBufferCacheImpl->frameReuses;
+}
+
+//
+// Implementation
+//
+
+CommandBufferCacheImpl::CommandBufferCacheImpl() = default;
+
+CommandBufferCacheImpl::~CommandBufferCacheImpl()
+{
+    // the renderer waits for the device to be idle before shutting down its systems
+    std::lock_guard<std::mutex> lock(VulkanDevice::GetCommandPoolMutex());
+    for (auto& [id, drawSet] : drawSets)
+    {
+        for (auto& recorded : drawSet.frames)
+            vkFreeCommandBuffers(VulkanDevice::GetDevice(), VulkanDevice::GetCommandPool(), 1, &recorded.commandBuffer);
+    }
+
+    drawSets.clear();
+}
+
+bool CommandBufferCacheImpl::IsUpToDate(const StaticDrawSet &drawSet, const RecordedDrawSet &recorded) const
+{
+    if (!recorded.bValid)
+        return false;
+
+    // a recreated swap chain means a new render pass and (probably) a new extent baked into the viewport
+    VkExtent2D extent = VulkanSwapchain::GetExtent();
+    if (recorded.renderPass != VulkanSwapchain::GetRenderPass() ||
+        recorded.extent.width != extent.width || recorded.extent.height != extent.height)
+        return false;
+
+    if (recorded.dependencyVersions.size() != drawSet.dependencies.size())
+        return false;
+
+    for (size_t i = 0; i < drawSet.dependencies.size(); i++)
+    {
+        auto it = dependencyVersions.find(drawSet.dependencies[i]);
+        uint64_t version = it != dependencyVersions.end() ? it->second : 0;
+        if (version != recorded.dependencyVersions[i])
+            return false;
+    }
+
+    return true;
+}
+
+void CommandBufferCacheImpl::Record(StaticDrawSet &drawSet, RecordedDrawSet &recorded)
+{
+    ZoneScoped;
+    ZoneText(drawSet.name.c_str(), drawSet.name.size());
+
+    VkExtent2D extent = VulkanSwapchain::GetExtent();
+    VkRenderPass renderPass = VulkanSwapchain::GetRenderPass();
+
+    VK_CHECK(vkResetCommandBuffer(recorded.commandBuffer, 0));
+
+    // the framebuffer is left out, so the same recording works for every swap chain image
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    VK_CHECK(vkBeginCommandBuffer(recorded.commandBuffer, &beginInfo));
+
+    // dynamic state is not inherited from the primary command buffer
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{{0, 0}, extent};
+    vkCmdSetViewport(recorded.commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(recorded.commandBuffer, 0, 1, &scissor);
+
+    if (drawSet.record)
+        drawSet.record(recorded.commandBuffer);
+
+    VK_CHECK(vkEndCommandBuffer(recorded.commandBuffer));
+
+    recorded.renderPass = renderPass;
+    recorded.extent = extent;
+    recorded.dependencyVersions.resize(drawSet.dependencies.size());
+    for (size_t i = 0; i < drawSet.dependencies.size(); i++)
+    {
+        auto it = dependencyVersions.find(drawSet.dependencies[i]);
+        recorded.dependencyVersions[i] = it != dependencyVersions.end() ? it->second : 0;
+    }
+    recorded.bValid = true;
+}
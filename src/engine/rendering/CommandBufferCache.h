@@ -0,0 +1,92 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_COMMANDBUFFERCACHE_H
+#define VULKAN_ENGINE_COMMANDBUFFERCACHE_H
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// records the draw commands of a static draw set (viewport/scissor are already set when this gets called)
+typedef std::function<void(VkCommandBuffer)> DrawSetRecordFunction;
+
+// a secondary command buffer for one frame in flight, with the state it was recorded against
+struct RecordedDrawSet
+{
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    bool bValid = false;
+
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkExtent2D extent{};
+    std::vector<uint64_t> dependencyVersions;
+};
+
+struct StaticDrawSet
+{
+    std::string name;
+    DrawSetRecordFunction record;
+
+    // anything the recorded commands depend on (pipelines, buffers, descriptor sets, ...)
+    std::vector<uint64_t> dependencies;
+
+    std::vector<RecordedDrawSet> frames; // one per frame in flight, so we never re-record a pending command buffer
+};
+
+struct CommandBufferCacheImpl
+{
+    CommandBufferCacheImpl();
+    ~CommandBufferCacheImpl();
+
+    bool IsUpToDate(const StaticDrawSet& drawSet, const RecordedDrawSet& recorded) const;
+    void Record(StaticDrawSet& drawSet, RecordedDrawSet& recorded);
+
+    std::unordered_map<uint32_t, StaticDrawSet> drawSets;
+    uint32_t nextDrawSetId = 1;
+
+    // bumped every time a dependency is invalidated
+    std::unordered_map<uint64_t, uint64_t> dependencyVersions;
+
+    // per frame counters
+    uint32_t frameRecords = 0;
+    uint32_t frameReuses = 0;
+};
+
+// Retained mode for static draws: the commands of a draw set are recorded once into secondary command buffers and
+// replayed every frame with vkCmdExecuteCommands, until something they depend on changes.
+class CommandBufferCache
+{
+public:
+    static constexpr uint32_t INVALID_DRAW_SET = 0;
+
+    static void Init();
+    static void Shutdown();
+
+    static void BeginFrame();
+
+    static uint32_t CreateDrawSet(const std::string& sName, const DrawSetRecordFunction& record,
+                                  const std::vector<uint64_t>& dependencies = {});
+    static void DestroyDrawSet(uint32_t drawSet);
+    static void SetDependencies(uint32_t drawSet, const std::vector<uint64_t>& dependencies);
+
+    // call when a dependency changed (recreated pipeline, new buffer contents, updated descriptors, ...)
+    static void Invalidate(uint64_t dependency);
+    static void InvalidateDrawSet(uint32_t drawSet);
+
+    // re-records what is out of date and executes every draw set with a single vkCmdExecuteCommands
+    // NOTE: The swap chain render pass must have been started with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    static void Execute(VkCommandBuffer commandBuffer, const std::vector<uint32_t>& drawSets);
+
+    static uint32_t GetFrameRecordCount();
+    static uint32_t GetFrameReuseCount();
+
+    // turns any vulkan handle into a dependency
+    template<typename T>
+    static uint64_t Dependency(T handle) { return (uint64_t) handle; }
+};
+
+
+#endif //VULKAN_ENGINE_COMMANDBUFFERCACHE_H
@@ -0,0 +1,231 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "DeletionQueue.h"
+#include "VulkanDevice.h"
+#include "GpuSync.h"
+#include <algorithm>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+DeletionQueueImpl* mDeletionQueueImpl = nullptr;
+
+// NOTE: Non-dispatchable handles are pointers on 64-bit platforms and uint64_t on 32-bit ones, the C-style cast
+//       works for both
+#define PUSH_HANDLE(type, handle, frame) mDeletionQueueImpl->Push(type, (uint64_t) handle, ResolveFrame(frame))
+
+uint64_t ResolveFrame(uint64_t lastUsedFrame)
+{
+    // the frame being recorded will get the next submission number
+    if (lastUsedFrame == DeletionQueue::CURRENT_FRAME)
+        return GpuSync::GetLastSubmittedValue(QUEUE_GRAPHICS) + 1;
+
+    return lastUsedFrame;
+}
+
+//
+// Initialization/Destruction
+//
+
+void DeletionQueue::Init()
+{
+    mDeletionQueueImpl = new DeletionQueueImpl;
+}
+
+void DeletionQueue::Shutdown()
+{
+    mDeletionQueueImpl->Flush(UINT64_MAX);
+
+    Logger::Debug("Deletion queue released " + std::to_string(mDeletionQueueImpl->totalReleased) + " resources");
+
+    delete mDeletionQueueImpl;
+    mDeletionQueueImpl = nullptr;
+}
+
+//
+// External
+//
+
+void DeletionQueue::Flush()
+{
+    mDeletionQueueImpl->Flush(GpuSync::GetCompletedValue(QUEUE_GRAPHICS));
+}
+
+void DeletionQueue::PushBuffer(VkBuffer buffer, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_BUFFER, buffer, lastUsedFrame);
+}
+
+void DeletionQueue::PushImage(VkImage image, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_IMAGE, image, lastUsedFrame);
+}
+
+void DeletionQueue::PushImageView(VkImageView imageView, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_IMAGE_VIEW, imageView, lastUsedFrame);
+}
+
+void DeletionQueue::PushSampler(VkSampler sampler, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_SAMPLER, sampler, lastUsedFrame);
+}
+
+void DeletionQueue::PushFramebuffer(VkFramebuffer framebuffer, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_FRAMEBUFFER, framebuffer, lastUsedFrame);
+}
+
+void DeletionQueue::PushRenderPass(VkRenderPass renderPass, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_RENDER_PASS, renderPass, lastUsedFrame);
+}
+
+void DeletionQueue::PushPipeline(VkPipeline pipeline, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_PIPELINE, pipeline, lastUsedFrame);
+}
+
+void DeletionQueue::PushPipelineLayout(VkPipelineLayout pipelineLayout, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_PIPELINE_LAYOUT, pipelineLayout, lastUsedFrame);
+}
+
+void DeletionQueue::PushDescriptorPool(VkDescriptorPool descriptorPool, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_DESCRIPTOR_POOL, descriptorPool, lastUsedFrame);
+}
+
+void DeletionQueue::PushShaderModule(VkShaderModule shaderModule, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_SHADER_MODULE, shaderModule, lastUsedFrame);
+}
+
+void DeletionQueue::PushMemory(VkDeviceMemory memory, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_DEVICE_MEMORY, memory, lastUsedFrame);
+}
+
+void DeletionQueue::PushSwapchain(VkSwapchainKHR swapchain, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_SWAPCHAIN_KHR, swapchain, lastUsedFrame);
+}
+
+void DeletionQueue::PushSemaphore(VkSemaphore semaphore, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_SEMAPHORE, semaphore, lastUsedFrame);
+}
+
+void DeletionQueue::PushFence(VkFence fence, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_FENCE, fence, lastUsedFrame);
+}
+
+void DeletionQueue::PushCommandBuffer(VkCommandBuffer commandBuffer, uint64_t lastUsedFrame)
+{
+    PUSH_HANDLE(VK_OBJECT_TYPE_COMMAND_BUFFER, commandBuffer, lastUsedFrame);
+}
+
+size_t DeletionQueue::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(mDeletionQueueImpl->mutex);
+    return mDeletionQueueImpl->pending.size();
+}
+
+//
+// Implementation
+//
+
+void DeletionQueueImpl::Push(VkObjectType type, uint64_t handle, uint64_t lastUsedFrame)
+{
+    if (handle == 0) // VK_NULL_HANDLE
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back({ type, handle, lastUsedFrame });
+}
+
+void DeletionQueueImpl::Flush(uint64_t completedFrame)
+{
+    std::vector<PendingDeletion> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // keeping the push order, so dependent objects (ex.: framebuffers before their views) go first
+        auto firstPending = std::stable_partition(pending.begin(), pending.end(), [completedFrame](const PendingDeletion& deletion) {
+            return deletion.lastUsedFrame <= completedFrame;
+        });
+
+        released.assign(pending.begin(), firstPending);
+        pending.erase(pending.begin(), firstPending);
+    }
+
+    // destroying outside of the lock, other threads can keep pushing in the meantime
+    for (const auto& deletion : released)
+        Destroy(deletion);
+
+    totalReleased += released.size();
+}
+
+void DeletionQueueImpl::Destroy(const PendingDeletion &deletion)
+{
+    VkDevice device = VulkanDevice::GetDevice();
+
+    switch (deletion.type)
+    {
+        case VK_OBJECT_TYPE_BUFFER:
+            vkDestroyBuffer(device, (VkBuffer) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_IMAGE:
+            vkDestroyImage(device, (VkImage) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_IMAGE_VIEW:
+            vkDestroyImageView(device, (VkImageView) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_SAMPLER:
+            vkDestroySampler(device, (VkSampler) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_FRAMEBUFFER:
+            vkDestroyFramebuffer(device, (VkFramebuffer) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_RENDER_PASS:
+            vkDestroyRenderPass(device, (VkRenderPass) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_PIPELINE:
+            vkDestroyPipeline(device, (VkPipeline) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+            vkDestroyPipelineLayout(device, (VkPipelineLayout) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+            vkDestroyDescriptorPool(device, (VkDescriptorPool) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_SHADER_MODULE:
+            vkDestroyShaderModule(device, (VkShaderModule) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_DEVICE_MEMORY:
+            vkFreeMemory(device, (VkDeviceMemory) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+            vkDestroySwapchainKHR(device, (VkSwapchainKHR) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_SEMAPHORE:
+            vkDestroySemaphore(device, (VkSemaphore) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_FENCE:
+            vkDestroyFence(device, (VkFence) deletion.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_COMMAND_BUFFER:
+        {
+            // NOTE: Flushing runs on the render thread, other threads may be allocating from the pool meanwhile
+            auto commandBuffer = (VkCommandBuffer) deletion.handle;
+            std::lock_guard<std::mutex> lock(VulkanDevice::GetCommandPoolMutex());
+            vkFreeCommandBuffers(device, VulkanDevice::GetCommandPool(), 1, &commandBuffer);
+            break;
+        }
+        default:
+            Logger::Error("Unsupported object type in deletion queue", std::to_string(deletion.type));
+            break;
+    }
+}
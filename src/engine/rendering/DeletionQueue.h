@@ -0,0 +1,68 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_DELETIONQUEUE_H
+#define VULKAN_ENGINE_DELETIONQUEUE_H
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct PendingDeletion
+{
+    VkObjectType type;
+    uint64_t handle;
+    uint64_t lastUsedFrame; // graphics timeline value of the last submission using it (see GpuSync)
+};
+
+struct DeletionQueueImpl
+{
+    void Push(VkObjectType type, uint64_t handle, uint64_t lastUsedFrame);
+    void Flush(uint64_t completedFrame);
+    void Destroy(const PendingDeletion& deletion);
+
+    // resources may be released from streaming/loading threads
+    std::mutex mutex;
+    std::vector<PendingDeletion> pending;
+
+    uint64_t totalReleased = 0;
+};
+
+// Resources handed over here are destroyed once the GPU has finished the frame they were last used in,
+// so they can be released at any time without waiting for the device to be idle.
+class DeletionQueue
+{
+public:
+    static void Init();
+    static void Shutdown(); // releases everything, the device must be idle
+
+    // releases (in bulk, in the order they were pushed) every resource whose frame has completed
+    static void Flush();
+
+    // means "the frame currently being recorded", which is the most conservative choice
+    static constexpr uint64_t CURRENT_FRAME = UINT64_MAX;
+
+    static void PushBuffer(VkBuffer buffer, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushImage(VkImage image, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushImageView(VkImageView imageView, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushSampler(VkSampler sampler, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushFramebuffer(VkFramebuffer framebuffer, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushRenderPass(VkRenderPass renderPass, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushPipeline(VkPipeline pipeline, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushPipelineLayout(VkPipelineLayout pipelineLayout, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushDescriptorPool(VkDescriptorPool descriptorPool, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushShaderModule(VkShaderModule shaderModule, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushMemory(VkDeviceMemory memory, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushSwapchain(VkSwapchainKHR swapchain, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushSemaphore(VkSemaphore semaphore, uint64_t lastUsedFrame = CURRENT_FRAME);
+    static void PushFence(VkFence fence, uint64_t lastUsedFrame = CURRENT_FRAME);
+    // goes back to the device's command pool (see VulkanDevice::GetCommandPool)
+    static void PushCommandBuffer(VkCommandBuffer commandBuffer, uint64_t lastUsedFrame = CURRENT_FRAME);
+
+    static size_t GetPendingCount();
+};
+
+
+#endif //VULKAN_ENGINE_DELETIONQUEUE_H
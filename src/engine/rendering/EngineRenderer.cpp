@@ -3,6 +3,24 @@
 //
 
 #include "EngineRenderer.h"
+#include "FramePacer.h"
+#include "CommandBufferCache.h"
+#include "DeletionQueue.h"
+#include "GeometryBuffer.h"
+#include "GpuResources.h"
+#include "FrameCapture.h"
+#include "GpuCulling.h"
+#include "RenderQueue.h"
+#include "SceneRenderer.h"
+#include "GpuSync.h"
+#include "../common/JobSystem.h"
+#include "ImageStateTracker.h"
+#include "../profiling/GpuProfiler.h"
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <thread>
 
 // TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
 //       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
@@ -17,13 +35,42 @@ void EngineRenderer::Init()
     Logger::Info("Initializing engine renderer");
 
     VulkanDevice::Init();
+    GpuSync::Init();
+    DeletionQueue::Init();
+    GpuResources::Init();
+    ImageStateTracker::Init();
     VulkanSwapchain::Init();
+    GpuProfiler::Init();
+    CommandBufferCache::Init();
+    GeometryBuffer::Init();
+    GpuCulling::Init();
+    RenderQueue::Init();
+    SceneRenderer::Init();
+    FrameCapture::Init();
+
+    mEngineRendererImpl = new EngineRendererImpl;
 }
 
 void EngineRenderer::Shutdown()
 {
     Logger::Info("Shutting down engine renderer");
+
+    // don't destroy anything the GPU may still be using
+    VulkanDevice::WaitIdle();
+
+    delete mEngineRendererImpl;
+    FrameCapture::Shutdown();
+    SceneRenderer::Shutdown();
+    RenderQueue::Shutdown();
+    GpuCulling::Shutdown();
+    GeometryBuffer::Shutdown();
+    CommandBufferCache::Shutdown();
+    GpuProfiler::Shutdown();
     VulkanSwapchain::Shutdown();
+    GpuResources::Shutdown();
+    DeletionQueue::Shutdown();
+    ImageStateTracker::Shutdown();
+    GpuSync::Shutdown();
     VulkanDevice::Shutdown();
 }
 
@@ -33,18 +80,145 @@ void EngineRenderer::Shutdown()
 
 VkCommandBuffer EngineRenderer::BeginFrame()
 {
-    return nullptr;
+    assert(!mEngineRendererImpl->frameHasStarted && "Can't call BeginFrame while a frame is already in progress");
+
+    // a new present mode can only be applied by recreating the swap chain
+    if (FramePacer::HasPresentModeChanged() && !Window::IsHeadless())
+    {
+        FramePacer::ClearPresentModeChanged();
+        mEngineRendererImpl->RecreateSwapChain();
+        return nullptr;
+    }
+
+    VkResult result = VulkanSwapchain::AcquireNextImage(&mEngineRendererImpl->currentImageIdx);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) // swap chain out of date (can happen on window resize)
+    {
+        mEngineRendererImpl->RecreateSwapChain();
+        return nullptr;
+    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+    {
+        throw std::runtime_error("failed to acquire swap chain image");
+    }
+
+    // acquiring waited for this frame slot, so whatever was released before it can be destroyed now
+    DeletionQueue::Flush();
+    GeometryBuffer::BeginFrame();
+    GpuCulling::BeginFrame();
+    FrameCapture::BeginFrame();
+
+    mEngineRendererImpl->frameHasStarted = true;
+
+    VkCommandBuffer commandBuffer = mEngineRendererImpl->commandBuffers[mEngineRendererImpl->currentFrameIndex];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+    GpuProfiler::BeginFrame(commandBuffer, mEngineRendererImpl->currentFrameIndex);
+    ImageStateTracker::BeginFrame();
+    CommandBufferCache::BeginFrame();
+    RenderQueue::BeginFrame();
+
+    return commandBuffer;
 }
 
 void EngineRenderer::EndFrame()
 {
+    assert(mEngineRendererImpl->frameHasStarted && "Can't call EndFrame while a frame is not in progress");
+
+    VkCommandBuffer commandBuffer = mEngineRendererImpl->commandBuffers[mEngineRendererImpl->currentFrameIndex];
+    FrameCapture::RecordCaptures(commandBuffer, mEngineRendererImpl->currentImageIdx);
+    VK_CHECK(vkEndCommandBuffer(commandBuffer));
+
+    VkResult result = VulkanSwapchain::SubmitCommandBuffers(&commandBuffer, &mEngineRendererImpl->currentImageIdx);
+    FrameCapture::EndFrame(GpuSync::GetLastSubmitted(QUEUE_GRAPHICS));
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    {
+        mEngineRendererImpl->RecreateSwapChain();
+    } else if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to present swap chain image");
+    }
 
+    mEngineRendererImpl->frameHasStarted = false;
+    mEngineRendererImpl->currentFrameIndex = (mEngineRendererImpl->currentFrameIndex + 1) % VulkanSwapchain::MAX_FRAMES_IN_FLIGHT;
+}
+
+void EngineRenderer::BeginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents)
+{
+    assert(mEngineRendererImpl->frameHasStarted && "Can't begin the render pass while a frame is not in progress");
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = VulkanSwapchain::GetRenderPass();
+    renderPassInfo.framebuffer = VulkanSwapchain::GetFrameBuffer(mEngineRendererImpl->currentImageIdx);
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = VulkanSwapchain::GetExtent();
+
+    // the order of clear values must match the order of the attachments (color, depth)
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = {{0.01f, 0.01f, 0.01f, 1.0f}};
+    clearValues[1].depthStencil = {1.0f, 0};
+
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+    // only vkCmdExecuteCommands is allowed here, the secondary command buffers set their own viewport/scissor
+    if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+        return;
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(VulkanSwapchain::GetExtent().width);
+    viewport.height = static_cast<float>(VulkanSwapchain::GetExtent().height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{{0, 0}, VulkanSwapchain::GetExtent()};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void EngineRenderer::EndSwapChainRenderPass(VkCommandBuffer commandBuffer)
+{
+    assert(mEngineRendererImpl->frameHasStarted && "Can't end the render pass while a frame is not in progress");
+
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+void EngineRenderer::WaitIdle()
+{
+    VulkanDevice::WaitIdle();
+}
+
+uint32_t EngineRenderer::GetFrameIndex()
+{
+    return static_cast<uint32_t>(mEngineRendererImpl->currentFrameIndex);
+}
+
+void EngineRenderer::ReadbackLastFrame(const std::string &sFileName)
+{
+    // the image index of the frame we just submitted is still stored as the current one
+    mEngineRendererImpl->ReadbackImage(mEngineRendererImpl->currentImageIdx, sFileName);
 }
 
 //
 // Implementation
 //
 
+EngineRendererImpl::EngineRendererImpl()
+{
+    CreateCommandBuffers();
+}
+
+EngineRendererImpl::~EngineRendererImpl()
+{
+    FreeCommandBuffers();
+}
+
 void EngineRendererImpl::CreateCommandBuffers()
 {
     commandBuffers.resize(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT);
@@ -55,10 +229,114 @@ void EngineRendererImpl::CreateCommandBuffers()
     allocInfo.commandPool = VulkanDevice::GetCommandPool();
     allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
 
+    std::lock_guard<std::mutex> lock(VulkanDevice::GetCommandPoolMutex());
     VK_CHECK(vkAllocateCommandBuffers(VulkanDevice::GetDevice(), &allocInfo, commandBuffers.data()));
 
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-
     Logger::Debug("Created command buffers");
 }
+
+void EngineRendererImpl::FreeCommandBuffers()
+{
+    std::lock_guard<std::mutex> lock(VulkanDevice::GetCommandPoolMutex());
+    vkFreeCommandBuffers(VulkanDevice::GetDevice(), VulkanDevice::GetCommandPool(),
+                         static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+    commandBuffers.clear();
+}
+
+void EngineRendererImpl::RecreateSwapChain()
+{
+    Logger::Debug("Recreating swap chain...");
+
+    int width = 0, height = 0;
+    Window::GetFramebufferSize(width, height);
+    while (width == 0 || height == 0) // window is minimized, wait for it to be on the foreground again
+    {
+        Window::GetFramebufferSize(width, height);
+
+        // GLFW events can only be waited on from the main thread, the render thread polls instead
+        if (JobSystem::GetCurrentThreadIdx() == 0)
+            glfwWaitEvents();
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // NOTE: No need to wait for the device, the old swap chain's resources go through the deletion queue
+    VulkanSwapchain::Recreate();
+}
+
+void EngineRendererImpl::ReadbackImage(uint32_t imageIdx, const std::string &sFileName)
+{
+    VkExtent2D extent = VulkanSwapchain::GetExtent();
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+    // the image may still be rendering
+    VulkanDevice::WaitIdle();
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    VulkanDevice::CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               stagingBuffer, stagingBufferMemory);
+
+    // the render pass wrote the image as a color attachment and left it in its final layout
+    // (VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL for offscreen images, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR otherwise)
+    VkImage image = VulkanSwapchain::GetImage(imageIdx);
+    VkImageLayout finalLayout = Window::IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    ImageStateTracker::RegisterImage(image, VK_IMAGE_ASPECT_COLOR_BIT);
+    ImageStateTracker::SetState(image, IMAGE_USE_COLOR_ATTACHMENT, finalLayout);
+
+    VkCommandBuffer commandBuffer = VulkanDevice::BeginSingleTimeCommands();
+
+    ImageStateTracker::Transition(commandBuffer, image, IMAGE_USE_TRANSFER_SRC);
+    ImageStateTracker::FlushBarriers(commandBuffer);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0; // tightly packed
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer, 1, &region);
+
+    // swap chain images have to go back to where the presentation engine expects them
+    if (finalLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+    {
+        ImageStateTracker::Transition(commandBuffer, image, IMAGE_USE_PRESENT);
+        ImageStateTracker::FlushBarriers(commandBuffer);
+    }
+
+    VulkanDevice::EndSingleTimeCommands(commandBuffer);
+    ImageStateTracker::UnregisterImage(image);
+
+    void* data;
+    vkMapMemory(VulkanDevice::GetDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
+
+    // writing a binary .ppm (no alpha), swizzling BGRA -> RGB
+    auto* pixels = static_cast<const uint8_t*>(data);
+    bool isBGR = VulkanSwapchain::GetImageFormat() == VK_FORMAT_B8G8R8A8_UNORM ||
+                 VulkanSwapchain::GetImageFormat() == VK_FORMAT_B8G8R8A8_SRGB;
+
+    std::ofstream file(sFileName, std::ios::out | std::ios::binary);
+    file << "P6\n" << extent.width << " " << extent.height << "\n255\n";
+    for (VkDeviceSize i = 0; i < imageSize; i += 4)
+    {
+        char rgb[3] = {
+                static_cast<char>(pixels[i + (isBGR ? 2 : 0)]),
+                static_cast<char>(pixels[i + 1]),
+                static_cast<char>(pixels[i + (isBGR ? 0 : 2)])
+        };
+        file.write(rgb, 3);
+    }
+    file.close();
+
+    vkUnmapMemory(VulkanDevice::GetDevice(), stagingBufferMemory);
+    vkDestroyBuffer(VulkanDevice::GetDevice(), stagingBuffer, nullptr);
+    vkFreeMemory(VulkanDevice::GetDevice(), stagingBufferMemory, nullptr);
+
+    Logger::Debug("Frame read back to " + sFileName);
+}
@@ -6,22 +6,25 @@
 #define VULKAN_ENGINE_ENGINERENDERER_H
 
 #include <vulkan/vulkan.h>
+#include <string>
 #include "VulkanSwapchain.h"
 #include "VulkanDevice.h"
 
 struct EngineRendererImpl
 {
-    VulkanSwapchain &swapChain;
-    VulkanDevice &device;
+    EngineRendererImpl();
+    ~EngineRendererImpl();
+
     std::vector<VkCommandBuffer> commandBuffers;
 
-    uint32_t currentImageIdx;
+    uint32_t currentImageIdx = 0;
     int currentFrameIndex = 0;
     bool frameHasStarted = false;
 
     void CreateCommandBuffers();
     void FreeCommandBuffers();
     void RecreateSwapChain();
+    void ReadbackImage(uint32_t imageIdx, const std::string& sFileName);
 };
 
 class EngineRenderer
@@ -33,11 +36,18 @@ public:
     static VkCommandBuffer BeginFrame();
     static void EndFrame();
 
-    void BeginSwapChainRenderPass(VkCommandBuffer commandBuffer);
-    void EndSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // use VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS to execute cached draw sets (see CommandBufferCache)
+    static void BeginSwapChainRenderPass(VkCommandBuffer commandBuffer,
+                                         VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+    static void EndSwapChainRenderPass(VkCommandBuffer commandBuffer);
+
+    static void WaitIdle();
 
-private:
+    // index of the frame in flight being recorded
+    static uint32_t GetFrameIndex();
 
+    // copies the last rendered image back to the CPU and dumps it to a .ppm file (stalls the GPU!)
+    static void ReadbackLastFrame(const std::string& sFileName);
 };
 
 
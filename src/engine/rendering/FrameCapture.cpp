@@ -0,0 +1,403 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "FrameCapture.h"
+#include "ImageStateTracker.h"
+#include "VulkanDevice.h"
+#include "VulkanSwapchain.h"
+#include "Window.h"
+#include "../common/Config.h"
+#include "../profiling/Logger.h"
+#include <Tracy.hpp>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <glfw/deps/stb_image_write.h>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+FrameCaptureImpl* mFrameCaptureImpl = nullptr;
+
+// the file extension picks the format (.png or .rgba/.raw), anything else gets the configured one
+ECaptureFormat GetCaptureFormat(const std::string& sFileName, ECaptureFormat defaultFormat)
+{
+    std::string sExtension = sFileName.substr(std::min(sFileName.find_last_of('.'), sFileName.size()));
+    if (sExtension == ".png")
+        return CAPTURE_FORMAT_PNG;
+    if (sExtension == ".rgba" || sExtension == ".raw")
+        return CAPTURE_FORMAT_RAW;
+
+    return defaultFormat;
+}
+
+//
+// Initialization/Destruction
+//
+
+void FrameCapture::Init()
+{
+    mFrameCaptureImpl = new FrameCaptureImpl;
+}
+
+void FrameCapture::Shutdown()
+{
+    Flush();
+    ReportStatistics();
+
+    delete mFrameCaptureImpl;
+    mFrameCaptureImpl = nullptr;
+}
+
+//
+// External
+//
+
+void FrameCapture::BeginFrame()
+{
+    mFrameCaptureImpl->CollectCompleted(false);
+
+    if (mFrameCaptureImpl->bContinuous)
+    {
+        std::stringstream ss;
+        ss << "capture_" << std::setw(5) << std::setfill('0') << mFrameCaptureImpl->continuousFrame++
+           << (mFrameCaptureImpl->defaultFormat == CAPTURE_FORMAT_PNG ? ".png" : ".rgba");
+        RequestCapture(ss.str());
+    }
+}
+
+void FrameCapture::RequestCapture(const std::string &sFileName)
+{
+    mFrameCaptureImpl->requests.push_back(sFileName);
+}
+
+void FrameCapture::SetContinuousCapture(bool bEnabled)
+{
+    mFrameCaptureImpl->bContinuous = bEnabled;
+}
+
+bool FrameCapture::IsContinuousCaptureEnabled()
+{
+    return mFrameCaptureImpl->bContinuous;
+}
+
+void FrameCapture::RecordCaptures(VkCommandBuffer commandBuffer, uint32_t imageIdx)
+{
+    if (mFrameCaptureImpl->requests.empty())
+        return;
+
+    ZoneScoped;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto& sFileName : mFrameCaptureImpl->requests)
+        mFrameCaptureImpl->RecordCopy(commandBuffer, imageIdx, sFileName);
+    mFrameCaptureImpl->requests.clear();
+
+    mFrameCaptureImpl->recordStats.AddSample(
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+void FrameCapture::EndFrame(const GpuSyncPoint &submission)
+{
+    for (auto& slot : mFrameCaptureImpl->slots)
+    {
+        if (slot->state == READBACK_SLOT_RECORDED)
+        {
+            slot->frame = submission;
+            slot->state = READBACK_SLOT_IN_FLIGHT;
+        }
+    }
+}
+
+void FrameCapture::Flush()
+{
+    // a frame that was recorded but never submitted won't write anything
+    for (auto& slot : mFrameCaptureImpl->slots)
+    {
+        if (slot->state == READBACK_SLOT_RECORDED)
+            slot->state = READBACK_SLOT_FREE;
+    }
+
+    mFrameCaptureImpl->CollectCompleted(true);
+
+    // wait for the encoder to go through its queue
+    for (auto& slot : mFrameCaptureImpl->slots)
+    {
+        while (slot->state == READBACK_SLOT_ENCODING)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void FrameCapture::ReportStatistics()
+{
+    if (mFrameCaptureImpl->captured == 0 && mFrameCaptureImpl->dropped == 0)
+        return;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3) << "Frame capture: " << mFrameCaptureImpl->captured << " captured, "
+       << mFrameCaptureImpl->encoded << " written, " << mFrameCaptureImpl->dropped << " dropped (ring full), "
+       << mFrameCaptureImpl->recordStats.GetAverage() << " ms avg recording on the render thread";
+    {
+        std::lock_guard<std::mutex> lock(mFrameCaptureImpl->encodeStatsMutex);
+        ss << ", " << mFrameCaptureImpl->encodeStats.GetAverage() << " ms avg encoding on the worker";
+    }
+    Logger::Info(ss.str());
+}
+
+//
+// Implementation
+//
+
+FrameCaptureImpl::FrameCaptureImpl()
+{
+    // at least one slot per frame in flight plus one, or every capture would wait for the GPU
+    uint32_t ringSize = std::max(Config::GetCaptureRingSize(), static_cast<uint32_t>(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT) + 1);
+    for (uint32_t i = 0; i < ringSize; i++)
+        slots.push_back(std::make_unique<ReadbackSlot>());
+
+    defaultFormat = Config::GetCaptureFormat() == "raw" ? CAPTURE_FORMAT_RAW : CAPTURE_FORMAT_PNG;
+    bContinuous = Config::IsContinuousCaptureEnabled();
+
+    encoder = std::thread(&FrameCaptureImpl::EncoderLoop, this);
+}
+
+FrameCaptureImpl::~FrameCaptureImpl()
+{
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        bStopEncoder = true;
+    }
+    encoderCondition.notify_all();
+    encoder.join();
+
+    for (auto& slot : slots)
+        ReleaseSlotBuffer(*slot);
+}
+
+ReadbackSlot *FrameCaptureImpl::AcquireSlot(VkDeviceSize size)
+{
+    // slots are handed out in ring order, so the oldest capture is always the next one to complete
+    ReadbackSlot& slot = *slots[nextSlot];
+    if (slot.state != READBACK_SLOT_FREE)
+        return nullptr;
+
+    nextSlot = (nextSlot + 1) % static_cast<uint32_t>(slots.size());
+
+    if (slot.size < size)
+    {
+        ReleaseSlotBuffer(slot);
+        CreateSlotBuffer(slot, size);
+    }
+
+    return &slot;
+}
+
+void FrameCaptureImpl::CreateSlotBuffer(ReadbackSlot &slot, VkDeviceSize size)
+{
+    VkDevice device = VulkanDevice::GetDevice();
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VK_CHECK(vkCreateBuffer(device, &bufferInfo, nullptr, &slot.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, slot.buffer, &requirements);
+
+    // cached memory is a lot faster to read from the CPU, but may need invalidating
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(VulkanDevice::GetPhysicalDevice(), &memoryProperties);
+
+    uint32_t memoryType = ~0u;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+        if ((requirements.memoryTypeBits & (1u << i)) &&
+            (flags & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) ==
+            (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT))
+        {
+            memoryType = i;
+            slot.bCoherent = (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+            break;
+        }
+    }
+
+    if (memoryType == ~0u)
+    {
+        memoryType = VulkanDevice::FindMemoryType(requirements.memoryTypeBits,
+                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        slot.bCoherent = true;
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = memoryType;
+    VK_CHECK(vkAllocateMemory(device, &allocInfo, nullptr, &slot.memory));
+    VK_CHECK(vkBindBufferMemory(device, slot.buffer, slot.memory, 0));
+    VK_CHECK(vkMapMemory(device, slot.memory, 0, VK_WHOLE_SIZE, 0, &slot.data));
+
+    slot.size = size;
+}
+
+void FrameCaptureImpl::ReleaseSlotBuffer(ReadbackSlot &slot)
+{
+    if (slot.buffer == VK_NULL_HANDLE)
+        return;
+
+    // only free slots are released, the GPU is done with them
+    vkUnmapMemory(VulkanDevice::GetDevice(), slot.memory);
+    vkDestroyBuffer(VulkanDevice::GetDevice(), slot.buffer, nullptr);
+    vkFreeMemory(VulkanDevice::GetDevice(), slot.memory, nullptr);
+
+    slot.buffer = VK_NULL_HANDLE;
+    slot.memory = VK_NULL_HANDLE;
+    slot.data = nullptr;
+    slot.size = 0;
+}
+
+void FrameCaptureImpl::RecordCopy(VkCommandBuffer commandBuffer, uint32_t imageIdx, const std::string &sFileName)
+{
+    VkExtent2D extent = VulkanSwapchain::GetExtent();
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+    ReadbackSlot* slot = AcquireSlot(imageSize);
+    if (slot == nullptr)
+    {
+        dropped++;
+        return;
+    }
+
+    slot->width = extent.width;
+    slot->height = extent.height;
+    slot->bBGRA = VulkanSwapchain::GetImageFormat() == VK_FORMAT_B8G8R8A8_UNORM ||
+                  VulkanSwapchain::GetImageFormat() == VK_FORMAT_B8G8R8A8_SRGB;
+    slot->fileName = sFileName;
+    slot->format = GetCaptureFormat(sFileName, defaultFormat);
+
+    // the render pass left the image in its final layout
+    // (VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL for offscreen images, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR otherwise)
+    VkImage image = VulkanSwapchain::GetImage(imageIdx);
+    VkImageLayout finalLayout = Window::IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    ImageStateTracker::RegisterImage(image, VK_IMAGE_ASPECT_COLOR_BIT);
+    ImageStateTracker::SetState(image, IMAGE_USE_COLOR_ATTACHMENT, finalLayout);
+
+    ImageStateTracker::Transition(commandBuffer, image, IMAGE_USE_TRANSFER_SRC);
+    ImageStateTracker::FlushBarriers(commandBuffer);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer, 1, &region);
+
+    // swap chain images have to go back to where the presentation engine expects them
+    if (finalLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+        ImageStateTracker::Transition(commandBuffer, image, IMAGE_USE_PRESENT);
+    ImageStateTracker::FlushBarriers(commandBuffer);
+    ImageStateTracker::UnregisterImage(image);
+
+    // make the copy visible to the CPU once the submission completes
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr,
+                         0, nullptr);
+
+    slot->state = READBACK_SLOT_RECORDED;
+    captured++;
+}
+
+void FrameCaptureImpl::CollectCompleted(bool bWait)
+{
+    for (auto& slot : slots)
+    {
+        if (slot->state != READBACK_SLOT_IN_FLIGHT)
+            continue;
+
+        if (bWait)
+            GpuSync::Wait(slot->frame);
+        else if (!GpuSync::IsComplete(slot->frame))
+            continue;
+
+        if (!slot->bCoherent)
+        {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = slot->memory;
+            range.size = VK_WHOLE_SIZE;
+            vkInvalidateMappedMemoryRanges(VulkanDevice::GetDevice(), 1, &range);
+        }
+
+        slot->state = READBACK_SLOT_ENCODING;
+        {
+            std::lock_guard<std::mutex> lock(encoderMutex);
+            encoderQueue.push_back(slot.get());
+        }
+        encoderCondition.notify_one();
+    }
+}
+
+void FrameCaptureImpl::EncoderLoop()
+{
+    while (true)
+    {
+        ReadbackSlot* slot;
+        {
+            std::unique_lock<std::mutex> lock(encoderMutex);
+            encoderCondition.wait(lock, [this]() { return bStopEncoder || !encoderQueue.empty(); });
+            if (encoderQueue.empty())
+                return;
+
+            slot = encoderQueue.front();
+            encoderQueue.pop_front();
+        }
+
+        Encode(*slot);
+        slot->state = READBACK_SLOT_FREE;
+    }
+}
+
+void FrameCaptureImpl::Encode(ReadbackSlot &slot)
+{
+    ZoneScoped;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // both formats want RGBA
+    std::vector<uint8_t> pixels(static_cast<size_t>(slot.width) * slot.height * 4);
+    memcpy(pixels.data(), slot.data, pixels.size());
+    if (slot.bBGRA)
+    {
+        for (size_t i = 0; i < pixels.size(); i += 4)
+            std::swap(pixels[i], pixels[i + 2]);
+    }
+
+    bool bWritten;
+    if (slot.format == CAPTURE_FORMAT_PNG)
+    {
+        bWritten = stbi_write_png(slot.fileName.c_str(), static_cast<int>(slot.width), static_cast<int>(slot.height), 4,
+                                  pixels.data(), static_cast<int>(slot.width * 4)) != 0;
+    } else
+    {
+        std::ofstream file(slot.fileName, std::ios::out | std::ios::binary);
+        file.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+        bWritten = file.good();
+    }
+
+    if (bWritten)
+        encoded++;
+    else
+        Logger::Error("Could not write frame capture", slot.fileName);
+
+    std::lock_guard<std::mutex> lock(encodeStatsMutex);
+    encodeStats.AddSample(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
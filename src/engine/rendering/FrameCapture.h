@@ -0,0 +1,123 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_FRAMECAPTURE_H
+#define VULKAN_ENGINE_FRAMECAPTURE_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GpuSync.h"
+#include "../profiling/FrameStatistics.h"
+
+enum ECaptureFormat
+{
+    CAPTURE_FORMAT_PNG,
+    CAPTURE_FORMAT_RAW  // tightly packed RGBA8 rows, no header
+};
+
+enum EReadbackSlotState
+{
+    READBACK_SLOT_FREE,
+    READBACK_SLOT_RECORDED,     // copy recorded, the frame hasn't been submitted yet
+    READBACK_SLOT_IN_FLIGHT,    // waiting for the GPU
+    READBACK_SLOT_ENCODING      // owned by the encoder thread
+};
+
+// a host visible buffer the GPU copies an image into
+struct ReadbackSlot
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    void* data = nullptr;       // persistently mapped
+    bool bCoherent = true;
+
+    std::atomic<EReadbackSlotState> state{READBACK_SLOT_FREE};
+    GpuSyncPoint frame;         // the submission that writes the buffer
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool bBGRA = false;
+    std::string fileName;
+    ECaptureFormat format = CAPTURE_FORMAT_PNG;
+};
+
+struct FrameCaptureImpl
+{
+    FrameCaptureImpl();
+    ~FrameCaptureImpl();
+
+    ReadbackSlot* AcquireSlot(VkDeviceSize size);
+    void CreateSlotBuffer(ReadbackSlot& slot, VkDeviceSize size);
+    void ReleaseSlotBuffer(ReadbackSlot& slot);
+    void RecordCopy(VkCommandBuffer commandBuffer, uint32_t imageIdx, const std::string& sFileName);
+    void CollectCompleted(bool bWait);
+
+    void EncoderLoop();
+    void Encode(ReadbackSlot& slot);
+
+    std::vector<std::unique_ptr<ReadbackSlot>> slots;
+    uint32_t nextSlot = 0;
+
+    // captures requested for the frame being recorded
+    std::vector<std::string> requests;
+    bool bContinuous = false;
+    uint32_t continuousFrame = 0;
+    ECaptureFormat defaultFormat = CAPTURE_FORMAT_PNG;
+
+    // encoder thread
+    std::thread encoder;
+    std::mutex encoderMutex;
+    std::condition_variable encoderCondition;
+    std::deque<ReadbackSlot*> encoderQueue;
+    bool bStopEncoder = false;
+
+    // statistics
+    uint32_t captured = 0;
+    uint32_t dropped = 0;
+    std::atomic<uint32_t> encoded{0};
+    FrameStatistics recordStats;    // CPU time spent recording copies on the render thread
+    FrameStatistics encodeStats;    // CPU time spent encoding on the encoder thread
+    std::mutex encodeStatsMutex;
+};
+
+// Asynchronous readback of the swap chain image: the copy is recorded into the frame's own command buffer and
+// lands in a ring of host visible buffers. Frames later, once the GPU is done with it, a worker thread encodes it
+// to a file, so neither the render thread nor the GPU ever wait on a capture.
+// When the ring is full, captures are dropped rather than stalling.
+class FrameCapture
+{
+public:
+    static void Init();
+    static void Shutdown();
+
+    // hands the copies that completed on the GPU to the encoder
+    static void BeginFrame();
+
+    // the current frame's swap chain image gets captured when the frame ends
+    static void RequestCapture(const std::string& sFileName);
+
+    // captures every frame (for perf reports), named capture_00000.png, capture_00001.png, ...
+    static void SetContinuousCapture(bool bEnabled);
+    static bool IsContinuousCaptureEnabled();
+
+    // called by the renderer: records the requested copies (after the render pass) and tags them with the submission
+    static void RecordCaptures(VkCommandBuffer commandBuffer, uint32_t imageIdx);
+    static void EndFrame(const GpuSyncPoint& submission);
+
+    // waits for every pending capture to be written to disk
+    static void Flush();
+
+    static void ReportStatistics();
+};
+
+
+#endif //VULKAN_ENGINE_FRAMECAPTURE_H
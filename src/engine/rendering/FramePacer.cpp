@@ -0,0 +1,298 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "FramePacer.h"
+#include "../common/Config.h"
+#include "../profiling/Logger.h"
+#include <Tracy.hpp>
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// OS sleeps can overshoot by about a millisecond, so we spin-wait for the tail end
+const double SPIN_WAIT_THRESHOLD = 0.002;
+
+// safety margin (in seconds) added to the predicted work time when running in low latency mode
+const double LOW_LATENCY_MARGIN = 0.001;
+
+// smoothing factor for the moving averages
+const double AVERAGE_SMOOTHING = 0.1;
+
+FramePacerImpl* mFramePacerImpl = nullptr;
+
+//
+// Initialization/Destruction
+//
+
+void FramePacer::Init()
+{
+    Logger::Info("Initializing frame pacer");
+    mFramePacerImpl = new FramePacerImpl;
+
+#ifdef _WIN32
+    // raising the timer resolution so sleeps are not rounded up to ~15ms
+    timeBeginPeriod(1);
+#endif
+}
+
+void FramePacer::Shutdown()
+{
+    Logger::Info("Shutting down frame pacer");
+    ReportStatistics();
+
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+
+    delete mFramePacerImpl;
+    mFramePacerImpl = nullptr;
+}
+
+//
+// External
+//
+
+void FramePacer::BeginFrame()
+{
+    mFramePacerImpl->BeginFrame();
+}
+
+void FramePacer::EndFrame()
+{
+    mFramePacerImpl->EndFrame();
+}
+
+void FramePacer::BeginGameFrame()
+{
+    mFramePacerImpl->BeginGameFrame();
+}
+
+void FramePacer::EndGameFrame()
+{
+    mFramePacerImpl->EndGameFrame();
+}
+
+EPresentMode FramePacer::GetPresentMode()
+{
+    return mFramePacerImpl->presentMode.load();
+}
+
+void FramePacer::SetPresentMode(EPresentMode eMode)
+{
+    // NOTE: The mode is written before the flag, so whoever sees the flag also sees the new mode
+    if (mFramePacerImpl->presentMode.exchange(eMode) == eMode)
+        return;
+
+    mFramePacerImpl->bPresentModeChanged.store(true);
+}
+
+bool FramePacer::HasPresentModeChanged()
+{
+    return mFramePacerImpl->bPresentModeChanged.load();
+}
+
+void FramePacer::ClearPresentModeChanged()
+{
+    mFramePacerImpl->bPresentModeChanged.store(false);
+}
+
+VkPresentModeKHR FramePacer::ChooseVulkanPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes)
+{
+    // the pacer may not be initialized (ex.: the testing renderers), so we go with the configured mode
+    EPresentMode mode = mFramePacerImpl ? mFramePacerImpl->presentMode.load() : ParsePresentMode(Config::GetPresentMode());
+
+    VkPresentModeKHR requestedMode = VK_PRESENT_MODE_FIFO_KHR;
+    switch (mode)
+    {
+        case FIFO:
+            requestedMode = VK_PRESENT_MODE_FIFO_KHR;
+            break;
+        case MAILBOX:
+            requestedMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            break;
+        case IMMEDIATE:
+            requestedMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            break;
+    }
+
+    for (const auto& availablePresentMode : availablePresentModes)
+    {
+        if (availablePresentMode == requestedMode)
+        {
+            return requestedMode;
+        }
+    }
+
+    // if the requested mode is not available, use Vulkan's default swap chain queue (aka VSync)
+    Logger::Warn("Requested present mode is not available, falling back to V-SYNC");
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+const FrameStatistics &FramePacer::GetStatistics()
+{
+    return mFramePacerImpl->frameStats;
+}
+
+void FramePacer::ReportStatistics()
+{
+    if (mFramePacerImpl->frameStats.GetSampleCount() == 0)
+        return;
+
+    mFramePacerImpl->frameStats.Report("Frame pacer");
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3)
+       << "Frame time variance: " << mFramePacerImpl->frameStats.GetVariance() << " ms^2";
+    Logger::Info(ss.str());
+}
+
+EPresentMode FramePacer::ParsePresentMode(const std::string &sMode)
+{
+    std::string mode(sMode);
+    std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+
+    if (mode == "fifo" || mode == "vsync")
+        return FIFO;
+    if (mode == "immediate")
+        return IMMEDIATE;
+    if (mode != "mailbox")
+        Logger::Warn("Unknown present mode '" + sMode + "', using mailbox");
+
+    return MAILBOX;
+}
+
+//
+// Implementation
+//
+
+FramePacerImpl::FramePacerImpl()
+{
+    presentMode.store(FramePacer::ParsePresentMode(Config::GetPresentMode()));
+    bLowLatency = Config::IsLowLatencyEnabled();
+
+    uint32_t frameRateLimit = Config::GetFrameRateLimit();
+    if (frameRateLimit > 0)
+        targetFrameTime = 1.0 / static_cast<double>(frameRateLimit);
+
+    std::stringstream ss;
+    ss << "Frame pacer -> present mode: " << Config::GetPresentMode()
+       << " | frame rate limit: " << frameRateLimit
+       << " | low latency: " << (bLowLatency ? "on" : "off");
+    Logger::Info(ss.str());
+}
+
+void FramePacerImpl::BeginFrame()
+{
+    ZoneScopedC(0xf1c40f);
+
+    // in low latency mode we hold off input sampling and simulation until just before the predicted GPU slot,
+    //  so the frame is built with the freshest input possible instead of waiting on the swap chain afterwards
+    if (bLowLatency && bHasPreviousFrame)
+    {
+        double interval = GetPredictedFrameInterval();
+        double wait = interval - averageWorkTime - LOW_LATENCY_MARGIN;
+
+        if (wait > 0.0)
+            WaitUntil(lastFrameEnd + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(wait)));
+    }
+
+    frameStart = Clock::now();
+}
+
+void FramePacerImpl::EndFrame()
+{
+    ZoneScopedC(0xf1c40f);
+
+    double workTime = std::chrono::duration<double>(Clock::now() - frameStart).count();
+    averageWorkTime = bHasPreviousFrame ? averageWorkTime + AVERAGE_SMOOTHING * (workTime - averageWorkTime) : workTime;
+
+    // the low latency mode already waited at the start of the frame
+    if (targetFrameTime > 0.0 && !bLowLatency && bHasPreviousFrame)
+    {
+        WaitUntil(lastFrameEnd + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(targetFrameTime)));
+    }
+
+    Clock::time_point frameEnd = Clock::now();
+    if (bHasPreviousFrame)
+    {
+        double frameInterval = std::chrono::duration<double>(frameEnd - lastFrameEnd).count();
+        averageFrameInterval = averageFrameInterval > 0.0 ?
+                averageFrameInterval + AVERAGE_SMOOTHING * (frameInterval - averageFrameInterval) : frameInterval;
+
+        frameStats.AddSample(frameInterval * 1000.0);
+    }
+
+    lastFrameEnd = frameEnd;
+    bHasPreviousFrame = true;
+
+    publishedFrameInterval.store(GetPredictedFrameInterval());
+    publishedWorkTime.store(averageWorkTime);
+    publishedFrameEnd.store(frameEnd.time_since_epoch().count());
+}
+
+void FramePacerImpl::BeginGameFrame()
+{
+    ZoneScopedC(0xf1c40f);
+
+    double interval = publishedFrameInterval.load();
+    if (bHasGameFrame && interval > 0.0)
+    {
+        // one packet per presented frame, the render thread would replace the others before rendering them
+        auto frameInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval));
+        Clock::time_point deadline = gameFrameStart + frameInterval;
+
+        // in low latency mode the packet is built just in time for the render thread's next frame, which starts just
+        //  before the predicted GPU slot (see BeginFrame)
+        if (bLowLatency)
+        {
+            Clock::time_point renderFrameEnd{Clock::duration(publishedFrameEnd.load())};
+            double wait = interval - publishedWorkTime.load() - averageGameWorkTime - LOW_LATENCY_MARGIN;
+            deadline = renderFrameEnd + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(wait));
+
+            // the render thread may not have finished the frame we built the last packet for, so we aim for the next one
+            while (deadline <= gameFrameStart)
+                deadline += frameInterval;
+        }
+
+        WaitUntil(deadline);
+    }
+
+    gameFrameStart = Clock::now();
+}
+
+void FramePacerImpl::EndGameFrame()
+{
+    double workTime = std::chrono::duration<double>(Clock::now() - gameFrameStart).count();
+    averageGameWorkTime = bHasGameFrame ? averageGameWorkTime + AVERAGE_SMOOTHING * (workTime - averageGameWorkTime) : workTime;
+    bHasGameFrame = true;
+}
+
+void FramePacerImpl::WaitUntil(Clock::time_point deadline)
+{
+    ZoneScopedC(0x95a5a6);
+
+    auto remaining = std::chrono::duration<double>(deadline - Clock::now()).count();
+    if (remaining > SPIN_WAIT_THRESHOLD)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(remaining - SPIN_WAIT_THRESHOLD));
+    }
+
+    while (Clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+}
+
+double FramePacerImpl::GetPredictedFrameInterval() const
+{
+    // with a frame cap the slot is known, otherwise we go with what we measured (ex.: the refresh rate with FIFO)
+    if (targetFrameTime > 0.0)
+        return targetFrameTime;
+
+    return averageFrameInterval;
+}
@@ -0,0 +1,95 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_FRAMEPACER_H
+#define VULKAN_ENGINE_FRAMEPACER_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../profiling/FrameStatistics.h"
+
+enum EPresentMode
+{
+    FIFO,       // v-sync, never tears
+    MAILBOX,    // triple buffering, newest image replaces the queued one
+    IMMEDIATE   // no v-sync, lowest latency but may tear
+};
+
+struct FramePacerImpl
+{
+    typedef std::chrono::steady_clock Clock;
+
+    FramePacerImpl();
+
+    void BeginFrame();
+    void EndFrame();
+    void BeginGameFrame();
+    void EndGameFrame();
+
+    // sleeps for the bulk of the wait and spins for the last bit, since OS sleeps are too coarse for frame pacing
+    void WaitUntil(Clock::time_point deadline);
+    double GetPredictedFrameInterval() const;
+
+    // set from the game/UI thread, read by the render thread when it (re)creates the swap chain
+    std::atomic<EPresentMode> presentMode;
+    std::atomic<bool> bPresentModeChanged{false};
+
+    double targetFrameTime = 0.0; // in seconds, 0 means uncapped
+    bool bLowLatency = false;
+
+    Clock::time_point frameStart;
+    Clock::time_point lastFrameEnd;
+    bool bHasPreviousFrame = false;
+
+    // exponential moving averages used to predict when the next GPU slot will be available
+    double averageWorkTime = 0.0;
+    double averageFrameInterval = 0.0;
+
+    // published by EndFrame for the game thread, which paces itself on the frames the render thread presents
+    std::atomic<Clock::rep> publishedFrameEnd{0};
+    std::atomic<double> publishedFrameInterval{0.0};
+    std::atomic<double> publishedWorkTime{0.0};
+
+    // game thread, only used with a render thread
+    Clock::time_point gameFrameStart;
+    bool bHasGameFrame = false;
+    double averageGameWorkTime = 0.0;
+
+    FrameStatistics frameStats;
+};
+
+class FramePacer
+{
+public:
+    static void Init();
+    static void Shutdown();
+
+    // call BeginFrame before sampling input and EndFrame after the frame has been submitted
+    static void BeginFrame();
+    static void EndFrame();
+
+    // with a render thread, Begin/EndFrame pace the render thread and these the game thread: call BeginGameFrame
+    //  before sampling input and EndGameFrame once the packet is published
+    static void BeginGameFrame();
+    static void EndGameFrame();
+
+    static EPresentMode GetPresentMode();
+    static void SetPresentMode(EPresentMode eMode);
+    static bool HasPresentModeChanged();
+    static void ClearPresentModeChanged();
+
+    // picks the requested present mode if available, falling back to FIFO (which is always supported)
+    static VkPresentModeKHR ChooseVulkanPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+
+    static const FrameStatistics& GetStatistics();
+    static void ReportStatistics();
+
+    static EPresentMode ParsePresentMode(const std::string& sMode);
+};
+
+
+#endif //VULKAN_ENGINE_FRAMEPACER_H
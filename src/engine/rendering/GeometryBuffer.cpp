@@ -0,0 +1,285 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "GeometryBuffer.h"
+#include "VulkanDevice.h"
+#include "GpuSync.h"
+#include "../common/Config.h"
+#include <glm/common.hpp>
+#include <algorithm>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+GeometryBufferImpl* mGeometryBufferImpl = nullptr;
+
+//
+// Initialization/Destruction
+//
+
+void GeometryBuffer::Init()
+{
+    mGeometryBufferImpl = new GeometryBufferImpl;
+}
+
+void GeometryBuffer::Shutdown()
+{
+    ReportStatistics();
+
+    delete mGeometryBufferImpl;
+    mGeometryBufferImpl = nullptr;
+}
+
+//
+// External
+//
+
+void GeometryBuffer::BeginFrame()
+{
+    uint64_t completedFrame = GpuSync::GetCompletedValue(QUEUE_GRAPHICS);
+
+    std::lock_guard<std::mutex> lock(mGeometryBufferImpl->mutex);
+    auto firstPending = std::stable_partition(mGeometryBufferImpl->pendingFrees.begin(), mGeometryBufferImpl->pendingFrees.end(),
+                                              [completedFrame](const PendingMeshFree& pending) {
+        return pending.lastUsedFrame <= completedFrame;
+    });
+
+    for (auto it = mGeometryBufferImpl->pendingFrees.begin(); it != firstPending; ++it)
+        mGeometryBufferImpl->ReleaseRange(it->mesh);
+
+    mGeometryBufferImpl->pendingFrees.erase(mGeometryBufferImpl->pendingFrees.begin(), firstPending);
+}
+
+MeshHandle GeometryBuffer::AddMesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
+{
+    if (vertices.empty() || indices.empty())
+        return {};
+
+    auto vertexCount = static_cast<uint32_t>(vertices.size());
+    auto indexCount = static_cast<uint32_t>(indices.size());
+
+    uint32_t vertexOffset;
+    uint32_t firstIndex;
+    {
+        std::lock_guard<std::mutex> lock(mGeometryBufferImpl->mutex);
+
+        vertexOffset = mGeometryBufferImpl->vertexAllocator.Allocate(vertexCount);
+        if (vertexOffset == RangeAllocator::INVALID_OFFSET)
+        {
+            Logger::Warn("Geometry buffer is out of vertex space (" + std::to_string(vertexCount) + " vertices requested)");
+            return {};
+        }
+
+        firstIndex = mGeometryBufferImpl->indexAllocator.Allocate(indexCount);
+        if (firstIndex == RangeAllocator::INVALID_OFFSET)
+        {
+            mGeometryBufferImpl->vertexAllocator.Free(vertexOffset, vertexCount);
+            Logger::Warn("Geometry buffer is out of index space (" + std::to_string(indexCount) + " indices requested)");
+            return {};
+        }
+    }
+
+    // the ranges are reserved, so the uploads don't need the lock
+
+    VulkanDevice::UploadBuffer(mGeometryBufferImpl->vertexBuffer, sizeof(Vertex) * vertexOffset,
+                               vertices.data(), sizeof(Vertex) * vertexCount);
+    VulkanDevice::UploadBuffer(mGeometryBufferImpl->indexBuffer, sizeof(uint32_t) * firstIndex,
+                               indices.data(), sizeof(uint32_t) * indexCount);
+
+    MeshRange mesh{};
+    mesh.firstIndex = firstIndex;
+    mesh.indexCount = indexCount;
+    mesh.vertexOffset = static_cast<int32_t>(vertexOffset);
+    mesh.vertexCount = vertexCount;
+    mesh.boundsMin = vertices[0].pos;
+    mesh.boundsMax = vertices[0].pos;
+    for (const auto& vertex : vertices)
+    {
+        mesh.boundsMin = glm::min(mesh.boundsMin, vertex.pos);
+        mesh.boundsMax = glm::max(mesh.boundsMax, vertex.pos);
+    }
+
+    std::lock_guard<std::mutex> lock(mGeometryBufferImpl->mutex);
+    return mGeometryBufferImpl->meshes.Create(mesh);
+}
+
+void GeometryBuffer::RemoveMesh(MeshHandle mesh)
+{
+    std::lock_guard<std::mutex> lock(mGeometryBufferImpl->mutex);
+
+    const MeshRange* range = mGeometryBufferImpl->meshes.Get(mesh);
+    if (!range)
+        return;
+
+    // the frame being recorded may still draw it
+    mGeometryBufferImpl->pendingFrees.push_back({ *range, GpuSync::GetLastSubmittedValue(QUEUE_GRAPHICS) + 1 });
+    mGeometryBufferImpl->meshes.Destroy(mesh);
+}
+
+MeshRange GeometryBuffer::GetMesh(MeshHandle mesh)
+{
+    std::lock_guard<std::mutex> lock(mGeometryBufferImpl->mutex);
+
+    const MeshRange* range = mGeometryBufferImpl->meshes.Get(mesh);
+    return range ? *range : MeshRange{};
+}
+
+bool GeometryBuffer::IsValid(MeshHandle mesh)
+{
+    std::lock_guard<std::mutex> lock(mGeometryBufferImpl->mutex);
+    return mGeometryBufferImpl->meshes.IsValid(mesh);
+}
+
+void GeometryBuffer::Bind(VkCommandBuffer commandBuffer)
+{
+    VkBuffer vertexBuffers[] = { mGeometryBufferImpl->vertexBuffer };
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, mGeometryBufferImpl->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryBuffer::Draw(VkCommandBuffer commandBuffer, MeshHandle mesh, uint32_t instanceCount, uint32_t firstInstance)
+{
+    MeshRange range = GetMesh(mesh);
+    if (!range.IsValid())
+        return;
+
+    vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount, range.firstIndex, range.vertexOffset, firstInstance);
+}
+
+VkBuffer GeometryBuffer::GetVertexBuffer()
+{
+    return mGeometryBufferImpl->vertexBuffer;
+}
+
+VkBuffer GeometryBuffer::GetIndexBuffer()
+{
+    return mGeometryBufferImpl->indexBuffer;
+}
+
+void GeometryBuffer::ReportStatistics()
+{
+    std::lock_guard<std::mutex> lock(mGeometryBufferImpl->mutex);
+
+    auto& vertices = mGeometryBufferImpl->vertexAllocator;
+    auto& indices = mGeometryBufferImpl->indexAllocator;
+
+    Logger::Info("Geometry buffer: " + std::to_string(mGeometryBufferImpl->meshes.GetCount()) + " meshes, " +
+                 std::to_string(vertices.GetUsed()) + "/" + std::to_string(vertices.capacity) + " vertices (largest free block " +
+                 std::to_string(vertices.GetLargestFreeBlock()) + "), " +
+                 std::to_string(indices.GetUsed()) + "/" + std::to_string(indices.capacity) + " indices (largest free block " +
+                 std::to_string(indices.GetLargestFreeBlock()) + ")");
+    mGeometryBufferImpl->meshes.ReportStatistics();
+}
+
+//
+// Implementation
+//
+
+GeometryBufferImpl::GeometryBufferImpl()
+{
+    CreateBuffers();
+}
+
+GeometryBufferImpl::~GeometryBufferImpl()
+{
+    // the renderer waits for the device to be idle before shutting down its systems
+    vkDestroyBuffer(VulkanDevice::GetDevice(), vertexBuffer, nullptr);
+    vkFreeMemory(VulkanDevice::GetDevice(), vertexBufferMemory, nullptr);
+    vkDestroyBuffer(VulkanDevice::GetDevice(), indexBuffer, nullptr);
+    vkFreeMemory(VulkanDevice::GetDevice(), indexBufferMemory, nullptr);
+}
+
+void GeometryBufferImpl::CreateBuffers()
+{
+    uint32_t vertexCapacity = Config::GetGeometryVertexCapacity();
+    uint32_t indexCapacity = Config::GetGeometryIndexCapacity();
+
+    // storage buffer usage so compute passes (culling, skinning) can read the geometry too
+    VulkanDevice::CreateBuffer(sizeof(Vertex) * static_cast<VkDeviceSize>(vertexCapacity),
+                               VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+    VulkanDevice::CreateBuffer(sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCapacity),
+                               VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+
+    vertexAllocator.Reset(vertexCapacity);
+    indexAllocator.Reset(indexCapacity);
+
+    Logger::Debug("Created geometry buffer (" + std::to_string(vertexCapacity) + " vertices, " +
+                  std::to_string(indexCapacity) + " indices)");
+}
+
+void GeometryBufferImpl::ReleaseRange(const MeshRange &mesh)
+{
+    vertexAllocator.Free(static_cast<uint32_t>(mesh.vertexOffset), mesh.vertexCount);
+    indexAllocator.Free(mesh.firstIndex, mesh.indexCount);
+}
+
+void RangeAllocator::Reset(uint32_t newCapacity)
+{
+    capacity = newCapacity;
+    used = 0;
+    freeBlocks.clear();
+    if (capacity > 0)
+        freeBlocks[0] = capacity;
+}
+
+uint32_t RangeAllocator::Allocate(uint32_t count)
+{
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+    {
+        if (it->second < count)
+            continue;
+
+        uint32_t offset = it->first;
+        uint32_t remaining = it->second - count;
+
+        freeBlocks.erase(it);
+        if (remaining > 0)
+            freeBlocks[offset + count] = remaining;
+
+        used += count;
+        return offset;
+    }
+
+    return INVALID_OFFSET;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t count)
+{
+    if (count == 0)
+        return;
+
+    used -= count;
+
+    auto next = freeBlocks.lower_bound(offset);
+
+    // merging with the following block
+    if (next != freeBlocks.end() && offset + count == next->first)
+    {
+        count += next->second;
+        next = freeBlocks.erase(next);
+    }
+
+    // merging with the preceding block
+    if (next != freeBlocks.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += count;
+            return;
+        }
+    }
+
+    freeBlocks[offset] = count;
+}
+
+uint32_t RangeAllocator::GetLargestFreeBlock() const
+{
+    uint32_t largest = 0;
+    for (const auto& [offset, count] : freeBlocks)
+        largest = std::max(largest, count);
+    return largest;
+}
@@ -0,0 +1,113 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_GEOMETRYBUFFER_H
+#define VULKAN_ENGINE_GEOMETRYBUFFER_H
+
+#include <vulkan/vulkan.h>
+#include <glm/vec3.hpp>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "Vertex.h"
+#include "../common/HandlePool.h"
+
+// where a mesh lives inside the geometry buffer, this is all that's needed to draw it
+struct MeshRange
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0; // added to every index, so meshes keep their local (0 based) indices
+    uint32_t vertexCount = 0;
+
+    // local space bounding box of the vertices, for culling
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+
+    bool IsValid() const { return indexCount > 0; }
+};
+
+typedef THandle<MeshRange> MeshHandle;
+
+// first-fit free-list over a range of elements, adjacent free blocks are merged back together
+struct RangeAllocator
+{
+    static constexpr uint32_t INVALID_OFFSET = ~0u;
+
+    void Reset(uint32_t capacity);
+    uint32_t Allocate(uint32_t count);
+    void Free(uint32_t offset, uint32_t count);
+
+    uint32_t GetUsed() const { return used; }
+    uint32_t GetLargestFreeBlock() const;
+
+    std::map<uint32_t, uint32_t> freeBlocks; // offset -> count, sorted by offset for merging
+    uint32_t capacity = 0;
+    uint32_t used = 0;
+};
+
+struct PendingMeshFree
+{
+    MeshRange mesh;
+    uint64_t lastUsedFrame; // graphics timeline value (see GpuSync)
+};
+
+struct GeometryBufferImpl
+{
+    GeometryBufferImpl();
+    ~GeometryBufferImpl();
+
+    void CreateBuffers();
+    void ReleaseRange(const MeshRange& mesh);
+
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
+
+    RangeAllocator vertexAllocator;
+    RangeAllocator indexAllocator;
+
+    // meshes may be added and removed from loading threads while the render thread reclaims the freed ranges,
+    // the lock covers the allocators, the pending frees and the pool (the uploads run outside of it)
+    std::mutex mutex;
+
+    // freed ranges can still be read by frames in flight
+    std::vector<PendingMeshFree> pendingFrees;
+
+    THandlePool<MeshRange> meshes{"Mesh"};
+};
+
+// One big vertex buffer and one big index buffer shared by every mesh, so a whole scene is drawn with a single
+// vkCmdBindVertexBuffers/vkCmdBindIndexBuffer pair (and can later be drawn with indirect commands).
+class GeometryBuffer
+{
+public:
+    static void Init();
+    static void Shutdown();
+
+    // reclaims the ranges of meshes whose last frame has completed on the GPU
+    static void BeginFrame();
+
+    // uploads the mesh through a staging buffer, returns a null handle when the buffers are full
+    static MeshHandle AddMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    // the handle is stale right away, the range is reused once the frames drawing it have completed
+    static void RemoveMesh(MeshHandle mesh);
+    // an invalid range (see MeshRange::IsValid) for a stale handle
+    static MeshRange GetMesh(MeshHandle mesh);
+    static bool IsValid(MeshHandle mesh);
+
+    static void Bind(VkCommandBuffer commandBuffer);
+    // does nothing for a stale handle
+    static void Draw(VkCommandBuffer commandBuffer, MeshHandle mesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+    static VkBuffer GetVertexBuffer();
+    static VkBuffer GetIndexBuffer();
+
+    static void ReportStatistics();
+};
+
+
+#endif //VULKAN_ENGINE_GEOMETRYBUFFER_H
@@ -0,0 +1,931 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "GpuCulling.h"
+#include "DeletionQueue.h"
+#include "EngineRenderer.h"
+#include "GeometryBuffer.h"
+#include "Shader.h"
+#include "../common/Config.h"
+#include "../common/Parallel.h"
+#include "../culling/FrustumCuller.h"
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <Tracy.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+GpuCullingImpl* mGpuCullingImpl = nullptr;
+
+const std::string CULL_SHADER = "assets/shaders/cull.comp.spv";
+const std::string DRAW_VERTEX_SHADER = "assets/shaders/indirect.vert.spv";
+const std::string DRAW_FRAGMENT_SHADER = "assets/shaders/indirect.frag.spv";
+
+// objects per compute workgroup, must match local_size_x in cull.comp
+constexpr uint32_t CULLING_GROUP_SIZE = 64;
+
+// objects closer than this to a frustum plane may be classified differently by the GPU (fma, precision)
+constexpr float CULLING_VALIDATION_TOLERANCE = 1e-3f;
+
+//
+// Initialization/Destruction
+//
+
+void GpuCulling::Init()
+{
+    mGpuCullingImpl = new GpuCullingImpl;
+}
+
+void GpuCulling::Shutdown()
+{
+    delete mGpuCullingImpl;
+    mGpuCullingImpl = nullptr;
+}
+
+//
+// External
+//
+
+void GpuCulling::SetObjects(const std::vector<GpuCullingObject> &objects)
+{
+    mGpuCullingImpl->sourceObjects = objects;
+    mGpuCullingImpl->UploadObjects();
+}
+
+void GpuCulling::BeginFrame()
+{
+    // the objects of a removed mesh would draw whatever reuses its range
+    // NOTE: Uploading waits on the GPU, so it's done here, before the frame's command buffer starts recording
+    if (mGpuCullingImpl->objects.empty() || mGpuCullingImpl->AreMeshesValid())
+        return;
+
+    Logger::Warn("A mesh of the GPU culled objects was removed, uploading them again");
+    mGpuCullingImpl->UploadObjects();
+}
+
+uint32_t GpuCulling::GetObjectCount()
+{
+    return static_cast<uint32_t>(mGpuCullingImpl->objects.size());
+}
+
+void GpuCulling::Cull(VkCommandBuffer commandBuffer, const glm::mat4 &viewProjection)
+{
+    if (mGpuCullingImpl->objects.empty())
+        return;
+
+    ZoneScoped;
+
+    // BeginFrame waited on this frame slot, so the count it copied back is ready
+    GpuCullingFrame& frame = mGpuCullingImpl->frames[EngineRenderer::GetFrameIndex()];
+    if (frame.bHasVisibleCount)
+    {
+        mGpuCullingImpl->lastVisibleCount = *frame.visibleCount;
+        TracyPlot("Visible objects", static_cast<int64_t>(mGpuCullingImpl->lastVisibleCount));
+    }
+
+    // host coherent, and this frame slot is no longer read by the GPU
+    *frame.camera = viewProjection;
+
+    mGpuCullingImpl->RecordCulling(commandBuffer, Frustum::FromViewProjection(viewProjection), &frame);
+}
+
+void GpuCulling::Draw(VkCommandBuffer commandBuffer)
+{
+    if (mGpuCullingImpl->objects.empty() || mGpuCullingImpl->drawPipeline.IsNull())
+        return;
+
+    ZoneScoped;
+
+    // NOTE: Cached draw sets are recorded for the frame slot they're executed in, so this is the right camera for them
+    const GpuCullingFrame& frame = mGpuCullingImpl->frames[EngineRenderer::GetFrameIndex()];
+    GpuPipeline pipeline = GpuResources::GetPipeline(mGpuCullingImpl->drawPipeline);
+    VkBuffer drawCommandBuffer = GpuResources::GetBuffer(mGpuCullingImpl->drawCommandBuffer).buffer;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout,
+                            0, 1, &frame.drawSet, 0, nullptr);
+
+    GeometryBuffer::Bind(commandBuffer);
+
+    auto objectCount = static_cast<uint32_t>(mGpuCullingImpl->objects.size());
+    uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    if (mGpuCullingImpl->bCompact)
+    {
+        mGpuCullingImpl->vkCmdDrawIndexedIndirectCount(commandBuffer, drawCommandBuffer, 0,
+                                                       GpuResources::GetBuffer(mGpuCullingImpl->drawCountBuffer).buffer, 0,
+                                                       objectCount, stride);
+        return;
+    }
+
+    // without a draw count every object keeps its slot (culled ones have no instances), in as few calls as allowed
+    for (uint32_t first = 0; first < objectCount; first += mGpuCullingImpl->maxDrawIndirectCount)
+    {
+        uint32_t drawCount = std::min(mGpuCullingImpl->maxDrawIndirectCount, objectCount - first);
+        vkCmdDrawIndexedIndirect(commandBuffer, drawCommandBuffer,
+                                 static_cast<VkDeviceSize>(first) * stride, drawCount, stride);
+    }
+}
+
+uint32_t GpuCulling::GetDrawSet()
+{
+    return mGpuCullingImpl->cachedDraw;
+}
+
+uint32_t GpuCulling::GetLastVisibleCount()
+{
+    return mGpuCullingImpl->lastVisibleCount;
+}
+
+bool GpuCulling::IsComputeCullingAvailable()
+{
+    return !mGpuCullingImpl->cullingPipeline.IsNull();
+}
+
+void GpuCulling::CullOnCpu(const std::vector<GpuObjectData> &objects, const Frustum &frustum, std::vector<uint32_t> &visible)
+{
+    ZoneScoped;
+
+    // world space spheres, laid out for the SIMD culler
+    BoundingSpheres spheres;
+    spheres.Resize(static_cast<uint32_t>(objects.size()));
+    ParallelFor(spheres.Size(), 16384, [&objects, &spheres](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            glm::vec3 center;
+            TransformBoundingSphere(objects[i].transform, objects[i].boundingSphere, center, spheres.radius[i]);
+            spheres.centerX[i] = center.x;
+            spheres.centerY[i] = center.y;
+            spheres.centerZ[i] = center.z;
+        }
+    });
+
+    FrustumCuller().CullSpheres(frustum, spheres, visible);
+}
+
+bool GpuCulling::Validate(const glm::mat4 &viewProjection)
+{
+    return mGpuCullingImpl->Validate(viewProjection);
+}
+
+void GpuCulling::CreateTestScene(uint32_t objectCount)
+{
+    Logger::Info("Creating GPU culling test scene with " + std::to_string(objectCount) + " objects");
+
+    // a unit cube, each corner with its own color
+    std::vector<Vertex> vertices;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        glm::vec3 corner((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+        vertices.push_back({ corner, corner + glm::vec3(0.5f), glm::vec2(0.0f) });
+    }
+
+    std::vector<uint32_t> indices = {
+            0, 2, 1, 1, 2, 3, // -z
+            4, 5, 6, 5, 7, 6, // +z
+            0, 1, 4, 1, 5, 4, // -y
+            2, 6, 3, 3, 6, 7, // +y
+            0, 4, 2, 2, 4, 6, // -x
+            1, 3, 5, 3, 7, 5  // +x
+    };
+
+    MeshHandle cubeMesh = GeometryBuffer::AddMesh(vertices, indices);
+    if (cubeMesh.IsNull())
+    {
+        Logger::Warn("Could not add the test scene mesh to the geometry buffer");
+        return;
+    }
+    // a new scene replaces the objects of the previous one
+    if (!mGpuCullingImpl->testMesh.IsNull())
+        GeometryBuffer::RemoveMesh(mGpuCullingImpl->testMesh);
+    mGpuCullingImpl->testMesh = cubeMesh;
+
+    // fixed seed, so every run (and every validation) sees the same scene
+    std::mt19937 random(1337);
+    float extent = std::cbrt(static_cast<float>(objectCount)) * 2.0f;
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+
+    std::vector<GpuCullingObject> objects(objectCount);
+    for (auto& object : objects)
+    {
+        // NOTE: One random number per statement, the evaluation order of function arguments is unspecified
+        glm::vec3 translation, axis;
+        for (int i = 0; i < 3; i++)
+            translation[i] = position(random);
+        for (int i = 0; i < 3; i++)
+            axis[i] = unit(random);
+        if (glm::length(axis) < 0.001f)
+            axis = glm::vec3(0.0f, 1.0f, 0.0f);
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), translation);
+        transform = glm::rotate(transform, unit(random) * glm::pi<float>(), glm::normalize(axis));
+        transform = glm::scale(transform, glm::vec3(scale(random)));
+
+        object.transform = transform;
+        object.boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, std::sqrt(3.0f) * 0.5f);
+        object.mesh = cubeMesh;
+    }
+
+    mGpuCullingImpl->testSceneExtent = extent;
+    SetObjects(objects);
+
+    if (Config::IsGpuCullingValidationEnabled())
+    {
+        // a few points of the camera path, looking at different parts of the field
+        for (double time : { 0.0, 7.5, 15.0, 22.5 })
+            Validate(GetTestSceneViewProjection(time));
+    }
+}
+
+bool GpuCulling::HasTestScene()
+{
+    return mGpuCullingImpl->testSceneExtent > 0.0f;
+}
+
+std::vector<std::string> GpuCulling::GetShaderFiles()
+{
+    return { CULL_SHADER, DRAW_VERTEX_SHADER, DRAW_FRAGMENT_SHADER };
+}
+
+glm::mat4 GpuCulling::GetTestSceneViewProjection(double time)
+{
+    float extent = std::max(mGpuCullingImpl->testSceneExtent, 1.0f);
+    auto angle = static_cast<float>(time * 0.2);
+
+    // circling inside the field, so objects get culled on every side
+    glm::vec3 eye(std::cos(angle) * extent * 0.5f, extent * 0.1f, std::sin(angle) * extent * 0.5f);
+    glm::vec3 target(std::cos(angle + 0.5f) * extent * 0.5f, 0.0f, std::sin(angle + 0.5f) * extent * 0.5f);
+
+    float aspect = VulkanSwapchain::GetAspectRatio();
+
+    glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), aspect, 0.1f, extent * 2.0f);
+    projection[1][1] *= -1; // vulkan's Y axis points down
+
+    return projection * view;
+}
+
+//
+// Implementation
+//
+
+GpuCullingImpl::GpuCullingImpl()
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(VulkanDevice::GetPhysicalDevice(), &properties);
+
+    if (VulkanDevice::IsDrawIndirectCountEnabled())
+    {
+        vkCmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+                vkGetDeviceProcAddr(VulkanDevice::GetDevice(), "vkCmdDrawIndexedIndirectCountKHR"));
+    }
+    bCompact = vkCmdDrawIndexedIndirectCount != nullptr;
+    maxDrawIndirectCount = VulkanDevice::IsMultiDrawIndirectEnabled() ? std::max(properties.limits.maxDrawIndirectCount, 1u) : 1;
+
+    frames.resize(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT);
+
+    CreateDescriptorSetLayouts();
+    CreateComputePipeline();
+    CreateGraphicsPipeline();
+
+    Logger::Info(std::string("GPU culling: ") + (!cullingPipeline.IsNull() ? "compute shader" : "CPU fallback") +
+                 (bCompact ? ", draw indirect count" : ", uncompacted multi draw indirect"));
+}
+
+GpuCullingImpl::~GpuCullingImpl()
+{
+    VkDevice device = VulkanDevice::GetDevice();
+
+    // the deletion queue is shut down after us and releases these
+    ReleaseObjectBuffers();
+    CommandBufferCache::DestroyDrawSet(cachedDraw);
+    GpuResources::DestroyPipeline(cullingPipeline);
+    GpuResources::DestroyPipeline(drawPipeline);
+
+    if (!testMesh.IsNull())
+        GeometryBuffer::RemoveMesh(testMesh);
+
+    vkDestroyDescriptorSetLayout(device, cullingSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, drawSetLayout, nullptr);
+}
+
+void GpuCullingImpl::CreateDescriptorSetLayouts()
+{
+    // culling: objects (read), draw commands (write), draw count (atomic)
+    std::array<VkDescriptorSetLayoutBinding, 3> cullingBindings{};
+    for (uint32_t i = 0; i < cullingBindings.size(); i++)
+    {
+        cullingBindings[i].binding = i;
+        cullingBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullingBindings[i].descriptorCount = 1;
+        cullingBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(cullingBindings.size());
+    layoutInfo.pBindings = cullingBindings.data();
+
+    VK_CHECK(vkCreateDescriptorSetLayout(VulkanDevice::GetDevice(), &layoutInfo, nullptr, &cullingSetLayout));
+
+    // drawing: objects (read by the vertex shader through the instance index) and the camera
+    std::array<VkDescriptorSetLayoutBinding, 2> drawBindings{};
+    drawBindings[0].binding = 0;
+    drawBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    drawBindings[0].descriptorCount = 1;
+    drawBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    drawBindings[1].binding = 1;
+    drawBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    drawBindings[1].descriptorCount = 1;
+    drawBindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    layoutInfo.bindingCount = static_cast<uint32_t>(drawBindings.size());
+    layoutInfo.pBindings = drawBindings.data();
+
+    VK_CHECK(vkCreateDescriptorSetLayout(VulkanDevice::GetDevice(), &layoutInfo, nullptr, &drawSetLayout));
+}
+
+void GpuCullingImpl::CreateComputePipeline()
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(CullingPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &cullingSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    VkShaderModule computeShaderModule = Shader::CreateModule(CULL_SHADER);
+    if (computeShaderModule == VK_NULL_HANDLE)
+        return;
+
+    GpuPipeline computePipeline{};
+    computePipeline.bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+    VK_CHECK(vkCreatePipelineLayout(VulkanDevice::GetDevice(), &pipelineLayoutInfo, nullptr, &computePipeline.layout));
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = computeShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = computePipeline.layout;
+
+    VK_CHECK(vkCreateComputePipelines(VulkanDevice::GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline.pipeline));
+
+    vkDestroyShaderModule(VulkanDevice::GetDevice(), computeShaderModule, nullptr);
+
+    cullingPipeline = GpuResources::RegisterPipeline(computePipeline);
+
+    Logger::Debug("Culling compute pipeline created");
+}
+
+void GpuCullingImpl::CreateGraphicsPipeline()
+{
+    // the camera comes from a per frame uniform buffer instead of push constants, so the draws can be cached
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &drawSetLayout;
+
+    // the object index reaches the vertex shader through the draw's first instance
+    if (!VulkanDevice::IsDrawIndirectFirstInstanceEnabled())
+    {
+        Logger::Warn("Device doesn't support drawIndirectFirstInstance, GPU culled objects won't be drawn");
+        return;
+    }
+
+    VkShaderModule vertShaderModule = Shader::CreateModule(DRAW_VERTEX_SHADER);
+    VkShaderModule fragShaderModule = Shader::CreateModule(DRAW_FRAGMENT_SHADER);
+    if (vertShaderModule == VK_NULL_HANDLE || fragShaderModule == VK_NULL_HANDLE)
+    {
+        vkDestroyShaderModule(VulkanDevice::GetDevice(), vertShaderModule, nullptr);
+        vkDestroyShaderModule(VulkanDevice::GetDevice(), fragShaderModule, nullptr);
+        return;
+    }
+
+    GpuPipeline indirectPipeline{};
+    VK_CHECK(vkCreatePipelineLayout(VulkanDevice::GetDevice(), &pipelineLayoutInfo, nullptr, &indirectPipeline.layout));
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+
+    auto bindingDescription = Vertex::getBindingDescription();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // viewport and scissor are set by the renderer when the render pass begins
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE; // meshes don't agree on a winding yet
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    // NOTE: Swap chain recreation keeps the attachment formats, so the new render pass stays compatible
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.pStages = shaderStages.data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = indirectPipeline.layout;
+    pipelineInfo.renderPass = VulkanSwapchain::GetRenderPass();
+    pipelineInfo.subpass = 0;
+
+    VK_CHECK(vkCreateGraphicsPipelines(VulkanDevice::GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &indirectPipeline.pipeline));
+
+    vkDestroyShaderModule(VulkanDevice::GetDevice(), vertShaderModule, nullptr);
+    vkDestroyShaderModule(VulkanDevice::GetDevice(), fragShaderModule, nullptr);
+
+    drawPipeline = GpuResources::RegisterPipeline(indirectPipeline);
+
+    Logger::Debug("Indirect draw pipeline created");
+}
+
+void GpuCullingImpl::UploadObjects()
+{
+    ReleaseObjectBuffers();
+    ResolveObjects();
+
+    if (objects.empty())
+    {
+        UpdateCachedDraw();
+        return;
+    }
+
+    CreateObjectBuffers(static_cast<uint32_t>(objects.size()));
+    CreateDescriptorSets();
+    UpdateCachedDraw();
+
+    VulkanDevice::UploadBuffer(GpuResources::GetBuffer(objectBuffer).buffer, 0, objects.data(),
+                               sizeof(GpuObjectData) * objects.size());
+
+    Logger::Debug("Uploaded " + std::to_string(objects.size()) + " objects for GPU culling");
+}
+
+void GpuCullingImpl::ResolveObjects()
+{
+    objects.clear();
+    meshes.clear();
+
+    uint32_t skipped = 0;
+    for (const auto& source : sourceObjects)
+    {
+        MeshRange mesh = GeometryBuffer::GetMesh(source.mesh);
+        if (!mesh.IsValid())
+        {
+            skipped++;
+            continue;
+        }
+
+        GpuObjectData object{};
+        object.transform = source.transform;
+        object.boundingSphere = source.boundingSphere;
+        object.firstIndex = mesh.firstIndex;
+        object.indexCount = mesh.indexCount;
+        object.vertexOffset = mesh.vertexOffset;
+        objects.push_back(object);
+
+        if (std::find(meshes.begin(), meshes.end(), source.mesh) == meshes.end())
+            meshes.push_back(source.mesh);
+    }
+
+    if (skipped > 0)
+        Logger::Warn(std::to_string(skipped) + " GPU culled objects were skipped, their mesh was removed");
+}
+
+bool GpuCullingImpl::AreMeshesValid() const
+{
+    return std::all_of(meshes.begin(), meshes.end(), [](MeshHandle mesh) { return GeometryBuffer::IsValid(mesh); });
+}
+
+void GpuCullingImpl::CreateObjectBuffers(uint32_t objectCount)
+{
+    VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(objectCount);
+    VkDevice device = VulkanDevice::GetDevice();
+
+    objectBuffer = GpuResources::CreateBuffer(sizeof(GpuObjectData) * static_cast<VkDeviceSize>(objectCount),
+                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    drawCommandBuffer = GpuResources::CreateBuffer(commandsSize,
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    drawCountBuffer = GpuResources::CreateBuffer(sizeof(uint32_t),
+                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    for (auto& frame : frames)
+    {
+        frame.visibleCountBuffer = GpuResources::CreateBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        VK_CHECK(vkMapMemory(device, GpuResources::GetBuffer(frame.visibleCountBuffer).memory, 0, sizeof(uint32_t), 0,
+                             reinterpret_cast<void**>(&frame.visibleCount)));
+        frame.bHasVisibleCount = false;
+
+        frame.cameraBuffer = GpuResources::CreateBuffer(sizeof(glm::mat4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        VK_CHECK(vkMapMemory(device, GpuResources::GetBuffer(frame.cameraBuffer).memory, 0, sizeof(glm::mat4), 0,
+                             reinterpret_cast<void**>(&frame.camera)));
+        *frame.camera = glm::mat4(1.0f);
+
+        if (!cullingPipeline.IsNull())
+            continue;
+
+        // commands followed by their count
+        frame.uploadBuffer = GpuResources::CreateBuffer(commandsSize + sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        VK_CHECK(vkMapMemory(device, GpuResources::GetBuffer(frame.uploadBuffer).memory, 0, VK_WHOLE_SIZE, 0,
+                             &frame.uploadData));
+    }
+}
+
+void GpuCullingImpl::ReleaseObjectBuffers()
+{
+    // frames in flight may still be culling/drawing with them
+    DeletionQueue::PushDescriptorPool(descriptorPool);
+    GpuResources::DestroyBuffer(objectBuffer);
+    GpuResources::DestroyBuffer(drawCommandBuffer);
+    GpuResources::DestroyBuffer(drawCountBuffer);
+
+    descriptorPool = VK_NULL_HANDLE;
+    objectBuffer = drawCommandBuffer = drawCountBuffer = BufferHandle{};
+
+    // NOTE: Freeing mapped memory implicitly unmaps it
+    for (auto& frame : frames)
+    {
+        GpuResources::DestroyBuffer(frame.visibleCountBuffer);
+        GpuResources::DestroyBuffer(frame.uploadBuffer);
+        GpuResources::DestroyBuffer(frame.cameraBuffer);
+        frame = GpuCullingFrame{};
+    }
+}
+
+void GpuCullingImpl::CreateDescriptorSets()
+{
+    auto frameCount = static_cast<uint32_t>(frames.size());
+
+    // one culling set, and a drawing set per frame in flight
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 3 + frameCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[1].descriptorCount = frameCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1 + frameCount;
+
+    VK_CHECK(vkCreateDescriptorPool(VulkanDevice::GetDevice(), &poolInfo, nullptr, &descriptorPool));
+
+    std::vector<VkDescriptorSetLayout> layouts(1 + frameCount, drawSetLayout);
+    layouts[0] = cullingSetLayout;
+    std::vector<VkDescriptorSet> sets(layouts.size());
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    allocInfo.pSetLayouts = layouts.data();
+
+    VK_CHECK(vkAllocateDescriptorSets(VulkanDevice::GetDevice(), &allocInfo, sets.data()));
+    cullingSet = sets[0];
+    for (uint32_t i = 0; i < frameCount; i++)
+        frames[i].drawSet = sets[1 + i];
+
+    std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+    bufferInfos[0] = { GpuResources::GetBuffer(objectBuffer).buffer, 0, VK_WHOLE_SIZE };
+    bufferInfos[1] = { GpuResources::GetBuffer(drawCommandBuffer).buffer, 0, VK_WHOLE_SIZE };
+    bufferInfos[2] = { GpuResources::GetBuffer(drawCountBuffer).buffer, 0, VK_WHOLE_SIZE };
+
+    std::vector<VkDescriptorBufferInfo> cameraInfos(frameCount);
+    std::vector<VkWriteDescriptorSet> writes(bufferInfos.size() + 2 * frameCount);
+    for (uint32_t i = 0; i < bufferInfos.size(); i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = cullingSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].descriptorCount = 1;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+        cameraInfos[i] = { GpuResources::GetBuffer(frames[i].cameraBuffer).buffer, 0, sizeof(glm::mat4) };
+
+        VkWriteDescriptorSet& objectsWrite = writes[bufferInfos.size() + 2 * i];
+        objectsWrite = writes[0];
+        objectsWrite.dstSet = frames[i].drawSet;
+
+        VkWriteDescriptorSet& cameraWrite = writes[bufferInfos.size() + 2 * i + 1];
+        cameraWrite = objectsWrite;
+        cameraWrite.dstBinding = 1;
+        cameraWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        cameraWrite.pBufferInfo = &cameraInfos[i];
+    }
+
+    vkUpdateDescriptorSets(VulkanDevice::GetDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void GpuCullingImpl::UpdateCachedDraw()
+{
+    if (objects.empty() || drawPipeline.IsNull())
+    {
+        CommandBufferCache::DestroyDrawSet(cachedDraw);
+        cachedDraw = CommandBufferCache::INVALID_DRAW_SET;
+        return;
+    }
+
+    // new buffers and descriptor sets mean new handles, so the draws get recorded again
+    std::vector<uint64_t> dependencies = {
+            CommandBufferCache::Dependency(GpuResources::GetPipeline(drawPipeline).pipeline),
+            CommandBufferCache::Dependency(descriptorPool),
+            CommandBufferCache::Dependency(GpuResources::GetBuffer(drawCommandBuffer).buffer),
+            CommandBufferCache::Dependency(GpuResources::GetBuffer(drawCountBuffer).buffer),
+            CommandBufferCache::Dependency(GeometryBuffer::GetVertexBuffer()),
+            CommandBufferCache::Dependency(GeometryBuffer::GetIndexBuffer())
+    };
+
+    if (cachedDraw == CommandBufferCache::INVALID_DRAW_SET)
+        cachedDraw = CommandBufferCache::CreateDrawSet("GPU Culled Objects", GpuCulling::Draw, dependencies);
+    else
+        CommandBufferCache::SetDependencies(cachedDraw, dependencies);
+}
+
+void GpuCullingImpl::RecordCulling(VkCommandBuffer commandBuffer, const Frustum &frustum, GpuCullingFrame *frame)
+{
+    auto objectCount = static_cast<uint32_t>(objects.size());
+    VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(objectCount);
+    VkBuffer commands = GpuResources::GetBuffer(drawCommandBuffer).buffer;
+    VkBuffer count = GpuResources::GetBuffer(drawCountBuffer).buffer;
+
+    // the previous frame may still be drawing from the commands we're about to overwrite
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    if (!cullingPipeline.IsNull())
+    {
+        vkCmdFillBuffer(commandBuffer, count, 0, sizeof(uint32_t), 0);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        CullingPushConstants pushConstants{};
+        std::copy(frustum.planes.begin(), frustum.planes.end(), pushConstants.planes);
+        pushConstants.objectCount = objectCount;
+        pushConstants.compact = bCompact ? 1 : 0;
+
+        GpuPipeline pipeline = GpuResources::GetPipeline(cullingPipeline);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout,
+                                0, 1, &cullingSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT,
+                           0, sizeof(CullingPushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, (objectCount + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE, 1, 1);
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    } else if (frame != nullptr)
+    {
+        WriteCpuCommands(frustum, *frame);
+
+        std::array<VkBufferCopy, 1> commandsCopy = {{ { 0, 0, commandsSize } }};
+        std::array<VkBufferCopy, 1> countCopy = {{ { commandsSize, 0, sizeof(uint32_t) } }};
+        VkBuffer uploadBuffer = GpuResources::GetBuffer(frame->uploadBuffer).buffer;
+        vkCmdCopyBuffer(commandBuffer, uploadBuffer, commands, 1, commandsCopy.data());
+        vkCmdCopyBuffer(commandBuffer, uploadBuffer, count, 1, countCopy.data());
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    if (frame == nullptr)
+        return;
+
+    // the count is read on the CPU once this frame slot comes around again
+    VkBufferCopy countCopy{ 0, 0, sizeof(uint32_t) };
+    vkCmdCopyBuffer(commandBuffer, count, GpuResources::GetBuffer(frame->visibleCountBuffer).buffer, 1, &countCopy);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    frame->bHasVisibleCount = true;
+}
+
+void GpuCullingImpl::WriteCpuCommands(const Frustum &frustum, GpuCullingFrame &frame)
+{
+    ZoneScoped;
+
+    auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(frame.uploadData);
+
+    GpuCulling::CullOnCpu(objects, frustum, cpuVisible);
+    auto visibleCount = static_cast<uint32_t>(cpuVisible.size());
+
+    // same output as the compute shader
+    if (bCompact)
+    {
+        for (uint32_t slot = 0; slot < visibleCount; slot++)
+        {
+            uint32_t i = cpuVisible[slot];
+            commands[slot] = { objects[i].indexCount, 1, objects[i].firstIndex, objects[i].vertexOffset, i };
+        }
+    } else
+    {
+        for (uint32_t i = 0; i < objects.size(); i++)
+            commands[i] = { objects[i].indexCount, 0, objects[i].firstIndex, objects[i].vertexOffset, i };
+        for (auto i : cpuVisible)
+            commands[i].instanceCount = 1;
+    }
+
+    memcpy(commands + objects.size(), &visibleCount, sizeof(uint32_t));
+}
+
+bool GpuCullingImpl::Validate(const glm::mat4 &viewProjection)
+{
+    if (objects.empty())
+        return true;
+
+    if (cullingPipeline.IsNull())
+    {
+        Logger::Warn("Skipping GPU culling validation, the culling compute shader is not available");
+        return false;
+    }
+
+    Frustum frustum = Frustum::FromViewProjection(viewProjection);
+    auto objectCount = static_cast<uint32_t>(objects.size());
+    VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(objectCount);
+
+    VkBuffer readbackBuffer;
+    VkDeviceMemory readbackMemory;
+    VulkanDevice::CreateBuffer(commandsSize + sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                               readbackBuffer, readbackMemory);
+
+    VkCommandBuffer commandBuffer = VulkanDevice::BeginSingleTimeCommands();
+
+    RecordCulling(commandBuffer, frustum, nullptr);
+
+    VkBufferCopy commandsCopy{ 0, 0, commandsSize };
+    VkBufferCopy countCopy{ 0, commandsSize, sizeof(uint32_t) };
+    vkCmdCopyBuffer(commandBuffer, GpuResources::GetBuffer(drawCommandBuffer).buffer, readbackBuffer, 1, &commandsCopy);
+    vkCmdCopyBuffer(commandBuffer, GpuResources::GetBuffer(drawCountBuffer).buffer, readbackBuffer, 1, &countCopy);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    VulkanDevice::EndSingleTimeCommands(commandBuffer);
+
+    void* data;
+    vkMapMemory(VulkanDevice::GetDevice(), readbackMemory, 0, VK_WHOLE_SIZE, 0, &data);
+
+    auto* commands = static_cast<const VkDrawIndexedIndirectCommand*>(data);
+    uint32_t gpuCount;
+    memcpy(&gpuCount, commands + objectCount, sizeof(uint32_t));
+
+    std::vector<uint32_t> gpuVisible;
+    if (bCompact)
+    {
+        for (uint32_t i = 0; i < std::min(gpuCount, objectCount); i++)
+            gpuVisible.push_back(commands[i].firstInstance);
+    } else
+    {
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            if (commands[i].instanceCount > 0)
+                gpuVisible.push_back(commands[i].firstInstance);
+        }
+    }
+
+    vkUnmapMemory(VulkanDevice::GetDevice(), readbackMemory);
+    vkDestroyBuffer(VulkanDevice::GetDevice(), readbackBuffer, nullptr);
+    vkFreeMemory(VulkanDevice::GetDevice(), readbackMemory, nullptr);
+
+    // compaction order depends on the GPU's scheduling
+    std::sort(gpuVisible.begin(), gpuVisible.end());
+
+    std::vector<uint32_t> cpuVisible;
+    GpuCulling::CullOnCpu(objects, frustum, cpuVisible);
+
+    std::vector<uint32_t> mismatches;
+    std::set_symmetric_difference(gpuVisible.begin(), gpuVisible.end(), cpuVisible.begin(), cpuVisible.end(),
+                                  std::back_inserter(mismatches));
+
+    // objects right on a plane can go either way, anything else is a real disagreement
+    uint32_t errors = 0;
+    for (auto objectIdx : mismatches)
+    {
+        glm::vec3 center;
+        float radius;
+        TransformBoundingSphere(objects[objectIdx].transform, objects[objectIdx].boundingSphere, center, radius);
+
+        float closest = std::numeric_limits<float>::max();
+        for (const auto& plane : frustum.planes)
+            closest = std::min(closest, std::abs(glm::dot(glm::vec3(plane), center) + plane.w + radius));
+
+        if (closest > CULLING_VALIDATION_TOLERANCE * std::max(1.0f, radius))
+            errors++;
+    }
+
+    bool bValid = errors == 0 && gpuCount == gpuVisible.size();
+
+    std::string sResult = "GPU culling validation: " + std::to_string(gpuVisible.size()) + " visible on the GPU, " +
+                          std::to_string(cpuVisible.size()) + " on the CPU, " + std::to_string(mismatches.size()) +
+                          " mismatches (" + std::to_string(errors) + " outside tolerance)";
+    if (bValid)
+        Logger::Info(sResult);
+    else
+        Logger::Error(sResult, "FAILED");
+
+    return bValid;
+}
@@ -0,0 +1,164 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_GPUCULLING_H
+#define VULKAN_ENGINE_GPUCULLING_H
+
+#include <vulkan/vulkan.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <string>
+#include <vector>
+#include "CommandBufferCache.h"
+#include "GeometryBuffer.h"
+#include "GpuResources.h"
+#include "../culling/Frustum.h"
+
+// per object data, laid out for std430 (must match ObjectData in cull.comp and indirect.vert)
+struct GpuObjectData
+{
+    glm::mat4 transform;
+    glm::vec4 boundingSphere; // local center (xyz) and radius (w)
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    uint32_t padding;
+};
+static_assert(sizeof(GpuObjectData) == 96, "GpuObjectData must match the std430 layout of the shaders");
+
+// an object to cull and draw, its mesh is resolved to a range of the geometry buffer when the objects are uploaded
+struct GpuCullingObject
+{
+    glm::mat4 transform;
+    glm::vec4 boundingSphere; // local center (xyz) and radius (w)
+    MeshHandle mesh;
+};
+
+struct CullingPushConstants
+{
+    glm::vec4 planes[FRUSTUM_PLANE_COUNT];
+    uint32_t objectCount;
+    uint32_t compact;
+};
+
+// host visible buffers owned by a frame in flight
+struct GpuCullingFrame
+{
+    BufferHandle visibleCountBuffer;                    // the culled count is copied here every frame
+    uint32_t* visibleCount = nullptr;
+    bool bHasVisibleCount = false;
+
+    BufferHandle uploadBuffer;                          // draw commands culled on the CPU (no compute shader)
+    void* uploadData = nullptr;
+
+    BufferHandle cameraBuffer;                          // written by Cull, so the draw commands never change
+    glm::mat4* camera = nullptr;
+
+    VkDescriptorSet drawSet = VK_NULL_HANDLE;           // objects and this frame's camera
+};
+
+struct GpuCullingImpl
+{
+    GpuCullingImpl();
+    ~GpuCullingImpl();
+
+    void CreateDescriptorSetLayouts();
+    void CreateComputePipeline();
+    void CreateGraphicsPipeline();
+
+    void UploadObjects();
+    void ResolveObjects();
+    bool AreMeshesValid() const;
+    void CreateObjectBuffers(uint32_t objectCount);
+    void ReleaseObjectBuffers();
+    void CreateDescriptorSets();
+    void UpdateCachedDraw();
+
+    void RecordCulling(VkCommandBuffer commandBuffer, const Frustum& frustum, GpuCullingFrame* frame);
+    void WriteCpuCommands(const Frustum& frustum, GpuCullingFrame& frame);
+    bool Validate(const glm::mat4& viewProjection);
+
+    // compute culling (falls back to culling on the CPU when the shader is not available)
+    VkDescriptorSetLayout cullingSetLayout = VK_NULL_HANDLE;
+    PipelineHandle cullingPipeline;     // null without the compute shader
+
+    VkDescriptorSetLayout drawSetLayout = VK_NULL_HANDLE;
+    PipelineHandle drawPipeline;
+
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet cullingSet = VK_NULL_HANDLE;
+
+    BufferHandle objectBuffer;
+    BufferHandle drawCommandBuffer;
+    BufferHandle drawCountBuffer;
+
+    std::vector<GpuCullingFrame> frames;
+
+    // the indirect draws only depend on the buffers, so they're recorded once per frame slot (see CommandBufferCache)
+    uint32_t cachedDraw = CommandBufferCache::INVALID_DRAW_SET;
+
+    // as given to SetObjects, and the distinct meshes they use (checked at the start of every frame)
+    std::vector<GpuCullingObject> sourceObjects;
+    std::vector<MeshHandle> meshes;
+    MeshHandle testMesh;
+
+    // CPU copy of what was uploaded, used by the reference culler
+    std::vector<GpuObjectData> objects;
+    std::vector<uint32_t> cpuVisible;
+
+    PFN_vkCmdDrawIndexedIndirectCountKHR vkCmdDrawIndexedIndirectCount = nullptr;
+    bool bCompact = false;          // draws are compacted and drawn with a GPU side count
+    uint32_t maxDrawIndirectCount = 1;
+
+    uint32_t lastVisibleCount = 0;
+    float testSceneExtent = 0.0f;
+};
+
+// GPU driven rendering: objects live in storage buffers, a compute pass frustum culls them and writes the indirect
+// draw commands (plus their count), and everything visible is drawn with a single vkCmdDrawIndexedIndirectCount.
+// Meshes must come from the GeometryBuffer.
+class GpuCulling
+{
+public:
+    static void Init();
+    static void Shutdown();
+
+    // replaces every object (uploads them to the GPU), objects whose mesh was removed are skipped
+    // NOTE: When one of the meshes is removed later, the objects are uploaded again without the ones using it
+    static void SetObjects(const std::vector<GpuCullingObject>& objects);
+    static uint32_t GetObjectCount();
+
+    // uploads the objects again if one of their meshes was removed, call before the frame starts recording
+    static void BeginFrame();
+
+    // records the culling pass and sets the camera of the frame, call outside of a render pass before drawing
+    static void Cull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection);
+
+    // draws whatever survived culling (with the camera given to Cull), call inside the swap chain render pass
+    static void Draw(VkCommandBuffer commandBuffer);
+    // the same draws as a static draw set for CommandBufferCache::Execute, INVALID_DRAW_SET without objects
+    static uint32_t GetDrawSet();
+
+    // visible objects of the last frame that completed on the GPU
+    static uint32_t GetLastVisibleCount();
+    static bool IsComputeCullingAvailable();
+
+    // CPU reference culler, fills the (sorted) indices of the visible objects
+    static void CullOnCpu(const std::vector<GpuObjectData>& objects, const Frustum& frustum, std::vector<uint32_t>& visible);
+
+    // culls on both the GPU and the CPU and compares the results (stalls the GPU!)
+    static bool Validate(const glm::mat4& viewProjection);
+
+    // a field of cubes for testing/benchmarking and a camera flying through it
+    // NOTE: Only created at init, so these are safe to call from the game thread
+    static void CreateTestScene(uint32_t objectCount);
+    static bool HasTestScene();
+    static glm::mat4 GetTestSceneViewProjection(double time);
+
+    // SPIR-V files loaded by Init, so they can be read ahead of time (see Shader::Preload)
+    static std::vector<std::string> GetShaderFiles();
+};
+
+
+#endif //VULKAN_ENGINE_GPUCULLING_H
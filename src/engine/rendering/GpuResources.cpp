@@ -0,0 +1,183 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "GpuResources.h"
+#include "VulkanDevice.h"
+#include "../profiling/Logger.h"
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+GpuResourcesImpl* mGpuResourcesImpl = nullptr;
+
+void ReleaseBuffer(const GpuBuffer& buffer, uint64_t lastUsedFrame)
+{
+    DeletionQueue::PushBuffer(buffer.buffer, lastUsedFrame);
+    DeletionQueue::PushMemory(buffer.memory, lastUsedFrame);
+}
+
+void ReleaseTexture(const GpuTexture& texture, uint64_t lastUsedFrame)
+{
+    if (texture.sampler != VK_NULL_HANDLE)
+        DeletionQueue::PushSampler(texture.sampler, lastUsedFrame);
+    if (texture.view != VK_NULL_HANDLE)
+        DeletionQueue::PushImageView(texture.view, lastUsedFrame);
+    if (texture.image != VK_NULL_HANDLE)
+        DeletionQueue::PushImage(texture.image, lastUsedFrame);
+    if (texture.memory != VK_NULL_HANDLE)
+        DeletionQueue::PushMemory(texture.memory, lastUsedFrame);
+}
+
+void ReleasePipeline(const GpuPipeline& pipeline, uint64_t lastUsedFrame)
+{
+    DeletionQueue::PushPipeline(pipeline.pipeline, lastUsedFrame);
+    if (pipeline.bOwnsLayout && pipeline.layout != VK_NULL_HANDLE)
+        DeletionQueue::PushPipelineLayout(pipeline.layout, lastUsedFrame);
+}
+
+//
+// Initialization/Destruction
+//
+
+void GpuResources::Init()
+{
+    mGpuResourcesImpl = new GpuResourcesImpl;
+}
+
+void GpuResources::Shutdown()
+{
+    ReportStatistics();
+
+    delete mGpuResourcesImpl;
+    mGpuResourcesImpl = nullptr;
+}
+
+//
+// External
+//
+
+BufferHandle GpuResources::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+    GpuBuffer buffer{};
+    buffer.size = size;
+    buffer.usage = usage;
+    VulkanDevice::CreateBuffer(size, usage, properties, buffer.buffer, buffer.memory);
+
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+    return mGpuResourcesImpl->buffers.Create(buffer);
+}
+
+void GpuResources::DestroyBuffer(BufferHandle buffer, uint64_t lastUsedFrame)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+
+    const GpuBuffer* resource = mGpuResourcesImpl->buffers.Get(buffer);
+    if (!resource)
+        return;
+
+    ReleaseBuffer(*resource, lastUsedFrame);
+    mGpuResourcesImpl->buffers.Destroy(buffer);
+}
+
+GpuBuffer GpuResources::GetBuffer(BufferHandle buffer)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+
+    const GpuBuffer* resource = mGpuResourcesImpl->buffers.Get(buffer);
+    return resource ? *resource : GpuBuffer{};
+}
+
+bool GpuResources::IsValid(BufferHandle buffer)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+    return mGpuResourcesImpl->buffers.IsValid(buffer);
+}
+
+TextureHandle GpuResources::RegisterTexture(const GpuTexture &texture)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+    return mGpuResourcesImpl->textures.Create(texture);
+}
+
+void GpuResources::DestroyTexture(TextureHandle texture, uint64_t lastUsedFrame)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+
+    const GpuTexture* resource = mGpuResourcesImpl->textures.Get(texture);
+    if (!resource)
+        return;
+
+    ReleaseTexture(*resource, lastUsedFrame);
+    mGpuResourcesImpl->textures.Destroy(texture);
+}
+
+GpuTexture GpuResources::GetTexture(TextureHandle texture)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+
+    const GpuTexture* resource = mGpuResourcesImpl->textures.Get(texture);
+    return resource ? *resource : GpuTexture{};
+}
+
+bool GpuResources::IsValid(TextureHandle texture)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+    return mGpuResourcesImpl->textures.IsValid(texture);
+}
+
+PipelineHandle GpuResources::RegisterPipeline(const GpuPipeline &pipeline)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+    return mGpuResourcesImpl->pipelines.Create(pipeline);
+}
+
+void GpuResources::DestroyPipeline(PipelineHandle pipeline, uint64_t lastUsedFrame)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+
+    const GpuPipeline* resource = mGpuResourcesImpl->pipelines.Get(pipeline);
+    if (!resource)
+        return;
+
+    ReleasePipeline(*resource, lastUsedFrame);
+    mGpuResourcesImpl->pipelines.Destroy(pipeline);
+}
+
+GpuPipeline GpuResources::GetPipeline(PipelineHandle pipeline)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+
+    const GpuPipeline* resource = mGpuResourcesImpl->pipelines.Get(pipeline);
+    return resource ? *resource : GpuPipeline{};
+}
+
+bool GpuResources::IsValid(PipelineHandle pipeline)
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+    return mGpuResourcesImpl->pipelines.IsValid(pipeline);
+}
+
+void GpuResources::ReportStatistics()
+{
+    std::lock_guard<std::mutex> lock(mGpuResourcesImpl->mutex);
+
+    mGpuResourcesImpl->buffers.ReportStatistics();
+    mGpuResourcesImpl->textures.ReportStatistics();
+    mGpuResourcesImpl->pipelines.ReportStatistics();
+}
+
+//
+// Implementation
+//
+
+GpuResourcesImpl::~GpuResourcesImpl()
+{
+    uint32_t leaked = buffers.GetCount() + textures.GetCount() + pipelines.GetCount();
+    if (leaked > 0)
+        Logger::Warn(std::to_string(leaked) + " GPU resources were never destroyed, releasing them at shutdown");
+
+    // the deletion queue destroys them when it shuts down, after the device is idle
+    buffers.ForEach([](BufferHandle, GpuBuffer& buffer) { ReleaseBuffer(buffer, DeletionQueue::CURRENT_FRAME); });
+    textures.ForEach([](TextureHandle, GpuTexture& texture) { ReleaseTexture(texture, DeletionQueue::CURRENT_FRAME); });
+    pipelines.ForEach([](PipelineHandle, GpuPipeline& pipeline) { ReleasePipeline(pipeline, DeletionQueue::CURRENT_FRAME); });
+}
@@ -0,0 +1,92 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_GPURESOURCES_H
+#define VULKAN_ENGINE_GPURESOURCES_H
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include "DeletionQueue.h"
+#include "../common/HandlePool.h"
+
+struct GpuBuffer
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    VkBufferUsageFlags usage = 0;
+};
+
+// null members are not destroyed with the texture (ex.: a sampler shared by several textures)
+struct GpuTexture
+{
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 1;
+};
+
+struct GpuPipeline
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    bool bOwnsLayout = true; // false when the layout is shared with other pipelines
+};
+
+typedef THandle<GpuBuffer> BufferHandle;
+typedef THandle<GpuTexture> TextureHandle;
+typedef THandle<GpuPipeline> PipelineHandle;
+
+struct GpuResourcesImpl
+{
+    ~GpuResourcesImpl();
+
+    // resources may be created and released from streaming/loading threads
+    std::mutex mutex;
+    THandlePool<GpuBuffer> buffers{"Buffer"};
+    THandlePool<GpuTexture> textures{"Texture"};
+    THandlePool<GpuPipeline> pipelines{"Pipeline"};
+};
+
+// Owner of the GPU resources the engine hands around: buffers, textures and pipelines are referred to by handles
+// instead of raw Vulkan handles, so a destroyed resource is detected instead of being used after it was freed.
+// Destroying a resource releases it through the deletion queue, once the GPU is done with it.
+// Lookups return a copy, an empty one (null Vulkan handles) for a stale handle.
+class GpuResources
+{
+public:
+    // needs the device and the deletion queue to be initialized
+    static void Init();
+    // releases whatever is still alive
+    static void Shutdown();
+
+    static BufferHandle CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+    static void DestroyBuffer(BufferHandle buffer, uint64_t lastUsedFrame = DeletionQueue::CURRENT_FRAME);
+    static GpuBuffer GetBuffer(BufferHandle buffer);
+    static bool IsValid(BufferHandle buffer);
+
+    // takes ownership of the texture's objects
+    static TextureHandle RegisterTexture(const GpuTexture& texture);
+    static void DestroyTexture(TextureHandle texture, uint64_t lastUsedFrame = DeletionQueue::CURRENT_FRAME);
+    static GpuTexture GetTexture(TextureHandle texture);
+    static bool IsValid(TextureHandle texture);
+
+    // takes ownership of the pipeline (and of the layout, when bOwnsLayout)
+    static PipelineHandle RegisterPipeline(const GpuPipeline& pipeline);
+    static void DestroyPipeline(PipelineHandle pipeline, uint64_t lastUsedFrame = DeletionQueue::CURRENT_FRAME);
+    static GpuPipeline GetPipeline(PipelineHandle pipeline);
+    static bool IsValid(PipelineHandle pipeline);
+
+    // alive/peak counts and stale lookups of every resource type
+    static void ReportStatistics();
+};
+
+
+#endif //VULKAN_ENGINE_GPURESOURCES_H
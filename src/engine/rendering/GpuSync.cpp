@@ -0,0 +1,325 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "GpuSync.h"
+#include "VulkanDevice.h"
+#include <algorithm>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+GpuSyncImpl* mGpuSyncImpl = nullptr;
+
+//
+// Initialization/Destruction
+//
+
+void GpuSync::Init()
+{
+    mGpuSyncImpl = new GpuSyncImpl;
+}
+
+void GpuSync::Shutdown()
+{
+    delete mGpuSyncImpl;
+    mGpuSyncImpl = nullptr;
+}
+
+//
+// External
+//
+
+GpuSyncPoint GpuSync::Submit(EQueueType queue, const GpuSubmission &submission)
+{
+    QueueTimeline& timeline = mGpuSyncImpl->GetTimeline(queue);
+
+    std::vector<VkSemaphore> waitSemaphores = submission.binaryWaitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages = submission.binaryWaitStages;
+    std::vector<uint64_t> waitValues(waitSemaphores.size(), 0); // ignored for binary semaphores
+
+    for (const auto& wait : submission.waits)
+    {
+        QueueTimeline& other = mGpuSyncImpl->GetTimeline(wait.point.queue);
+
+        // work on the same queue is already ordered by submission
+        if (wait.point.value == 0 || &other == &timeline)
+            continue;
+
+        if (mGpuSyncImpl->bTimelineSemaphores)
+        {
+            waitSemaphores.push_back(other.semaphore);
+            waitStages.push_back(wait.stages);
+            waitValues.push_back(wait.point.value);
+        } else {
+            // NOTE: Without timeline semaphores a wait across queues degrades to a CPU wait
+            Wait(wait.point);
+        }
+    }
+
+    std::vector<VkSemaphore> signalSemaphores = submission.binarySignalSemaphores;
+    std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+
+    std::lock_guard<std::mutex> lock(timeline.mutex);
+
+    uint64_t value = timeline.lastSubmitted + 1;
+
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+
+    VkFence fence = VK_NULL_HANDLE;
+    if (mGpuSyncImpl->bTimelineSemaphores)
+    {
+        signalSemaphores.push_back(timeline.semaphore);
+        signalValues.push_back(value);
+
+        timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+    } else {
+        fence = mGpuSyncImpl->AcquireFence(timeline);
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = mGpuSyncImpl->bTimelineSemaphores ? &timelineInfo : nullptr;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = static_cast<uint32_t>(submission.commandBuffers.size());
+    submitInfo.pCommandBuffers = submission.commandBuffers.data();
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    VK_CHECK(vkQueueSubmit(timeline.queue, 1, &submitInfo, fence));
+
+    timeline.lastSubmitted = value;
+    if (fence != VK_NULL_HANDLE)
+        timeline.pendingFences.emplace_back(value, fence);
+
+    return { queue, value };
+}
+
+VkResult GpuSync::Present(const VkPresentInfoKHR &presentInfo)
+{
+    VkQueue presentQueue = VulkanDevice::GetPresentQueue();
+
+    // the present queue is usually the graphics one
+    for (auto& timeline : mGpuSyncImpl->timelines)
+    {
+        if (timeline.queue != presentQueue)
+            continue;
+
+        std::lock_guard<std::mutex> lock(timeline.mutex);
+        return vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
+
+    // a queue nothing else submits to
+    return vkQueuePresentKHR(presentQueue, &presentInfo);
+}
+
+bool GpuSync::IsComplete(const GpuSyncPoint &point)
+{
+    if (point.value == 0)
+        return true;
+
+    QueueTimeline& timeline = mGpuSyncImpl->GetTimeline(point.queue);
+    return point.value <= mGpuSyncImpl->PollCompleted(timeline);
+}
+
+void GpuSync::Wait(const GpuSyncPoint &point)
+{
+    if (IsComplete(point))
+        return;
+
+    QueueTimeline& timeline = mGpuSyncImpl->GetTimeline(point.queue);
+
+    if (mGpuSyncImpl->bTimelineSemaphores)
+    {
+        VkSemaphoreWaitInfoKHR waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &timeline.semaphore;
+        waitInfo.pValues = &point.value;
+
+        VK_CHECK(mGpuSyncImpl->waitSemaphores(VulkanDevice::GetDevice(), &waitInfo, UINT64_MAX));
+
+        std::lock_guard<std::mutex> lock(timeline.mutex);
+        timeline.lastCompleted = std::max(timeline.lastCompleted, point.value);
+    } else {
+        mGpuSyncImpl->WaitFallback(timeline, point.value);
+    }
+}
+
+uint64_t GpuSync::GetLastSubmittedValue(EQueueType queue)
+{
+    QueueTimeline& timeline = mGpuSyncImpl->GetTimeline(queue);
+
+    std::lock_guard<std::mutex> lock(timeline.mutex);
+    return timeline.lastSubmitted;
+}
+
+uint64_t GpuSync::GetCompletedValue(EQueueType queue)
+{
+    return mGpuSyncImpl->PollCompleted(mGpuSyncImpl->GetTimeline(queue));
+}
+
+GpuSyncPoint GpuSync::GetLastSubmitted(EQueueType queue)
+{
+    return { queue, GetLastSubmittedValue(queue) };
+}
+
+bool GpuSync::IsUsingTimelineSemaphores()
+{
+    return mGpuSyncImpl->bTimelineSemaphores;
+}
+
+//
+// Implementation
+//
+
+GpuSyncImpl::GpuSyncImpl()
+{
+    if (VulkanDevice::IsTimelineSemaphoreEnabled())
+    {
+        // the KHR names work when the extension is enabled, the core ones on 1.2 devices
+        waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(VulkanDevice::GetDevice(), "vkWaitSemaphoresKHR"));
+        if (!waitSemaphores)
+            waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(VulkanDevice::GetDevice(), "vkWaitSemaphores"));
+
+        getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(VulkanDevice::GetDevice(), "vkGetSemaphoreCounterValueKHR"));
+        if (!getSemaphoreCounterValue)
+            getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(VulkanDevice::GetDevice(), "vkGetSemaphoreCounterValue"));
+
+        bTimelineSemaphores = waitSemaphores && getSemaphoreCounterValue;
+    }
+
+    // REVIEW: Compute and transfer work goes to the graphics queue until we pick dedicated queue families
+    std::array<VkQueue, QUEUE_TYPE_COUNT> queues = {
+            VulkanDevice::GetGraphicsQueue(),
+            VulkanDevice::GetGraphicsQueue(),
+            VulkanDevice::GetGraphicsQueue()
+    };
+
+    uint32_t timelineCount = 0;
+    for (uint32_t i = 0; i < QUEUE_TYPE_COUNT; i++)
+    {
+        // reuse the timeline of a queue type that already uses the same VkQueue
+        auto sameQueue = std::find_if(timelines.begin(), timelines.begin() + timelineCount, [&](const QueueTimeline& timeline) {
+            return timeline.queue == queues[i];
+        });
+
+        if (sameQueue != timelines.begin() + timelineCount)
+        {
+            timelineIdx[i] = static_cast<uint32_t>(sameQueue - timelines.begin());
+            continue;
+        }
+
+        QueueTimeline& timeline = timelines[timelineCount];
+        timeline.queue = queues[i];
+
+        if (bTimelineSemaphores)
+        {
+            VkSemaphoreTypeCreateInfoKHR typeInfo{};
+            typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+            typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+            typeInfo.initialValue = 0;
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphoreInfo.pNext = &typeInfo;
+
+            VK_CHECK(vkCreateSemaphore(VulkanDevice::GetDevice(), &semaphoreInfo, nullptr, &timeline.semaphore));
+        }
+
+        timelineIdx[i] = timelineCount++;
+    }
+
+    Logger::Debug(std::string("GPU sync using ") + (bTimelineSemaphores ? "timeline semaphores" : "fences"));
+}
+
+GpuSyncImpl::~GpuSyncImpl()
+{
+    for (auto& timeline : timelines)
+    {
+        if (timeline.semaphore != VK_NULL_HANDLE)
+            vkDestroySemaphore(VulkanDevice::GetDevice(), timeline.semaphore, nullptr);
+
+        for (auto& pending : timeline.pendingFences)
+            vkDestroyFence(VulkanDevice::GetDevice(), pending.second, nullptr);
+
+        for (auto fence : timeline.freeFences)
+            vkDestroyFence(VulkanDevice::GetDevice(), fence, nullptr);
+    }
+}
+
+QueueTimeline &GpuSyncImpl::GetTimeline(EQueueType queue)
+{
+    return timelines[timelineIdx[queue]];
+}
+
+uint64_t GpuSyncImpl::PollCompleted(QueueTimeline &timeline)
+{
+    std::lock_guard<std::mutex> lock(timeline.mutex);
+
+    if (bTimelineSemaphores)
+    {
+        uint64_t value = 0;
+        VK_CHECK(getSemaphoreCounterValue(VulkanDevice::GetDevice(), timeline.semaphore, &value));
+        timeline.lastCompleted = std::max(timeline.lastCompleted, value);
+    } else {
+        // fences signal in submission order, so we stop at the first one that isn't done yet
+        while (!timeline.pendingFences.empty() &&
+               vkGetFenceStatus(VulkanDevice::GetDevice(), timeline.pendingFences.front().second) == VK_SUCCESS)
+        {
+            timeline.lastCompleted = timeline.pendingFences.front().first;
+            vkResetFences(VulkanDevice::GetDevice(), 1, &timeline.pendingFences.front().second);
+            timeline.freeFences.push_back(timeline.pendingFences.front().second);
+            timeline.pendingFences.pop_front();
+        }
+    }
+
+    return timeline.lastCompleted;
+}
+
+void GpuSyncImpl::WaitFallback(QueueTimeline &timeline, uint64_t value)
+{
+    // NOTE: The lock is held while waiting, so no other thread recycles the fences we're waiting on
+    std::lock_guard<std::mutex> lock(timeline.mutex);
+
+    std::vector<VkFence> fences;
+    for (const auto& pending : timeline.pendingFences)
+    {
+        if (pending.first > value)
+            break;
+        fences.push_back(pending.second);
+    }
+
+    if (fences.empty())
+        return;
+
+    VK_CHECK(vkWaitForFences(VulkanDevice::GetDevice(), static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX));
+    VK_CHECK(vkResetFences(VulkanDevice::GetDevice(), static_cast<uint32_t>(fences.size()), fences.data()));
+
+    timeline.lastCompleted = std::max(timeline.lastCompleted, timeline.pendingFences[fences.size() - 1].first);
+    timeline.freeFences.insert(timeline.freeFences.end(), fences.begin(), fences.end());
+    timeline.pendingFences.erase(timeline.pendingFences.begin(), timeline.pendingFences.begin() + static_cast<long>(fences.size()));
+}
+
+VkFence GpuSyncImpl::AcquireFence(QueueTimeline &timeline)
+{
+    // NOTE: The timeline's mutex must be held by the caller
+    if (!timeline.freeFences.empty())
+    {
+        VkFence fence = timeline.freeFences.back();
+        timeline.freeFences.pop_back();
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+    VK_CHECK(vkCreateFence(VulkanDevice::GetDevice(), &fenceInfo, nullptr, &fence));
+    return fence;
+}
@@ -0,0 +1,108 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_GPUSYNC_H
+#define VULKAN_ENGINE_GPUSYNC_H
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+enum EQueueType
+{
+    QUEUE_GRAPHICS,
+    QUEUE_COMPUTE,
+    QUEUE_TRANSFER,
+    QUEUE_TYPE_COUNT
+};
+
+// a point on a queue's timeline, value 0 is always considered complete
+struct GpuSyncPoint
+{
+    EQueueType queue = QUEUE_GRAPHICS;
+    uint64_t value = 0;
+};
+
+struct GpuWait
+{
+    GpuSyncPoint point;
+    VkPipelineStageFlags stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+};
+
+struct GpuSubmission
+{
+    std::vector<VkCommandBuffer> commandBuffers;
+
+    // work on other queues (or earlier work on the same one) that has to finish first
+    std::vector<GpuWait> waits;
+
+    // binary semaphores are still needed for the swap chain (acquire/present)
+    std::vector<VkSemaphore> binaryWaitSemaphores;
+    std::vector<VkPipelineStageFlags> binaryWaitStages;
+    std::vector<VkSemaphore> binarySignalSemaphores;
+};
+
+// every queue has a counter that increases by one on each submission
+struct QueueTimeline
+{
+    VkQueue queue = VK_NULL_HANDLE;
+    VkSemaphore semaphore = VK_NULL_HANDLE; // timeline semaphore (when supported)
+
+    uint64_t lastSubmitted = 0;
+    uint64_t lastCompleted = 0;
+
+    // fallback without timeline semaphores: one fence per submission, in submission order
+    std::deque<std::pair<uint64_t, VkFence>> pendingFences;
+    std::vector<VkFence> freeFences;
+
+    // submissions have to reach the queue in the same order as their values
+    std::mutex mutex;
+};
+
+struct GpuSyncImpl
+{
+    GpuSyncImpl();
+    ~GpuSyncImpl();
+
+    QueueTimeline& GetTimeline(EQueueType queue);
+    uint64_t PollCompleted(QueueTimeline& timeline);
+    void WaitFallback(QueueTimeline& timeline, uint64_t value);
+    VkFence AcquireFence(QueueTimeline& timeline);
+
+    bool bTimelineSemaphores = false;
+    PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue = nullptr;
+
+    // queue types that share the same VkQueue share the same timeline
+    std::array<QueueTimeline, QUEUE_TYPE_COUNT> timelines;
+    std::array<uint32_t, QUEUE_TYPE_COUNT> timelineIdx{};
+};
+
+// CPU/GPU synchronization through per queue timelines. Resources remember the GpuSyncPoint of their last use and
+// CPU waits/GPU cross queue waits are just comparisons against it.
+class GpuSync
+{
+public:
+    // needs the device to be initialized
+    static void Init();
+    static void Shutdown();
+
+    static GpuSyncPoint Submit(EQueueType queue, const GpuSubmission& submission);
+    // presents under the lock of the queue it goes through, which other threads may be submitting to
+    static VkResult Present(const VkPresentInfoKHR& presentInfo);
+
+    static bool IsComplete(const GpuSyncPoint& point);
+    static void Wait(const GpuSyncPoint& point);
+
+    static uint64_t GetLastSubmittedValue(EQueueType queue);
+    static uint64_t GetCompletedValue(EQueueType queue);
+    static GpuSyncPoint GetLastSubmitted(EQueueType queue);
+
+    static bool IsUsingTimelineSemaphores();
+};
+
+
+#endif //VULKAN_ENGINE_GPUSYNC_H
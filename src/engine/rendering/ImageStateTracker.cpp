@@ -0,0 +1,322 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "ImageStateTracker.h"
+#include "VulkanDevice.h"
+#include <Tracy.hpp>
+#include <cassert>
+#include <sstream>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+ImageStateTrackerImpl* mImageStateTrackerImpl = nullptr;
+
+// NOTE: Only stage/access bits that also exist in the original (32 bit) flags are used, so the same values work for the
+//       vkCmdPipelineBarrier fallback
+ImageSubresourceState GetUseState(EImageUse use)
+{
+    switch (use)
+    {
+        case IMAGE_USE_TRANSFER_SRC:
+            return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+                     VK_ACCESS_2_TRANSFER_READ_BIT_KHR, false };
+        case IMAGE_USE_TRANSFER_DST:
+            return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+                     VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, true };
+        case IMAGE_USE_SHADER_READ:
+            return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                     VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+                     VK_ACCESS_2_SHADER_READ_BIT_KHR, false };
+        case IMAGE_USE_STORAGE_WRITE:
+            return { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+                     VK_ACCESS_2_SHADER_READ_BIT_KHR | VK_ACCESS_2_SHADER_WRITE_BIT_KHR, true };
+        case IMAGE_USE_COLOR_ATTACHMENT:
+            return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+                     VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR, true };
+        case IMAGE_USE_DEPTH_ATTACHMENT:
+            return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                     VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+                     VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR, true };
+        case IMAGE_USE_PRESENT:
+            // the presentation engine synchronizes through the semaphores, nothing to wait on here
+            return { VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_NONE_KHR, VK_ACCESS_2_NONE_KHR, false };
+        default:
+            return {};
+    }
+}
+
+//
+// Initialization/Destruction
+//
+
+void ImageStateTracker::Init()
+{
+    mImageStateTrackerImpl = new ImageStateTrackerImpl;
+}
+
+void ImageStateTracker::Shutdown()
+{
+    ReportStatistics();
+
+    delete mImageStateTrackerImpl;
+    mImageStateTrackerImpl = nullptr;
+}
+
+//
+// External
+//
+
+void ImageStateTracker::BeginFrame()
+{
+    std::lock_guard<std::mutex> lock(mImageStateTrackerImpl->mutex);
+
+    TracyPlot("Image barriers", static_cast<int64_t>(mImageStateTrackerImpl->frameBarriers));
+    TracyPlot("Image barrier calls", static_cast<int64_t>(mImageStateTrackerImpl->frameBarrierCalls));
+
+    mImageStateTrackerImpl->barrierStats.AddSample(static_cast<double>(mImageStateTrackerImpl->frameBarriers));
+    mImageStateTrackerImpl->frameBarriers = 0;
+    mImageStateTrackerImpl->frameBarrierCalls = 0;
+    mImageStateTrackerImpl->frameSkippedTransitions = 0;
+}
+
+void ImageStateTracker::RegisterImage(VkImage image, VkImageAspectFlags aspectMask, uint32_t mipLevels,
+                                      uint32_t layerCount, VkImageLayout initialLayout)
+{
+    std::lock_guard<std::mutex> lock(mImageStateTrackerImpl->mutex);
+
+    TrackedImage trackedImage;
+    trackedImage.aspectMask = aspectMask;
+    trackedImage.mipLevels = mipLevels;
+    trackedImage.layerCount = layerCount;
+    trackedImage.subresources.resize(static_cast<size_t>(mipLevels) * layerCount);
+
+    for (auto& subresource : trackedImage.subresources)
+        subresource.layout = initialLayout;
+
+    mImageStateTrackerImpl->images[image] = trackedImage;
+}
+
+void ImageStateTracker::UnregisterImage(VkImage image)
+{
+    std::lock_guard<std::mutex> lock(mImageStateTrackerImpl->mutex);
+    mImageStateTrackerImpl->images.erase(image);
+}
+
+void ImageStateTracker::SetState(VkImage image, EImageUse lastUse, VkImageLayout layout)
+{
+    std::lock_guard<std::mutex> lock(mImageStateTrackerImpl->mutex);
+
+    auto trackedImage = mImageStateTrackerImpl->images.find(image);
+    assert(trackedImage != mImageStateTrackerImpl->images.end() && "Image is not tracked");
+
+    ImageSubresourceState state = GetUseState(lastUse);
+    state.layout = layout;
+
+    for (auto& subresource : trackedImage->second.subresources)
+        subresource = state;
+}
+
+void ImageStateTracker::Transition(VkCommandBuffer commandBuffer, VkImage image, EImageUse nextUse, uint32_t baseMip,
+                                   uint32_t mipCount, uint32_t baseLayer, uint32_t layerCount)
+{
+    std::lock_guard<std::mutex> lock(mImageStateTrackerImpl->mutex);
+
+    auto trackedImage = mImageStateTrackerImpl->images.find(image);
+    assert(trackedImage != mImageStateTrackerImpl->images.end() && "Image is not tracked");
+
+    if (mipCount == ALL_REMAINING)
+        mipCount = trackedImage->second.mipLevels - baseMip;
+    if (layerCount == ALL_REMAINING)
+        layerCount = trackedImage->second.layerCount - baseLayer;
+
+    mImageStateTrackerImpl->Transition(mImageStateTrackerImpl->pendingBarriers[commandBuffer], trackedImage->second, image,
+                                       nextUse, baseMip, mipCount, baseLayer, layerCount);
+}
+
+void ImageStateTracker::FlushBarriers(VkCommandBuffer commandBuffer)
+{
+    std::lock_guard<std::mutex> lock(mImageStateTrackerImpl->mutex);
+    mImageStateTrackerImpl->Flush(commandBuffer);
+}
+
+VkImageLayout ImageStateTracker::GetLayout(VkImage image, uint32_t mip, uint32_t layer)
+{
+    std::lock_guard<std::mutex> lock(mImageStateTrackerImpl->mutex);
+
+    auto trackedImage = mImageStateTrackerImpl->images.find(image);
+    if (trackedImage == mImageStateTrackerImpl->images.end())
+        return VK_IMAGE_LAYOUT_UNDEFINED;
+
+    return trackedImage->second.subresources[layer * trackedImage->second.mipLevels + mip].layout;
+}
+
+uint32_t ImageStateTracker::GetFrameBarrierCount()
+{
+    return mImageStateTrackerImpl->frameBarriers;
+}
+
+uint32_t ImageStateTracker::GetFrameBarrierCallCount()
+{
+    return mImageStateTrackerImpl->frameBarrierCalls;
+}
+
+void ImageStateTracker::ReportStatistics()
+{
+    const FrameStatistics& stats = mImageStateTrackerImpl->barrierStats;
+    if (stats.GetSampleCount() == 0)
+        return;
+
+    std::stringstream ss;
+    ss << "Image barriers per frame -> frames: " << stats.GetSampleCount()
+       << " | avg: " << stats.GetAverage()
+       << " | max: " << stats.GetMax()
+       << " | synchronization2: " << (mImageStateTrackerImpl->bSynchronization2 ? "yes" : "no");
+    Logger::Info(ss.str());
+}
+
+//
+// Implementation
+//
+
+ImageStateTrackerImpl::ImageStateTrackerImpl()
+{
+    // the KHR entry point has to be loaded, the loader doesn't export it
+    if (VulkanDevice::IsSynchronization2Enabled())
+    {
+        cmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(
+                vkGetDeviceProcAddr(VulkanDevice::GetDevice(), "vkCmdPipelineBarrier2KHR"));
+        bSynchronization2 = cmdPipelineBarrier2 != nullptr;
+    }
+}
+
+void ImageStateTrackerImpl::Transition(std::vector<VkImageMemoryBarrier2KHR> &pending, TrackedImage &image, VkImage handle,
+                                       EImageUse use, uint32_t baseMip, uint32_t mipCount, uint32_t baseLayer,
+                                       uint32_t layerCount)
+{
+    ImageSubresourceState next = GetUseState(use);
+
+    for (uint32_t layer = baseLayer; layer < baseLayer + layerCount; layer++)
+    {
+        // consecutive mips in the same state share a single barrier
+        uint32_t mip = baseMip;
+        while (mip < baseMip + mipCount)
+        {
+            ImageSubresourceState previous = image.subresources[layer * image.mipLevels + mip];
+
+            uint32_t runEnd = mip + 1;
+            while (runEnd < baseMip + mipCount && image.subresources[layer * image.mipLevels + runEnd] == previous)
+                runEnd++;
+
+            bool bSameLayout = previous.layout == next.layout;
+            bool bNothingToWaitOn = previous.stages == VK_PIPELINE_STAGE_2_NONE_KHR;
+
+            if (bSameLayout && (bNothingToWaitOn || (!previous.bWritten && !next.bWritten)))
+            {
+                // read after read (or first use) in the right layout, the accesses just accumulate
+                for (uint32_t i = mip; i < runEnd; i++)
+                {
+                    ImageSubresourceState& state = image.subresources[layer * image.mipLevels + i];
+                    state.stages |= next.stages;
+                    state.access |= next.access;
+                    state.bWritten |= next.bWritten;
+                }
+
+                frameSkippedTransitions++;
+            } else {
+                VkImageMemoryBarrier2KHR barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+                barrier.srcStageMask = previous.stages;
+                barrier.srcAccessMask = previous.bWritten ? previous.access : VK_ACCESS_2_NONE_KHR; // write after read only needs an execution dependency
+                barrier.dstStageMask = next.stages;
+                barrier.dstAccessMask = next.access;
+                barrier.oldLayout = previous.layout;
+                barrier.newLayout = next.layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = handle;
+                barrier.subresourceRange.aspectMask = image.aspectMask;
+                barrier.subresourceRange.baseMipLevel = mip;
+                barrier.subresourceRange.levelCount = runEnd - mip;
+                barrier.subresourceRange.baseArrayLayer = layer;
+                barrier.subresourceRange.layerCount = 1;
+
+                // the same mip range of the previous layer may be extended instead
+                VkImageMemoryBarrier2KHR* last = pending.empty() ? nullptr : &pending.back();
+                if (last && last->image == handle &&
+                    last->subresourceRange.baseMipLevel == mip && last->subresourceRange.levelCount == runEnd - mip &&
+                    last->subresourceRange.baseArrayLayer + last->subresourceRange.layerCount == layer &&
+                    last->srcStageMask == barrier.srcStageMask && last->srcAccessMask == barrier.srcAccessMask &&
+                    last->dstStageMask == barrier.dstStageMask && last->dstAccessMask == barrier.dstAccessMask &&
+                    last->oldLayout == barrier.oldLayout && last->newLayout == barrier.newLayout)
+                {
+                    last->subresourceRange.layerCount++;
+                } else {
+                    pending.push_back(barrier);
+                }
+
+                for (uint32_t i = mip; i < runEnd; i++)
+                    image.subresources[layer * image.mipLevels + i] = next;
+            }
+
+            mip = runEnd;
+        }
+    }
+}
+
+void ImageStateTrackerImpl::Flush(VkCommandBuffer commandBuffer)
+{
+    auto commandBufferBarriers = pendingBarriers.find(commandBuffer);
+    if (commandBufferBarriers == pendingBarriers.end())
+        return;
+
+    const std::vector<VkImageMemoryBarrier2KHR>& pending = commandBufferBarriers->second;
+
+    if (bSynchronization2)
+    {
+        VkDependencyInfoKHR dependencyInfo{};
+        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+        dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(pending.size());
+        dependencyInfo.pImageMemoryBarriers = pending.data();
+
+        cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    } else {
+        // without synchronization2 the stages of the whole batch have to be merged into a single pair of masks
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<VkImageMemoryBarrier> barriers(pending.size());
+
+        for (size_t i = 0; i < pending.size(); i++)
+        {
+            const VkImageMemoryBarrier2KHR& barrier = pending[i];
+
+            srcStages |= static_cast<VkPipelineStageFlags>(barrier.srcStageMask);
+            dstStages |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+
+            barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barriers[i].srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+            barriers[i].dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+            barriers[i].oldLayout = barrier.oldLayout;
+            barriers[i].newLayout = barrier.newLayout;
+            barriers[i].srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+            barriers[i].dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+            barriers[i].image = barrier.image;
+            barriers[i].subresourceRange = barrier.subresourceRange;
+        }
+
+        // empty masks aren't allowed here
+        if (srcStages == 0)
+            srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        if (dstStages == 0)
+            dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             static_cast<uint32_t>(barriers.size()), barriers.data());
+    }
+
+    frameBarriers += static_cast<uint32_t>(pending.size());
+    frameBarrierCalls++;
+    pendingBarriers.erase(commandBufferBarriers);
+}
@@ -0,0 +1,108 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_IMAGESTATETRACKER_H
+#define VULKAN_ENGINE_IMAGESTATETRACKER_H
+
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "../profiling/FrameStatistics.h"
+
+// what an image is going to be used for next, the tracker derives layouts, stages and accesses from it
+enum EImageUse
+{
+    IMAGE_USE_UNDEFINED,            // contents can be discarded
+    IMAGE_USE_TRANSFER_SRC,
+    IMAGE_USE_TRANSFER_DST,
+    IMAGE_USE_SHADER_READ,          // sampled from fragment or compute shaders
+    IMAGE_USE_STORAGE_WRITE,        // written from compute shaders
+    IMAGE_USE_COLOR_ATTACHMENT,
+    IMAGE_USE_DEPTH_ATTACHMENT,
+    IMAGE_USE_PRESENT
+};
+
+// state of a single mip level of a single array layer
+struct ImageSubresourceState
+{
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags2KHR stages = VK_PIPELINE_STAGE_2_NONE_KHR;   // stages that accessed it since the last barrier
+    VkAccessFlags2KHR access = VK_ACCESS_2_NONE_KHR;                  // accesses done since the last barrier
+    bool bWritten = false;                                            // whether any of those accesses was a write
+
+    bool operator==(const ImageSubresourceState& other) const
+    {
+        return layout == other.layout && stages == other.stages && access == other.access && bWritten == other.bWritten;
+    }
+};
+
+struct TrackedImage
+{
+    VkImageAspectFlags aspectMask;
+    uint32_t mipLevels;
+    uint32_t layerCount;
+    std::vector<ImageSubresourceState> subresources; // layer * mipLevels + mip
+};
+
+struct ImageStateTrackerImpl
+{
+    ImageStateTrackerImpl();
+
+    void Transition(std::vector<VkImageMemoryBarrier2KHR>& pending, TrackedImage& image, VkImage handle, EImageUse use,
+                    uint32_t baseMip, uint32_t mipCount, uint32_t baseLayer, uint32_t layerCount);
+    void Flush(VkCommandBuffer commandBuffer);
+
+    std::mutex mutex;
+    std::unordered_map<VkImage, TrackedImage> images;
+    // by the command buffer they're recorded into, several threads may be recording at the same time
+    std::unordered_map<VkCommandBuffer, std::vector<VkImageMemoryBarrier2KHR>> pendingBarriers;
+
+    bool bSynchronization2 = false;
+    PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2 = nullptr;
+
+    // per frame counters
+    uint32_t frameBarriers = 0;
+    uint32_t frameBarrierCalls = 0;
+    uint32_t frameSkippedTransitions = 0;
+    FrameStatistics barrierStats;
+};
+
+class ImageStateTracker
+{
+public:
+    static constexpr uint32_t ALL_REMAINING = ~0u;
+
+    // needs the device to be initialized
+    static void Init();
+    static void Shutdown();
+
+    // publishes the previous frame's barrier counts and resets them
+    static void BeginFrame();
+
+    static void RegisterImage(VkImage image, VkImageAspectFlags aspectMask, uint32_t mipLevels = 1, uint32_t layerCount = 1,
+                              VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    static void UnregisterImage(VkImage image);
+
+    // for layout changes done outside of the tracker (ex.: render pass final layouts)
+    static void SetState(VkImage image, EImageUse lastUse, VkImageLayout layout);
+
+    // batches the barriers needed before the next use in the command buffer (none for read after read in the same layout)
+    // NOTE: Barriers are only batched here, they're recorded by FlushBarriers for the same command buffer
+    static void Transition(VkCommandBuffer commandBuffer, VkImage image, EImageUse nextUse,
+                           uint32_t baseMip = 0, uint32_t mipCount = ALL_REMAINING,
+                           uint32_t baseLayer = 0, uint32_t layerCount = ALL_REMAINING);
+
+    // records every barrier pending for the command buffer with a single vkCmdPipelineBarrier2 (or vkCmdPipelineBarrier) call
+    static void FlushBarriers(VkCommandBuffer commandBuffer);
+
+    static VkImageLayout GetLayout(VkImage image, uint32_t mip = 0, uint32_t layer = 0);
+
+    static uint32_t GetFrameBarrierCount();
+    static uint32_t GetFrameBarrierCallCount();
+    static void ReportStatistics();
+};
+
+
+#endif //VULKAN_ENGINE_IMAGESTATETRACKER_H
@@ -0,0 +1,676 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "RenderQueue.h"
+#include "../common/Parallel.h"
+#include "../profiling/Logger.h"
+#include <glm/mat4x4.hpp>
+#include <Tracy.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <random>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+RenderQueueImpl* mRenderQueueImpl = nullptr;
+
+//
+// Sort keys
+//
+
+uint64_t RenderSortKey::Make(ERenderQueuePass ePass, uint32_t nLayer, bool bTranslucent, uint32_t nPipeline, uint32_t nMaterial,
+                             float fDepth)
+{
+    const uint64_t maxDepth = (1ull << DEPTH_BITS) - 1;
+    auto depth = static_cast<uint64_t>(std::min(std::max(fDepth, 0.0f), 1.0f) * static_cast<float>(maxDepth));
+
+    uint64_t pipeline = nPipeline & (MAX_PIPELINES - 1);
+    uint64_t material = nMaterial & (MAX_MATERIALS - 1);
+
+    uint64_t key = (static_cast<uint64_t>(ePass) & ((1ull << PASS_BITS) - 1)) << PASS_SHIFT;
+    key |= (static_cast<uint64_t>(nLayer) & ((1ull << LAYER_BITS) - 1)) << LAYER_SHIFT;
+
+    if (bTranslucent)
+    {
+        key |= 1ull << TRANSLUCENT_SHIFT;
+        key |= (maxDepth - depth) << (PIPELINE_BITS + MATERIAL_BITS);
+        key |= pipeline << MATERIAL_BITS;
+        key |= material;
+    } else
+    {
+        key |= pipeline << (MATERIAL_BITS + DEPTH_BITS);
+        key |= material << DEPTH_BITS;
+        key |= depth;
+    }
+
+    return key;
+}
+
+ERenderQueuePass RenderSortKey::GetPass(uint64_t key)
+{
+    return static_cast<ERenderQueuePass>(key >> PASS_SHIFT);
+}
+
+//
+// Initialization/Destruction
+//
+
+void RenderQueue::Init()
+{
+    mRenderQueueImpl = new RenderQueueImpl;
+}
+
+void RenderQueue::Shutdown()
+{
+    delete mRenderQueueImpl;
+    mRenderQueueImpl = nullptr;
+}
+
+//
+// External
+//
+
+void RenderQueue::BeginFrame()
+{
+    const auto& stats = mRenderQueueImpl->frameStatistics;
+    TracyPlot("Queued draws", static_cast<int64_t>(stats.draws));
+    TracyPlot("Pipeline binds", static_cast<int64_t>(stats.pipelineBinds));
+    TracyPlot("Descriptor set binds", static_cast<int64_t>(stats.descriptorSetBinds));
+    TracyPlot("Buffer binds", static_cast<int64_t>(stats.vertexBufferBinds + stats.indexBufferBinds));
+    TracyPlot("Skipped binds", static_cast<int64_t>(stats.skippedBinds));
+
+    mRenderQueueImpl->lastFrameStatistics = stats;
+    mRenderQueueImpl->frameStatistics = RenderQueueStatistics{};
+
+    mRenderQueueImpl->ResetSubmissions();
+    mRenderQueueImpl->draws.clear();
+    mRenderQueueImpl->pushConstants.clear();
+    mRenderQueueImpl->sortedDraws.clear();
+    mRenderQueueImpl->bSorted = false;
+}
+
+uint32_t RenderQueue::RegisterPipeline(VkPipeline pipeline, VkPipelineLayout layout, VkShaderStageFlags pushConstantStages)
+{
+    if (mRenderQueueImpl->pipelines.size() >= RenderSortKey::MAX_PIPELINES)
+    {
+        Logger::Error("Could not register pipeline in the render queue", "too many pipelines");
+        return 0;
+    }
+
+    mRenderQueueImpl->pipelines.push_back({ pipeline, layout, pushConstantStages, PipelineHandle{} });
+    mRenderQueueImpl->pipelineCount.store(static_cast<uint32_t>(mRenderQueueImpl->pipelines.size()));
+    return static_cast<uint32_t>(mRenderQueueImpl->pipelines.size() - 1);
+}
+
+uint32_t RenderQueue::RegisterPipeline(PipelineHandle pipeline, VkShaderStageFlags pushConstantStages)
+{
+    if (!GpuResources::IsValid(pipeline))
+    {
+        Logger::Error("Could not register pipeline in the render queue", "stale pipeline handle");
+        return 0;
+    }
+
+    uint32_t id = RegisterPipeline(VK_NULL_HANDLE, VK_NULL_HANDLE, pushConstantStages);
+    if (id != 0)
+        mRenderQueueImpl->pipelines[id].handle = pipeline;
+    return id;
+}
+
+uint32_t RenderQueue::RegisterMaterial(VkDescriptorSet descriptorSet, uint32_t setIndex)
+{
+    if (mRenderQueueImpl->materials.size() >= RenderSortKey::MAX_MATERIALS)
+    {
+        Logger::Error("Could not register material in the render queue", "too many materials");
+        return 0;
+    }
+
+    mRenderQueueImpl->materials.push_back({ descriptorSet, setIndex });
+    mRenderQueueImpl->materialCount.store(static_cast<uint32_t>(mRenderQueueImpl->materials.size()));
+    return static_cast<uint32_t>(mRenderQueueImpl->materials.size() - 1);
+}
+
+void RenderQueue::Submit(const RenderDraw &draw, const void *pushConstants, uint32_t pushConstantSize)
+{
+    // recording would bind a null pipeline or read past the registered ones
+    if (!mRenderQueueImpl->IsRegistered(draw))
+    {
+        mRenderQueueImpl->rejectedDraws++;
+        if (!mRenderQueueImpl->bWarnedRejectedDraw.exchange(true))
+            Logger::Warn("Draws with an unregistered pipeline or material were submitted to the render queue, they're skipped");
+        return;
+    }
+
+    SubmissionThreadBuffer* buffer = mRenderQueueImpl->GetThreadBuffer();
+    SubmissionChunk* chunk = buffer->GetChunkWithSpace();
+
+    uint32_t slot = chunk->count++;
+    RenderDraw& queued = chunk->draws[slot];
+    queued = draw;
+
+    // offsets are local to the thread's buffer until the submissions are merged
+    queued.pushConstantOffset = static_cast<uint32_t>(buffer->pushConstants.size());
+    queued.pushConstantSize = pushConstants != nullptr ? pushConstantSize : 0;
+    if (queued.pushConstantSize > 0)
+    {
+        buffer->pushConstants.resize(queued.pushConstantOffset + pushConstantSize);
+        memcpy(buffer->pushConstants.data() + queued.pushConstantOffset, pushConstants, pushConstantSize);
+    }
+
+    chunk->keys[slot] = RenderSortKey::Make(draw.pass, draw.layer, draw.bTranslucent, draw.pipeline, draw.material, draw.depth);
+}
+
+void RenderQueue::Record(VkCommandBuffer commandBuffer, ERenderQueuePass ePass)
+{
+    ZoneScoped;
+
+    if (mRenderQueueImpl->MergeSubmissions() > 0)
+        mRenderQueueImpl->bSorted = false;
+
+    if (!mRenderQueueImpl->bSorted)
+        mRenderQueueImpl->Sort();
+
+    // the draws of a pass are contiguous once sorted
+    const auto& sortedDraws = mRenderQueueImpl->sortedDraws;
+    auto byKey = [](const SortItem& item, uint64_t key) { return item.key < key; };
+    auto first = std::lower_bound(sortedDraws.begin(), sortedDraws.end(),
+                                  static_cast<uint64_t>(ePass) << RenderSortKey::PASS_SHIFT, byKey);
+    auto last = std::lower_bound(first, sortedDraws.end(),
+                                 static_cast<uint64_t>(ePass + 1) << RenderSortKey::PASS_SHIFT, byKey);
+
+    mRenderQueueImpl->Record(commandBuffer, static_cast<uint32_t>(first - sortedDraws.begin()),
+                             static_cast<uint32_t>(last - sortedDraws.begin()));
+}
+
+uint32_t RenderQueue::GetDrawCount()
+{
+    return static_cast<uint32_t>(mRenderQueueImpl->draws.size());
+}
+
+const RenderQueueStatistics &RenderQueue::GetFrameStatistics()
+{
+    return mRenderQueueImpl->frameStatistics;
+}
+
+const RenderQueueStatistics &RenderQueue::GetLastFrameStatistics()
+{
+    return mRenderQueueImpl->lastFrameStatistics;
+}
+
+void RenderQueue::RunBenchmark()
+{
+    const uint32_t drawCount = 100000;
+    const uint32_t pipelineCount = 64;
+    const uint32_t materialCount = 1024;
+    const uint32_t iterations = 20;
+
+    // benchmarks run before the engine is initialized
+    bool bOwnsQueue = mRenderQueueImpl == nullptr;
+    if (bOwnsQueue)
+        Init();
+
+    Logger::Info("Render queue benchmark: " + std::to_string(drawCount) + " draws, " + std::to_string(pipelineCount) +
+                 " pipelines, " + std::to_string(materialCount) + " materials, " + std::to_string(GetParallelThreadCount()) +
+                 " threads");
+
+    // fake handles, nothing is recorded
+    uint32_t firstPipeline = 0, firstMaterial = 0;
+    for (uint32_t i = 0; i < pipelineCount; i++)
+    {
+        uint32_t id = RegisterPipeline(VK_NULL_HANDLE, VK_NULL_HANDLE);
+        firstPipeline = i == 0 ? id : firstPipeline;
+    }
+    for (uint32_t i = 0; i < materialCount; i++)
+    {
+        uint32_t id = RegisterMaterial(VK_NULL_HANDLE);
+        firstMaterial = i == 0 ? id : firstMaterial;
+    }
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<uint32_t> pipeline(0, pipelineCount - 1);
+    std::uniform_int_distribution<uint32_t> material(0, materialCount - 1);
+    std::uniform_int_distribution<uint32_t> mesh(0, 15);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+    std::vector<RenderDraw> draws(drawCount);
+    for (auto& draw : draws)
+    {
+        draw.pipeline = firstPipeline + pipeline(random);
+        draw.material = firstMaterial + material(random);
+        draw.bTranslucent = (draw.pipeline % 8) == 0; // some pipelines blend
+        draw.depth = depth(random);
+        draw.vertexBuffer = reinterpret_cast<VkBuffer>(static_cast<uintptr_t>(1 + draw.material % 4)); // NOLINT
+        draw.indexBuffer = draw.vertexBuffer;
+        draw.firstIndex = mesh(random) * 36;
+        draw.indexCount = 36;
+    }
+
+    auto submitAll = [&draws]() {
+        BeginFrame();
+        for (const auto& draw : draws)
+            Submit(draw);
+    };
+
+    // submission order, what we had before the queue
+    submitAll();
+    mRenderQueueImpl->MergeSubmissions();
+    mRenderQueueImpl->bSorted = true;
+    mRenderQueueImpl->Record(VK_NULL_HANDLE, 0, drawCount);
+    RenderQueueStatistics unsorted = mRenderQueueImpl->frameStatistics;
+
+    // radix sort
+    double radixMilliseconds = 0.0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        submitAll();
+        mRenderQueueImpl->MergeSubmissions();
+        mRenderQueueImpl->Sort();
+        radixMilliseconds += mRenderQueueImpl->frameStatistics.sortMilliseconds;
+    }
+    std::vector<SortItem> radixSorted = mRenderQueueImpl->sortedDraws;
+
+    // std::sort, for comparison (stable, so the order must be the same)
+    double stdMilliseconds = 0.0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        submitAll();
+        mRenderQueueImpl->MergeSubmissions();
+        auto start = std::chrono::steady_clock::now();
+        std::stable_sort(mRenderQueueImpl->sortedDraws.begin(), mRenderQueueImpl->sortedDraws.end(),
+                         [](const SortItem& a, const SortItem& b) { return a.key < b.key; });
+        stdMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    bool bSameOrder = std::equal(radixSorted.begin(), radixSorted.end(), mRenderQueueImpl->sortedDraws.begin(),
+                                 [](const SortItem& a, const SortItem& b) { return a.key == b.key && a.value == b.value; });
+
+    submitAll();
+    Record(VK_NULL_HANDLE, RENDER_QUEUE_PASS_MAIN);
+    RenderQueueStatistics sorted = mRenderQueueImpl->frameStatistics;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3)
+       << "  radix sort " << radixMilliseconds / iterations << " ms, std::stable_sort " << stdMilliseconds / iterations
+       << " ms" << (bSameOrder ? ", same order" : ", DIFFERENT ORDER");
+    Logger::Info(ss.str());
+
+    auto logBinds = [](const std::string& sName, const RenderQueueStatistics& stats) {
+        Logger::Info("  " + sName + ": " + std::to_string(stats.pipelineBinds) + " pipeline binds, " +
+                     std::to_string(stats.descriptorSetBinds) + " descriptor set binds, " +
+                     std::to_string(stats.vertexBufferBinds + stats.indexBufferBinds) + " buffer binds, " +
+                     std::to_string(stats.skippedBinds) + " skipped");
+    };
+    logBinds("submission order", unsorted);
+    logBinds("sorted", sorted);
+
+    if (bOwnsQueue)
+        Shutdown();
+}
+
+void RenderQueue::RunSubmissionBenchmark()
+{
+    const uint32_t drawCount = 1000000;
+
+    bool bOwnsQueue = mRenderQueueImpl == nullptr;
+    if (bOwnsQueue)
+        Init();
+
+    Logger::Info("Draw submission benchmark: " + std::to_string(drawCount) + " draws split over 1 to 64 threads, " +
+                 std::to_string(std::thread::hardware_concurrency()) + " hardware threads");
+
+    // fake handles, nothing is recorded (one material per thread)
+    RenderDraw draw;
+    draw.pipeline = RegisterPipeline(VK_NULL_HANDLE, VK_NULL_HANDLE);
+    draw.indexCount = 36;
+    glm::mat4 transform(1.0f);
+
+    uint32_t firstMaterial = 0;
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        uint32_t id = RegisterMaterial(VK_NULL_HANDLE);
+        firstMaterial = i == 0 ? id : firstMaterial;
+    }
+
+    for (uint32_t threadCount : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+    {
+        uint32_t drawsPerThread = drawCount / threadCount;
+
+        // runs submit on threadCount threads at once, returns the wall time
+        auto measure = [threadCount](const std::function<void(uint32_t thread)>& submit) {
+            std::atomic<bool> bGo{false};
+            std::vector<std::thread> threads;
+            for (uint32_t t = 0; t < threadCount; t++)
+                threads.emplace_back([&bGo, &submit, t]() {
+                    while (!bGo.load(std::memory_order_acquire))
+                        std::this_thread::yield();
+                    submit(t);
+                });
+
+            auto start = std::chrono::steady_clock::now();
+            bGo.store(true, std::memory_order_release);
+            for (auto& thread : threads)
+                thread.join();
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        // lock-free per thread buffers
+        BeginFrame();
+        double lockFreeMilliseconds = measure([&](uint32_t thread) {
+            RenderDraw threadDraw = draw;
+            for (uint32_t i = 0; i < drawsPerThread; i++)
+            {
+                threadDraw.material = firstMaterial + thread;
+                threadDraw.depth = static_cast<float>(i) / static_cast<float>(drawsPerThread);
+                Submit(threadDraw, &transform, sizeof(transform));
+            }
+        });
+
+        auto start = std::chrono::steady_clock::now();
+        uint32_t merged = mRenderQueueImpl->MergeSubmissions();
+        double mergeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // one shared vector behind a mutex, the obvious alternative
+        std::mutex mutex;
+        std::vector<std::pair<RenderDraw, glm::mat4>> shared;
+        double mutexMilliseconds = measure([&](uint32_t thread) {
+            RenderDraw threadDraw = draw;
+            for (uint32_t i = 0; i < drawsPerThread; i++)
+            {
+                threadDraw.material = firstMaterial + thread;
+                threadDraw.depth = static_cast<float>(i) / static_cast<float>(drawsPerThread);
+                std::lock_guard<std::mutex> lock(mutex);
+                shared.emplace_back(threadDraw, transform);
+            }
+        });
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3) << "  " << threadCount << " threads: lock-free " << lockFreeMilliseconds
+           << " ms + " << mergeMilliseconds << " ms merge (" << merged << " draws), mutex " << mutexMilliseconds << " ms ("
+           << shared.size() << " draws)";
+        Logger::Info(ss.str());
+    }
+
+    BeginFrame();
+
+    if (bOwnsQueue)
+        Shutdown();
+}
+
+//
+// Implementation
+//
+
+SubmissionChunk *SubmissionThreadBuffer::GetChunkWithSpace()
+{
+    if (usedChunks > 0 && chunks[usedChunks - 1]->count < SubmissionChunk::SIZE)
+        return chunks[usedChunks - 1].get();
+
+    // chunks from previous frames are reused, new ones are only allocated when this thread submits more than ever
+    if (usedChunks == chunks.size())
+        chunks.push_back(std::make_unique<SubmissionChunk>());
+
+    SubmissionChunk* chunk = chunks[usedChunks++].get();
+    chunk->count = 0;
+    bSubmittedThisFrame = true;
+    return chunk;
+}
+
+void SubmissionThreadBuffer::Reset()
+{
+    usedChunks = 0;
+    pushConstants.clear();
+}
+
+RenderQueueImpl::RenderQueueImpl()
+{
+    // every queue gets a new generation, so threads never write to the buffers of a destroyed one
+    static std::atomic<uint64_t> nextGeneration{1};
+    generation = nextGeneration++;
+
+    // id 0 means "nothing bound"
+    pipelines.push_back({ VK_NULL_HANDLE, VK_NULL_HANDLE, 0, PipelineHandle{} });
+    materials.push_back({ VK_NULL_HANDLE, 0 });
+    pipelineCount.store(1);
+    materialCount.store(1);
+}
+
+RenderQueueImpl::~RenderQueueImpl()
+{
+    SubmissionThreadBuffer* buffer = threadBuffers.load();
+    while (buffer != nullptr)
+    {
+        SubmissionThreadBuffer* next = buffer->next;
+        delete buffer;
+        buffer = next;
+    }
+}
+
+SubmissionThreadBuffer *RenderQueueImpl::GetThreadBuffer()
+{
+    thread_local SubmissionThreadBuffer* threadBuffer = nullptr;
+    thread_local uint64_t threadBufferGeneration = 0;
+
+    if (threadBuffer != nullptr && threadBufferGeneration == generation)
+        return threadBuffer;
+
+    // first submission of this thread: push a new buffer to the front of the list
+    auto* buffer = new SubmissionThreadBuffer;
+    buffer->next = threadBuffers.load(std::memory_order_relaxed);
+    while (!threadBuffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed));
+
+    threadBuffer = buffer;
+    threadBufferGeneration = generation;
+    return buffer;
+}
+
+uint32_t RenderQueueImpl::MergeSubmissions()
+{
+    ZoneScoped;
+
+    struct BufferMerge
+    {
+        SubmissionThreadBuffer* buffer;
+        uint32_t firstDraw;
+        uint32_t firstPushConstant;
+    };
+
+    // where every thread's draws and push constants go
+    std::vector<BufferMerge> merges;
+    auto drawCount = static_cast<uint32_t>(draws.size());
+    auto pushConstantSize = static_cast<uint32_t>(pushConstants.size());
+
+    for (auto* buffer = threadBuffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next)
+    {
+        if (buffer->usedChunks == 0)
+            continue;
+
+        merges.push_back({ buffer, drawCount, pushConstantSize });
+        for (uint32_t i = 0; i < buffer->usedChunks; i++)
+            drawCount += buffer->chunks[i]->count;
+        pushConstantSize += static_cast<uint32_t>(buffer->pushConstants.size());
+    }
+
+    frameStatistics.rejectedDraws += rejectedDraws.exchange(0);
+
+    auto mergedCount = static_cast<uint32_t>(drawCount - draws.size());
+    if (mergedCount == 0)
+        return 0;
+
+    draws.resize(drawCount);
+    sortedDraws.resize(drawCount);
+    pushConstants.resize(pushConstantSize);
+
+    // threads don't share anything, so their buffers are copied in parallel
+    ParallelFor(static_cast<uint32_t>(merges.size()), 1, [this, &merges](uint32_t begin, uint32_t end) {
+        for (uint32_t m = begin; m < end; m++)
+        {
+            SubmissionThreadBuffer* buffer = merges[m].buffer;
+            uint32_t drawIdx = merges[m].firstDraw;
+
+            for (uint32_t c = 0; c < buffer->usedChunks; c++)
+            {
+                const SubmissionChunk& chunk = *buffer->chunks[c];
+                for (uint32_t i = 0; i < chunk.count; i++, drawIdx++)
+                {
+                    draws[drawIdx] = chunk.draws[i];
+                    draws[drawIdx].pushConstantOffset += merges[m].firstPushConstant;
+                    sortedDraws[drawIdx] = { chunk.keys[i], drawIdx };
+                }
+            }
+
+            if (!buffer->pushConstants.empty())
+                memcpy(pushConstants.data() + merges[m].firstPushConstant, buffer->pushConstants.data(), buffer->pushConstants.size());
+
+            buffer->Reset();
+        }
+    });
+
+    return mergedCount;
+}
+
+void RenderQueueImpl::ResetSubmissions()
+{
+    for (auto* buffer = threadBuffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next)
+    {
+        buffer->Reset();
+
+        if (!buffer->bSubmittedThisFrame)
+        {
+            buffer->chunks.clear();
+            buffer->pushConstants.shrink_to_fit();
+        }
+        buffer->bSubmittedThisFrame = false;
+    }
+}
+
+void RenderQueueImpl::Sort()
+{
+    ZoneScoped;
+
+    auto start = std::chrono::steady_clock::now();
+
+    RadixSort(sortedDraws, sortScratch);
+    bSorted = true;
+
+    frameStatistics.sortMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RenderQueueImpl::Record(VkCommandBuffer commandBuffer, uint32_t first, uint32_t last)
+{
+    // what's bound right now
+    uint32_t boundPipeline = 0;
+    uint32_t boundMaterial = 0;
+    VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+    VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+    VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+    bool bFirstDraw = true;
+
+    // handles are resolved once per pipeline change (draws are sorted by pipeline), not per draw
+    uint32_t resolvedPipeline = 0;
+    GpuPipeline pipeline{};
+    VkShaderStageFlags pushConstantStages = 0;
+    bool bResolved = false;
+
+    auto& stats = frameStatistics;
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        const RenderDraw& draw = draws[sortedDraws[i].value];
+        const RenderQueueMaterial& material = materials[draw.material];
+
+        if (!bResolved || draw.pipeline != resolvedPipeline)
+        {
+            const RenderQueuePipeline& registered = pipelines[draw.pipeline];
+            if (registered.handle.IsNull())
+                pipeline = { registered.pipeline, registered.layout };
+            else
+                pipeline = GpuResources::GetPipeline(registered.handle);
+            pushConstantStages = registered.pushConstantStages;
+
+            resolvedPipeline = draw.pipeline;
+            bResolved = true;
+        }
+
+        // the pipeline was destroyed after its draws were submitted
+        if (commandBuffer != VK_NULL_HANDLE && pipeline.pipeline == VK_NULL_HANDLE)
+        {
+            stats.rejectedDraws++;
+            continue;
+        }
+
+        if (bFirstDraw || draw.pipeline != boundPipeline)
+        {
+            if (commandBuffer != VK_NULL_HANDLE)
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+            boundPipeline = draw.pipeline;
+            stats.pipelineBinds++;
+        } else
+            stats.skippedBinds++;
+
+        // a different layout can disturb the bound sets, so they're bound again
+        if (bFirstDraw || draw.material != boundMaterial || pipeline.layout != boundLayout)
+        {
+            if (commandBuffer != VK_NULL_HANDLE && material.descriptorSet != VK_NULL_HANDLE)
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, material.setIndex,
+                                        1, &material.descriptorSet, 0, nullptr);
+            boundMaterial = draw.material;
+            boundLayout = pipeline.layout;
+            stats.descriptorSetBinds++;
+        } else
+            stats.skippedBinds++;
+
+        if (bFirstDraw || draw.vertexBuffer != boundVertexBuffer)
+        {
+            VkDeviceSize offset = 0;
+            if (commandBuffer != VK_NULL_HANDLE)
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1, &draw.vertexBuffer, &offset);
+            boundVertexBuffer = draw.vertexBuffer;
+            stats.vertexBufferBinds++;
+        } else
+            stats.skippedBinds++;
+
+        if (draw.indexBuffer != VK_NULL_HANDLE)
+        {
+            if (bFirstDraw || draw.indexBuffer != boundIndexBuffer)
+            {
+                if (commandBuffer != VK_NULL_HANDLE)
+                    vkCmdBindIndexBuffer(commandBuffer, draw.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+                boundIndexBuffer = draw.indexBuffer;
+                stats.indexBufferBinds++;
+            } else
+                stats.skippedBinds++;
+        }
+
+        bFirstDraw = false;
+
+        if (commandBuffer == VK_NULL_HANDLE)
+        {
+            stats.draws++;
+            continue;
+        }
+
+        if (draw.pushConstantSize > 0)
+            vkCmdPushConstants(commandBuffer, pipeline.layout, pushConstantStages, 0, draw.pushConstantSize,
+                               pushConstants.data() + draw.pushConstantOffset);
+
+        if (draw.indexBuffer != VK_NULL_HANDLE)
+            vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset,
+                             draw.firstInstance);
+        else
+            vkCmdDraw(commandBuffer, draw.indexCount, draw.instanceCount, static_cast<uint32_t>(draw.vertexOffset),
+                      draw.firstInstance);
+
+        stats.draws++;
+    }
+}
+
+bool RenderQueueImpl::IsRegistered(const RenderDraw &draw) const
+{
+    return draw.pipeline != 0 && draw.pipeline < pipelineCount.load(std::memory_order_acquire) &&
+           draw.material < materialCount.load(std::memory_order_acquire);
+}
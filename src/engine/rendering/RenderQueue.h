@@ -0,0 +1,204 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_RENDERQUEUE_H
+#define VULKAN_ENGINE_RENDERQUEUE_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "GpuResources.h"
+#include "../common/RadixSort.h"
+
+// passes are the most significant part of a sort key, so they come out of the queue in this order
+enum ERenderQueuePass
+{
+    RENDER_QUEUE_PASS_SHADOW,
+    RENDER_QUEUE_PASS_MAIN,
+    RENDER_QUEUE_PASS_UI,
+    RENDER_QUEUE_PASS_COUNT
+};
+
+// Sort key layout, from the most significant bit:
+//   opaque:      pass (4) | layer (8) | 0 | pipeline (12) | material (16) | depth (23, front to back)
+//   translucent: pass (4) | layer (8) | 1 | depth (23, back to front) | pipeline (12) | material (16)
+// so opaque draws are grouped by state and translucent ones are blended in the right order
+struct RenderSortKey
+{
+    static constexpr uint32_t PASS_BITS = 4;
+    static constexpr uint32_t LAYER_BITS = 8;
+    static constexpr uint32_t PIPELINE_BITS = 12;
+    static constexpr uint32_t MATERIAL_BITS = 16;
+    static constexpr uint32_t DEPTH_BITS = 23;
+
+    static constexpr uint32_t PASS_SHIFT = 60;
+    static constexpr uint32_t LAYER_SHIFT = 52;
+    static constexpr uint32_t TRANSLUCENT_SHIFT = 51;
+
+    static constexpr uint32_t MAX_PIPELINES = 1u << PIPELINE_BITS;
+    static constexpr uint32_t MAX_MATERIALS = 1u << MATERIAL_BITS;
+
+    // depth is the normalized view depth (0 = near plane, 1 = far plane)
+    static uint64_t Make(ERenderQueuePass ePass, uint32_t nLayer, bool bTranslucent, uint32_t nPipeline, uint32_t nMaterial,
+                         float fDepth);
+    static ERenderQueuePass GetPass(uint64_t key);
+};
+
+// everything needed to record a draw, pipeline and material are ids returned by RenderQueue::Register*
+struct RenderDraw
+{
+    ERenderQueuePass pass = RENDER_QUEUE_PASS_MAIN;
+    uint32_t layer = 0;
+    bool bTranslucent = false;
+    uint32_t pipeline = 0;
+    uint32_t material = 0;
+    float depth = 0.0f;
+
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;  // without one, indexCount/vertexOffset are the vertex count/first vertex
+    uint32_t indexCount = 0;
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+    uint32_t instanceCount = 1;
+    uint32_t firstInstance = 0;
+
+    // filled in by Submit (slice of the queue's push constant storage)
+    uint32_t pushConstantOffset = 0;
+    uint32_t pushConstantSize = 0;
+};
+
+// either raw Vulkan objects or a GpuResources handle, which is resolved when recording
+struct RenderQueuePipeline
+{
+    VkPipeline pipeline;
+    VkPipelineLayout layout;
+    VkShaderStageFlags pushConstantStages;
+    PipelineHandle handle;
+};
+
+struct RenderQueueMaterial
+{
+    VkDescriptorSet descriptorSet;
+    uint32_t setIndex;
+};
+
+struct RenderQueueStatistics
+{
+    uint32_t draws = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorSetBinds = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t indexBufferBinds = 0;
+    uint32_t skippedBinds = 0; // state that was already bound
+    uint32_t rejectedDraws = 0; // unregistered ids (on submission) or destroyed pipelines (when recording)
+    double sortMilliseconds = 0.0;
+};
+
+// a fixed block of submitted draws, chunks are never moved or freed so appending never copies what's already there
+struct SubmissionChunk
+{
+    static constexpr uint32_t SIZE = 1024;
+
+    RenderDraw draws[SIZE];
+    uint64_t keys[SIZE];
+    uint32_t count = 0;
+};
+
+// Draws submitted by one thread. Only that thread writes to it while submitting, and only the recording thread
+// reads it when merging, so the hot path needs neither locks nor atomics.
+struct SubmissionThreadBuffer
+{
+    SubmissionChunk* GetChunkWithSpace();
+    void Reset();
+
+    std::vector<std::unique_ptr<SubmissionChunk>> chunks; // kept between frames
+    uint32_t usedChunks = 0;
+    std::vector<uint8_t> pushConstants;
+    bool bSubmittedThisFrame = false; // buffers idle for a whole frame (e.g. of threads that exited) give back their memory
+
+    SubmissionThreadBuffer* next = nullptr; // every buffer of the queue, newest first
+};
+
+struct RenderQueueImpl
+{
+    RenderQueueImpl();
+    ~RenderQueueImpl();
+
+    SubmissionThreadBuffer* GetThreadBuffer();
+    uint32_t MergeSubmissions();
+    void ResetSubmissions();
+
+    void Sort();
+    void Record(VkCommandBuffer commandBuffer, uint32_t first, uint32_t last);
+    bool IsRegistered(const RenderDraw& draw) const;
+
+    // one buffer per thread that ever submitted, registered with a lock-free push to the front of the list
+    std::atomic<SubmissionThreadBuffer*> threadBuffers{nullptr};
+    uint64_t generation; // tells threads their cached buffer belongs to an older queue
+
+    std::vector<RenderQueuePipeline> pipelines; // index 0 is "no pipeline"
+    std::vector<RenderQueueMaterial> materials; // index 0 is "no material"
+    // what submitting threads check ids against, updated once the registered entry is in place
+    std::atomic<uint32_t> pipelineCount{0};
+    std::atomic<uint32_t> materialCount{0};
+
+    // draws rejected by Submit since the last merge, warned about once
+    std::atomic<uint32_t> rejectedDraws{0};
+    std::atomic<bool> bWarnedRejectedDraw{false};
+
+    // merged submissions of the frame
+    std::vector<RenderDraw> draws;
+    std::vector<uint8_t> pushConstants;
+    std::vector<SortItem> sortedDraws; // key and index into draws
+    std::vector<SortItem> sortScratch;
+    bool bSorted = false;
+
+    RenderQueueStatistics frameStatistics;
+    RenderQueueStatistics lastFrameStatistics;
+};
+
+// Draws are submitted in any order with a 64 bit sort key, sorted once per frame (parallel radix sort) and then
+// recorded pass by pass. The recorder remembers what's bound and skips pipeline, descriptor set and buffer binds
+// that wouldn't change anything.
+// Any thread can submit: every thread appends to its own chunked buffer, and the buffers are merged when the queue
+// is recorded. Submitting must be done (jobs finished) by then, and must not start before BeginFrame.
+class RenderQueue
+{
+public:
+    static void Init();
+    static void Shutdown();
+
+    // reports the bind counts of the previous frame and clears the queue
+    static void BeginFrame();
+
+    static uint32_t RegisterPipeline(VkPipeline pipeline, VkPipelineLayout layout, VkShaderStageFlags pushConstantStages = 0);
+    // a pipeline owned by GpuResources, returns 0 (no pipeline) for a stale handle
+    // NOTE: The handle is resolved when recording, draws are skipped once the pipeline is destroyed
+    static uint32_t RegisterPipeline(PipelineHandle pipeline, VkShaderStageFlags pushConstantStages = 0);
+    static uint32_t RegisterMaterial(VkDescriptorSet descriptorSet, uint32_t setIndex = 0);
+
+    // thread safe and lock-free, push constants (if any) are copied, so they can live on the stack
+    // draws without a registered pipeline (id 0 included) or with an unregistered material are rejected
+    static void Submit(const RenderDraw& draw, const void* pushConstants = nullptr, uint32_t pushConstantSize = 0);
+
+    // records the draws of one pass in key order, call inside the matching render pass
+    // NOTE: With VK_NULL_HANDLE nothing is recorded, but binds are still counted (used by the benchmark)
+    static void Record(VkCommandBuffer commandBuffer, ERenderQueuePass ePass);
+
+    // draws merged into the queue so far (submissions are merged by Record)
+    static uint32_t GetDrawCount();
+    static const RenderQueueStatistics& GetFrameStatistics();
+    static const RenderQueueStatistics& GetLastFrameStatistics();
+
+    // sorts 100k random draws (radix vs std::sort) and compares the binds of sorted and submission order
+    static void RunBenchmark();
+
+    // submits 1M draws from 1 to 64 threads, against a mutex protected queue
+    static void RunSubmissionBenchmark();
+};
+
+
+#endif //VULKAN_ENGINE_RENDERQUEUE_H
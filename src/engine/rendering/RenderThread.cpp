@@ -0,0 +1,215 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "RenderThread.h"
+#include "FramePacer.h"
+#include "../common/JobSystem.h"
+#include "../profiling/Logger.h"
+#include <Tracy.hpp>
+#include <cstring>
+#include <sstream>
+
+#ifdef TRACY_ENABLE
+#include <common/TracySystem.hpp>
+#endif
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+RenderThreadImpl* mRenderThreadImpl = nullptr;
+
+//
+// Initialization/Destruction
+//
+
+void RenderThread::Start(const std::function<void(const RenderPacket&)>& render)
+{
+    Logger::Info("Starting render thread");
+    mRenderThreadImpl = new RenderThreadImpl(render);
+}
+
+void RenderThread::Stop()
+{
+    if (mRenderThreadImpl == nullptr)
+        return;
+
+    Logger::Info("Stopping render thread");
+    mRenderThreadImpl->Join();
+    mRenderThreadImpl->ReportStatistics();
+    delete mRenderThreadImpl;
+    mRenderThreadImpl = nullptr;
+}
+
+RenderThreadImpl::RenderThreadImpl(std::function<void(const RenderPacket&)> render) : render(std::move(render))
+{
+    thread = std::thread(&RenderThreadImpl::RenderLoop, this);
+}
+
+RenderThreadImpl::~RenderThreadImpl()
+{
+    Join();
+}
+
+//
+// External
+//
+
+bool RenderThread::IsRunning()
+{
+    return mRenderThreadImpl != nullptr;
+}
+
+RenderPacket &RenderThread::BeginPacket()
+{
+    RenderPacket& packet = mRenderThreadImpl->packets.GetWritePacket();
+    packet.Reset();
+    return packet;
+}
+
+void RenderThread::PublishPacket()
+{
+    if (mRenderThreadImpl->packets.Publish())
+        mRenderThreadImpl->dropped++;
+    mRenderThreadImpl->published++;
+
+    // the render thread only holds the lock while checking for a packet, so this never waits on rendering
+    {
+        std::lock_guard<std::mutex> lock(mRenderThreadImpl->wakeMutex);
+    }
+    mRenderThreadImpl->wakeCondition.notify_one();
+}
+
+//
+// Implementation
+//
+
+void RenderThreadImpl::Join()
+{
+    if (!thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        bStop.store(true);
+    }
+    wakeCondition.notify_one();
+
+    // the renderer may be waiting on a GLFW call that has to run here
+    while (!bFinished.load())
+    {
+        JobSystem::ProcessMainThreadJobs();
+        std::this_thread::yield();
+    }
+
+    thread.join();
+}
+
+void RenderThreadImpl::ReportStatistics()
+{
+    latencyStats.Report("Render packet latency");
+    renderStats.Report("Render thread");
+
+    std::stringstream ss;
+    ss << "Render thread: " << published.load() << " packets published, " << rendered.load() << " rendered, "
+       << dropped.load() << " replaced before they were rendered";
+    Logger::Info(ss.str());
+}
+
+void RenderPacket::Reset()
+{
+    frame = 0;
+    tick = 0;
+    interpolationAlpha = 0.0f;
+    time = 0.0;
+    viewProjection = glm::mat4(1.0f);
+    draws.clear();
+    pushConstants.clear();
+}
+
+void RenderPacket::AddDraw(const RenderDraw &draw, const void *pPushConstants, uint32_t pushConstantSize)
+{
+    draws.push_back(draw);
+    draws.back().pushConstantOffset = static_cast<uint32_t>(pushConstants.size());
+    draws.back().pushConstantSize = pPushConstants != nullptr ? pushConstantSize : 0;
+
+    if (pPushConstants != nullptr && pushConstantSize > 0)
+    {
+        pushConstants.resize(pushConstants.size() + pushConstantSize);
+        std::memcpy(pushConstants.data() + draws.back().pushConstantOffset, pPushConstants, pushConstantSize);
+    }
+}
+
+RenderPacketBuffer::RenderPacketBuffer() = default;
+
+RenderPacket &RenderPacketBuffer::GetWritePacket()
+{
+    return mPackets[mWriteIdx];
+}
+
+bool RenderPacketBuffer::Publish()
+{
+    // the written packet becomes the latest one, and we keep writing into the one it replaces
+    uint32_t previous = mLatest.exchange(mWriteIdx | NEW_BIT, std::memory_order_acq_rel);
+    mWriteIdx = previous & INDEX_MASK;
+    return (previous & NEW_BIT) != 0;
+}
+
+bool RenderPacketBuffer::HasNewPacket() const
+{
+    return (mLatest.load(std::memory_order_acquire) & NEW_BIT) != 0;
+}
+
+bool RenderPacketBuffer::Acquire()
+{
+    if (!HasNewPacket())
+        return false;
+
+    // only this thread clears the bit, so what we get back is always a new packet
+    uint32_t latest = mLatest.exchange(mReadIdx, std::memory_order_acq_rel);
+    mReadIdx = latest & INDEX_MASK;
+    return true;
+}
+
+const RenderPacket &RenderPacketBuffer::GetReadPacket() const
+{
+    return mPackets[mReadIdx];
+}
+
+void RenderThreadImpl::RenderLoop()
+{
+#ifdef TRACY_ENABLE
+    tracy::SetThreadName("Render Thread");
+#endif
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait(lock, [this]() { return packets.HasNewPacket() || bStop.load(); });
+        }
+
+        // the last published packet still gets rendered when stopping
+        if (!packets.Acquire())
+        {
+            if (bStop.load())
+                break;
+            continue;
+        }
+
+        const RenderPacket& packet = packets.GetReadPacket();
+        auto start = RenderPacket::Clock::now();
+
+        FramePacer::BeginFrame();
+        render(packet);
+        FramePacer::EndFrame();
+
+        auto end = RenderPacket::Clock::now();
+        renderStats.AddSample(std::chrono::duration<double, std::milli>(end - start).count());
+        latencyStats.AddSample(std::chrono::duration<double, std::milli>(end - packet.simulationStart).count());
+        rendered++;
+
+        FrameMarkNamed("Render");
+    }
+
+    bFinished.store(true);
+}
@@ -0,0 +1,117 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_RENDERTHREAD_H
+#define VULKAN_ENGINE_RENDERTHREAD_H
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RenderQueue.h"
+#include "../profiling/FrameStatistics.h"
+
+// Everything the renderer needs from one simulated frame. The game thread fills it, and once published it's never
+// modified again, so the render thread can read it without locks while the next frame is simulated.
+struct RenderPacket
+{
+    typedef std::chrono::steady_clock Clock;
+
+    void Reset();
+
+    // the push constants are copied into the packet
+    void AddDraw(const RenderDraw& draw, const void* pPushConstants = nullptr, uint32_t pushConstantSize = 0);
+
+    uint64_t frame = 0;
+    uint64_t tick = 0;                  // latest simulation tick
+    float interpolationAlpha = 0.0f;    // how far between the previous and latest tick this packet is
+    double time = 0.0;                  // interpolated simulation time
+
+    glm::mat4 viewProjection{1.0f}; // camera
+
+    // draw lists, submitted to the render queue by the render thread (pushConstantOffset indexes pushConstants)
+    std::vector<RenderDraw> draws;
+    std::vector<uint8_t> pushConstants;
+
+    Clock::time_point simulationStart; // when the game thread started the frame, for the latency
+};
+
+// Lock-free triple buffer: the game thread always has a packet to write and the render thread always has one to
+// read, the third one holds the latest published packet. Publishing swaps the written packet with it, so a packet
+// the render thread didn't pick up in time gets replaced by the newer one (counted as dropped).
+class RenderPacketBuffer
+{
+public:
+    RenderPacketBuffer();
+
+    // game thread
+    RenderPacket& GetWritePacket();
+    bool Publish(); // returns true when it replaced a packet that was never rendered
+
+    // render thread
+    bool HasNewPacket() const;
+    bool Acquire(); // takes the latest packet, if a new one was published
+    const RenderPacket& GetReadPacket() const;
+
+private:
+    static constexpr uint32_t INDEX_MASK = 0x3;
+    static constexpr uint32_t NEW_BIT = 0x4;
+
+    RenderPacket mPackets[3];
+    uint32_t mWriteIdx = 0;
+    uint32_t mReadIdx = 1;
+    std::atomic<uint32_t> mLatest{2}; // index of the latest packet, plus NEW_BIT until it's acquired
+};
+
+struct RenderThreadImpl
+{
+    explicit RenderThreadImpl(std::function<void(const RenderPacket&)> render);
+    ~RenderThreadImpl();
+
+    void RenderLoop();
+    void Join(); // renders the last published packet, then stops
+    void ReportStatistics();
+
+    std::function<void(const RenderPacket&)> render;
+    RenderPacketBuffer packets;
+
+    std::thread thread;
+    std::atomic<bool> bStop{false};
+    std::atomic<bool> bFinished{false};
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+
+    // statistics
+    FrameStatistics latencyStats;   // simulation start to submission, in ms
+    FrameStatistics renderStats;    // CPU time recording and submitting a packet
+    std::atomic<uint32_t> published{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<uint32_t> rendered{0};
+};
+
+// Renders on its own thread, one frame behind the simulation: while the game thread simulates frame N, the render
+// thread records and submits frame N - 1 from its packet. The game thread never waits on it, it just publishes
+// packets as they're done (paced by FramePacer::BeginGameFrame).
+class RenderThread
+{
+public:
+    // render is called on the render thread with every packet it picks up
+    static void Start(const std::function<void(const RenderPacket&)>& render);
+    // renders what's left, joins the thread and reports the latency, runs main thread jobs in the meantime (GLFW calls
+    // from the renderer)
+    static void Stop();
+    static bool IsRunning();
+
+    // game thread: fill the packet, then publish it
+    static RenderPacket& BeginPacket();
+    static void PublishPacket();
+};
+
+
+#endif //VULKAN_ENGINE_RENDERTHREAD_H
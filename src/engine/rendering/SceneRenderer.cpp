@@ -0,0 +1,487 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "SceneRenderer.h"
+#include "EngineRenderer.h"
+#include "RenderQueue.h"
+#include "Shader.h"
+#include "../scenes/SceneSystem.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <Tracy.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+SceneRendererImpl* mSceneRendererImpl = nullptr;
+
+const std::string MESH_VERTEX_SHADER = "assets/shaders/mesh.vert.spv";
+const std::string MESH_FRAGMENT_SHADER = "assets/shaders/indirect.frag.spv"; // only passes the color through
+
+// the camera looks down -Z from this far, layers are placed at z = layer in front of it
+constexpr float SCENE_CAMERA_DISTANCE = 512.0f;
+
+// the world space box around a local box once it's been moved by the transform
+static void TransformBounds(const glm::mat4& transform, const glm::vec3& localMin, const glm::vec3& localMax,
+                            glm::vec3& worldMin, glm::vec3& worldMax)
+{
+    glm::vec3 center = glm::vec3(transform * glm::vec4((localMin + localMax) * 0.5f, 1.0f));
+    glm::vec3 halfSize = (localMax - localMin) * 0.5f;
+    glm::vec3 extent = glm::abs(glm::vec3(transform[0])) * halfSize.x + glm::abs(glm::vec3(transform[1])) * halfSize.y +
+                       glm::abs(glm::vec3(transform[2])) * halfSize.z;
+
+    worldMin = center - extent;
+    worldMax = center + extent;
+}
+
+//
+// Initialization/Destruction
+//
+
+void SceneRenderer::Init()
+{
+    mSceneRendererImpl = new SceneRendererImpl;
+}
+
+void SceneRenderer::Shutdown()
+{
+    delete mSceneRendererImpl;
+    mSceneRendererImpl = nullptr;
+}
+
+//
+// External
+//
+
+void SceneRenderer::Extract(RenderPacket &packet)
+{
+    ZoneScoped;
+
+    SceneRendererImpl* impl = mSceneRendererImpl;
+    if (impl->queuePipeline == 0)
+        return;
+
+    impl->candidates.clear();
+    impl->spheres.Clear();
+
+    // simulated entities are drawn between their last two ticks
+    auto& previousTransforms = SceneSystem::GetRegistry().storage<PreviousTransform>();
+    auto& hierarchyNodes = SceneSystem::GetRegistry().storage<HierarchyNode>();
+    const TransformHierarchy& hierarchy = SceneSystem::GetHierarchy();
+    float alpha = packet.interpolationAlpha;
+
+    SceneSystem::GetMeshGroup().each([&](entt::entity entity, const MeshRenderer& renderer, const Transform& current) {
+        if (!renderer.bVisible)
+            return;
+
+        MeshRange mesh = GeometryBuffer::GetMesh(renderer.mesh);
+        if (!mesh.IsValid())
+            return;
+
+        Transform transform = previousTransforms.contains(entity)
+                ? InterpolateTransform(previousTransforms.get(entity).transform, current, alpha)
+                : current;
+        glm::mat4 world = ComposeTransformMatrix(transform.position, transform.rotation, transform.scale);
+
+        // NOTE: The parent's world matrix is the one of the latest tick, only the entity's own transform is interpolated
+        if (hierarchyNodes.contains(entity))
+        {
+            TransformNodeHandle node = hierarchyNodes.get(entity).node;
+            if (hierarchy.IsValid(node) && hierarchy.GetParent(node.index) != INVALID_TRANSFORM_NODE)
+                world = hierarchy.GetWorldMatrix(hierarchy.GetParent(node.index)) * world;
+        }
+        world[3][2] = static_cast<float>(renderer.layer);
+
+        glm::vec3 localCenter = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+        float localRadius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+        glm::vec3 center;
+        float radius;
+        TransformBoundingSphere(world, glm::vec4(localCenter, localRadius), center, radius);
+
+        impl->spheres.Add(center, radius);
+        impl->candidates.push_back({ world, renderer.color, mesh, renderer.materialId, renderer.layer, renderer.bOccluder });
+    });
+
+    SceneRendererStatistics& statistics = impl->lastStatistics;
+    statistics = SceneRendererStatistics{};
+    statistics.meshes = static_cast<uint32_t>(impl->candidates.size());
+
+    impl->culler.CullSpheres(Frustum::FromViewProjection(packet.viewProjection), impl->spheres, impl->visible);
+    statistics.inFrustum = static_cast<uint32_t>(impl->visible.size());
+
+    impl->CullOccluded(packet.viewProjection);
+    statistics.draws = static_cast<uint32_t>(impl->visible.size());
+
+    VkBuffer vertexBuffer = GeometryBuffer::GetVertexBuffer();
+    VkBuffer indexBuffer = GeometryBuffer::GetIndexBuffer();
+
+    for (uint32_t index : impl->visible)
+    {
+        const SceneMeshDraw& candidate = impl->candidates[index];
+
+        MeshPushConstants constants{};
+        constants.modelViewProjection = packet.viewProjection * candidate.world;
+        constants.color = candidate.color;
+
+        glm::vec4 clip = packet.viewProjection * glm::vec4(impl->spheres.centerX[index], impl->spheres.centerY[index],
+                                                           impl->spheres.centerZ[index], 1.0f);
+
+        RenderDraw draw;
+        draw.layer = static_cast<uint32_t>(std::clamp(candidate.layer, 0, 255));
+        draw.pipeline = impl->queuePipeline;
+        draw.material = candidate.material;
+        draw.depth = clip.w != 0.0f ? std::clamp(clip.z / clip.w, 0.0f, 1.0f) : 0.0f;
+        draw.vertexBuffer = vertexBuffer;
+        draw.indexBuffer = indexBuffer;
+        draw.indexCount = candidate.mesh.indexCount;
+        draw.firstIndex = candidate.mesh.firstIndex;
+        draw.vertexOffset = candidate.mesh.vertexOffset;
+
+        packet.AddDraw(draw, &constants, sizeof(constants));
+    }
+}
+
+const SceneRendererStatistics &SceneRenderer::GetLastStatistics()
+{
+    return mSceneRendererImpl->lastStatistics;
+}
+
+void SceneRenderer::CreateTestScene(uint32_t objectCount)
+{
+    Logger::Info("Creating scene test scene with " + std::to_string(objectCount) + " quads");
+
+    // a unit quad, lighter at the top
+    std::vector<Vertex> vertices = {
+            { glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.6f), glm::vec2(0.0f, 1.0f) },
+            { glm::vec3( 0.5f, -0.5f, 0.0f), glm::vec3(0.6f), glm::vec2(1.0f, 1.0f) },
+            { glm::vec3(-0.5f,  0.5f, 0.0f), glm::vec3(1.0f), glm::vec2(0.0f, 0.0f) },
+            { glm::vec3( 0.5f,  0.5f, 0.0f), glm::vec3(1.0f), glm::vec2(1.0f, 0.0f) }
+    };
+    std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+
+    MeshHandle quad = GeometryBuffer::AddMesh(vertices, indices);
+    if (quad.IsNull())
+    {
+        Logger::Warn("Could not add the scene test scene mesh to the geometry buffer");
+        return;
+    }
+
+    // fixed seed, so every run sees the same scene
+    std::mt19937 random(1337);
+    float extent = std::sqrt(static_cast<float>(objectCount)) * 2.0f;
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> speed(-4.0f, 4.0f);
+    std::uniform_int_distribution<uint32_t> rotation(0, 359);
+    std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+    std::uniform_real_distribution<float> channel(0.2f, 1.0f);
+    std::uniform_int_distribution<int32_t> layer(0, 7);
+
+    auto& registry = SceneSystem::GetRegistry();
+    for (uint32_t i = 0; i < objectCount; i++)
+    {
+        // NOTE: One random number per statement, the evaluation order of function arguments is unspecified
+        Transform transform{};
+        transform.position.x = position(random);
+        transform.position.y = position(random);
+        transform.rotation = rotation(random);
+        transform.scale = glm::vec2(scale(random));
+
+        Velocity velocity;
+        velocity.linear.x = speed(random);
+        velocity.linear.y = speed(random);
+
+        MeshRenderer renderer;
+        renderer.mesh = quad;
+        renderer.color.r = channel(random);
+        renderer.color.g = channel(random);
+        renderer.color.b = channel(random);
+        renderer.layer = layer(random);
+
+        // every 16th quad is a big one above all the others, hiding what's under it
+        if (i % 16 == 0)
+        {
+            transform.scale *= 6.0f;
+            renderer.layer = 8;
+            renderer.bOccluder = true;
+        }
+
+        entt::entity entity = SceneSystem::CreateEntity();
+        registry.emplace<Transform>(entity, transform);
+        registry.emplace<PreviousTransform>(entity, PreviousTransform{ transform });
+        registry.emplace<Velocity>(entity, velocity);
+        registry.emplace<MeshRenderer>(entity, renderer);
+
+        if (!renderer.bOccluder)
+            continue;
+
+        // two small quads riding on the corners of the occluder, moved along by the transform hierarchy
+        SceneSystem::AddToHierarchy(entity);
+        for (float corner : { -0.5f, 0.5f })
+        {
+            MeshRenderer childRenderer;
+            childRenderer.mesh = quad;
+            childRenderer.layer = 9;
+
+            entt::entity child = SceneSystem::CreateEntity();
+            registry.emplace<Transform>(child, Transform{ { corner, 0.5f }, 45, { 0.25f, 0.25f } });
+            registry.emplace<MeshRenderer>(child, childRenderer);
+            SceneSystem::AddToHierarchy(child, entity);
+        }
+    }
+
+    // runs after "Movement" (both write the transforms), so the quads never drift out of the field
+    // NOTE: The previous transform wraps along, otherwise the quad would be drawn sweeping across the whole field
+    SceneSystem::RegisterSystem("Test Scene Wrap", ComponentSet::Of<Velocity>(),
+                                ComponentSet::Of<Transform, PreviousTransform>(), [extent](SceneSystemContext& context, double) {
+        context.ParallelEach<Transform, PreviousTransform, const Velocity>([extent](Transform& transform,
+                                                                                   PreviousTransform& previous,
+                                                                                   const Velocity&) {
+            for (int axis = 0; axis < 2; axis++)
+            {
+                float offset = 0.0f;
+                if (transform.position[axis] > extent)
+                    offset = -extent * 2.0f;
+                else if (transform.position[axis] < -extent)
+                    offset = extent * 2.0f;
+
+                transform.position[axis] += offset;
+                previous.transform.position[axis] += offset;
+            }
+        });
+    });
+
+    mSceneRendererImpl->testMesh = quad;
+    mSceneRendererImpl->testSceneExtent = extent;
+}
+
+bool SceneRenderer::HasTestScene()
+{
+    return mSceneRendererImpl->testSceneExtent > 0.0f;
+}
+
+glm::mat4 SceneRenderer::GetTestSceneViewProjection(double time)
+{
+    float extent = std::max(mSceneRendererImpl->testSceneExtent, 1.0f);
+    auto t = static_cast<float>(time);
+
+    // panning over a quarter of the field, so quads get culled on every side
+    glm::vec2 center(std::cos(t * 0.1f) * extent * 0.5f, std::sin(t * 0.07f) * extent * 0.5f);
+    float halfHeight = extent * 0.25f;
+
+    float aspect = VulkanSwapchain::GetAspectRatio();
+
+    glm::mat4 view = glm::lookAt(glm::vec3(center, SCENE_CAMERA_DISTANCE), glm::vec3(center, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::orthoRH_ZO(-halfHeight * aspect, halfHeight * aspect, -halfHeight, halfHeight, 0.1f,
+                                           SCENE_CAMERA_DISTANCE * 2.0f);
+    projection[1][1] *= -1; // vulkan's Y axis points down
+
+    return projection * view;
+}
+
+std::vector<std::string> SceneRenderer::GetShaderFiles()
+{
+    // the fragment shader is GpuCulling's, which reads it first
+    return { MESH_VERTEX_SHADER };
+}
+
+//
+// Implementation
+//
+
+SceneRendererImpl::SceneRendererImpl()
+{
+    for (uint32_t i = 0; i < 8; i++)
+        boxVertices.emplace_back((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+    boxIndices = {
+            0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+            2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5
+    };
+
+    CreatePipeline();
+
+    if (!pipeline.IsNull())
+        queuePipeline = RenderQueue::RegisterPipeline(pipeline, VK_SHADER_STAGE_VERTEX_BIT);
+}
+
+SceneRendererImpl::~SceneRendererImpl()
+{
+    if (!testMesh.IsNull())
+        GeometryBuffer::RemoveMesh(testMesh);
+
+    // the deletion queue is shut down after us and releases it
+    if (!pipeline.IsNull())
+        GpuResources::DestroyPipeline(pipeline);
+}
+
+void SceneRendererImpl::CullOccluded(const glm::mat4 &viewProjection)
+{
+    ZoneScoped;
+
+    occlusionCuller.BeginFrame(viewProjection);
+
+    tested.clear();
+    testedMins.clear();
+    testedMaxs.clear();
+    for (uint32_t index : visible)
+    {
+        const SceneMeshDraw& candidate = candidates[index];
+        if (candidate.bOccluder)
+        {
+            // the unit box stretched over the mesh bounds
+            glm::mat4 boundsTransform = glm::translate(glm::mat4(1.0f), (candidate.mesh.boundsMin + candidate.mesh.boundsMax) * 0.5f);
+            boundsTransform = glm::scale(boundsTransform, candidate.mesh.boundsMax - candidate.mesh.boundsMin);
+            occlusionCuller.AddOccluder(boxVertices, boxIndices, candidate.world * boundsTransform);
+            lastStatistics.occluders++;
+            continue;
+        }
+
+        glm::vec3 worldMin, worldMax;
+        TransformBounds(candidate.world, candidate.mesh.boundsMin, candidate.mesh.boundsMax, worldMin, worldMax);
+        tested.push_back(index);
+        testedMins.push_back(worldMin);
+        testedMaxs.push_back(worldMax);
+    }
+
+    if (lastStatistics.occluders == 0 || tested.empty())
+        return;
+
+    occlusionCuller.RasterizeOccluders();
+
+    testedVisible.resize(tested.size());
+    occlusionCuller.TestObjects(testedMins.data(), testedMaxs.data(), static_cast<uint32_t>(tested.size()),
+                                testedVisible.data());
+
+    // occluders are never tested (their own depth would hide them), the rest stay in the frustum culler's order
+    uint32_t testedIndex = 0;
+    uint32_t visibleCount = 0;
+    for (uint32_t index : visible)
+    {
+        if (testedIndex < tested.size() && tested[testedIndex] == index)
+        {
+            if (!testedVisible[testedIndex++])
+            {
+                lastStatistics.occluded++;
+                continue;
+            }
+        }
+        visible[visibleCount++] = index;
+    }
+    visible.resize(visibleCount);
+}
+
+void SceneRendererImpl::CreatePipeline()
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(MeshPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    VkShaderModule vertShaderModule = Shader::CreateModule(MESH_VERTEX_SHADER);
+    VkShaderModule fragShaderModule = Shader::CreateModule(MESH_FRAGMENT_SHADER);
+    if (vertShaderModule == VK_NULL_HANDLE || fragShaderModule == VK_NULL_HANDLE)
+    {
+        Logger::Warn("Scene meshes won't be drawn, the mesh shaders are missing");
+        vkDestroyShaderModule(VulkanDevice::GetDevice(), vertShaderModule, nullptr);
+        vkDestroyShaderModule(VulkanDevice::GetDevice(), fragShaderModule, nullptr);
+        return;
+    }
+
+    GpuPipeline meshPipeline{};
+    VK_CHECK(vkCreatePipelineLayout(VulkanDevice::GetDevice(), &pipelineLayoutInfo, nullptr, &meshPipeline.layout));
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+
+    auto bindingDescription = Vertex::getBindingDescription();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // viewport and scissor are set by the renderer when the render pass begins
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE; // meshes don't agree on a winding yet
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    // NOTE: Swap chain recreation keeps the attachment formats, so the new render pass stays compatible
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.pStages = shaderStages.data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = meshPipeline.layout;
+    pipelineInfo.renderPass = VulkanSwapchain::GetRenderPass();
+    pipelineInfo.subpass = 0;
+
+    VK_CHECK(vkCreateGraphicsPipelines(VulkanDevice::GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &meshPipeline.pipeline));
+
+    vkDestroyShaderModule(VulkanDevice::GetDevice(), vertShaderModule, nullptr);
+    vkDestroyShaderModule(VulkanDevice::GetDevice(), fragShaderModule, nullptr);
+
+    pipeline = GpuResources::RegisterPipeline(meshPipeline);
+
+    Logger::Debug("Scene mesh pipeline created");
+}
@@ -0,0 +1,106 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_SCENERENDERER_H
+#define VULKAN_ENGINE_SCENERENDERER_H
+
+#include <vulkan/vulkan.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GeometryBuffer.h"
+#include "GpuResources.h"
+#include "RenderThread.h"
+#include "../culling/FrustumCuller.h"
+#include "../culling/OcclusionCuller.h"
+
+// pushed with every mesh draw (must match the push constants of mesh.vert)
+struct MeshPushConstants
+{
+    glm::mat4 modelViewProjection;
+    glm::vec4 color;
+};
+
+// a scene mesh that may end up in the packet, collected before culling
+struct SceneMeshDraw
+{
+    glm::mat4 world;
+    glm::vec4 color;
+    MeshRange mesh;
+    uint32_t material;
+    int32_t layer;
+    bool bOccluder;
+};
+
+struct SceneRendererStatistics
+{
+    uint32_t meshes = 0;        // visible MeshRenderers with a live mesh
+    uint32_t inFrustum = 0;
+    uint32_t occluders = 0;
+    uint32_t occluded = 0;      // in the frustum, but hidden behind an occluder
+    uint32_t draws = 0;
+};
+
+struct SceneRendererImpl
+{
+    SceneRendererImpl();
+    ~SceneRendererImpl();
+
+    void CreatePipeline();
+    void CullOccluded(const glm::mat4& viewProjection);
+
+    PipelineHandle pipeline;
+    uint32_t queuePipeline = 0; // id in the render queue, 0 when the pipeline couldn't be created
+
+    // kept between frames, so extracting doesn't allocate once the scene stopped growing
+    std::vector<SceneMeshDraw> candidates;
+    BoundingSpheres spheres;    // world space, by candidate
+    std::vector<uint32_t> visible;
+    FrustumCuller culler;
+
+    // occluders are rasterized as their bounding boxes, then the boxes of the other visible meshes are tested
+    OcclusionCuller occlusionCuller;
+    std::vector<glm::vec3> boxVertices; // unit box
+    std::vector<uint32_t> boxIndices;
+    std::vector<uint32_t> tested;       // candidates tested for occlusion
+    std::vector<glm::vec3> testedMins;
+    std::vector<glm::vec3> testedMaxs;
+    std::vector<uint8_t> testedVisible;
+
+    SceneRendererStatistics lastStatistics;
+
+    MeshHandle testMesh;
+    float testSceneExtent = 0.0f;
+};
+
+// Turns the scene's MeshRenderers into render queue draws: every frame the game thread walks the mesh group, frustum
+// culls the meshes against the packet's camera, drops the ones hidden behind occluders and adds what's left to the
+// packet, which the render thread then submits to the RenderQueue to be sorted and recorded.
+// Meshes must come from the GeometryBuffer, layers are spread along Z so higher layers end up on top.
+class SceneRenderer
+{
+public:
+    // needs the render queue, the geometry buffer and the swap chain's render pass
+    static void Init();
+    static void Shutdown();
+
+    // adds the visible meshes of the scene to the packet, seen from packet.viewProjection
+    static void Extract(RenderPacket& packet);
+    // what the last Extract culled
+    static const SceneRendererStatistics& GetLastStatistics();
+
+    // quads drifting over a 2D field for testing/benchmarking and a camera panning over them
+    // NOTE: Only created at init, so these are safe to call from the game thread
+    static void CreateTestScene(uint32_t objectCount);
+    static bool HasTestScene();
+    static glm::mat4 GetTestSceneViewProjection(double time);
+
+    // SPIR-V files loaded by Init, so they can be read ahead of time (see Shader::Preload)
+    static std::vector<std::string> GetShaderFiles();
+};
+
+
+#endif //VULKAN_ENGINE_SCENERENDERER_H
@@ -3,9 +3,29 @@
 //
 
 #include "Shader.h"
+#include "VulkanDevice.h"
+#include "../common/JobSystem.h"
+#include "../profiling/Logger.h"
+#include <mutex>
+#include <unordered_map>
+
+// files read by Preload, waiting for ReadFile
+std::mutex mPreloadMutex;
+std::unordered_map<std::string, std::vector<char>> mPreloadedFiles;
 
 std::vector<char> Shader::ReadFile(const std::string &filename)
 {
+    {
+        std::lock_guard<std::mutex> lock(mPreloadMutex);
+        auto preloaded = mPreloadedFiles.find(filename);
+        if (preloaded != mPreloadedFiles.end())
+        {
+            std::vector<char> buffer = std::move(preloaded->second);
+            mPreloadedFiles.erase(preloaded);
+            return buffer;
+        }
+    }
+
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
     if (!file.is_open())
@@ -22,3 +42,46 @@ std::vector<char> Shader::ReadFile(const std::string &filename)
 
     return buffer;
 }
+
+void Shader::Preload(const std::vector<std::string> &filenames, JobCounter *counter)
+{
+    for (const auto& filename : filenames)
+    {
+        JobSystem::Run([filename]() {
+            std::vector<char> buffer;
+            try
+            {
+                buffer = ReadFile(filename);
+            } catch (const std::runtime_error&)
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mPreloadMutex);
+            mPreloadedFiles[filename] = std::move(buffer);
+        }, counter);
+    }
+}
+
+VkShaderModule Shader::CreateModule(const std::string &filename)
+{
+    std::vector<char> code;
+    try
+    {
+        code = ReadFile(filename);
+    } catch (const std::runtime_error&)
+    {
+        Logger::Warn("Could not read shader " + filename + " (run compile.bat)");
+        return VK_NULL_HANDLE;
+    }
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    VK_CHECK(vkCreateShaderModule(VulkanDevice::GetDevice(), &createInfo, nullptr, &shaderModule));
+
+    return shaderModule;
+}
@@ -10,10 +10,19 @@
 #include <fstream>
 #include <vulkan/vulkan.h>
 
+struct JobCounter;
+
 class Shader
 {
 public:
+    // hands out the preloaded contents when the file was preloaded (only once), reads it otherwise
     static std::vector<char> ReadFile(const std::string& filename);
+
+    // reads the files on the job system ahead of time, files that can't be read are left for ReadFile to report
+    static void Preload(const std::vector<std::string>& filenames, JobCounter* counter);
+
+    // VK_NULL_HANDLE (and a warning) when the SPIR-V file can't be read, the caller destroys the module
+    static VkShaderModule CreateModule(const std::string& filename);
 };
 
 
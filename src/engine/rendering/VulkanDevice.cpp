@@ -4,6 +4,7 @@
 
 #include "VulkanDevice.h"
 #include "../common/Config.h"
+#include "GpuSync.h"
 
 // callback functions
 static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
@@ -24,14 +25,23 @@ VulkanDeviceImpl* mVulkanDeviceImpl = nullptr;
 // Initialization/Destruction
 //
 
-void VulkanDevice::Init()
+void VulkanDevice::CreateInstance()
 {
     mVulkanDeviceImpl = new VulkanDeviceImpl;
 }
 
+void VulkanDevice::Init()
+{
+    if (mVulkanDeviceImpl == nullptr)
+        CreateInstance();
+
+    mVulkanDeviceImpl->CreateDevice();
+}
+
 void VulkanDevice::Shutdown()
 {
     delete mVulkanDeviceImpl;
+    mVulkanDeviceImpl = nullptr;
 }
 
 //
@@ -48,6 +58,67 @@ void VulkanDevice::EndSingleTimeCommands(VkCommandBuffer commandBuffer)
     mVulkanDeviceImpl->EndSingleTimeCommands(commandBuffer);
 }
 
+void VulkanDevice::WaitIdle()
+{
+    vkDeviceWaitIdle(mVulkanDeviceImpl->device);
+}
+
+void VulkanDevice::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                VkBuffer &buffer, VkDeviceMemory &bufferMemory)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // the buffer will only be used by the graphics queue
+
+    VK_CHECK(vkCreateBuffer(mVulkanDeviceImpl->device, &bufferInfo, nullptr, &buffer));
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(mVulkanDeviceImpl->device, buffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = mVulkanDeviceImpl->FindMemoryType(memRequirements.memoryTypeBits, properties);
+
+    VK_CHECK(vkAllocateMemory(mVulkanDeviceImpl->device, &allocInfo, nullptr, &bufferMemory));
+
+    vkBindBufferMemory(mVulkanDeviceImpl->device, buffer, bufferMemory, 0);
+}
+
+void VulkanDevice::UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *data, VkDeviceSize size)
+{
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 stagingBuffer, stagingBufferMemory);
+
+    void* mapped;
+    vkMapMemory(mVulkanDeviceImpl->device, stagingBufferMemory, 0, size, 0, &mapped);
+    memcpy(mapped, data, static_cast<size_t>(size));
+    vkUnmapMemory(mVulkanDeviceImpl->device, stagingBufferMemory);
+
+    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, dstBuffer, 1, &copyRegion);
+
+    EndSingleTimeCommands(commandBuffer);
+
+    vkDestroyBuffer(mVulkanDeviceImpl->device, stagingBuffer, nullptr);
+    vkFreeMemory(mVulkanDeviceImpl->device, stagingBufferMemory, nullptr);
+}
+
+uint32_t VulkanDevice::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    return mVulkanDeviceImpl->FindMemoryType(typeFilter, properties);
+}
+
 VkInstance VulkanDevice::GetInstance()
 {
     return mVulkanDeviceImpl->instance;
@@ -58,6 +129,11 @@ VkCommandPool VulkanDevice::GetCommandPool()
     return mVulkanDeviceImpl->commandPool;
 }
 
+std::mutex &VulkanDevice::GetCommandPoolMutex()
+{
+    return mVulkanDeviceImpl->commandPoolMutex;
+}
+
 VkDevice VulkanDevice::GetDevice()
 {
     return mVulkanDeviceImpl->device;
@@ -93,6 +169,36 @@ uint32_t VulkanDevice::GetPresentQueueFamilyIdx()
     return mVulkanDeviceImpl->presentFamilyIdx.value();
 }
 
+bool VulkanDevice::IsPipelineStatisticsEnabled()
+{
+    return mVulkanDeviceImpl->bPipelineStatisticsEnabled;
+}
+
+bool VulkanDevice::IsSynchronization2Enabled()
+{
+    return mVulkanDeviceImpl->bSynchronization2Enabled;
+}
+
+bool VulkanDevice::IsMultiDrawIndirectEnabled()
+{
+    return mVulkanDeviceImpl->bMultiDrawIndirectEnabled;
+}
+
+bool VulkanDevice::IsDrawIndirectFirstInstanceEnabled()
+{
+    return mVulkanDeviceImpl->bDrawIndirectFirstInstanceEnabled;
+}
+
+bool VulkanDevice::IsDrawIndirectCountEnabled()
+{
+    return mVulkanDeviceImpl->bDrawIndirectCountEnabled;
+}
+
+bool VulkanDevice::IsTimelineSemaphoreEnabled()
+{
+    return mVulkanDeviceImpl->bTimelineSemaphoreEnabled;
+}
+
 SwapChainSupportDetails VulkanDevice::GetSwapChainSupport()
 {
     return mVulkanDeviceImpl->QuerySwapChainSupport(mVulkanDeviceImpl->physicalDevice);
@@ -104,8 +210,15 @@ SwapChainSupportDetails VulkanDevice::GetSwapChainSupport()
 
 VulkanDeviceImpl::VulkanDeviceImpl()
 {
+    bHeadless = Window::IsHeadless();
+
     CreateInstance();
     SetupDebugMessenger();
+    EnumeratePhysicalDevices();
+}
+
+void VulkanDeviceImpl::CreateDevice()
+{
     CreateSurface();
     PickPhysicalDevice();
     CreateLogicalDeviceAndQueues();
@@ -120,7 +233,8 @@ VulkanDeviceImpl::~VulkanDeviceImpl()
 //    if (enableValidationLayers)
 //        DestroyDebugUtilsMesse
 
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (surface != VK_NULL_HANDLE)
+        vkDestroySurfaceKHR(instance, surface, nullptr);
     vkDestroyInstance(instance, nullptr);
 }
 
@@ -138,13 +252,17 @@ void VulkanDeviceImpl::CreateInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(0, 0, 1);
     appInfo.pEngineName = Config::GetEngineVersion().c_str();
     appInfo.engineVersion = VK_MAKE_VERSION(0,0,0);
-    appInfo.apiVersion = VK_MAKE_VERSION(1, 0, VK_HEADER_VERSION);
+    appInfo.apiVersion = ChooseApiVersion();
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
+    // NOTE: Headless mode doesn't need any surface extensions
     auto glfwExtensions = Window::GetRequiredExtensions();
+    if (enableValidationLayers)
+        glfwExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+
     createInfo.enabledExtensionCount = static_cast<uint32_t>(glfwExtensions.size());
     createInfo.ppEnabledExtensionNames = glfwExtensions.data();
 
@@ -175,6 +293,12 @@ void VulkanDeviceImpl::CreateInstance()
 
 void VulkanDeviceImpl::CreateSurface()
 {
+    if (bHeadless)
+    {
+        Logger::Debug("Headless mode, no surface created");
+        return;
+    }
+
     VK_CHECK(glfwCreateWindowSurface(instance, Window::GetWindow(), nullptr, &surface));
     Logger::Debug("Surface created");
 }
@@ -191,7 +315,7 @@ void VulkanDeviceImpl::SetupDebugMessenger()
     }
 }
 
-void VulkanDeviceImpl::PickPhysicalDevice()
+void VulkanDeviceImpl::EnumeratePhysicalDevices()
 {
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
@@ -202,10 +326,21 @@ void VulkanDeviceImpl::PickPhysicalDevice()
         throw std::runtime_error("failed to find GPU's with Vulkan support");
     }
 
-    std::vector<VkPhysicalDevice> devices(deviceCount);
-    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+    physicalDevices.resize(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, physicalDevices.data());
+
+    // the one we use is picked once there's a surface to present to
+    for (const auto& device: physicalDevices)
+    {
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(device, &props);
+        Logger::Debug("Found physical device " + std::string(props.deviceName));
+    }
+}
 
-    for (const auto& device: devices)
+void VulkanDeviceImpl::PickPhysicalDevice()
+{
+    for (const auto& device: physicalDevices)
     {
         if (IsDeviceSuitable(device))
         {
@@ -254,8 +389,12 @@ void VulkanDeviceImpl::CreateLogicalDeviceAndQueues()
             graphicsFamilyIdx = i;
 
         // look for a queue family that has the capability of presenting to our window surface
+        // (in headless mode we never present, so the graphics queue takes that role)
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+        if (bHeadless)
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        else
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
 
         // getting the present queue family index
         if (presentSupport)
@@ -285,9 +424,22 @@ void VulkanDeviceImpl::CreateLogicalDeviceAndQueues()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    // pipeline statistics queries are only used by the GPU profiler, so we only ask for them when they're wanted
+    bPipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery && Config::IsGpuPipelineStatisticsEnabled();
+    deviceFeatures.pipelineStatisticsQuery = bPipelineStatisticsEnabled ? VK_TRUE : VK_FALSE;
+
+    // GPU driven rendering: many draws per indirect call, and per object data fetched through firstInstance
+    bMultiDrawIndirectEnabled = supportedFeatures.multiDrawIndirect;
+    bDrawIndirectFirstInstanceEnabled = supportedFeatures.drawIndirectFirstInstance;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
     // creating the logical device
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -296,8 +448,67 @@ void VulkanDeviceImpl::CreateLogicalDeviceAndQueues()
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    // headless doesn't present, so it doesn't need the swapchain extension
+    std::vector<const char*> enabledExtensions;
+    if (!bHeadless)
+        enabledExtensions = deviceExtensions;
+
+    // optional features are chained into the create info only when the device supports them
+    void* pFeatureChain = nullptr;
+
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+    synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    if (SupportsFeatureQueries() && IsDeviceExtensionSupported(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &synchronization2Features;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        if (synchronization2Features.synchronization2)
+        {
+            enabledExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+            synchronization2Features.pNext = pFeatureChain;
+            pFeatureChain = &synchronization2Features;
+            bSynchronization2Enabled = true;
+        }
+    }
+    Logger::Info(std::string("Synchronization2: ") + (bSynchronization2Enabled ? "enabled" : "not supported"));
+
+    // timeline semaphores are core in 1.2, before that they need the extension
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures{};
+    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    bool bTimelineSemaphoreCore = apiVersion >= VK_API_VERSION_1_2 && GetDeviceApiVersion() >= VK_API_VERSION_1_2;
+    if (Config::IsTimelineSemaphoreEnabled() && SupportsFeatureQueries() &&
+        (bTimelineSemaphoreCore || IsDeviceExtensionSupported(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)))
+    {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &timelineSemaphoreFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        if (timelineSemaphoreFeatures.timelineSemaphore)
+        {
+            if (!bTimelineSemaphoreCore)
+                enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+            timelineSemaphoreFeatures.pNext = pFeatureChain;
+            pFeatureChain = &timelineSemaphoreFeatures;
+            bTimelineSemaphoreEnabled = true;
+        }
+    }
+    Logger::Info(std::string("Timeline semaphores: ") + (bTimelineSemaphoreEnabled ? "enabled" : "not available, using fences"));
+
+    // NOTE: The extension has no feature struct, and it's still exposed by 1.2 devices where the command is core
+    if (IsDeviceExtensionSupported(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+    {
+        enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        bDrawIndirectCountEnabled = true;
+    }
+    Logger::Info(std::string("Draw indirect count: ") + (bDrawIndirectCountEnabled ? "enabled" : "not supported"));
+
+    createInfo.pNext = pFeatureChain;
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.empty() ? nullptr : enabledExtensions.data();
 
     // retro compatibility with older implementations
     if (enableValidationLayers)
@@ -340,7 +551,10 @@ VkCommandBuffer VulkanDeviceImpl::BeginSingleTimeCommands()
     allocInfo.commandBufferCount = 1;
 
     VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+    {
+        std::lock_guard<std::mutex> lock(commandPoolMutex);
+        vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+    }
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -355,16 +569,32 @@ void VulkanDeviceImpl::EndSingleTimeCommands(VkCommandBuffer commandBuffer)
 {
     vkEndCommandBuffer(commandBuffer);
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+    // waiting for this submission only, not for the whole queue to drain
+    GpuSubmission submission;
+    submission.commandBuffers.push_back(commandBuffer);
+    GpuSync::Wait(GpuSync::Submit(QUEUE_GRAPHICS, submission));
 
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
+    std::lock_guard<std::mutex> lock(commandPoolMutex);
     vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
+uint32_t VulkanDeviceImpl::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    // querying info about the available types of memory
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+        if (typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find a suitable memory type");
+}
+
 //
 // Helpers
 //
@@ -465,6 +695,27 @@ SwapChainSupportDetails VulkanDeviceImpl::QuerySwapChainSupport(VkPhysicalDevice
 
 bool VulkanDeviceImpl::IsDeviceSuitable(VkPhysicalDevice device)
 {
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
+
+    // without a surface any device that can do graphics is good enough (software ICDs like lavapipe included)
+    if (bHeadless)
+    {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+        bool hasGraphicsQueue = false;
+        for (const auto& queueFamily : queueFamilies)
+        {
+            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+                hasGraphicsQueue = true;
+        }
+
+        return hasGraphicsQueue && supportedFeatures.samplerAnisotropy;
+    }
+
     bool extensionsSupported = CheckDeviceExtensionSupport(device);
     bool swapChainAdequate = false;
 
@@ -475,12 +726,54 @@ bool VulkanDeviceImpl::IsDeviceSuitable(VkPhysicalDevice device)
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
 
-    VkPhysicalDeviceFeatures supportedFeatures;
-    vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
-
     return extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
 }
 
+uint32_t VulkanDeviceImpl::ChooseApiVersion()
+{
+    // vkEnumerateInstanceVersion doesn't exist on 1.0 loaders, so we have to look it up
+    auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+            vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+
+    uint32_t instanceVersion = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion)
+        enumerateInstanceVersion(&instanceVersion);
+
+    // we only rely on 1.2 at most, extensions cover the rest
+    apiVersion = std::min(instanceVersion, static_cast<uint32_t>(VK_API_VERSION_1_2));
+    return apiVersion;
+}
+
+uint32_t VulkanDeviceImpl::GetDeviceApiVersion()
+{
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    return props.apiVersion;
+}
+
+bool VulkanDeviceImpl::SupportsFeatureQueries()
+{
+    // vkGetPhysicalDeviceFeatures2 is core in 1.1 (both the instance and the device must support it)
+    return apiVersion >= VK_API_VERSION_1_1 && GetDeviceApiVersion() >= VK_API_VERSION_1_1;
+}
+
+bool VulkanDeviceImpl::IsDeviceExtensionSupported(const char *sExtension)
+{
+    uint32_t extensionsCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionsCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionsCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionsCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions)
+    {
+        if (strcmp(extension.extensionName, sExtension) == 0)
+            return true;
+    }
+
+    return false;
+}
+
 bool VulkanDeviceImpl::CheckDeviceExtensionSupport(VkPhysicalDevice device)
 {
     uint32_t extensionsCount;
@@ -6,6 +6,7 @@
 #define VULKAN_ENGINE_VULKANDEVICE_H
 
 #include <vulkan/vulkan.h>
+#include <mutex>
 #include <vector>
 #include <set>
 #include <optional>
@@ -26,9 +27,12 @@ struct VulkanDeviceImpl
     VulkanDeviceImpl();
     ~VulkanDeviceImpl();
 
+    void CreateDevice();
+
     void CreateInstance();
     void SetupDebugMessenger();
     void CreateSurface();
+    void EnumeratePhysicalDevices();
     void PickPhysicalDevice();
     void CreateLogicalDeviceAndQueues();
     void CreateCommandPool();
@@ -42,7 +46,12 @@ struct VulkanDeviceImpl
     VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT *createInfo, const VkAllocationCallbacks *allocator, VkDebugUtilsMessengerEXT *debugMessenger);
 //    void HasGflwRequiredInstanceExtensions();
     bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+    bool IsDeviceExtensionSupported(const char* sExtension);
+    uint32_t ChooseApiVersion();
+    bool SupportsFeatureQueries();
+    uint32_t GetDeviceApiVersion();
     SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
     // command buffer single time commands
     VkCommandBuffer BeginSingleTimeCommands();
@@ -51,14 +60,29 @@ struct VulkanDeviceImpl
     // variables
     VkInstance instance{};
     VkDebugUtilsMessengerEXT debugMessenger{};
+    std::vector<VkPhysicalDevice> physicalDevices; // enumerated with the instance, picked from once there's a surface
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkCommandPool commandPool{};
+    std::mutex commandPoolMutex; // the pool is shared by every thread allocating (or freeing) command buffers
 
     VkDevice device{};
     VkSurfaceKHR surface{};
     VkQueue graphicsQueue{};
     VkQueue presentQueue{};
 
+    // when headless there is no surface, so we don't need presentation support (nor the swapchain extension)
+    bool bHeadless = false;
+
+    uint32_t apiVersion = VK_API_VERSION_1_0;
+
+    // optional features, enabled when the device supports them
+    bool bPipelineStatisticsEnabled = false;
+    bool bSynchronization2Enabled = false;
+    bool bTimelineSemaphoreEnabled = false;
+    bool bMultiDrawIndirectEnabled = false;
+    bool bDrawIndirectFirstInstanceEnabled = false;
+    bool bDrawIndirectCountEnabled = false;
+
     std::optional<uint32_t> graphicsFamilyIdx;
     std::optional<uint32_t> presentFamilyIdx;
 
@@ -70,6 +94,10 @@ struct VulkanDeviceImpl
 class VulkanDevice
 {
 public:
+    // creates the instance and enumerates the physical devices, which doesn't need the window yet, so it can run on
+    // a worker while the rest of the engine starts (the window system must be initialized, see Window::Init)
+    static void CreateInstance();
+    // creates the surface and the device (and the instance, if CreateInstance wasn't called)
     static void Init();
     static void Shutdown();
 
@@ -84,6 +112,8 @@ public:
 
     static VkInstance GetInstance();
     static VkCommandPool GetCommandPool();
+    // held while allocating or freeing command buffers from the pool, which must be externally synchronized
+    static std::mutex& GetCommandPoolMutex();
     static VkDevice GetDevice();
     static VkPhysicalDevice GetPhysicalDevice();
     static VkSurfaceKHR GetSurface();
@@ -91,22 +121,32 @@ public:
     static VkQueue GetPresentQueue();
     static uint32_t GetGraphicsQueueFamilyIdx();
     static uint32_t GetPresentQueueFamilyIdx();
+    static bool IsPipelineStatisticsEnabled();
+    static bool IsSynchronization2Enabled();
+    static bool IsTimelineSemaphoreEnabled();
+    static bool IsMultiDrawIndirectEnabled();
+    static bool IsDrawIndirectFirstInstanceEnabled();
+    static bool IsDrawIndirectCountEnabled();
 
     static SwapChainSupportDetails GetSwapChainSupport();
-//    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    static uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 //    QueueFamilyIndices FindPhysicalQueueFamilies() { return FindQueueFamilies(physicalDevice); }
 //    VkFormat FindSupportedFormat(
 //            const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 //
-//    // Buffer Helper Functions
-//    void CreateBuffer(
-//            VkDeviceSize size,
-//            VkBufferUsageFlags usage,
-//            VkMemoryPropertyFlags properties,
-//            VkBuffer &buffer,
-//            VkDeviceMemory &bufferMemory);
+
+    // Buffer Helper Functions
+    static void CreateBuffer(
+            VkDeviceSize size,
+            VkBufferUsageFlags usage,
+            VkMemoryPropertyFlags properties,
+            VkBuffer &buffer,
+            VkDeviceMemory &bufferMemory);
+    // copies data into a (device local) buffer through a temporary staging buffer, waits for the copy to finish
+    static void UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
     static VkCommandBuffer BeginSingleTimeCommands();
     static void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
+    static void WaitIdle();
 //    void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 //    void CopyBufferToImage(
 //            VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
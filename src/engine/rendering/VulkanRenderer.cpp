@@ -17,6 +17,7 @@
 #include "Shader.h"
 #include "VulkanContext.h"
 #include "../common/Config.h"
+#include "FramePacer.h"
 
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
@@ -56,10 +57,7 @@ void CVulkanRenderer::Draw()
     // TODO: Implement drawing
 //    mVulkanRendererImpl->DrawFrame();
 
-    // TODO: Add tracy zone for vulkan drawing
-//    vkBeginCommandBuffer(cmd, &beginInfo);
-//    TracyVkZone(ctx, cmd, "Render");
-//    vkEndCommandBuffer(cmd);
+    // NOTE: GPU zones (tracy + timestamp queries) are recorded with GPU_PROFILE_SCOPE, see GpuProfiler.h
 }
 
 void CVulkanRenderer::Shutdown()
@@ -300,17 +298,8 @@ VkSurfaceFormatKHR CVulkanRendererImpl::ChooseSwapSurfaceFormat(const std::vecto
 
 VkPresentModeKHR CVulkanRendererImpl::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
 {
-    // checking if triple buffering is available
-    for (const auto& availablePresentMode: availablePresentModes)
-    {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-        {
-            return availablePresentMode;
-        }
-    }
-
-    // if triple buffering is not available, use Vulkan's default swap chain queue (aka VSync)
-    return VK_PRESENT_MODE_FIFO_KHR;
+    // the present mode is user selectable (fifo, mailbox or immediate) through the frame pacer
+    return FramePacer::ChooseVulkanPresentMode(availablePresentModes);
 }
 
 // Swap Extent = resolution of the swap chain images
@@ -4,11 +4,23 @@
 
 #include "VulkanSwapchain.h"
 #include "VulkanDevice.h"
+#include "FramePacer.h"
+#include "DeletionQueue.h"
+#include "GpuSync.h"
+#include <algorithm>
 
 // TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
 //       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
 VulkanSwapChainImpl* mVulkanSwapChainImpl = nullptr;
 
+// written whenever the swap chain is (re)created, read by the game thread while the render thread may be recreating it
+std::atomic<float> mSwapChainAspectRatio{1.0f};
+
+void PublishAspectRatio(VkExtent2D extent)
+{
+    mSwapChainAspectRatio.store(static_cast<float>(extent.width) / static_cast<float>(std::max(extent.height, 1u)));
+}
+
 //
 // Initialization/Destruction
 //
@@ -16,58 +28,149 @@ VulkanSwapChainImpl* mVulkanSwapChainImpl = nullptr;
 void VulkanSwapchain::Init()
 {
     mVulkanSwapChainImpl = new VulkanSwapChainImpl;
+    PublishAspectRatio(mVulkanSwapChainImpl->swapChainExtent);
 }
 
 void VulkanSwapchain::Shutdown()
 {
     delete mVulkanSwapChainImpl;
+    mVulkanSwapChainImpl = nullptr;
+}
+
+void VulkanSwapchain::Recreate()
+{
+    // no need to drain the GPU: the old swap chain's resources go through the deletion queue
+    VulkanSwapChainImpl* previous = mVulkanSwapChainImpl;
+    mVulkanSwapChainImpl = new VulkanSwapChainImpl(previous);
+    delete previous;
+    PublishAspectRatio(mVulkanSwapChainImpl->swapChainExtent);
+}
+
+//
+// External
+//
+
+VkResult VulkanSwapchain::AcquireNextImage(uint32_t *imageIndex)
+{
+    return mVulkanSwapChainImpl->AcquireNextImage(imageIndex);
+}
+
+
+VkResult VulkanSwapchain::SubmitCommandBuffers(const VkCommandBuffer *buffers, const uint32_t *imageIndex)
+{
+    return mVulkanSwapChainImpl->SubmitCommandBuffers(buffers, imageIndex);
+}
+
+uint32_t VulkanSwapchain::GetImageCount()
+{
+    return static_cast<uint32_t>(mVulkanSwapChainImpl->swapChainImages.size());
+}
+
+VkImage VulkanSwapchain::GetImage(uint32_t index)
+{
+    return mVulkanSwapChainImpl->swapChainImages[index];
+}
+
+VkFormat VulkanSwapchain::GetImageFormat()
+{
+    return mVulkanSwapChainImpl->swapChainImageFormat;
+}
+
+VkExtent2D VulkanSwapchain::GetExtent()
+{
+    return mVulkanSwapChainImpl->swapChainExtent;
+}
+
+float VulkanSwapchain::GetAspectRatio()
+{
+    return mSwapChainAspectRatio.load();
+}
+
+VkRenderPass VulkanSwapchain::GetRenderPass()
+{
+    return mVulkanSwapChainImpl->renderPass;
+}
+
+VkFramebuffer VulkanSwapchain::GetFrameBuffer(uint32_t index)
+{
+    return mVulkanSwapChainImpl->swapChainFrameBuffers[index];
 }
 
 //
 // Implementation
 //
 
-VulkanSwapChainImpl::VulkanSwapChainImpl()
+VulkanSwapChainImpl::VulkanSwapChainImpl(VulkanSwapChainImpl* previous)
 {
-    CreateSwapChain();
+    bHeadless = Window::IsHeadless();
+
+    if (bHeadless)
+        CreateOffscreenImages();
+    else
+        CreateSwapChain(previous ? previous->swapChain : VK_NULL_HANDLE);
     CreateImageViews();
     CreateRenderPass();
     CreateDepthResources();
     CreateFramebuffers();
-//    CreateSyncObjects(); // TODO
+
+    if (previous)
+        TakeSyncObjects(previous);
+    else
+        CreateSyncObjects();
 }
 
 VulkanSwapChainImpl::~VulkanSwapChainImpl()
 {
-    Logger::Debug("Destroying swapchain image views");
-    for (auto imageView : swapChainImageViews)
+    // frames still in flight may be using these, so they're released once the last submitted frame has completed
+    // NOTE: Order matters, objects are destroyed in the order they were pushed
+    uint64_t lastUsedFrame = GpuSync::GetLastSubmittedValue(QUEUE_GRAPHICS);
+
+    Logger::Debug("Releasing framebuffers");
+    for (auto frameBuffer : swapChainFrameBuffers)
     {
-        vkDestroyImageView(VulkanDevice::GetDevice(), imageView, nullptr);
+        DeletionQueue::PushFramebuffer(frameBuffer, lastUsedFrame);
     }
-    swapChainImages.clear();
 
-    Logger::Debug("Destroying swapchain");
-    if (swapChain != nullptr)
+    Logger::Debug("Releasing swapchain image views");
+    for (auto imageView : swapChainImageViews)
     {
-        vkDestroySwapchainKHR(VulkanDevice::GetDevice(), swapChain, nullptr);
-        swapChain = nullptr;
+        DeletionQueue::PushImageView(imageView, lastUsedFrame);
     }
 
-    // TODO: Destroy depth images (image view, image and free memory)
-
-    Logger::Debug("Destroying framebuffers");
-    for (auto frameBuffer : swapChainFrameBuffers)
+    // offscreen images are ours to destroy (swapchain images are owned by the swapchain)
+    if (bHeadless)
     {
-        vkDestroyFramebuffer(VulkanDevice::GetDevice(), frameBuffer, nullptr);
+        Logger::Debug("Releasing offscreen images");
+        for (size_t i = 0; i < swapChainImages.size(); i++)
+        {
+            DeletionQueue::PushImage(swapChainImages[i], lastUsedFrame);
+            DeletionQueue::PushMemory(offscreenImageMemories[i], lastUsedFrame);
+        }
     }
+    swapChainImages.clear();
+
+    Logger::Debug("Releasing depth resources");
+    DeletionQueue::PushImageView(depthImageView, lastUsedFrame);
+    DeletionQueue::PushImage(depthImage, lastUsedFrame);
+    DeletionQueue::PushMemory(depthImageMemory, lastUsedFrame);
+
+    Logger::Debug("Releasing swapchain");
+    DeletionQueue::PushSwapchain(swapChain, lastUsedFrame);
+    swapChain = VK_NULL_HANDLE;
 
-    Logger::Debug("Destroying renderpass");
-    vkDestroyRenderPass(VulkanDevice::GetDevice(), renderPass, nullptr);
+    Logger::Debug("Releasing renderpass");
+    DeletionQueue::PushRenderPass(renderPass, lastUsedFrame);
 
-    // TODO: Cleanup synchonization objects (semaphores and fences)
+    // retired swap chains have handed their sync objects over to the new one, so these may be empty
+    Logger::Debug("Releasing synchronization objects");
+    for (size_t i = 0; i < imageAvailableSemaphores.size(); i++)
+    {
+        DeletionQueue::PushSemaphore(renderFinishedSemaphores[i], lastUsedFrame);
+        DeletionQueue::PushSemaphore(imageAvailableSemaphores[i], lastUsedFrame);
+    }
 }
 
-void VulkanSwapChainImpl::CreateSwapChain()
+void VulkanSwapChainImpl::CreateSwapChain(VkSwapchainKHR oldSwapChain)
 {
     SwapChainSupportDetails swapChainSupport = VulkanDevice::GetSwapChainSupport();
 
@@ -121,8 +224,9 @@ void VulkanSwapChainImpl::CreateSwapChain()
 
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE; // we don't care for pixels that are obscured (ex.: another window in front of our own)
-    createInfo.oldSwapchain = VK_NULL_HANDLE; // for now we assume that we'll be creating only one swap chain.
-    // NOTE: Only one swap chain is not the best option because we'd like the screen to be resized, so in the future we'll probably recreate the swap chain ;)
+    // handing the old swap chain over lets the driver reuse its resources and lets us keep presenting the frames
+    // that are still in flight while the new one is created (the old one is retired, not destroyed here)
+    createInfo.oldSwapchain = oldSwapChain;
 
     // effectively creating the swap chain
     VK_CHECK(vkCreateSwapchainKHR(VulkanDevice::GetDevice(), &createInfo, nullptr, &swapChain));
@@ -138,6 +242,30 @@ void VulkanSwapChainImpl::CreateSwapChain()
     Logger::Debug("Swap chain created");
 }
 
+void VulkanSwapChainImpl::CreateOffscreenImages()
+{
+    // without a surface we just create the images we'd otherwise get from the swap chain
+    WindowSize size = Window::GetSize();
+
+    swapChainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    swapChainExtent = { size.width, size.height };
+
+    swapChainImages.resize(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT);
+    offscreenImageMemories.resize(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT);
+
+    for (size_t i = 0; i < swapChainImages.size(); i++)
+    {
+        // VK_IMAGE_USAGE_TRANSFER_SRC_BIT - so we can read the rendered image back to the CPU
+        CreateImage(swapChainExtent.width, swapChainExtent.height,
+                    swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i],
+                    offscreenImageMemories[i]);
+    }
+
+    Logger::Debug("Offscreen images created");
+}
+
 void VulkanSwapChainImpl::CreateImageViews()
 {
     // resizing the list to fit all of the image views
@@ -164,6 +292,10 @@ void VulkanSwapChainImpl::CreateRenderPass()
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // layout of the image before the render pass begins
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // layout to automatically transition the image to when the render pass finishes
 
+    // offscreen images are never presented, we leave them ready to be copied back to the CPU
+    if (bHeadless)
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
     // we'll stick to a single subpass for now (so index 0)
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -261,6 +393,103 @@ void VulkanSwapChainImpl::CreateFramebuffers()
     Logger::Debug("Framebuffers created");
 }
 
+void VulkanSwapChainImpl::CreateSyncObjects()
+{
+    imageAvailableSemaphores.resize(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT);
+    renderFinishedSemaphores.resize(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT);
+    imageSubmissions.resize(swapChainImages.size(), 0);
+    frameSubmissions.resize(VulkanSwapchain::MAX_FRAMES_IN_FLIGHT, 0); // value 0 is always complete, so the first frames don't wait
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (size_t i = 0; i < VulkanSwapchain::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        VK_CHECK(vkCreateSemaphore(VulkanDevice::GetDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]));
+        VK_CHECK(vkCreateSemaphore(VulkanDevice::GetDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]));
+    }
+
+    Logger::Debug("Sync objects created");
+}
+
+void VulkanSwapChainImpl::TakeSyncObjects(VulkanSwapChainImpl *previous)
+{
+    // the frames in flight are still pending, so we continue exactly where the previous swap chain stopped
+    imageAvailableSemaphores = std::move(previous->imageAvailableSemaphores);
+    renderFinishedSemaphores = std::move(previous->renderFinishedSemaphores);
+    frameSubmissions = std::move(previous->frameSubmissions);
+    previous->imageAvailableSemaphores.clear();
+    previous->renderFinishedSemaphores.clear();
+
+    currentFrame = previous->currentFrame;
+
+    // none of the new images has been used yet
+    imageSubmissions.assign(swapChainImages.size(), 0);
+
+    Logger::Debug("Sync objects taken over from the previous swap chain");
+}
+
+VkResult VulkanSwapChainImpl::AcquireNextImage(uint32_t *imageIndex)
+{
+    // waiting for the GPU to finish the last frame that used this slot (CPU <-> GPU)
+    GpuSync::Wait({ QUEUE_GRAPHICS, frameSubmissions[currentFrame] });
+
+    // offscreen images are simply used round-robin
+    if (bHeadless)
+    {
+        *imageIndex = static_cast<uint32_t>(currentFrame % swapChainImages.size());
+        return VK_SUCCESS;
+    }
+
+    return vkAcquireNextImageKHR(VulkanDevice::GetDevice(), swapChain, UINT64_MAX,
+                                 imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, imageIndex);
+}
+
+VkResult VulkanSwapChainImpl::SubmitCommandBuffers(const VkCommandBuffer *buffers, const uint32_t *imageIndex)
+{
+    // make sure no other frame is still using this image
+    GpuSync::Wait({ QUEUE_GRAPHICS, imageSubmissions[*imageIndex] });
+
+    VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
+
+    GpuSubmission submission;
+    submission.commandBuffers.push_back(*buffers);
+
+    // nothing to wait on (or signal) when we don't acquire/present images
+    if (!bHeadless)
+    {
+        submission.binaryWaitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+        submission.binaryWaitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        submission.binarySignalSemaphores.push_back(renderFinishedSemaphores[currentFrame]);
+    }
+
+    GpuSyncPoint submitted = GpuSync::Submit(QUEUE_GRAPHICS, submission);
+    frameSubmissions[currentFrame] = submitted.value;
+    imageSubmissions[*imageIndex] = submitted.value;
+
+    VkResult result = VK_SUCCESS;
+    if (!bHeadless)
+    {
+        // submitting the result back to the swap chain to have it eventually show up on the screen
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = signalSemaphores;
+
+        VkSwapchainKHR swapChains[] = { swapChain };
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = swapChains;
+        presentInfo.pImageIndices = imageIndex;
+
+        result = GpuSync::Present(presentInfo);
+    }
+
+    // advance current frame
+    currentFrame = (currentFrame + 1) % VulkanSwapchain::MAX_FRAMES_IN_FLIGHT;
+
+    return result;
+}
+
 //
 // Helpers
 //
@@ -311,19 +540,23 @@ VkSurfaceFormatKHR VulkanSwapChainImpl::ChooseSwapSurfaceFormat(const std::vecto
 
 VkPresentModeKHR VulkanSwapChainImpl::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes)
 {
-    // checking if triple buffering is available
-    for (const auto& availablePresentMode: availablePresentModes)
+    // the present mode is user selectable (fifo, mailbox or immediate) through the frame pacer
+    VkPresentModeKHR presentMode = FramePacer::ChooseVulkanPresentMode(availablePresentModes);
+
+    switch (presentMode)
     {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-        {
+        case VK_PRESENT_MODE_MAILBOX_KHR:
             Logger::Debug("Present Mode: MAILBOX");
-            return availablePresentMode;
-        }
+            break;
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            Logger::Debug("Present Mode: IMMEDIATE");
+            break;
+        default:
+            Logger::Debug("Present Mode: V-SYNC");
+            break;
     }
 
-    // if triple buffering is not available, use Vulkan's default swap chain queue (aka VSync)
-    Logger::Debug("Present Mode: V-SYNC");
-    return VK_PRESENT_MODE_FIFO_KHR;
+    return presentMode;
 }
 
 VkExtent2D VulkanSwapChainImpl::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities)
@@ -333,7 +566,7 @@ VkExtent2D VulkanSwapChainImpl::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR
         return capabilities.currentExtent;
     } else {
         int width, height;
-        glfwGetFramebufferSize(Window::GetWindow(), &width, &height);
+        Window::GetFramebufferSize(width, height);
 
         VkExtent2D actualExtent = {
                 static_cast<uint32_t>(width),
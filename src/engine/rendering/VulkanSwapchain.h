@@ -12,6 +12,7 @@
 #endif
 
 #include <vulkan/vulkan.h>
+#include <atomic>
 #include <vector>
 #include <iostream>
 #include <array>
@@ -20,15 +21,23 @@
 
 struct VulkanSwapChainImpl
 {
-    VulkanSwapChainImpl();
+    // when recreating, the previous swap chain is handed over as oldSwapchain and its sync objects are taken over,
+    // so the frames it still has in flight keep running
+    explicit VulkanSwapChainImpl(VulkanSwapChainImpl* previous = nullptr);
     ~VulkanSwapChainImpl();
 
-    void CreateSwapChain();
+    void CreateSwapChain(VkSwapchainKHR oldSwapChain);
     void CreateImageViews();
     void CreateRenderPass();
     void CreateDepthResources();
     void CreateFramebuffers();
     void CreateSyncObjects();
+    void TakeSyncObjects(VulkanSwapChainImpl* previous);
+    void CreateOffscreenImages();
+
+    // frame submission
+    VkResult AcquireNextImage(uint32_t* imageIndex);
+    VkResult SubmitCommandBuffers(const VkCommandBuffer* buffers, const uint32_t* imageIndex);
 
     // helpers
     VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
@@ -51,7 +60,7 @@ struct VulkanSwapChainImpl
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
 
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     VkRenderPass renderPass;
 
     VkImage depthImage;
@@ -59,19 +68,42 @@ struct VulkanSwapChainImpl
     VkImageView depthImageView;
 
     std::vector<VkFramebuffer> swapChainFrameBuffers;
+
+    // headless mode renders into images we own instead of the swapchain's
+    bool bHeadless = false;
+    std::vector<VkDeviceMemory> offscreenImageMemories;
+
+    // synchronization
+    std::vector<VkSemaphore> imageAvailableSemaphores;
+    std::vector<VkSemaphore> renderFinishedSemaphores;
+    size_t currentFrame = 0;
+
+    // graphics timeline values (see GpuSync) of the last submission that used each frame slot/image
+    std::vector<uint64_t> frameSubmissions;
+    std::vector<uint64_t> imageSubmissions;
 };
 
+
 class VulkanSwapchain
 {
 public:
     static void Init();
     static void Shutdown();
+    static void Recreate();
 
     static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-    uint32_t imageCount;
 
-    // TODO: Implement
-    static uint32_t GetImageCount() { return 0; }
+    static VkResult AcquireNextImage(uint32_t* imageIndex);
+    static VkResult SubmitCommandBuffers(const VkCommandBuffer* buffers, const uint32_t* imageIndex);
+
+    static uint32_t GetImageCount();
+    static VkImage GetImage(uint32_t index);
+    static VkFormat GetImageFormat();
+    static VkExtent2D GetExtent();
+    // width / height of the latest swap chain, safe to call from any thread (unlike the rest)
+    static float GetAspectRatio();
+    static VkRenderPass GetRenderPass();
+    static VkFramebuffer GetFrameBuffer(uint32_t index);
 };
 
 
@@ -5,25 +5,45 @@
 #include "Window.h"
 #include "../profiling/Logger.h"
 #include "../common/Config.h"
+#include "../common/JobSystem.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 #include <Tracy.hpp>
+#include <chrono>
 
 WindowImpl* mWindowImpl = nullptr;
 
 WindowImpl::WindowImpl(EngineConfig* pConfig)
 {
     window = nullptr;
+    bHeadless = Config::IsHeadless();
+    title = pConfig->gameTitle;
+
+    mWidth = pConfig->windowSize.width;
+    mHeight = pConfig->windowSize.height;
+
+    // in headless mode we render offscreen, so there's no window system to talk to
+    if (bHeadless)
+    {
+        Logger::Info("headless mode, skipping window creation");
+        return;
+    }
 
     Logger::Debug("initializing glfw");
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // tell GLFW to not create a OpenGL context (because we might use Vulkan/DirectX)
 
+    // the icon is decoded on a worker while the window gets created
+    GLFWimage icon{};
+    JobCounter iconCounter;
+    JobSystem::Run([&icon]() {
+        icon.pixels = stbi_load("assets/icons/icon.png", &icon.width, &icon.height, nullptr, STBI_rgb_alpha);
+    }, &iconCounter);
+
     // TODO: Pass engine config here
     Logger::Debug("creating window");
     window = glfwCreateWindow(pConfig->windowSize.width, pConfig->windowSize.height, pConfig->gameTitle.c_str(), nullptr, nullptr);
-    title = pConfig->gameTitle;
 
     if (window == nullptr)
         Logger::Error("failed to create window with GLFW", "window == nullptr");
@@ -36,40 +56,46 @@ WindowImpl::WindowImpl(EngineConfig* pConfig)
 //    glfwSetWindowSizeLimits(window, 480, 320, GLFW_DONT_CARE, GLFW_DONT_CARE);
 //    glfwSetKeyCallback(window, keyCallback);
 
-    mWidth = pConfig->windowSize.width;
-    mHeight = pConfig->windowSize.height;
-
-    loadIcon();
+    JobSystem::Wait(iconCounter);
+    loadIcon(icon);
 }
 
 WindowImpl::~WindowImpl()
 {
+    if (bHeadless)
+        return;
+
     glfwDestroyWindow(mWindowImpl->window);
     glfwTerminate();
 }
 
-void WindowImpl::loadIcon()
+void WindowImpl::loadIcon(GLFWimage& icon)
 {
     Logger::Debug("loading icon");
 
-    GLFWimage icons[1];
-    icons[0].pixels = stbi_load("assets/icons/icon.png", &icons[0].width, &icons[0].height, nullptr, STBI_rgb_alpha);
-
-    if (!icons[0].pixels)
+    if (!icon.pixels)
     {
         throw std::runtime_error("failed to load icon image");
     }
 
-    glfwSetWindowIcon(window, 1, icons);
+    glfwSetWindowIcon(window, 1, &icon);
 
-    stbi_image_free(icons[0].pixels);
+    stbi_image_free(icon.pixels);
 }
 
 bool Window::ShouldCloseWindow()
 {
+    if (mWindowImpl->bHeadless)
+        return false;
+
     return glfwWindowShouldClose(mWindowImpl->window);
 }
 
+bool Window::IsHeadless()
+{
+    return mWindowImpl->bHeadless;
+}
+
 void Window::Init(EngineConfig* pConfig)
 {
     Logger::Info("Initializing window");
@@ -79,6 +105,9 @@ void Window::Init(EngineConfig* pConfig)
 void Window::Update()
 {
     ZoneScopedC(0x2ecc71);
+    if (mWindowImpl->bHeadless)
+        return;
+
     glfwPollEvents();
 }
 
@@ -102,8 +131,20 @@ GLFWwindow *Window::GetWindow()
     return mWindowImpl->window;
 }
 
+void Window::GetFramebufferSize(int &width, int &height)
+{
+    // runs right away on the main thread, other threads (the renderer) wait for the main loop to pick it up
+    JobCounter counter;
+    JobSystem::RunOnMainThread([&]() { glfwGetFramebufferSize(mWindowImpl->window, &width, &height); }, &counter);
+    JobSystem::Wait(counter);
+}
+
 std::vector<const char *> Window::GetRequiredExtensions()
 {
+    // no surface extensions are needed when rendering offscreen
+    if (mWindowImpl->bHeadless)
+        return {};
+
     uint32_t glfwExtensionCount = 0;
     const char** glfwExtensions;
 
@@ -118,6 +159,9 @@ std::vector<const char *> Window::GetRequiredExtensions()
 
 void Window::UpdateFPSInTitle(double fps)
 {
+    if (mWindowImpl->bHeadless)
+        return;
+
     std::stringstream ss;
     ss << mWindowImpl->title << " (FPS: " << fps << ")";
     glfwSetWindowTitle(mWindowImpl->window, ss.str().c_str());
@@ -125,5 +169,12 @@ void Window::UpdateFPSInTitle(double fps)
 
 double Window::GetTime()
 {
+    // glfw is never initialized in headless mode, so we fall back to the standard clock
+    if (mWindowImpl->bHeadless)
+    {
+        using namespace std::chrono;
+        return duration<double>(steady_clock::now().time_since_epoch()).count();
+    }
+
     return glfwGetTime();
 }
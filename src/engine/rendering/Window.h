@@ -16,11 +16,12 @@ struct WindowImpl
     ~WindowImpl();
 
     GLFWwindow* window;
+    bool bHeadless;
 
     uint32_t mWidth, mHeight;
     std::string title;
 
-    void loadIcon();
+    void loadIcon(GLFWimage& icon); // sets the decoded icon and frees it
 };
 
 class Window
@@ -36,8 +37,11 @@ public:
 
     // methods
     static bool ShouldCloseWindow();
+    static bool IsHeadless();
     static WindowSize GetSize();
     static GLFWwindow* GetWindow();
+    // safe to call from any thread, GLFW only allows it on the main thread so it runs there
+    static void GetFramebufferSize(int& width, int& height);
     static void UpdateFPSInTitle(double fps);
     static double GetTime();
 
@@ -0,0 +1,61 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_COMPONENTS_H
+#define VULKAN_ENGINE_COMPONENTS_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include "../common/GameObject.h" // Transform
+#include "../common/HandlePool.h"
+#include "TransformHierarchy.h"
+
+// meshes live in the GeometryBuffer, the scene only keeps their handles
+struct MeshRange;
+typedef THandle<MeshRange> MeshHandle;
+
+// Components of the scene world. They're plain data, EnTT keeps each type packed in its own array.
+// NOTE: Transform lives in common/GameObject.h, it's shared with the GameObject path
+
+// the Transform as it was at the end of the previous tick, the renderer blends the two (see InterpolateTransform)
+// NOTE: Only entities that have one are interpolated, the others are drawn where the latest tick left them
+struct PreviousTransform
+{
+    Transform transform;
+};
+
+// the entity's node in the scene's TransformHierarchy (see SceneSystem::AddToHierarchy), its Transform is the node's
+// local transform and it's drawn with the world matrix of the node
+// NOTE: Destroying the entity destroys the nodes under it too, the child entities keep their (now stale) handle and are
+// drawn without a parent until they're added to the hierarchy again
+struct HierarchyNode
+{
+    TransformNodeHandle node;
+};
+
+struct Velocity
+{
+    glm::vec2 linear{0.0f}; // units per second
+};
+
+struct Sprite
+{
+    uint32_t textureId = 0;
+    glm::vec4 uvRect{0.0f, 0.0f, 1.0f, 1.0f}; // offset (xy) and size (zw) in the texture
+    glm::vec4 color{1.0f};
+    int32_t layer = 0;                          // higher layers are drawn on top
+};
+
+struct MeshRenderer
+{
+    MeshHandle mesh;
+    uint32_t materialId = 0;                    // render queue material, 0 for none
+    glm::vec4 color{1.0f};                      // multiplies the vertex colors
+    int32_t layer = 0;                          // higher layers are drawn on top
+    bool bVisible = true;
+    bool bOccluder = false;                     // its bounding box hides the meshes behind it (see OcclusionCuller)
+};
+
+
+#endif //VULKAN_ENGINE_COMPONENTS_H
@@ -3,13 +3,498 @@
 //
 
 #include "SceneSystem.h"
+#include "../profiling/Logger.h"
+#include <Tracy.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+
+// TODO: Refactor the code so that we don't use raw pointers. Instead we want to use smart pointers
+//       See more here: https://stackoverflow.com/questions/106508/what-is-a-smart-pointer-and-when-should-i-use-one
+SceneSystemImpl* mSceneSystemImpl = nullptr;
+
+//
+// Initialization/Destruction
+//
 
 void SceneSystem::Init()
 {
-    entt::registry registry;
+    Logger::Info("Initializing scene system");
+    mSceneSystemImpl = new SceneSystemImpl();
+
+    // registered first, so it runs before anything else touches the transforms of the tick
+    RegisterSystem("Previous Transforms", ComponentSet::Of<Transform>(), ComponentSet::Of<PreviousTransform>(),
+                   [](SceneSystemContext& context, double) {
+        context.ParallelEach<PreviousTransform, const Transform>([](PreviousTransform& previous, const Transform& transform) {
+            previous.transform = transform;
+        });
+    });
+    RegisterSystem("Movement", ComponentSet::Of<Velocity>(), ComponentSet::Of<Transform>(),
+                   [](SceneSystemContext& context, double fDeltaTime) {
+        float dt = static_cast<float>(fDeltaTime);
+        context.ParallelEach<Transform, const Velocity>([dt](Transform& transform, const Velocity& velocity) {
+            transform.position += velocity.linear * dt;
+        });
+    });
 }
 
 void SceneSystem::Shutdown()
 {
+    Logger::Info("Shutting down scene system");
+    delete mSceneSystemImpl;
+    mSceneSystemImpl = nullptr;
+}
+
+SceneSystemImpl::SceneSystemImpl()
+    : spriteGroup(registry.group<Transform, Sprite>()),
+      meshGroup(registry.group<MeshRenderer>(entt::get<Transform>))
+{
+}
+
+SceneSystemImpl::~SceneSystemImpl() = default;
+
+//
+// External
+//
+
+entt::registry &SceneSystem::GetRegistry()
+{
+    return mSceneSystemImpl->registry;
+}
+
+entt::entity SceneSystem::CreateEntity()
+{
+    return mSceneSystemImpl->registry.create();
+}
+
+void SceneSystem::DestroyEntity(entt::entity entity)
+{
+    auto& registry = mSceneSystemImpl->registry;
+    if (const auto* node = registry.try_get<HierarchyNode>(entity))
+    {
+        // a stale handle means the node went with an ancestor, and its id may belong to another node by now
+        if (mSceneSystemImpl->hierarchy.IsValid(node->node))
+            mSceneSystemImpl->hierarchy.DestroyNode(node->node.index);
+    }
+
+    registry.destroy(entity);
+}
+
+uint32_t SceneSystem::GetEntityCount()
+{
+    return static_cast<uint32_t>(mSceneSystemImpl->registry.alive());
+}
+
+SpriteGroup &SceneSystem::GetSpriteGroup()
+{
+    return mSceneSystemImpl->spriteGroup;
+}
+
+MeshGroup &SceneSystem::GetMeshGroup()
+{
+    return mSceneSystemImpl->meshGroup;
+}
+
+TransformHierarchy &SceneSystem::GetHierarchy()
+{
+    return mSceneSystemImpl->hierarchy;
+}
+
+TransformNodeHandle SceneSystem::AddToHierarchy(entt::entity entity, entt::entity parent)
+{
+    auto& registry = mSceneSystemImpl->registry;
+    TransformHierarchy& hierarchy = mSceneSystemImpl->hierarchy;
+
+    uint32_t parentNode = INVALID_TRANSFORM_NODE;
+    if (parent != entt::null)
+    {
+        const auto* node = registry.try_get<HierarchyNode>(parent);
+        if (node && hierarchy.IsValid(node->node))
+            parentNode = node->node.index;
+    }
+
+    TransformNodeHandle node = hierarchy.GetHandle(hierarchy.CreateNode(registry.get<Transform>(entity), parentNode));
+    registry.emplace_or_replace<HierarchyNode>(entity, HierarchyNode{ node });
+    return node;
+}
+
+uint32_t SceneSystem::RegisterSystem(const std::string &sName, const ComponentSet &reads, const ComponentSet &writes,
+                                     const SceneSystemFunction &function)
+{
+    auto& systems = mSceneSystemImpl->systems;
+    systems.push_back(SceneSystemEntry{ sName, reads, writes, function });
+    return static_cast<uint32_t>(systems.size() - 1);
+}
+
+uint32_t SceneSystem::RegisterExclusiveSystem(const std::string &sName, const SceneSystemFunction &function)
+{
+    auto& systems = mSceneSystemImpl->systems;
+    systems.push_back(SceneSystemEntry{ sName, {}, {}, function, true });
+    return static_cast<uint32_t>(systems.size() - 1);
+}
+
+void SceneSystem::SetSystemEnabled(uint32_t systemId, bool bEnabled)
+{
+    mSceneSystemImpl->systems[systemId].bEnabled = bEnabled;
+}
+
+void SceneSystem::Update(double fDeltaTime)
+{
+    ZoneScoped;
+
+    auto& impl = *mSceneSystemImpl;
+    impl.BuildBatches();
+
+    auto run = [&impl, fDeltaTime](uint32_t systemId) {
+        const auto& system = impl.systems[systemId];
+        ZoneTransientN(zone, system.name.c_str(), true);
+
+        SceneSystemContext context(impl.registry, impl.hierarchy, system);
+        system.function(context, fDeltaTime);
+    };
+
+    for (const auto& batch : impl.batches)
+    {
+        if (batch.size() == 1)
+        {
+            run(batch[0]);
+            continue;
+        }
+
+        JobCounter counter;
+        for (uint32_t systemId : batch)
+            JobSystem::Run([&run, systemId]() { run(systemId); }, &counter);
+        JobSystem::Wait(counter);
+    }
+
+    // only the nodes whose entity moved queue their subtree
+    impl.registry.view<const Transform, const HierarchyNode>().each([&impl](const Transform& transform,
+                                                                           const HierarchyNode& node) {
+        if (!impl.hierarchy.IsValid(node.node))
+            return;
+
+        Transform local = impl.hierarchy.GetLocalTransform(node.node.index);
+        if (local.position != transform.position || local.rotation != transform.rotation || local.scale != transform.scale)
+            impl.hierarchy.SetLocalTransform(node.node.index, transform);
+    });
+
+    impl.hierarchy.Update();
+}
+
+//
+// Implementation
+//
+
+void ComponentSet::Add(entt::id_type id, const std::string &sName)
+{
+    if (Contains(id))
+        return;
+
+    ids.push_back(id);
+    names.push_back(sName);
+}
+
+bool ComponentSet::Contains(entt::id_type id) const
+{
+    return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+bool ComponentSet::Intersects(const ComponentSet &other) const
+{
+    for (entt::id_type id : ids)
+        if (other.Contains(id))
+            return true;
+    return false;
+}
+
+bool SceneSystemEntry::ConflictsWith(const SceneSystemEntry &other) const
+{
+    if (bExclusive || other.bExclusive)
+        return true;
+
+    return writes.Intersects(other.writes) || writes.Intersects(other.reads) || reads.Intersects(other.writes);
+}
+
+void SceneSystemImpl::BuildBatches()
+{
+    // a system goes in the batch right after the last one it conflicts with, so conflicting systems keep their
+    // registration order and everything else runs as early as it can
+    batches.clear();
+    std::vector<uint32_t> systemBatch(systems.size(), 0);
+
+    for (uint32_t systemId = 0; systemId < systems.size(); systemId++)
+    {
+        if (!systems[systemId].bEnabled)
+            continue;
+
+        uint32_t batch = 0;
+        for (const auto& earlierBatch : batches)
+            for (uint32_t earlierId : earlierBatch)
+                if (systems[systemId].ConflictsWith(systems[earlierId]))
+                    batch = std::max(batch, systemBatch[earlierId] + 1);
+
+        if (batch == batches.size())
+            batches.emplace_back();
+        batches[batch].push_back(systemId);
+        systemBatch[systemId] = batch;
+    }
+}
+
+SceneSystemContext::SceneSystemContext(entt::registry &registry, TransformHierarchy &hierarchy,
+                                       const SceneSystemEntry &system)
+    : mRegistry(registry), mHierarchy(hierarchy), mSystem(system)
+{
+}
+
+TransformHierarchy &SceneSystemContext::GetHierarchy()
+{
+    if (enableComponentAccessValidation)
+        Validate<TransformHierarchy>();
+    return mHierarchy;
+}
+
+entt::registry &SceneSystemContext::GetRegistry()
+{
+    if (enableComponentAccessValidation && !mSystem.bExclusive)
+        ReportUndeclaredAccess("the whole registry", true);
+    return mRegistry;
+}
+
+const std::string &SceneSystemContext::GetSystemName() const
+{
+    return mSystem.name;
+}
+
+void SceneSystemContext::ReportUndeclaredAccess(const std::string &sComponent, bool bWrite)
+{
+    std::string sAccess = mSystem.name + (bWrite ? " writes " : " reads ") + sComponent;
+
+    std::lock_guard<std::mutex> lock(mSceneSystemImpl->undeclaredAccessMutex);
+    if (mSceneSystemImpl->reportedAccess.insert(sAccess).second)
+        Logger::Error("Undeclared component access", sAccess);
+}
+
+//
+// Benchmark
+//
+
+// what game objects looked like before the scene world: one heap allocation and one virtual call each
+class BenchmarkGameObject : public GameObject
+{
+public:
+    static constexpr float DELTA_TIME = 1.0f / 60.0f;
+
+    BenchmarkGameObject(const Transform& transform, const glm::vec2& velocity) : transform(transform), velocity(velocity) {}
+
+    void Update() override
+    {
+        transform.position += velocity * DELTA_TIME;
+    }
+
+    Transform transform;
+    glm::vec2 velocity;
+};
+
+void SceneSystem::RunBenchmark()
+{
+    const uint32_t entityCount = 1000000;
+    const uint32_t iterations = 20;
+    const float dt = BenchmarkGameObject::DELTA_TIME;
+
+    Logger::Info("ECS benchmark: moving " + std::to_string(entityCount) + " entities, " + std::to_string(iterations) +
+                 " updates each");
+
+    std::mt19937 random(entityCount);
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> speed(-10.0f, 10.0f);
+
+    // NOTE: Allocated one after the other, so they end up close in memory, the best case for the virtual path
+    std::vector<std::unique_ptr<GameObject>> gameObjects;
+    gameObjects.reserve(entityCount);
+    entt::registry registry;
+
+    for (uint32_t i = 0; i < entityCount; i++)
+    {
+        Transform transform{ { position(random), position(random) }, 0, { 1.0f, 1.0f } };
+        glm::vec2 velocity{ speed(random), speed(random) };
+
+        gameObjects.push_back(std::make_unique<BenchmarkGameObject>(transform, velocity));
+
+        auto entity = registry.create();
+        registry.emplace<Transform>(entity, transform);
+        registry.emplace<Velocity>(entity, Velocity{ velocity });
+        // half of the entities are sprites, so the view has to skip some of them
+        if (i % 2 == 0)
+            registry.emplace<Sprite>(entity);
+    }
+
+    auto measure = [iterations](const std::function<void()>& update) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            update();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+    };
+
+    // every path runs the same updates on the same starting positions, so they must end up in the same place
+    auto checksum = [](const glm::dvec2& sum) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2) << sum.x << ", " << sum.y;
+        return ss.str();
+    };
+
+    double virtualMilliseconds = measure([&]() {
+        for (auto& gameObject : gameObjects)
+            gameObject->Update();
+    });
+    glm::dvec2 virtualSum{0.0};
+    for (auto& gameObject : gameObjects)
+        virtualSum += glm::dvec2(static_cast<BenchmarkGameObject*>(gameObject.get())->transform.position);
+
+    // keeps the registry's state for the group run below
+    std::vector<Transform> startTransforms;
+    startTransforms.reserve(entityCount);
+    registry.view<const Transform>().each([&](const Transform& transform) { startTransforms.push_back(transform); });
+
+    double viewMilliseconds = measure([&]() {
+        registry.view<Transform, const Velocity>().each([dt](Transform& transform, const Velocity& velocity) {
+            transform.position += velocity.linear * dt;
+        });
+    });
+    glm::dvec2 viewSum{0.0};
+    registry.view<const Transform>().each([&](const Transform& transform) { viewSum += glm::dvec2(transform.position); });
+
+    // back to the starting positions, then the owning group packs Transform and Velocity together
+    uint32_t idx = 0;
+    registry.view<Transform>().each([&](Transform& transform) { transform = startTransforms[idx++]; });
+
+    auto group = registry.group<Transform, Velocity>();
+    double groupMilliseconds = measure([&]() {
+        group.each([dt](Transform& transform, const Velocity& velocity) {
+            transform.position += velocity.linear * dt;
+        });
+    });
+    glm::dvec2 groupSum{0.0};
+    group.each([&](const Transform& transform, const Velocity&) { groupSum += glm::dvec2(transform.position); });
+
+    // millions of entities per second
+    auto throughput = [entityCount](double milliseconds) { return entityCount / (milliseconds * 1000.0); };
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3)
+       << "  virtual GameObject::Update: " << virtualMilliseconds << " ms (" << throughput(virtualMilliseconds) << " M/s), positions " << checksum(virtualSum)
+       << "\n  ECS view: " << viewMilliseconds << " ms (" << throughput(viewMilliseconds) << " M/s), positions " << checksum(viewSum)
+       << "\n  ECS owning group: " << groupMilliseconds << " ms (" << throughput(groupMilliseconds) << " M/s), positions " << checksum(groupSum)
+       << "\n  owning group is " << std::setprecision(2) << virtualMilliseconds / groupMilliseconds << "x faster than virtual updates";
+    Logger::Info(ss.str());
+}
+
+void SceneSystem::RunScalingBenchmark()
+{
+    const uint32_t entityCount = 1000000;
+    const uint32_t iterations = 10;
+    const double dt = 1.0 / 60.0;
+
+    bool bOwnsJobSystem = !JobSystem::IsInitialized();
+    uint32_t previousWorkerCount = JobSystem::GetThreadCount() - 1;
+
+    // the benchmark gets its own world, the engine's (if there's one) is put back at the end
+    SceneSystemImpl* previousImpl = mSceneSystemImpl;
+
+    Logger::Info("ECS scaling benchmark: " + std::to_string(entityCount) + " entities, 4 systems in 2 batches, " +
+                 std::to_string(std::thread::hardware_concurrency()) + " hardware threads");
+
+    double baseline = 0.0;
+    glm::dvec2 expectedSum{0.0};
+    uint32_t expectedVisible = 0;
+
+    for (uint32_t threadCount : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+    {
+        JobSystem::Init(threadCount - 1);
+        mSceneSystemImpl = new SceneSystemImpl();
+
+        // batch 1: movement and sprite animation touch different components
+        RegisterSystem("Movement", ComponentSet::Of<Velocity>(), ComponentSet::Of<Transform>(),
+                       [](SceneSystemContext& context, double fDeltaTime) {
+            float dt = static_cast<float>(fDeltaTime);
+            context.ParallelEach<Transform, const Velocity>([dt](Transform& transform, const Velocity& velocity) {
+                transform.position += velocity.linear * dt;
+            });
+        });
+        RegisterSystem("Sprite Animation", {}, ComponentSet::Of<Sprite>(), [](SceneSystemContext& context, double) {
+            context.ParallelEach<Sprite>([](Sprite& sprite) {
+                float phase = static_cast<float>(sprite.layer) * 0.1f + sprite.color.a;
+                sprite.color.r = 0.5f + 0.5f * std::sin(phase);
+                sprite.color.g = 0.5f + 0.5f * std::cos(phase);
+                sprite.color.a = std::fmod(sprite.color.a + 0.01f, 1.0f);
+            });
+        });
+        // batch 2: both need the movement to be done
+        RegisterSystem("Mesh Culling", ComponentSet::Of<Transform>(), ComponentSet::Of<MeshRenderer>(),
+                       [](SceneSystemContext& context, double) {
+            context.ParallelEach<MeshRenderer, const Transform>([](MeshRenderer& mesh, const Transform& transform) {
+                mesh.bVisible = glm::length(transform.position) < 700.0f;
+            });
+        });
+        RegisterSystem("Velocity Damping", {}, ComponentSet::Of<Velocity>(), [](SceneSystemContext& context, double) {
+            context.ParallelEach<Velocity>([](Velocity& velocity) {
+                velocity.linear *= 0.999f;
+            });
+        });
+
+        // same world for every thread count
+        std::mt19937 random(entityCount);
+        std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+        std::uniform_real_distribution<float> speed(-10.0f, 10.0f);
+        auto& registry = mSceneSystemImpl->registry;
+        for (uint32_t i = 0; i < entityCount; i++)
+        {
+            auto entity = registry.create();
+            registry.emplace<Transform>(entity, Transform{ { position(random), position(random) }, 0, { 1.0f, 1.0f } });
+            registry.emplace<Velocity>(entity, Velocity{ { speed(random), speed(random) } });
+            if (i % 2 == 0)
+                registry.emplace<Sprite>(entity).layer = static_cast<int32_t>(i % 16);
+            if (i % 4 == 0)
+                registry.emplace<MeshRenderer>(entity);
+        }
+
+        Update(dt); // warm up
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+            Update(dt);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        glm::dvec2 sum{0.0};
+        registry.view<const Transform>().each([&](const Transform& transform) { sum += glm::dvec2(transform.position); });
+        uint32_t visible = 0;
+        registry.view<const MeshRenderer>().each([&](const MeshRenderer& mesh) { visible += mesh.bVisible ? 1 : 0; });
+
+        if (threadCount == 1)
+        {
+            baseline = milliseconds;
+            expectedSum = sum;
+            expectedVisible = visible;
+        }
+
+        bool bCorrect = sum == expectedSum && visible == expectedVisible;
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3) << "  " << threadCount << " threads: " << milliseconds << " ms per update ("
+           << std::setprecision(2) << baseline / milliseconds << "x), " << visible << " meshes visible"
+           << (bCorrect ? "" : " MISMATCH");
+        Logger::Info(ss.str());
+
+        delete mSceneSystemImpl;
+    }
 
+    mSceneSystemImpl = previousImpl;
+    if (bOwnsJobSystem)
+        JobSystem::Shutdown();
+    else
+        JobSystem::Init(previousWorkerCount);
 }
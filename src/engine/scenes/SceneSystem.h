@@ -6,12 +6,203 @@
 #define VULKAN_ENGINE_SCENESYSTEM_H
 
 #include <entt/entt.hpp>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "Components.h"
+#include "TransformHierarchy.h"
+#include "../common/JobSystem.h"
 
+#ifdef NDEBUG
+const bool enableComponentAccessValidation = false;
+#else
+const bool enableComponentAccessValidation = true;
+#endif
+
+class SceneSystemContext;
+
+// runs once per simulation tick, with the tick duration in seconds
+typedef std::function<void(SceneSystemContext&, double)> SceneSystemFunction;
+
+// component types a system reads or writes
+struct ComponentSet
+{
+    template<typename... Components>
+    static ComponentSet Of()
+    {
+        ComponentSet set;
+        (set.Add(entt::type_hash<std::remove_const_t<Components>>::value(),
+                 std::string(entt::type_name<std::remove_const_t<Components>>::value())), ...);
+        return set;
+    }
+
+    void Add(entt::id_type id, const std::string& sName);
+    bool Contains(entt::id_type id) const;
+    bool Intersects(const ComponentSet& other) const;
+
+    std::vector<entt::id_type> ids;
+    std::vector<std::string> names; // for the logs
+};
+
+struct SceneSystemEntry
+{
+    std::string name;
+    ComponentSet reads;
+    ComponentSet writes;            // writing implies reading
+    SceneSystemFunction function;
+    bool bExclusive = false;        // no declared access, runs alone and can touch the whole registry
+    bool bEnabled = true;
+
+    // both touch a component and at least one of them writes it
+    bool ConflictsWith(const SceneSystemEntry& other) const;
+};
+
+// What a system gets to access the scene. With enableComponentAccessValidation every access is checked against
+// the components the system declared, and undeclared ones are reported.
+class SceneSystemContext
+{
+public:
+    SceneSystemContext(entt::registry& registry, TransformHierarchy& hierarchy, const SceneSystemEntry& system);
+
+    // const components are read, the rest is written
+    template<typename... Components>
+    auto View()
+    {
+        if (enableComponentAccessValidation)
+            (Validate<Components>(), ...);
+        return mRegistry.view<Components...>();
+    }
+
+    template<typename... Components, typename Function>
+    void Each(Function function)
+    {
+        View<Components...>().each(function);
+    }
+
+    // splits the view in chunks processed on the job system, the function gets the components of one entity
+    // NOTE: Don't add or remove components from here, other chunks may be iterating the same storage
+    template<typename... Components, typename Function>
+    void ParallelEach(Function function, uint32_t minChunkSize = 1024)
+    {
+        auto view = View<Components...>();
+        const auto& handle = view.handle(); // the smallest storage, iterated like the view does
+        const entt::entity* entities = handle.data();
+
+        JobSystem::ParallelFor(static_cast<uint32_t>(handle.size()), minChunkSize, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                entt::entity entity = entities[i];
+                if (view.contains(entity))
+                    function(view.template get<Components>(entity)...);
+            }
+        });
+    }
+
+    template<typename Component>
+    Component& Get(entt::entity entity)
+    {
+        if (enableComponentAccessValidation)
+            Validate<Component>();
+        return mRegistry.get<std::remove_const_t<Component>>(entity);
+    }
+
+    // parented transforms, systems using it declare ComponentSet::Of<TransformHierarchy>()
+    TransformHierarchy& GetHierarchy();
+
+    // unchecked access (creating entities, adding components...), only for exclusive systems
+    entt::registry& GetRegistry();
+
+    const std::string& GetSystemName() const;
+
+private:
+    template<typename Component>
+    void Validate()
+    {
+        bool bWrite = !std::is_const_v<Component>;
+        entt::id_type id = entt::type_hash<std::remove_const_t<Component>>::value();
+        if (mSystem.bExclusive || mSystem.writes.Contains(id) || (!bWrite && mSystem.reads.Contains(id)))
+            return;
+
+        ReportUndeclaredAccess(std::string(entt::type_name<std::remove_const_t<Component>>::value()), bWrite);
+    }
+
+    void ReportUndeclaredAccess(const std::string& sComponent, bool bWrite);
+
+    entt::registry& mRegistry;
+    TransformHierarchy& mHierarchy;
+    const SceneSystemEntry& mSystem;
+};
+
+// owning groups for what the renderer iterates every frame, their components are kept packed and in the same order,
+// so iterating them is a linear walk over the arrays
+// NOTE: Groups can't own the same component twice, so the mesh group only owns MeshRenderer and gets the Transform
+// NOTE: Nothing draws the sprite group yet, there's no sprite pipeline (meshes are drawn by SceneRenderer)
+typedef entt::basic_group<entt::entity, entt::owned_t<Transform, Sprite>, entt::get_t<>, entt::exclude_t<>> SpriteGroup;
+typedef entt::basic_group<entt::entity, entt::owned_t<MeshRenderer>, entt::get_t<Transform>, entt::exclude_t<>> MeshGroup;
+
+struct SceneSystemImpl
+{
+    SceneSystemImpl();
+    ~SceneSystemImpl();
+
+    entt::registry registry;
+
+    // created before any entity, so they never have to be rebuilt
+    SpriteGroup spriteGroup;
+    MeshGroup meshGroup;
+
+    TransformHierarchy hierarchy; // world matrices are resolved once every system ran
+
+    std::vector<SceneSystemEntry> systems; // in registration order
+
+    // systems that don't conflict share a batch, batches run one after another
+    void BuildBatches();
+    std::vector<std::vector<uint32_t>> batches;
+
+    std::mutex undeclaredAccessMutex;
+    std::set<std::string> reportedAccess; // each undeclared access is only reported once
+};
+
+// The scene world: entities and their components live in an EnTT registry owned by this system, and registered
+// systems update them every simulation tick. Systems declare the components they read and write, the ones that
+// don't conflict run at the same time on the job system.
 class SceneSystem
 {
 public:
     static void Init();
     static void Shutdown();
+
+    static entt::registry& GetRegistry();
+    static entt::entity CreateEntity();
+    static void DestroyEntity(entt::entity entity);
+    static uint32_t GetEntityCount();
+
+    static SpriteGroup& GetSpriteGroup(); // Transform + Sprite
+    static MeshGroup& GetMeshGroup();     // MeshRenderer + Transform
+    static TransformHierarchy& GetHierarchy();
+    // parents the entity's Transform under the parent entity's node (a root without one), returns the node
+    static TransformNodeHandle AddToHierarchy(entt::entity entity, entt::entity parent = entt::null);
+
+    // conflicting systems run in the order they were registered, returns the system id
+    // e.g. RegisterSystem("Movement", ComponentSet::Of<Velocity>(), ComponentSet::Of<Transform>(), ...)
+    static uint32_t RegisterSystem(const std::string& sName, const ComponentSet& reads, const ComponentSet& writes,
+                                   const SceneSystemFunction& function);
+    // without declarations, the system runs alone
+    static uint32_t RegisterExclusiveSystem(const std::string& sName, const SceneSystemFunction& function);
+    static void SetSystemEnabled(uint32_t systemId, bool bEnabled);
+
+    // runs every enabled system, then updates the world matrices of the hierarchy from the changed entity transforms,
+    // called once per simulation tick
+    static void Update(double fDeltaTime);
+
+    // iterating 1M entities in the registry against virtual GameObject::Update calls
+    static void RunBenchmark();
+    // frame time of a synthetic 1M entity scene with 1 to 64 threads
+    static void RunScalingBenchmark();
 };
 
 
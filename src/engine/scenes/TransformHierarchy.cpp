@@ -0,0 +1,472 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#include "TransformHierarchy.h"
+#include "../common/Simd.h"
+#include "../profiling/Logger.h"
+#include <Tracy.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+// local matrices are built this many nodes at a time, then multiplied with their parents'
+const uint32_t LOCAL_MATRIX_BATCH = 64;
+
+// parent * local, adds the products in the same order glm does so both give the same result
+// NOTE: SSE2 is part of x86-64, so this one doesn't need a runtime check
+static void MultiplyMatrix(const glm::mat4& parent, const glm::mat4& local, glm::mat4& result)
+{
+#if SIMD_X86
+    const float* a = &parent[0][0];
+    const float* b = &local[0][0];
+    float* r = &result[0][0];
+
+    __m128 a0 = _mm_loadu_ps(a);
+    __m128 a1 = _mm_loadu_ps(a + 4);
+    __m128 a2 = _mm_loadu_ps(a + 8);
+    __m128 a3 = _mm_loadu_ps(a + 12);
+
+    for (uint32_t column = 0; column < 4; column++)
+    {
+        const float* bColumn = b + column * 4;
+        __m128 sum = _mm_mul_ps(a0, _mm_set1_ps(bColumn[0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(bColumn[1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(bColumn[2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(bColumn[3])));
+        _mm_storeu_ps(r + column * 4, sum);
+    }
+#else
+    result = parent * local;
+#endif
+}
+
+TransformHierarchy::TransformHierarchy() = default;
+
+//
+// External
+//
+
+uint32_t TransformHierarchy::CreateNode(const Transform &local, uint32_t parent)
+{
+    uint32_t node;
+    if (!mFreeNodes.empty())
+    {
+        node = mFreeNodes.back();
+        mFreeNodes.pop_back();
+    } else
+    {
+        node = static_cast<uint32_t>(mParents.size());
+        mParents.push_back(INVALID_TRANSFORM_NODE);
+        mFirstChildren.push_back(INVALID_TRANSFORM_NODE);
+        mNextSiblings.push_back(INVALID_TRANSFORM_NODE);
+        mNodeIndices.push_back(0);
+        mQueued.push_back(0);
+        mAlive.push_back(0);
+        mGenerations.push_back(0);
+    }
+
+    mParents[node] = INVALID_TRANSFORM_NODE;
+    mFirstChildren[node] = INVALID_TRANSFORM_NODE;
+    mNextSiblings[node] = INVALID_TRANSFORM_NODE;
+    mAlive[node] = 1;
+    mNodeCount++;
+
+    // appended for now, Update moves it under its parent
+    mNodeIndices[node] = static_cast<uint32_t>(mIndexNodes.size());
+    mIndexNodes.push_back(node);
+    mParentIndices.push_back(INVALID_TRANSFORM_NODE);
+    mSubtreeSizes.push_back(1);
+    mPositions.push_back(local.position);
+    mRotations.push_back(local.rotation);
+    mScales.push_back(local.scale);
+    mWorldMatrices.emplace_back(1.0f);
+
+    if (parent != INVALID_TRANSFORM_NODE && IsValid(parent))
+    {
+        Link(node, parent);
+        mOrderDirty = true;
+    }
+
+    QueueNode(node);
+    return node;
+}
+
+void TransformHierarchy::DestroyNode(uint32_t node)
+{
+    if (!IsValid(node))
+        return;
+
+    Unlink(node);
+
+    // the array slots are dropped by the next reorder
+    std::vector<uint32_t> stack = { node };
+    while (!stack.empty())
+    {
+        uint32_t current = stack.back();
+        stack.pop_back();
+
+        for (uint32_t child = mFirstChildren[current]; child != INVALID_TRANSFORM_NODE; child = mNextSiblings[child])
+            stack.push_back(child);
+
+        mAlive[current] = 0;
+        mGenerations[current]++;
+        mParents[current] = INVALID_TRANSFORM_NODE;
+        mFirstChildren[current] = INVALID_TRANSFORM_NODE;
+        mFreeNodes.push_back(current);
+        mNodeCount--;
+    }
+
+    mOrderDirty = true;
+}
+
+bool TransformHierarchy::IsValid(uint32_t node) const
+{
+    return node < mAlive.size() && mAlive[node] != 0;
+}
+
+TransformNodeHandle TransformHierarchy::GetHandle(uint32_t node) const
+{
+    if (!IsValid(node))
+        return {};
+
+    return TransformNodeHandle{ node, mGenerations[node] };
+}
+
+bool TransformHierarchy::IsValid(TransformNodeHandle node) const
+{
+    return IsValid(node.index) && mGenerations[node.index] == node.generation;
+}
+
+bool TransformHierarchy::SetParent(uint32_t node, uint32_t parent)
+{
+    if (!IsValid(node) || (parent != INVALID_TRANSFORM_NODE && (!IsValid(parent) || IsAncestor(node, parent))))
+        return false;
+
+    if (mParents[node] == parent)
+        return true;
+
+    Unlink(node);
+    if (parent != INVALID_TRANSFORM_NODE)
+        Link(node, parent);
+
+    mOrderDirty = true;
+    QueueNode(node);
+    return true;
+}
+
+uint32_t TransformHierarchy::GetParent(uint32_t node) const
+{
+    return mParents[node];
+}
+
+void TransformHierarchy::SetLocalTransform(uint32_t node, const Transform &local)
+{
+    uint32_t idx = mNodeIndices[node];
+    mPositions[idx] = local.position;
+    mRotations[idx] = local.rotation;
+    mScales[idx] = local.scale;
+    QueueNode(node);
+}
+
+Transform TransformHierarchy::GetLocalTransform(uint32_t node) const
+{
+    uint32_t idx = mNodeIndices[node];
+    return Transform{ mPositions[idx], mRotations[idx], mScales[idx] };
+}
+
+const glm::mat4 &TransformHierarchy::GetWorldMatrix(uint32_t node) const
+{
+    return mWorldMatrices[mNodeIndices[node]];
+}
+
+uint32_t TransformHierarchy::Update()
+{
+    if (mQueuedNodes.empty() && !mOrderDirty)
+        return 0;
+
+    ZoneScoped;
+
+    if (mOrderDirty)
+        Reorder();
+
+    std::vector<uint32_t> queuedIndices;
+    queuedIndices.reserve(mQueuedNodes.size());
+    for (uint32_t node : mQueuedNodes)
+    {
+        mQueued[node] = 0;
+        if (IsValid(node))
+            queuedIndices.push_back(mNodeIndices[node]);
+    }
+    mQueuedNodes.clear();
+
+    // a subtree is a range, so a queued node inside a range that's already recomputed is skipped
+    std::sort(queuedIndices.begin(), queuedIndices.end());
+
+    uint32_t updated = 0;
+    uint32_t coveredEnd = 0;
+    for (uint32_t idx : queuedIndices)
+    {
+        if (idx < coveredEnd)
+            continue;
+
+        coveredEnd = idx + mSubtreeSizes[idx];
+        UpdateRange(idx, coveredEnd);
+        updated += coveredEnd - idx;
+    }
+
+    TracyPlot("Transform Hierarchy Updated", static_cast<int64_t>(updated));
+    return updated;
+}
+
+uint32_t TransformHierarchy::GetNodeCount() const
+{
+    return mNodeCount;
+}
+
+//
+// Implementation
+//
+
+void TransformHierarchy::Reorder()
+{
+    ZoneScoped;
+
+    // depth-first from every root, roots keep the order they had
+    std::vector<uint32_t> order;
+    order.reserve(mNodeCount);
+    std::vector<uint32_t> stack;
+
+    for (uint32_t idx = 0; idx < mIndexNodes.size(); idx++)
+    {
+        uint32_t root = mIndexNodes[idx];
+        // slots of destroyed nodes (or of ids that were reused since) are dropped
+        if (!IsValid(root) || mNodeIndices[root] != idx || mParents[root] != INVALID_TRANSFORM_NODE)
+            continue;
+
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            uint32_t node = stack.back();
+            stack.pop_back();
+            order.push_back(node);
+
+            for (uint32_t child = mFirstChildren[node]; child != INVALID_TRANSFORM_NODE; child = mNextSiblings[child])
+                stack.push_back(child);
+        }
+    }
+
+    uint32_t count = static_cast<uint32_t>(order.size());
+    std::vector<uint32_t> parentIndices(count);
+    std::vector<uint32_t> subtreeSizes(count, 1);
+    std::vector<glm::vec2> positions(count);
+    std::vector<uint32_t> rotations(count);
+    std::vector<glm::vec2> scales(count);
+    std::vector<glm::mat4> worldMatrices(count);
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        uint32_t node = order[idx];
+        uint32_t previousIdx = mNodeIndices[node];
+        positions[idx] = mPositions[previousIdx];
+        rotations[idx] = mRotations[previousIdx];
+        scales[idx] = mScales[previousIdx];
+        worldMatrices[idx] = mWorldMatrices[previousIdx];
+    }
+
+    // parents come first, so their new index is known by the time we get to the children
+    for (uint32_t idx = 0; idx < count; idx++)
+        mNodeIndices[order[idx]] = idx;
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        uint32_t parent = mParents[order[idx]];
+        parentIndices[idx] = parent != INVALID_TRANSFORM_NODE ? mNodeIndices[parent] : INVALID_TRANSFORM_NODE;
+    }
+    for (uint32_t idx = count; idx-- > 0;)
+        if (parentIndices[idx] != INVALID_TRANSFORM_NODE)
+            subtreeSizes[parentIndices[idx]] += subtreeSizes[idx];
+
+    mIndexNodes = std::move(order);
+    mParentIndices = std::move(parentIndices);
+    mSubtreeSizes = std::move(subtreeSizes);
+    mPositions = std::move(positions);
+    mRotations = std::move(rotations);
+    mScales = std::move(scales);
+    mWorldMatrices = std::move(worldMatrices);
+    mOrderDirty = false;
+}
+
+void TransformHierarchy::UpdateRange(uint32_t begin, uint32_t end)
+{
+    glm::mat4 localMatrices[LOCAL_MATRIX_BATCH];
+
+    for (uint32_t batchBegin = begin; batchBegin < end; batchBegin += LOCAL_MATRIX_BATCH)
+    {
+        uint32_t batchEnd = std::min(batchBegin + LOCAL_MATRIX_BATCH, end);
+
+        for (uint32_t idx = batchBegin; idx < batchEnd; idx++)
+            localMatrices[idx - batchBegin] = ComposeTransformMatrix(mPositions[idx], mRotations[idx], mScales[idx]);
+
+        // in order, so a parent in the same batch is already done
+        for (uint32_t idx = batchBegin; idx < batchEnd; idx++)
+        {
+            uint32_t parentIdx = mParentIndices[idx];
+            if (parentIdx == INVALID_TRANSFORM_NODE)
+                mWorldMatrices[idx] = localMatrices[idx - batchBegin];
+            else
+                MultiplyMatrix(mWorldMatrices[parentIdx], localMatrices[idx - batchBegin], mWorldMatrices[idx]);
+        }
+    }
+}
+
+void TransformHierarchy::QueueNode(uint32_t node)
+{
+    if (mQueued[node])
+        return;
+
+    mQueued[node] = 1;
+    mQueuedNodes.push_back(node);
+}
+
+bool TransformHierarchy::IsAncestor(uint32_t ancestor, uint32_t node) const
+{
+    for (uint32_t current = node; current != INVALID_TRANSFORM_NODE; current = mParents[current])
+        if (current == ancestor)
+            return true;
+    return false;
+}
+
+void TransformHierarchy::Unlink(uint32_t node)
+{
+    uint32_t parent = mParents[node];
+    if (parent == INVALID_TRANSFORM_NODE)
+        return;
+
+    if (mFirstChildren[parent] == node)
+    {
+        mFirstChildren[parent] = mNextSiblings[node];
+    } else
+    {
+        uint32_t sibling = mFirstChildren[parent];
+        while (mNextSiblings[sibling] != node)
+            sibling = mNextSiblings[sibling];
+        mNextSiblings[sibling] = mNextSiblings[node];
+    }
+
+    mParents[node] = INVALID_TRANSFORM_NODE;
+    mNextSiblings[node] = INVALID_TRANSFORM_NODE;
+}
+
+void TransformHierarchy::Link(uint32_t node, uint32_t parent)
+{
+    mParents[node] = parent;
+    mNextSiblings[node] = mFirstChildren[parent];
+    mFirstChildren[parent] = node;
+}
+
+//
+// Benchmark
+//
+
+void TransformHierarchy::RunBenchmark()
+{
+    // hands of cards with a few decorations each
+    const uint32_t rootCount = 10000;
+    const uint32_t childrenPerRoot = 9;
+    const uint32_t grandchildrenPerChild = 10;
+
+    TransformHierarchy hierarchy;
+    std::vector<uint32_t> roots;
+    std::vector<uint32_t> nodes;
+
+    auto measure = [&hierarchy](uint32_t& updated) {
+        auto start = std::chrono::steady_clock::now();
+        updated = hierarchy.Update();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    uint32_t counter = 0;
+    auto makeTransform = [&counter]() {
+        counter++;
+        return Transform{ { static_cast<float>(counter % 97), static_cast<float>(counter % 89) }, (counter * 7) % 360,
+                          { 1.0f + static_cast<float>(counter % 5) * 0.1f, 1.0f } };
+    };
+
+    // created in the worst order, children before their siblings' children, so the first update has to reorder
+    for (uint32_t r = 0; r < rootCount; r++)
+        roots.push_back(hierarchy.CreateNode(makeTransform()));
+    std::vector<uint32_t> children;
+    for (uint32_t root : roots)
+        for (uint32_t c = 0; c < childrenPerRoot; c++)
+            children.push_back(hierarchy.CreateNode(makeTransform(), root));
+    for (uint32_t child : children)
+        for (uint32_t g = 0; g < grandchildrenPerChild; g++)
+            nodes.push_back(hierarchy.CreateNode(makeTransform(), child));
+
+    Logger::Info("Transform hierarchy benchmark: " + std::to_string(hierarchy.GetNodeCount()) + " nodes, " +
+                 std::to_string(rootCount) + " roots, 3 levels");
+
+    uint32_t firstUpdated = 0;
+    double firstMilliseconds = measure(firstUpdated);
+
+    // every root moved
+    for (uint32_t root : roots)
+    {
+        Transform local = hierarchy.GetLocalTransform(root);
+        local.position.x += 1.0f;
+        hierarchy.SetLocalTransform(root, local);
+    }
+    uint32_t fullUpdated = 0;
+    double fullMilliseconds = measure(fullUpdated);
+
+    // 1% of the roots moved, plus some single leaves
+    for (uint32_t r = 0; r < rootCount; r += 100)
+    {
+        Transform local = hierarchy.GetLocalTransform(roots[r]);
+        local.rotation = (local.rotation + 15) % 360;
+        hierarchy.SetLocalTransform(roots[r], local);
+    }
+    for (uint32_t n = 0; n < nodes.size(); n += 1000)
+        hierarchy.SetLocalTransform(nodes[n], makeTransform());
+    uint32_t partialUpdated = 0;
+    double partialMilliseconds = measure(partialUpdated);
+
+    // nothing moved
+    const uint32_t idleIterations = 1000;
+    uint32_t idleUpdated = 0;
+    auto idleStart = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < idleIterations; i++)
+        idleUpdated += hierarchy.Update();
+    double idleMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - idleStart).count() / idleIterations;
+
+    // every 997th node against the same chain of glm multiplies, walking up to the root
+    bool bMatches = true;
+    for (uint32_t n = 0; n < nodes.size(); n += 997)
+    {
+        std::vector<uint32_t> chain;
+        for (uint32_t node = nodes[n]; node != INVALID_TRANSFORM_NODE; node = hierarchy.GetParent(node))
+            chain.push_back(node);
+
+        glm::mat4 world(1.0f);
+        for (size_t i = chain.size(); i-- > 0;)
+        {
+            Transform local = hierarchy.GetLocalTransform(chain[i]);
+            glm::mat4 localMatrix = ComposeTransformMatrix(local.position, local.rotation, local.scale);
+            world = i + 1 == chain.size() ? localMatrix : world * localMatrix;
+        }
+
+        if (world != hierarchy.GetWorldMatrix(nodes[n]))
+            bMatches = false;
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3)
+       << "  first update (reorder + all): " << firstMilliseconds << " ms, " << firstUpdated << " matrices"
+       << "\n  every root moved: " << fullMilliseconds << " ms, " << fullUpdated << " matrices"
+       << "\n  1% of the roots and 0.1% of the leaves moved: " << partialMilliseconds << " ms, " << partialUpdated << " matrices"
+       << "\n  nothing moved: " << idleMicroseconds << " us, " << idleUpdated << " matrices"
+       << "\n  world matrices " << (bMatches ? "match" : "DO NOT MATCH") << " glm";
+    Logger::Info(ss.str());
+}
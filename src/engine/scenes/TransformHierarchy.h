@@ -0,0 +1,93 @@
+//
+// Created by Diego S. Seabra on 19/10/26.
+//
+
+#ifndef VULKAN_ENGINE_TRANSFORMHIERARCHY_H
+#define VULKAN_ENGINE_TRANSFORMHIERARCHY_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "../common/GameObject.h" // Transform
+#include "../common/HandlePool.h"
+
+const uint32_t INVALID_TRANSFORM_NODE = ~0u;
+
+// node id plus the generation of its slot, for references kept outside the hierarchy (see HierarchyNode): a destroyed
+// node's id is reused by the next CreateNode, the generation tells the two apart
+class TransformHierarchy;
+typedef THandle<TransformHierarchy> TransformNodeHandle;
+
+// Parented transforms (card stacks, hands, UI panels...). Nodes are kept in depth-first order in contiguous arrays,
+// one per attribute, so a parent always comes before its children and a whole subtree is a single range.
+// Changing a node queues it, and Update only recomputes the world matrices of the queued subtrees: when nothing
+// moved, it returns right away.
+// Node ids stay the same when the arrays are reordered.
+class TransformHierarchy
+{
+public:
+    TransformHierarchy();
+
+    // parent is INVALID_TRANSFORM_NODE for a root, returns the node id
+    uint32_t CreateNode(const Transform& local, uint32_t parent = INVALID_TRANSFORM_NODE);
+    // destroys the node and every node under it
+    void DestroyNode(uint32_t node);
+    bool IsValid(uint32_t node) const;
+    // a null handle for an invalid node
+    TransformNodeHandle GetHandle(uint32_t node) const;
+    // false once the node was destroyed, even if its id was reused since
+    bool IsValid(TransformNodeHandle node) const;
+
+    // returns false (and changes nothing) if the parent is the node itself or one of its children
+    bool SetParent(uint32_t node, uint32_t parent);
+    uint32_t GetParent(uint32_t node) const;
+
+    void SetLocalTransform(uint32_t node, const Transform& local);
+    Transform GetLocalTransform(uint32_t node) const;
+
+    // valid after Update
+    const glm::mat4& GetWorldMatrix(uint32_t node) const;
+
+    // reorders the arrays if nodes were created, destroyed or reparented, then recomputes the world matrices of the
+    // changed subtrees, returns how many were recomputed
+    uint32_t Update();
+
+    uint32_t GetNodeCount() const;
+
+    // full update, a few moved subtrees and a frame where nothing moved, on 1M nodes
+    static void RunBenchmark();
+
+private:
+    void Reorder();
+    void UpdateRange(uint32_t begin, uint32_t end);
+    void QueueNode(uint32_t node);
+    bool IsAncestor(uint32_t ancestor, uint32_t node) const;
+    void Unlink(uint32_t node);
+    void Link(uint32_t node, uint32_t parent);
+
+    // by node id: the tree, and where the node is in the arrays below
+    std::vector<uint32_t> mParents;
+    std::vector<uint32_t> mFirstChildren;
+    std::vector<uint32_t> mNextSiblings;
+    std::vector<uint32_t> mNodeIndices;
+    std::vector<uint8_t> mQueued;
+    std::vector<uint8_t> mAlive;
+    std::vector<uint32_t> mGenerations;    // bumped when the node is destroyed
+    std::vector<uint32_t> mFreeNodes;
+    uint32_t mNodeCount = 0;
+
+    // by index, depth-first
+    std::vector<uint32_t> mIndexNodes;     // node id at that index
+    std::vector<uint32_t> mParentIndices;  // INVALID_TRANSFORM_NODE for roots
+    std::vector<uint32_t> mSubtreeSizes;   // the node and everything under it
+    std::vector<glm::vec2> mPositions;
+    std::vector<uint32_t> mRotations;
+    std::vector<glm::vec2> mScales;
+    std::vector<glm::mat4> mWorldMatrices;
+
+    std::vector<uint32_t> mQueuedNodes;    // changed since the last update
+    bool mOrderDirty = false;
+};
+
+
+#endif //VULKAN_ENGINE_TRANSFORMHIERARCHY_H